@@ -0,0 +1,192 @@
+/// @file fanout_bench.cc
+/// @brief 进程内扇出基准: 推流端和拉流端都通过 socketpair 接入服务器 (RtmpServer::AdoptConnection),
+///        不占用端口也不经过 TCP 协议栈, 结果只包含服务器的解析, 转发和排队开销, 重复性好
+///        每次推一帧后等待所有拉流端收到, 输出每帧的墙上时间和整个进程的 CPU 时间
+///        用法: ./fanout_bench [--players=1000] [--frames=3000] [--frame-size=20000]
+///              [--threads=1] [--client-threads=1]
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "LatencyHistogram.h"
+#include "RtmpClient.h"
+#include "RtmpPublisher.h"
+#include "RtmpServer.h"
+#include "TestHelper.h"
+
+namespace {
+
+const char *kUrl = "rtmp://127.0.0.1/bench/fanout";
+
+struct Options {
+  int players = 1000;
+  int frames = 3000;
+  uint32_t frame_size = 20000;
+  int threads = 1;         // 服务器 EventLoop 线程数
+  int client_threads = 1;  // 推流端和拉流端共用的 EventLoop 线程数
+};
+
+bool ParseArg(const char *arg, const char *name, std::string &value) {
+  size_t len = strlen(name);
+  if (strncmp(arg, name, len) == 0 && arg[len] == '=') {
+    value = arg + len + 1;
+    return true;
+  }
+  return false;
+}
+
+Options ParseOptions(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    std::string value;
+    if (ParseArg(argv[i], "--players", value)) {
+      opt.players = atoi(value.c_str());
+    } else if (ParseArg(argv[i], "--frames", value)) {
+      opt.frames = atoi(value.c_str());
+    } else if (ParseArg(argv[i], "--frame-size", value)) {
+      opt.frame_size = (uint32_t)atoi(value.c_str());
+    } else if (ParseArg(argv[i], "--threads", value)) {
+      opt.threads = atoi(value.c_str());
+    } else if (ParseArg(argv[i], "--client-threads", value)) {
+      opt.client_threads = atoi(value.c_str());
+    } else {
+      fprintf(stderr, "unknown option: %s\n", argv[i]);
+    }
+  }
+  if (opt.players < 0) opt.players = 0;
+  if (opt.frames <= 0) opt.frames = 3000;
+  if (opt.frame_size < 16) opt.frame_size = 16;
+  if (opt.threads <= 0) opt.threads = 1;
+  if (opt.client_threads <= 0) opt.client_threads = 1;
+  return opt;
+}
+
+int64_t CpuMicros() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (int64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+         usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+// 创建一对已连接的 socket, 一端交给服务器, 另一端返回给客户端
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt = ParseOptions(argc, argv);
+
+  EventLoop server_loop(opt.threads);
+  auto server = RtmpServer::Create(&server_loop);
+  server->SetChunkSize(60000);
+  server->SetGopCache();  // 和 rtmp_server 一致, 新的拉流端从 GOP 缓存起播
+
+  std::string status;
+  EventLoop client_loop(opt.client_threads);
+  auto publisher = RtmpPublisher::Create(&client_loop);
+  publisher->SetChunkSize(60000);
+  publisher->SetMediaInfo(TestMediaInfo());
+  if (publisher->OpenSocket(AdoptPair(server), kUrl, 3000, status) != 0) {
+    fprintf(stderr, "publish failed: %s\n", status.c_str());
+    return 1;
+  }
+
+  std::vector<uint8_t> frame(opt.frame_size, 0xab);
+  frame[0] = 0;
+  frame[1] = 0;
+  frame[2] = 0;
+  frame[3] = 1;
+  frame[4] = 0x65;  // 先推一个 IDR, 拉流端起播时收到 GOP 缓存
+  publisher->PushVideoFrame(frame.data(), opt.frame_size);
+
+  std::atomic<uint64_t> received(0);
+  std::vector<std::shared_ptr<RtmpClient>> players;
+  auto open_start = std::chrono::steady_clock::now();
+  for (int i = 0; i < opt.players; i++) {
+    auto client = RtmpClient::Create(&client_loop);
+    client->SetRecvFrameCB([&received](uint8_t *payload, uint32_t, uint8_t codec_id, uint32_t) {
+      if (codec_id == RTMP_CODEC_ID_H264 && payload[1] == 1) {  // 不计序列头
+        received.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+    if (client->OpenSocket(AdoptPair(server), kUrl, 3000, status) != 0) {
+      fprintf(stderr, "play %d failed: %s\n", i, status.c_str());
+      return 1;
+    }
+    players.push_back(client);
+  }
+  double open_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                             open_start).count();
+
+  // 会话在下一帧到来时才给新的拉流端发送序列头和 GOP 缓存, 推一帧预热,
+  // 等每个拉流端都收到 GOP 中的帧和这一帧后开始计数
+  frame[4] = 0x41;
+  publisher->PushVideoFrame(frame.data(), opt.frame_size);
+  auto warmup_end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (received.load() < 2 * (uint64_t)opt.players) {
+    if (std::chrono::steady_clock::now() > warmup_end) {
+      fprintf(stderr, "warm up timeout, received %llu\n", (unsigned long long)received.load());
+      return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));  // 预热帧同时在 GOP 中, 可能多收一次
+  received = 0;
+
+  LatencyHistogram frame_ns;
+  uint64_t timeouts = 0;
+  int64_t cpu_start = CpuMicros();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < opt.frames; i++) {  // 只推 P 帧, 不改变 GOP 缓存的大小
+    uint64_t expected = (uint64_t)(i + 1) * opt.players;
+    auto begin = std::chrono::steady_clock::now();
+    publisher->PushVideoFrame(frame.data(), opt.frame_size);
+
+    // 自旋等待所有拉流端收到, 单帧超过 1 秒认为丢失
+    while (received.load(std::memory_order_relaxed) < expected) {
+      if (std::chrono::steady_clock::now() - begin > std::chrono::seconds(1)) {
+        timeouts++;
+        break;
+      }
+      std::this_thread::yield();
+    }
+    frame_ns.Record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                             begin).count());
+  }
+  double wall_us =
+      std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  int64_t cpu_us = CpuMicros() - cpu_start;
+  uint64_t delivered = received.load();
+
+  for (auto &client : players) {
+    client->Close();
+  }
+  publisher->Close();
+  server->Stop();
+
+  LatencyHistogram::Snapshot h = frame_ns.GetSnapshot();
+  uint64_t fanout = delivered > 0 ? delivered : 1;
+  printf("{\"benchmark\":\"fanout\",\"transport\":\"socketpair\",\"players\":%d,\"frames\":%d,"
+         "\"frame_size\":%u,\"threads\":%d,\"open_ms\":%.1f,\"delivered\":%llu,\"timeouts\":%llu,"
+         "\"wall_us_per_frame\":%.2f,\"cpu_us_per_frame\":%.2f,\"cpu_ns_per_delivery\":%.1f,"
+         "\"frame_p50_us\":%.1f,\"frame_p99_us\":%.1f,\"frame_max_us\":%.1f}\n",
+         opt.players, opt.frames, opt.frame_size, opt.threads, open_ms,
+         (unsigned long long)delivered, (unsigned long long)timeouts, wall_us / opt.frames,
+         (double)cpu_us / opt.frames, (double)cpu_us * 1000.0 / fanout,
+         h.Percentile(0.5) / 1000.0, h.Percentile(0.99) / 1000.0, h.max / 1000.0);
+  return timeouts == 0 ? 0 : 1;
+}
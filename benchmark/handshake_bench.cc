@@ -0,0 +1,86 @@
+/// @file handshake_bench.cc
+/// @brief 握手吞吐基准: 在内存中完成 C0C1 -> S0S1S2 -> C2 的完整握手, 统计每个核每秒握手次数
+///        用法: ./handshake_bench [线程数, 默认 1] [持续秒数, 默认 3]
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "BufferReader.h"
+#include "RtmpHandshake.h"
+
+// 一次完整的服务端 + 客户端握手, 成功返回 true
+static bool HandshakeOnce(char *buf, uint32_t buf_size) {
+  RtmpHandshake server(RtmpHandshake::HANDSHAKE_C0C1);
+  RtmpHandshake client(RtmpHandshake::HANDSHAKE_S0S1S2);
+  BufferReader server_in(4096);
+  BufferReader client_in(4096);
+
+  int size = client.BuildC0C1(buf, buf_size);
+  server_in.Append(buf, size);
+  size = server.Parse(server_in, buf, buf_size);  // S0S1S2
+  if (size <= 0) {
+    return false;
+  }
+
+  client_in.Append(buf, size);
+  size = client.Parse(client_in, buf, buf_size);  // C2
+  if (size <= 0) {
+    return false;
+  }
+
+  server_in.Append(buf, size);
+  server.Parse(server_in, buf, buf_size);
+  return server.IsCompleted() && client.IsCompleted();
+}
+
+int main(int argc, char **argv) {
+  int num_threads = argc > 1 ? atoi(argv[1]) : 1;
+  int seconds = argc > 2 ? atoi(argv[2]) : 3;
+  if (num_threads <= 0) num_threads = 1;
+  if (seconds <= 0) seconds = 3;
+
+  std::atomic_bool stop(false);
+  std::vector<uint64_t> counts(num_threads, 0);
+  std::vector<std::thread> threads;
+
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&stop, &counts, i] {
+      char buf[4096];
+      uint64_t count = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (!HandshakeOnce(buf, sizeof(buf))) {
+          fprintf(stderr, "handshake failed\n");
+          exit(1);
+        }
+        count++;
+      }
+      counts[i] = count;
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  stop = true;
+  for (auto &t : threads) {
+    t.join();
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  uint64_t total = 0;
+  for (auto c : counts) {
+    total += c;
+  }
+
+  printf("{\"threads\": %d, \"seconds\": %.2f, \"handshakes\": %llu, "
+         "\"handshakes_per_sec\": %.0f, \"handshakes_per_sec_per_core\": %.0f}\n",
+         num_threads, elapsed, (unsigned long long)total, total / elapsed,
+         total / elapsed / num_threads);
+  return 0;
+}
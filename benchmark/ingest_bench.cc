@@ -0,0 +1,174 @@
+/// @file ingest_bench.cc
+/// @brief 入口吞吐压测: 一个进程在同一个 EventLoop 上开 N 路 RtmpFlvPublisher 推同一个 FLV 文件,
+///        文件只映射一次并预先建立 tag 索引, 推送不拷贝 payload, 统计推送的 tag 数和字节数,
+///        结果以 JSON 输出到 stdout. speed=0 时不限速, 只受发送队列限制, 用于测量服务器的入口上限
+///        用法: ./ingest_bench [--url=rtmp://127.0.0.1:1935/live/ingest] [--flv=benchmark/test.flv]
+///              [--streams=100] [--speed=1 (倍速, 0 不限速)] [--seconds=10] [--loop=1]
+///              [--threads=CPU 核数] [--open-threads=16]
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "RtmpFlvPublisher.h"
+
+namespace {
+
+struct BenchConfig {
+  std::string url = "rtmp://127.0.0.1:1935/live/ingest";
+  std::string flv = "benchmark/test.flv";
+  int streams = 100;
+  double speed = 1.0;
+  int seconds = 10;
+  bool loop = true;
+  int threads = (int)std::thread::hardware_concurrency();
+  int open_threads = 16;  // OpenUrl 会阻塞等待握手完成, 并发建立连接
+};
+
+bool ParseArgs(int argc, char **argv, BenchConfig &config) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+
+    std::string key = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    int number = atoi(value.c_str());
+    if (key == "url") {
+      config.url = value;
+    } else if (key == "flv") {
+      config.flv = value;
+    } else if (key == "streams") {
+      config.streams = std::max(number, 1);
+    } else if (key == "speed") {
+      config.speed = std::max(atof(value.c_str()), 0.0);
+    } else if (key == "seconds") {
+      config.seconds = std::max(number, 1);
+    } else if (key == "loop") {
+      config.loop = number != 0;
+    } else if (key == "threads") {
+      config.threads = std::max(number, 1);
+    } else if (key == "open-threads") {
+      config.open_threads = std::max(number, 1);
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+int RunParallel(int count, int num_threads, const std::function<bool(int)> &fn) {
+  std::atomic<int> next(0);
+  std::atomic<int> succeeded(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < std::min(count, num_threads); t++) {
+    threads.emplace_back([&] {
+      for (int i = next++; i < count; i = next++) {
+        if (fn(i)) {
+          succeeded++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return succeeded;
+}
+
+struct Totals {
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+  uint64_t loops = 0;
+  int finished = 0;
+};
+
+Totals Collect(const std::vector<std::shared_ptr<RtmpFlvPublisher>> &publishers) {
+  Totals totals;
+  for (auto &publisher : publishers) {
+    if (publisher) {
+      totals.frames += publisher->GetSentFrames();
+      totals.bytes += publisher->GetSentBytes();
+      totals.loops += publisher->GetLoops();
+      totals.finished += publisher->IsFinished() ? 1 : 0;
+    }
+  }
+  return totals;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  BenchConfig config;
+  if (!ParseArgs(argc, argv, config)) {
+    return 1;
+  }
+
+  auto source = RtmpFlvSource::Open(config.flv);
+  if (source == nullptr) {
+    fprintf(stderr, "load %s failed\n", config.flv.c_str());
+    return 1;
+  }
+
+  EventLoop event_loop(config.threads);
+  std::vector<std::shared_ptr<RtmpFlvPublisher>> publishers(config.streams);
+  int published = RunParallel(config.streams, config.open_threads, [&](int i) {
+    std::string status;
+    auto publisher = RtmpFlvPublisher::Create(&event_loop, source);
+    publisher->SetChunkSize(60000);
+    publisher->SetSpeed(config.speed);
+    publisher->SetLoop(config.loop);
+    if (publisher->OpenUrl(config.url + std::to_string(i), 5000, status) != 0) {
+      fprintf(stderr, "publish %d failed: %s\n", i, status.c_str());
+      return false;
+    }
+    publishers[i] = publisher;
+    return true;
+  });
+
+  // 连接建立完成之后开始计时, 建立连接期间推送的部分不计入
+  Totals start = Collect(publishers);
+  auto begin = std::chrono::steady_clock::now();
+  auto end = begin + std::chrono::seconds(config.seconds);
+  while (std::chrono::steady_clock::now() < end && Collect(publishers).finished < published) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  Totals stop = Collect(publishers);
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+  for (auto &publisher : publishers) {
+    if (publisher) publisher->Close();
+  }
+
+  uint64_t frames = stop.frames - start.frames;
+  uint64_t bytes = stop.bytes - start.bytes;
+  printf("{\"benchmark\":\"ingest\",\"config\":{\"url\":\"%s\",\"flv\":\"%s\",\"streams\":%d,"
+         "\"speed\":%.2f,\"seconds\":%d,\"loop\":%s,\"threads\":%d},",
+         config.url.c_str(), config.flv.c_str(), config.streams, config.speed, config.seconds,
+         config.loop ? "true" : "false", config.threads);
+  printf("\"source\":{\"tags\":%zu,\"duration_ms\":%u,\"bitrate_kbps\":%.1f},",
+         source->GetFrames().size(), source->GetDuration(),
+         source->GetBytes() * 8.0 / std::max(source->GetDuration(), 1u));
+  printf("\"publishers\":{\"connected\":%d,\"finished\":%d,\"loops\":%llu},", published,
+         stop.finished, (unsigned long long)stop.loops);
+  printf("\"elapsed_s\":%.3f,\"tags\":%llu,\"bytes\":%llu,\"tags_per_s\":%.1f,"
+         "\"bytes_per_s\":%.1f,\"mbps\":%.2f}\n",
+         elapsed, (unsigned long long)frames, (unsigned long long)bytes, frames / elapsed,
+         bytes / elapsed, bytes * 8.0 / elapsed / 1000000.0);
+  return 0;
+}
@@ -0,0 +1,111 @@
+/// @file latency_bench.cc
+/// @brief 端到端延迟基准: 进程内启动服务器, 一个推流端按固定帧率推合成的 H264 帧并写入时间戳,
+///        一个拉流端取出时间戳统计 推流 -> 服务器 -> 拉流 的延迟分布, 用于比较转发路径的改动
+///        用法: ./latency_bench [sei|amf, 默认 sei] [帧率, 默认 30] [持续秒数, 默认 5]
+///              [帧大小字节, 默认 20000] [端口, 默认 19350]
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "LatencyHistogram.h"
+#include "RtmpClient.h"
+#include "RtmpPublisher.h"
+#include "RtmpServer.h"
+#include "TestHelper.h"
+
+// 合成的 baseline profile SPS/PPS, 只用于生成序列头, 不需要能被解码
+int main(int argc, char **argv) {
+  std::string mode_name = argc > 1 ? argv[1] : "sei";
+  int fps = argc > 2 ? atoi(argv[2]) : 30;
+  int seconds = argc > 3 ? atoi(argv[3]) : 5;
+  uint32_t frame_size = argc > 4 ? (uint32_t)atoi(argv[4]) : 20000;
+  uint16_t port = argc > 5 ? (uint16_t)atoi(argv[5]) : 19350;
+  if (fps <= 0) fps = 30;
+  if (seconds <= 0) seconds = 5;
+  if (frame_size < 16) frame_size = 16;
+
+  RtmpLatencyProbe::Mode mode =
+      mode_name == "amf" ? RtmpLatencyProbe::PROBE_AMF : RtmpLatencyProbe::PROBE_SEI;
+  std::string url = "rtmp://127.0.0.1:" + std::to_string(port) + "/bench/latency";
+
+  EventLoop server_loop(1);
+  auto server = RtmpServer::Create(&server_loop);
+  server->SetChunkSize(60000);
+  if (!server->Start("127.0.0.1", port)) {
+    fprintf(stderr, "listen on %u failed\n", port);
+    return 1;
+  }
+
+  std::string status;
+  EventLoop publisher_loop(1);
+  auto publisher = RtmpPublisher::Create(&publisher_loop);
+  publisher->SetChunkSize(60000);
+  publisher->SetMediaInfo(TestMediaInfo());
+  publisher->SetLatencyProbe(mode);
+  if (publisher->OpenUrl(url, 3000, status) != 0) {
+    fprintf(stderr, "publish failed: %s\n", status.c_str());
+    return 1;
+  }
+
+  LatencyHistogram latency_us;
+  std::atomic_bool measuring(false);  // 起播前推出的帧包含建连等待时间, 不计入
+  EventLoop client_loop(1);
+  auto client = RtmpClient::Create(&client_loop);
+  client->SetLatencyProbe(mode, [&latency_us, &measuring](int64_t us) {
+    if (measuring.load(std::memory_order_relaxed)) {
+      latency_us.Record(us > 0 ? us : 0);
+    }
+  });
+
+  // 拉流端要等服务器发出 Play.Start, 先推一个关键帧让会话开始转发
+  std::vector<uint8_t> frame(frame_size, 0xab);
+  frame[0] = 0;
+  frame[1] = 0;
+  frame[2] = 0;
+  frame[3] = 1;
+  frame[4] = 0x65;  // IDR
+  publisher->PushVideoFrame(frame.data(), frame_size);
+  if (client->OpenUrl(url, 3000, status) != 0) {
+    fprintf(stderr, "play failed: %s\n", status.c_str());
+    return 1;
+  }
+
+  measuring = true;
+  uint64_t frames = 0;
+  auto interval = std::chrono::microseconds(1000000 / fps);
+  auto next = std::chrono::steady_clock::now();
+  auto end = next + std::chrono::seconds(seconds);
+  while (next < end) {
+    frame[4] = (frames % fps == 0) ? 0x65 : 0x41;  // 每秒一个 IDR, 其余为 P 帧
+    publisher->PushVideoFrame(frame.data(), frame_size);
+    frames++;
+    next += interval;
+    std::this_thread::sleep_until(next);
+  }
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));  // 等最后几帧到达
+  publisher->Close();
+  client->Close();
+  server->Stop();
+
+  LatencyHistogram::Snapshot h = latency_us.GetSnapshot();
+  printf("{\"benchmark\":\"latency\",\"mode\":\"%s\",\"fps\":%d,\"frame_size\":%u,"
+         "\"frames_sent\":%llu,\"samples\":%llu,\"mean_us\":%.1f,\"p50_us\":%llu,"
+         "\"p90_us\":%llu,\"p99_us\":%llu,\"max_us\":%llu}\n",
+         mode == RtmpLatencyProbe::PROBE_AMF ? "amf" : "sei", fps, frame_size,
+         (unsigned long long)frames, (unsigned long long)h.count, h.Mean(),
+         (unsigned long long)h.Percentile(0.5), (unsigned long long)h.Percentile(0.9),
+         (unsigned long long)h.Percentile(0.99), (unsigned long long)h.max);
+  return h.count > 0 ? 0 : 1;
+}
@@ -0,0 +1,412 @@
+/// @file micro_bench.cc
+/// @brief 热点基础组件的微基准 (Google Benchmark), 每个用例同时输出每次操作的内存分配次数 allocs_per_op
+///        用法: ./micro_bench [--benchmark_filter=正则] [--benchmark_format=json]
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <benchmark/benchmark.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BufferReader.h"
+#include "BufferWriter.h"
+#include "EventLoop.h"
+#include "H264File.h"
+#include "RingBuffer.h"
+#include "RtmpChunk.h"
+#include "RtmpClient.h"
+#include "RtmpPublisher.h"
+#include "RtmpServer.h"
+#include "TestHelper.h"
+#include "Timer.h"
+#include "amf.h"
+
+// 统计所有线程的 operator new 次数
+// 替换的 operator new/delete 内联后 GCC 会误报 new 和 free 不匹配
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+static std::atomic<uint64_t> g_allocs{0};
+
+void *operator new(size_t size) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  void *p = malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete[](void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+namespace {
+
+// 作用域内的分配次数按迭代次数平均后写入 allocs_per_op
+class AllocCounter {
+ public:
+  explicit AllocCounter(benchmark::State &state)
+      : state_(state), begin_(g_allocs.load(std::memory_order_relaxed)) {}
+
+  ~AllocCounter() {
+    uint64_t allocs = g_allocs.load(std::memory_order_relaxed) - begin_;
+    state_.counters["allocs_per_op"] =
+        benchmark::Counter((double)allocs, benchmark::Counter::kAvgIterations);
+  }
+
+ private:
+  benchmark::State &state_;
+  uint64_t begin_;
+};
+
+std::shared_ptr<char> MakePayload(uint32_t size) {
+  std::shared_ptr<char> data(new char[size], std::default_delete<char[]>());
+  memset(data.get(), 0xab, size);
+  data.get()[0] = 0x27;  // 非关键帧, H.264
+  data.get()[1] = 1;
+  return data;
+}
+
+RtmpMessage MakeVideoMessage(uint32_t size) {
+  RtmpMessage msg;
+  msg.type_id = RTMP_VIDEO;
+  msg.stream_id = 1;
+  msg.absolute_timestamp = 40;
+  msg.payload = MakePayload(size);
+  msg.length = size;
+  return msg;
+}
+
+// RtmpChunk::CreateChunk, 参数: 块大小, 消息大小
+void BM_ChunkCreate(benchmark::State &state) {
+  RtmpChunk chunk;
+  chunk.SetOutChunkSize((uint32_t)state.range(0));
+  uint32_t length = (uint32_t)state.range(1);
+  RtmpMessage msg = MakeVideoMessage(length);
+  std::vector<char> buf(length + length / 128 * 5 + 1024);
+
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    msg.length = length;  // CreateChunk 会把 length 消耗到 0
+    int size = chunk.CreateChunk(RTMP_CHUNK_VIDEO_ID, msg, buf.data(), (uint32_t)buf.size());
+    benchmark::DoNotOptimize(size);
+  }
+  state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_ChunkCreate)
+    ->Args({128, 16384})
+    ->Args({4096, 16384})
+    ->Args({60000, 16384})
+    ->Args({4096, 200000});
+
+// RtmpChunk::Parse, 参数同上, 每次迭代解析出一条完整消息
+void BM_ChunkParse(benchmark::State &state) {
+  RtmpChunk writer;
+  writer.SetOutChunkSize((uint32_t)state.range(0));
+  uint32_t length = (uint32_t)state.range(1);
+  RtmpMessage msg = MakeVideoMessage(length);
+  std::vector<char> buf(length + length / 128 * 5 + 1024);
+  int size = writer.CreateChunk(RTMP_CHUNK_VIDEO_ID, msg, buf.data(), (uint32_t)buf.size());
+
+  RtmpChunk parser;
+  parser.SetInChunkSize((uint32_t)state.range(0));
+  BufferReader reader((uint32_t)buf.size());
+
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    reader.Append(buf.data(), size);
+    RtmpMessage out;
+    while (reader.ReadableBytes() > 0) {
+      out = RtmpMessage();
+      if (parser.Parse(reader, out) <= 0 || out.IsCompleted()) {
+        break;
+      }
+    }
+    if (!out.IsCompleted()) {
+      state.SkipWithError("parse failed");
+      break;
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_ChunkParse)
+    ->Args({128, 16384})
+    ->Args({4096, 16384})
+    ->Args({60000, 16384})
+    ->Args({4096, 200000});
+
+// connect 命令的编码, 和服务器收到的命令大小相当
+uint32_t EncodeConnect(AmfEncoder &encoder) {
+  AmfObjects objects;
+  objects["app"] = AmfObject(std::string("live"));
+  objects["type"] = AmfObject(std::string("nonprivate"));
+  objects["flashVer"] = AmfObject(std::string("FMLE/3.0 (compatible; FMSc/1.0)"));
+  objects["tcUrl"] = AmfObject(std::string("rtmp://127.0.0.1:1935/live"));
+  objects["audioCodecs"] = AmfObject(3575.0);
+  objects["videoCodecs"] = AmfObject(252.0);
+
+  encoder.Reset();
+  encoder.EncodeString("connect", 7);
+  encoder.EncodeNumber(1);
+  encoder.EncodeObjects(objects);
+  return encoder.Size();
+}
+
+void BM_AmfEncode(benchmark::State &state) {
+  AmfEncoder encoder;
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(EncodeConnect(encoder));
+  }
+}
+BENCHMARK(BM_AmfEncode);
+
+void BM_AmfDecode(benchmark::State &state) {
+  AmfEncoder encoder;
+  uint32_t size = EncodeConnect(encoder);
+  AmfDecoder decoder;
+
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    decoder.Reset();
+    benchmark::DoNotOptimize(decoder.Decode(encoder.Data().get(), size));
+  }
+}
+BENCHMARK(BM_AmfDecode);
+
+// 服务器命令处理实际使用的零拷贝读取
+void BM_AmfReader(benchmark::State &state) {
+  AmfEncoder encoder;
+  uint32_t size = EncodeConnect(encoder);
+
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    AmfReader reader(encoder.Data().get(), size);
+    AmfValue value;
+    AmfValue app;
+    while (reader.Next(value)) {
+      if (value.IsObject()) {
+        benchmark::DoNotOptimize(value.Find("app", app));
+      }
+    }
+  }
+}
+BENCHMARK(BM_AmfReader);
+
+// BufferWriter::Append + Send, 对端在每批之后读空; 参数: 包大小
+void BM_BufferWriterSend(benchmark::State &state) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    state.SkipWithError("socketpair failed");
+    return;
+  }
+
+  uint32_t size = (uint32_t)state.range(0);
+  std::shared_ptr<char> data = MakePayload(size);
+  std::vector<char> sink(256 * 1024);
+  BufferWriter writer;
+
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    writer.Append(data, size);
+    while (!writer.IsEmpty()) {
+      if (writer.Send(fds[0]) < 0) {
+        break;
+      }
+      if (!writer.IsEmpty()) {
+        ssize_t n = read(fds[1], sink.data(), sink.size());
+        benchmark::DoNotOptimize(n);
+      }
+    }
+    while (recv(fds[1], sink.data(), sink.size(), MSG_DONTWAIT) > 0) {
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+  close(fds[0]);
+  close(fds[1]);
+}
+BENCHMARK(BM_BufferWriterSend)->Arg(1024)->Arg(16384)->Arg(131072);
+
+// 拷贝数据的 Append 重载, 发送响应时使用
+void BM_BufferWriterAppendCopy(benchmark::State &state) {
+  std::vector<char> data(1024, 0x5a);
+  BufferWriter writer(1 << 20);
+
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    if (!writer.Append(data.data(), (uint32_t)data.size())) {
+      state.PauseTiming();
+      writer = BufferWriter(1 << 20);
+      state.ResumeTiming();
+    }
+  }
+}
+BENCHMARK(BM_BufferWriterAppendCopy);
+
+void BM_RingBuffer(benchmark::State &state) {
+  RingBuffer<std::function<void()>> ring(1024);
+  int counter_value = 0;
+
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    ring.Push([&counter_value] { counter_value++; });
+    std::function<void()> task;
+    ring.Pop(task);
+    task();
+  }
+  benchmark::DoNotOptimize(counter_value);
+}
+BENCHMARK(BM_RingBuffer);
+
+void BM_TimerAddRemove(benchmark::State &state) {
+  TimerQueue queue;
+  // 预先放一些定时器, 使 map 的深度接近真实情况
+  for (int i = 0; i < state.range(0); i++) {
+    queue.AddTimer([] { return true; }, 1000 + i);
+  }
+
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    TimerId id = queue.AddTimer([] { return false; }, 500);
+    queue.RemoveTimer(id);
+  }
+}
+BENCHMARK(BM_TimerAddRemove)->Arg(0)->Arg(1000);
+
+// 每次迭代有 range(0) 个到期的一次性定时器
+void BM_TimerExpire(benchmark::State &state) {
+  TimerQueue queue;
+  int fired = 0;
+
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    state.PauseTiming();
+    for (int i = 0; i < state.range(0); i++) {
+      queue.AddTimer([&fired] {
+        fired++;
+        return false;
+      }, 1);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    state.ResumeTiming();
+    queue.HandleTimerEvent();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  benchmark::DoNotOptimize(fired);
+}
+BENCHMARK(BM_TimerExpire)->Arg(100)->Arg(1000);
+
+void BM_H264FindNal(benchmark::State &state) {
+  // 一个 SPS, 一个 PPS, 一个大的 IDR, 起始码分别是 4, 4, 3 字节
+  static const uint8_t kHeader[] = {0, 0, 0, 1, 0x67, 0x42, 0xc0, 0x1f, 0, 0, 0,
+                                    1, 0x68, 0xce, 0x3c, 0, 0, 1, 0x65};
+  std::vector<uint8_t> data(sizeof(kHeader) + (size_t)state.range(0), 0x88);
+  memcpy(data.data(), kHeader, sizeof(kHeader));
+
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    const uint8_t *pos = data.data();
+    uint32_t remain = (uint32_t)data.size();
+    int count = 0;
+    while (remain > 4) {
+      Nal nal = H264File::findNal(pos, remain);
+      if (nal.first == nullptr || nal.second <= pos) {
+        break;
+      }
+      count++;
+      remain -= (uint32_t)(nal.second - pos);
+      pos = nal.second;
+    }
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_H264FindNal)->Arg(1024)->Arg(65536);
+
+// socketpair 的一端交给服务器, 返回另一端
+// RtmpSession::SendMediaData 向 range(0) 个拉流端扇出, 拉流端是通过 socketpair 接入的 RtmpClient
+// 分配次数包括订阅者线程中发送的分配
+void BM_SessionFanout(benchmark::State &state) {
+  static const char *kUrl = "rtmp://127.0.0.1/bench/fanout";
+  int num_players = (int)state.range(0);
+
+  EventLoop event_loop(1);
+  auto server = RtmpServer::Create(&event_loop);
+
+  // 推流端只用来创建会话, 数据由基准直接调用 session 分发
+  std::string status;
+  EventLoop client_loop(1);
+  auto publisher = RtmpPublisher::Create(&client_loop);
+  if (publisher->OpenSocket(AdoptPair(server), kUrl, 3000, status) != 0) {
+    state.SkipWithError("publish failed");
+    return;
+  }
+
+  std::vector<std::shared_ptr<RtmpClient>> players;
+  for (int i = 0; i < num_players; i++) {
+    auto client = RtmpClient::Create(&client_loop);
+    client->SetRecvFrameCB([](uint8_t *, uint32_t, uint8_t, uint32_t) {});
+    if (client->OpenSocket(AdoptPair(server), kUrl, 3000, status) != 0) {
+      state.SkipWithError("play failed");
+      return;
+    }
+    players.push_back(client);
+  }
+
+  RtmpSession::Ptr session;
+  server->ForEachSession([&session](const std::string &, const RtmpSession::Ptr &s) {
+    session = s;
+  });
+  if (!session) {
+    state.SkipWithError("no session");
+    return;
+  }
+
+  std::shared_ptr<char> frame = MakePayload(4096);
+  auto schedulers = server->GetEventLoop()->GetTaskSchedulers();
+  uint64_t timestamp = 0;
+
+  AllocCounter counter(state);
+  for (auto _ : state) {
+    session->SendMediaData(RTMP_VIDEO, timestamp, frame, 4096);
+    timestamp += 40;
+
+    // 订阅者线程的触发队列满了之后新的帧会被丢弃, 定期等待队列排空
+    if ((timestamp / 40) % 32 == 0) {
+      state.PauseTiming();
+      for (auto &scheduler : schedulers) {
+        while (scheduler->GetTriggerQueueDepth() > 0) {
+          std::this_thread::yield();
+        }
+      }
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * num_players);
+
+  for (auto &client : players) {
+    client->Close();
+  }
+  publisher->Close();
+  server->Stop();
+}
+BENCHMARK(BM_SessionFanout)->Arg(1)->Arg(10)->Arg(100)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,228 @@
+/// @file replay_bench.cc
+/// @brief 回放 RtmpServer::SetIngressCapture 抓到的推流字节, 不经过网络测量 chunk 解析和消息处理的吞吐,
+///        数据来自真实的编码器 (OBS, 硬件编码器, ffmpeg), 包含各自的分块大小和扩展时间戳用法
+///        1. parse: 只调用 RtmpChunk::Parse, 处理 Set Chunk Size 消息
+///        2. full: 在服务器连接的事件循环线程中调用 RtmpConnection::ReplayChunks,
+///           经过 HandleMessage 的命令处理, 会话和 GOP 缓存, 没有拉流端
+///        用法: ./replay_bench <capture.rtmpcap> [--loops=10] [--read-size=65536]
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "BufferReader.h"
+#include "EventLoop.h"
+#include "RtmpChunk.h"
+#include "RtmpConnection.h"
+#include "RtmpIngressCapture.h"
+#include "RtmpServer.h"
+
+namespace {
+
+struct ParseResult {
+  uint64_t messages = 0;
+  uint64_t video = 0;
+  uint64_t audio = 0;
+  uint64_t extended_timestamps = 0;
+  bool ok = true;
+};
+
+bool LoadCapture(const char *path, std::string &data) {
+  FILE *fp = fopen(path, "rb");
+  if (fp == nullptr) {
+    return false;
+  }
+
+  char buf[64 * 1024];
+  size_t n = 0;
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+    data.append(buf, n);
+  }
+  fclose(fp);
+
+  if (data.size() < sizeof(RtmpIngressCapture::kMagic) ||
+      memcmp(data.data(), RtmpIngressCapture::kMagic, sizeof(RtmpIngressCapture::kMagic)) != 0) {
+    return false;
+  }
+  data.erase(0, sizeof(RtmpIngressCapture::kMagic));
+  return true;
+}
+
+// 按 read_size 分段喂给解析器, 模拟每次从 socket 读到的数据
+ParseResult ParseOnly(const std::string &data, uint32_t read_size) {
+  ParseResult result;
+  RtmpChunk chunk;
+  BufferReader buffer(read_size * 2);
+
+  for (size_t pos = 0; pos < data.size(); pos += read_size) {
+    uint32_t size = (uint32_t)std::min<size_t>(read_size, data.size() - pos);
+    buffer.Append(data.data() + pos, size);
+
+    while (buffer.ReadableBytes() > 0) {
+      RtmpMessage msg;
+      int ret = chunk.Parse(buffer, msg);
+      if (ret < 0) {
+        result.ok = false;
+        return result;
+      }
+      if (msg.IsCompleted()) {
+        result.messages++;
+        if (msg.type_id == RTMP_VIDEO) {
+          result.video++;
+        } else if (msg.type_id == RTMP_AUDIO) {
+          result.audio++;
+        } else if (msg.type_id == RTMP_SET_CHUNK_SIZE) {
+          chunk.SetInChunkSize(ReadUint32BE(msg.payload.get()));
+        }
+        if (msg.timestamp_delta >= 0xffffff) {
+          result.extended_timestamps++;
+        }
+      }
+      if (ret == 0) {
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+bool HasPublisher(const std::shared_ptr<RtmpServer> &server) {
+  bool found = false;
+  server->ForEachSession([&found](const std::string &, const RtmpSession::Ptr &session) {
+    if (session->GetPublisher() != nullptr) {
+      found = true;
+    }
+  });
+  return found;
+}
+
+// 在连接所属的线程中回放一次, 返回回放耗时, 失败返回 -1
+int64_t ReplayOnce(const std::shared_ptr<RtmpServer> &server, TaskScheduler *scheduler,
+                   const std::string &data, uint32_t read_size) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    return -1;
+  }
+
+  // 服务器的响应 (connect 结果, onStatus 等) 写到 fds[0], 由 fds[1] 丢弃
+  auto conn = std::make_shared<RtmpConnection>(server, scheduler, fds[0]);
+  std::atomic<int64_t> elapsed_ns(0);
+  std::atomic_bool done(false);
+
+  scheduler->AddTriggerEvent([conn, &data, read_size, &elapsed_ns, &done] {
+    BufferReader buffer(read_size * 2);
+    bool ok = true;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos < data.size() && ok; pos += read_size) {
+      uint32_t size = (uint32_t)std::min<size_t>(read_size, data.size() - pos);
+      buffer.Append(data.data() + pos, size);
+      ok = conn->ReplayChunks(buffer);
+    }
+    auto end = std::chrono::steady_clock::now();
+    elapsed_ns = ok ? std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()
+                    : -1;
+    conn->Disconnect();
+    done = true;
+  });
+
+  char sink[64 * 1024];
+  while (!done.load()) {
+    while (recv(fds[1], sink, sizeof(sink), MSG_DONTWAIT) > 0) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // 等连接关闭并从会话中移除, 下一次回放才能重新 publish 同一个流,
+  // 会话只持有推流连接的弱引用, 这里也要释放
+  conn.reset();
+  while (HasPublisher(server)) {
+    while (recv(fds[1], sink, sizeof(sink), MSG_DONTWAIT) > 0) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  close(fds[1]);
+  return elapsed_ns.load();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <capture.rtmpcap> [--loops=10] [--read-size=65536]\n", argv[0]);
+    return 1;
+  }
+
+  int loops = 10;
+  uint32_t read_size = 65536;
+  for (int i = 2; i < argc; i++) {
+    if (strncmp(argv[i], "--loops=", 8) == 0) {
+      loops = atoi(argv[i] + 8);
+    } else if (strncmp(argv[i], "--read-size=", 12) == 0) {
+      read_size = (uint32_t)atoi(argv[i] + 12);
+    } else {
+      fprintf(stderr, "unknown option: %s\n", argv[i]);
+    }
+  }
+  if (loops <= 0) loops = 10;
+  if (read_size < 1) read_size = 65536;
+
+  std::string data;
+  if (!LoadCapture(argv[1], data)) {
+    fprintf(stderr, "%s is not a capture file\n", argv[1]);
+    return 1;
+  }
+
+  ParseResult parsed;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < loops; i++) {
+    parsed = ParseOnly(data, read_size);
+    if (!parsed.ok) {
+      fprintf(stderr, "chunk parse failed\n");
+      return 1;
+    }
+  }
+  double parse_ns =
+      std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+      loops;
+
+  EventLoop event_loop(1);
+  auto server = RtmpServer::Create(&event_loop);
+  server->SetChunkSize(60000);
+  server->SetGopCache();
+  TaskScheduler *scheduler = event_loop.GetTaskScheduler().get();
+
+  int64_t full_total_ns = 0;
+  for (int i = 0; i < loops; i++) {
+    int64_t ns = ReplayOnce(server, scheduler, data, read_size);
+    if (ns < 0) {
+      fprintf(stderr, "replay failed\n");
+      return 1;
+    }
+    full_total_ns += ns;
+  }
+  double full_ns = (double)full_total_ns / loops;
+  server->Stop();
+
+  uint64_t messages = parsed.messages > 0 ? parsed.messages : 1;
+  printf("{\"benchmark\":\"replay\",\"bytes\":%zu,\"read_size\":%u,\"loops\":%d,\"messages\":%llu,"
+         "\"video\":%llu,\"audio\":%llu,\"extended_timestamps\":%llu,"
+         "\"parse_mb_per_sec\":%.1f,\"parse_ns_per_msg\":%.1f,"
+         "\"full_mb_per_sec\":%.1f,\"full_ns_per_msg\":%.1f}\n",
+         data.size(), read_size, loops, (unsigned long long)parsed.messages,
+         (unsigned long long)parsed.video, (unsigned long long)parsed.audio,
+         (unsigned long long)parsed.extended_timestamps, data.size() * 1000.0 / parse_ns,
+         parse_ns / messages, data.size() * 1000.0 / full_ns, full_ns / messages);
+  return 0;
+}
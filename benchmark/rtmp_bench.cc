@@ -0,0 +1,480 @@
+/// @file rtmp_bench.cc
+/// @brief RTMP 压测工具: N 路推流, 每路 M 个拉流, 推流源为 FLV 文件或按码率和 GOP 长度合成的 H264 帧
+///        统计服务器 CPU 和 RES, 每个拉流端的吞吐, 丢帧数, 以及通过 SEI 时间戳得到的端到端延迟分位数,
+///        结果以 JSON 输出到 stdout. 丢帧和延迟只统计 H.264 视频帧
+///        用法: ./rtmp_bench [--url=rtmp://127.0.0.1:1935/live/bench] [--streams=1] [--players=1]
+///              [--seconds=10] [--flv=文件路径, 不指定则使用合成源] [--bitrate=1000 (kbps)]
+///              [--fps=25] [--gop=50 (帧)] [--threads=CPU 核数] [--server-pid=自动查找 rtmp_server]
+///              [--probe=1] [--open-threads=16]
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "FlvFile.h"
+#include "LatencyHistogram.h"
+#include "RtmpClient.h"
+#include "RtmpLatencyProbe.h"
+#include "RtmpPublisher.h"
+#include "TestHelper.h"
+
+namespace {
+
+struct BenchConfig {
+  std::string url = "rtmp://127.0.0.1:1935/live/bench";
+  int streams = 1;
+  int players = 1;  // 每路流的拉流数
+  int seconds = 10;
+  std::string flv;
+  int bitrate_kbps = 1000;
+  int fps = 25;
+  int gop = 50;
+  int threads = (int)std::thread::hardware_concurrency();
+  int server_pid = 0;
+  bool probe = true;
+  int open_threads = 16;  // OpenUrl 会阻塞等待握手完成, 并发建立连接
+};
+
+// 一条待推送的音视频消息, 时间戳为源内相对时间
+struct MediaTag {
+  uint8_t type = 0;  // RTMP_VIDEO 或 RTMP_AUDIO
+  uint32_t timestamp = 0;
+  std::shared_ptr<char> data;
+  uint32_t size = 0;
+  bool is_header = false;  // 序列头, 只在开始时推一次
+  bool is_frame = false;   // 视频帧 (AVC NALU), 参与丢帧和延迟统计
+};
+
+struct MediaSource {
+  std::vector<MediaTag> tags;
+  uint32_t duration_ms = 0;  // 循环推送时每轮时间戳的偏移
+  uint64_t bytes = 0;        // 一轮的字节数, 用于计算源码率
+};
+
+struct PlayerStats {
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> video_frames{0};
+};
+
+struct ProcessSample {
+  uint64_t cpu_ticks = 0;
+  uint64_t res_kb = 0;
+  uint64_t peak_res_kb = 0;
+};
+
+bool ParseArgs(int argc, char **argv, BenchConfig &config) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 || eq == std::string::npos) {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+
+    std::string key = arg.substr(2, eq - 2);
+    std::string value = arg.substr(eq + 1);
+    int number = atoi(value.c_str());
+    if (key == "url") {
+      config.url = value;
+    } else if (key == "streams") {
+      config.streams = std::max(number, 1);
+    } else if (key == "players") {
+      config.players = std::max(number, 0);
+    } else if (key == "seconds") {
+      config.seconds = std::max(number, 1);
+    } else if (key == "flv") {
+      config.flv = value;
+    } else if (key == "bitrate") {
+      config.bitrate_kbps = std::max(number, 1);
+    } else if (key == "fps") {
+      config.fps = std::max(number, 1);
+    } else if (key == "gop") {
+      config.gop = std::max(number, 1);
+    } else if (key == "threads") {
+      config.threads = std::max(number, 1);
+    } else if (key == "server-pid") {
+      config.server_pid = number;
+    } else if (key == "probe") {
+      config.probe = number != 0;
+    } else if (key == "open-threads") {
+      config.open_threads = std::max(number, 1);
+    } else {
+      fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<char> CopyData(const uint8_t *data, uint32_t size) {
+  std::shared_ptr<char> buf(new char[size], std::default_delete<char[]>());
+  memcpy(buf.get(), data, size);
+  return buf;
+}
+
+bool LoadFlv(const std::string &path, MediaSource &source) {
+  FlvFile file;
+  if (!file.Open(path.c_str())) {
+    return false;
+  }
+
+  FlvTag tag;
+  uint32_t last_timestamp = 0;
+  uint32_t first_timestamp = 0;
+  bool has_first = false;
+  while (file.ReadTag(tag)) {
+    if ((tag.type != RTMP_VIDEO && tag.type != RTMP_AUDIO) || tag.size < 2) {
+      continue;
+    }
+
+    if (!has_first) {
+      first_timestamp = tag.timestamp;
+      has_first = true;
+    }
+
+    MediaTag media;
+    media.type = tag.type;
+    media.timestamp = tag.timestamp - first_timestamp;
+    media.data = CopyData(tag.data, tag.size);
+    media.size = tag.size;
+    if (tag.type == RTMP_VIDEO) {
+      bool is_avc = (tag.data[0] & 0x0f) == RTMP_CODEC_ID_H264;
+      media.is_header = is_avc && tag.data[1] == 0;
+      media.is_frame = is_avc && tag.data[1] == 1;
+    } else {
+      media.is_header = (tag.data[0] >> 4) == RTMP_CODEC_ID_AAC && tag.data[1] == 0;
+    }
+    last_timestamp = std::max(last_timestamp, media.timestamp);
+    source.bytes += tag.size;
+    source.tags.push_back(std::move(media));
+  }
+
+  source.duration_ms = last_timestamp + 40;  // 最后一帧的时长按 25fps 估算
+  return !source.tags.empty();
+}
+
+// 合成源: 一个 AVC 序列头加一个 GOP 的帧, 帧大小按码率平均分配
+void BuildSynthetic(const BenchConfig &config, MediaSource &source) {
+  std::string header = TestAvcSequenceHeader();
+
+  MediaTag sequence_header;
+  sequence_header.type = RTMP_VIDEO;
+  sequence_header.data = CopyData((const uint8_t *)header.data(), (uint32_t)header.size());
+  sequence_header.size = (uint32_t)header.size();
+  sequence_header.is_header = true;
+  source.tags.push_back(sequence_header);
+
+  uint32_t frame_size = std::max<uint32_t>(config.bitrate_kbps * 1000 / 8 / config.fps, 16);
+  uint32_t nal_size = frame_size - 9;
+  for (int i = 0; i < config.gop; i++) {
+    std::vector<uint8_t> frame(frame_size, 0xab);
+    bool key = i == 0;
+    frame[0] = key ? 0x17 : 0x27;
+    frame[1] = 1;
+    frame[2] = frame[3] = frame[4] = 0;
+    frame[5] = (nal_size >> 24) & 0xff;
+    frame[6] = (nal_size >> 16) & 0xff;
+    frame[7] = (nal_size >> 8) & 0xff;
+    frame[8] = nal_size & 0xff;
+    frame[9] = key ? 0x65 : 0x41;
+
+    MediaTag media;
+    media.type = RTMP_VIDEO;
+    media.timestamp = (uint32_t)((uint64_t)i * 1000 / config.fps);
+    media.data = CopyData(frame.data(), frame_size);
+    media.size = frame_size;
+    media.is_frame = true;
+    source.bytes += frame_size;
+    source.tags.push_back(std::move(media));
+  }
+  source.duration_ms = (uint32_t)((uint64_t)config.gop * 1000 / config.fps);
+}
+
+// 在 AVC 头和 NALU 之间插入带当前时间的探测 SEI, 所有推流端共用同一份数据
+std::shared_ptr<char> StampFrame(const MediaTag &tag, uint32_t &size) {
+  size = tag.size + RtmpLatencyProbe::kSeiSize;
+  std::shared_ptr<char> buf(new char[size], std::default_delete<char[]>());
+  uint8_t *p = (uint8_t *)buf.get();
+  memcpy(p, tag.data.get(), 5);
+  RtmpLatencyProbe::WriteSei(p + 5, RtmpLatencyProbe::kSeiSize, Timestamp::NowMicros());
+  memcpy(p + 5 + RtmpLatencyProbe::kSeiSize, tag.data.get() + 5, tag.size - 5);
+  return buf;
+}
+
+int FindServerPid() {
+  DIR *dir = opendir("/proc");
+  if (dir == nullptr) {
+    return 0;
+  }
+
+  int pid = 0;
+  struct dirent *entry = nullptr;
+  while ((entry = readdir(dir)) != nullptr && pid == 0) {
+    int candidate = atoi(entry->d_name);
+    if (candidate <= 0) {
+      continue;
+    }
+    std::ifstream comm(std::string("/proc/") + entry->d_name + "/comm");
+    std::string name;
+    if (std::getline(comm, name) && name == "rtmp_server") {
+      pid = candidate;
+    }
+  }
+  closedir(dir);
+  return pid;
+}
+
+bool SampleProcess(int pid, ProcessSample &sample) {
+  std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+  std::string line;
+  if (pid <= 0 || !std::getline(stat, line)) {
+    return false;
+  }
+
+  // comm 字段可能包含空格, 从最后一个 ')' 之后开始数字段, utime 和 stime 是第 14 和 15 个字段
+  size_t pos = line.rfind(')');
+  if (pos == std::string::npos) {
+    return false;
+  }
+  std::vector<std::string> fields;
+  size_t start = pos + 2;
+  while (start < line.size()) {
+    size_t end = line.find(' ', start);
+    if (end == std::string::npos) end = line.size();
+    fields.push_back(line.substr(start, end - start));
+    start = end + 1;
+  }
+  if (fields.size() < 13) {
+    return false;
+  }
+  sample.cpu_ticks = strtoull(fields[11].c_str(), nullptr, 10) +
+                     strtoull(fields[12].c_str(), nullptr, 10);
+
+  std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmRSS:") == 0) {
+      sample.res_kb = strtoull(line.c_str() + 6, nullptr, 10);
+    } else if (line.compare(0, 6, "VmHWM:") == 0) {
+      sample.peak_res_kb = strtoull(line.c_str() + 6, nullptr, 10);
+    }
+  }
+  return true;
+}
+
+// 用 num_threads 个线程并发执行 count 次 fn(index), fn 返回成功与否, 返回成功次数
+int RunParallel(int count, int num_threads, const std::function<bool(int)> &fn) {
+  std::atomic<int> next(0);
+  std::atomic<int> succeeded(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < std::min(count, num_threads); t++) {
+    threads.emplace_back([&] {
+      for (int i = next++; i < count; i = next++) {
+        if (fn(i)) {
+          succeeded++;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return succeeded;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  BenchConfig config;
+  if (!ParseArgs(argc, argv, config)) {
+    return 1;
+  }
+
+  MediaSource source;
+  if (!config.flv.empty()) {
+    if (!LoadFlv(config.flv, source)) {
+      fprintf(stderr, "load %s failed\n", config.flv.c_str());
+      return 1;
+    }
+  } else {
+    BuildSynthetic(config, source);
+  }
+
+  EventLoop event_loop(config.threads);
+  std::vector<std::shared_ptr<RtmpPublisher>> publishers(config.streams);
+  int published = RunParallel(config.streams, config.open_threads, [&](int i) {
+    std::string status;
+    auto publisher = RtmpPublisher::Create(&event_loop);
+    publisher->SetChunkSize(60000);
+    if (publisher->OpenUrl(config.url + std::to_string(i), 5000, status) != 0) {
+      fprintf(stderr, "publish %d failed: %s\n", i, status.c_str());
+      return false;
+    }
+    publishers[i] = publisher;
+    return true;
+  });
+
+  LatencyHistogram latency_us;
+  std::atomic_bool measuring(false);
+  int num_players = config.streams * config.players;
+  std::vector<std::unique_ptr<PlayerStats>> player_stats(num_players);
+  std::vector<std::shared_ptr<RtmpClient>> players(num_players);
+  int playing = RunParallel(num_players, config.open_threads, [&](int i) {
+    player_stats[i].reset(new PlayerStats);
+    PlayerStats *stats = player_stats[i].get();
+    auto client = RtmpClient::Create(&event_loop);
+    client->SetRecvFrameCB([stats, &measuring](uint8_t *payload, uint32_t length, uint8_t codec_id,
+                                               uint32_t timestamp) {
+      if (!measuring.load(std::memory_order_relaxed)) {
+        return;
+      }
+      stats->bytes.fetch_add(length, std::memory_order_relaxed);
+      if (codec_id == RTMP_CODEC_ID_H264 && length > 1 && payload[1] == 1) {
+        stats->video_frames.fetch_add(1, std::memory_order_relaxed);
+      }
+    });
+    if (config.probe) {
+      client->SetLatencyProbe(RtmpLatencyProbe::PROBE_SEI, [&latency_us, &measuring](int64_t us) {
+        if (measuring.load(std::memory_order_relaxed)) {
+          latency_us.Record(us > 0 ? us : 0);
+        }
+      });
+    }
+
+    std::string status;
+    if (client->OpenUrl(config.url + std::to_string(i / config.players), 5000, status) != 0) {
+      fprintf(stderr, "play %d failed: %s\n", i, status.c_str());
+      return false;
+    }
+    players[i] = client;
+    return true;
+  });
+
+  int server_pid = config.server_pid > 0 ? config.server_pid : FindServerPid();
+  ProcessSample begin_sample;
+  ProcessSample end_sample;
+  bool has_server = SampleProcess(server_pid, begin_sample);
+
+  // 按源的时间戳节奏推送, 所有推流端同时推同一条消息
+  measuring = true;
+  uint64_t frames_sent = 0;
+  uint64_t bytes_sent = 0;
+  auto begin = std::chrono::steady_clock::now();
+  auto end = begin + std::chrono::seconds(config.seconds);
+  for (uint64_t loop = 0; std::chrono::steady_clock::now() < end; loop++) {
+    for (auto &tag : source.tags) {
+      if (tag.is_header && loop > 0) {
+        continue;
+      }
+
+      uint64_t timestamp = loop * source.duration_ms + tag.timestamp;
+      auto when = begin + std::chrono::milliseconds(timestamp);
+      if (when >= end) {
+        break;
+      }
+      std::this_thread::sleep_until(when);
+
+      std::shared_ptr<char> data = tag.data;
+      uint32_t size = tag.size;
+      if (config.probe && tag.is_frame && tag.size > 5) {
+        data = StampFrame(tag, size);
+      }
+      for (auto &publisher : publishers) {
+        if (publisher) {
+          publisher->PushMediaData(tag.type, timestamp, data, size);
+        }
+      }
+      frames_sent += tag.is_frame ? 1 : 0;
+      bytes_sent += size;
+    }
+  }
+
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  if (has_server) {
+    SampleProcess(server_pid, end_sample);
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(1));  // 等待队列中的帧到达拉流端
+  measuring = false;
+
+  for (auto &publisher : publishers) {
+    if (publisher) publisher->Close();
+  }
+  for (auto &client : players) {
+    if (client) client->Close();
+  }
+
+  // 输出
+  printf("{\"benchmark\":\"rtmp\",\"config\":{\"url\":\"%s\",\"streams\":%d,\"players_per_stream\":%d,"
+         "\"seconds\":%d,\"source\":\"%s\",\"source_bitrate_kbps\":%.1f,\"fps\":%d,\"gop\":%d,"
+         "\"threads\":%d},",
+         config.url.c_str(), config.streams, config.players, config.seconds,
+         config.flv.empty() ? "synthetic" : config.flv.c_str(),
+         source.duration_ms ? source.bytes * 8.0 / source.duration_ms : 0.0, config.fps,
+         config.gop, config.threads);
+  printf("\"publishers\":{\"connected\":%d,\"frames_sent\":%llu,\"bytes_sent\":%llu},",
+         published, (unsigned long long)frames_sent, (unsigned long long)bytes_sent);
+
+  if (has_server) {
+    long ticks_per_sec = sysconf(_SC_CLK_TCK);
+    double cpu = (end_sample.cpu_ticks - begin_sample.cpu_ticks) * 100.0 / ticks_per_sec / elapsed;
+    printf("\"server\":{\"pid\":%d,\"cpu_percent\":%.1f,\"res_kb\":%llu,\"peak_res_kb\":%llu},",
+           server_pid, cpu, (unsigned long long)end_sample.res_kb,
+           (unsigned long long)end_sample.peak_res_kb);
+  } else {
+    printf("\"server\":null,");
+  }
+
+  uint64_t total_frames = 0;
+  uint64_t lost_frames = 0;
+  double min_kbps = 0;
+  double max_kbps = 0;
+  double sum_kbps = 0;
+  printf("\"players\":{\"connected\":%d,\"list\":[", playing);
+  bool first = true;
+  for (int i = 0; i < num_players; i++) {
+    if (!players[i]) {
+      continue;
+    }
+    uint64_t frames = player_stats[i]->video_frames.load();
+    uint64_t lost = frames_sent > frames ? frames_sent - frames : 0;
+    double kbps = player_stats[i]->bytes.load() * 8.0 / 1000 / elapsed;
+    printf("%s{\"id\":%d,\"stream\":%d,\"kbps\":%.1f,\"frames\":%llu,\"lost\":%llu}",
+           first ? "" : ",", i, i / config.players, kbps, (unsigned long long)frames,
+           (unsigned long long)lost);
+    min_kbps = first ? kbps : std::min(min_kbps, kbps);
+    max_kbps = std::max(max_kbps, kbps);
+    sum_kbps += kbps;
+    total_frames += frames;
+    lost_frames += lost;
+    first = false;
+  }
+  uint64_t expected = frames_sent * playing;
+  printf("],\"kbps_min\":%.1f,\"kbps_avg\":%.1f,\"kbps_max\":%.1f,\"frames_received\":%llu,"
+         "\"frames_lost\":%llu,\"loss_ratio\":%.6f},",
+         min_kbps, playing ? sum_kbps / playing : 0.0, max_kbps, (unsigned long long)total_frames,
+         (unsigned long long)lost_frames, expected ? (double)lost_frames / expected : 0.0);
+
+  LatencyHistogram::Snapshot h = latency_us.GetSnapshot();
+  printf("\"latency_us\":{\"samples\":%llu,\"mean\":%.1f,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,"
+         "\"p999\":%llu,\"max\":%llu}}\n",
+         (unsigned long long)h.count, h.Mean(), (unsigned long long)h.Percentile(0.5),
+         (unsigned long long)h.Percentile(0.9), (unsigned long long)h.Percentile(0.99),
+         (unsigned long long)h.Percentile(0.999), (unsigned long long)h.max);
+
+  return published == config.streams && playing == num_players ? 0 : 1;
+}
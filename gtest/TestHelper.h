@@ -0,0 +1,128 @@
+/// @file TestHelper.h
+/// @brief 单元测试和基准测试共用的辅助函数: 通过 socketpair 把连接交给服务器, 测试用的 H.264 参数集,
+///        测试用的 FLV 文件和空闲端口
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_TEST_HELPER_H
+#define RTMP_SERVER_TEST_HELPER_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "FlvWriter.h"
+#include "TcpServer.h"
+#include "amf.h"
+#include "rtmp.h"
+
+// 1280x720 baseline
+static const uint8_t kTestSps[] = {0x67, 0x42, 0xc0, 0x1f, 0xda, 0x01, 0x40, 0x16, 0xe8};
+static const uint8_t kTestPps[] = {0x68, 0xce, 0x3c, 0x80};
+
+// 一端交给服务器, 返回另一端, 失败返回 INVALID_SOCKET
+inline SOCKET AdoptPair(TcpServer &server) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    return INVALID_SOCKET;
+  }
+  if (!server.AdoptConnection(fds[0])) {
+    close(fds[0]);
+    close(fds[1]);
+    return INVALID_SOCKET;
+  }
+  return fds[1];
+}
+
+template <typename Server>
+SOCKET AdoptPair(const std::shared_ptr<Server> &server) {
+  return AdoptPair(*server);
+}
+
+// 只有视频的 MediaInfo, 用于 RtmpPublisher::SetMediaInfo
+inline MediaInfo TestMediaInfo() {
+  MediaInfo info;
+  info.video_codec_id = RTMP_CODEC_ID_H264;
+  info.audio_codec_id = 0;
+  info.sps.reset(new uint8_t[sizeof(kTestSps)], std::default_delete<uint8_t[]>());
+  memcpy(info.sps.get(), kTestSps, sizeof(kTestSps));
+  info.sps_size = sizeof(kTestSps);
+  info.pps.reset(new uint8_t[sizeof(kTestPps)], std::default_delete<uint8_t[]>());
+  memcpy(info.pps.get(), kTestPps, sizeof(kTestPps));
+  info.pps_size = sizeof(kTestPps);
+  return info;
+}
+
+// AVCDecoderConfigurationRecord
+inline std::string TestAvcConfig() {
+  std::string data = {0x01, 0x42, (char)0xc0, 0x1f, (char)0xff, (char)0xe1, 0x00,
+                      (char)sizeof(kTestSps)};
+  data.append((const char *)kTestSps, sizeof(kTestSps));
+  data += {0x01, 0x00, (char)sizeof(kTestPps)};
+  data.append((const char *)kTestPps, sizeof(kTestPps));
+  return data;
+}
+
+// FLV 视频 tag 的 AVC 序列头
+inline std::string TestAvcSequenceHeader() {
+  return std::string({0x17, 0x00, 0x00, 0x00, 0x00}) + TestAvcConfig();
+}
+
+// 2 秒的视频, 25fps, 1 秒一个 GOP, 每帧后面跟一个音频帧, 第 6 个字节是帧序号.
+// 序列头和第一帧的时间戳是 base_ts, with_meta 时开头写入 duration 为 2 秒的 onMetaData
+inline bool WriteTestFlv(const std::string &path, uint32_t base_ts = 0, bool with_meta = false) {
+  FlvWriter writer(4096, 0);
+  if (!writer.Open(path, true, true)) {
+    return false;
+  }
+
+  if (with_meta) {
+    AmfObjects meta;
+    meta["duration"] = AmfObject(2.0);
+    AmfEncoder encoder;
+    encoder.EncodeString("onMetaData", 10);
+    encoder.EncodeECMA(meta);
+    writer.WriteTag(RTMP_DATA_MESSAGE, 0, encoder.Data().get(), encoder.Size());
+  }
+
+  std::string avc_sequence_header = TestAvcSequenceHeader();
+  writer.WriteTag(RTMP_VIDEO, base_ts, avc_sequence_header.data(),
+                  (uint32_t)avc_sequence_header.size());
+  writer.WriteTag(RTMP_AUDIO, base_ts, "\xaf\x00\x12\x10", 4);
+
+  std::string frame(200, 'v');
+  for (uint32_t i = 0; i < 50; i++) {
+    frame[0] = i % 25 == 0 ? 0x17 : 0x27;
+    frame[1] = 0x01;
+    frame[5] = (char)i;
+    writer.WriteTag(RTMP_VIDEO, base_ts + i * 40, frame.data(), (uint32_t)frame.size());
+    writer.WriteTag(RTMP_AUDIO, base_ts + i * 40 + 10, "\xaf\x01\x21", 3);
+  }
+  writer.Close();
+  return true;
+}
+
+// 系统分配一个空闲的本地端口, 失败返回 0
+inline uint16_t FreePort() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  uint16_t port = 0;
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+      getsockname(fd, (struct sockaddr *)&addr, &len) == 0) {
+    port = ntohs(addr.sin_port);
+  }
+  close(fd);
+  return port;
+}
+
+#endif  // RTMP_SERVER_TEST_HELPER_H
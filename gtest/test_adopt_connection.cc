@@ -0,0 +1,88 @@
+/// @file test_adopt_connection.cc
+/// @brief 服务器接管 socketpair 连接, 推流和拉流不经过监听端口
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "RtmpClient.h"
+#include "RtmpPublisher.h"
+#include "RtmpServer.h"
+#include "TestHelper.h"
+
+namespace {
+
+const char *kUrl = "rtmp://127.0.0.1/adopt/stream";
+
+}  // namespace
+
+TEST(TestAdoptConnection, PublishAndPlay) {
+  EventLoop server_loop(1);
+  auto server = RtmpServer::Create(&server_loop);
+  server->SetGopCache();
+
+  std::string status;
+  EventLoop client_loop(1);
+  auto publisher = RtmpPublisher::Create(&client_loop);
+  publisher->SetMediaInfo(TestMediaInfo());
+  ASSERT_EQ(publisher->OpenSocket(AdoptPair(server), kUrl, 3000, status), 0);
+
+  bool has_publisher = false;
+  server->ForEachSession([&has_publisher](const std::string &path, const RtmpSession::Ptr &s) {
+    has_publisher = path == "/adopt/stream" && s->GetPublisher() != nullptr;
+  });
+  EXPECT_TRUE(has_publisher);
+
+  std::vector<uint8_t> frame(1000, 0xab);
+  frame[0] = 0;
+  frame[1] = 0;
+  frame[2] = 0;
+  frame[3] = 1;
+  frame[4] = 0x65;
+  publisher->PushVideoFrame(frame.data(), (uint32_t)frame.size());
+
+  std::atomic<int> frames(0);
+  auto client = RtmpClient::Create(&client_loop);
+  client->SetRecvFrameCB([&frames](uint8_t *payload, uint32_t, uint8_t, uint32_t) {
+    if (payload[1] == 1) {
+      frames++;
+    }
+  });
+  ASSERT_EQ(client->OpenSocket(AdoptPair(server), kUrl, 3000, status), 0);
+
+  // 下一帧到来时拉流端收到 GOP 缓存中的关键帧
+  frame[4] = 0x41;
+  publisher->PushVideoFrame(frame.data(), (uint32_t)frame.size());
+  for (int i = 0; i < 100 && frames.load() < 2; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_GE(frames.load(), 2);
+
+  client->Close();
+  publisher->Close();
+  server->Stop();
+}
+
+TEST(TestAdoptConnection, InvalidUrlClosesSocket) {
+  EventLoop client_loop(1);
+  auto client = RtmpClient::Create(&client_loop);
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  std::string status;
+  EXPECT_EQ(client->OpenSocket(fds[1], "http://127.0.0.1/live", 100, status), -1);
+
+  // 失败时客户端关闭自己的一端, 对端读到 EOF
+  char buf[1];
+  EXPECT_EQ(read(fds[0], buf, sizeof(buf)), 0);
+  close(fds[0]);
+}
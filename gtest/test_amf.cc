@@ -0,0 +1,74 @@
+/// @file test_amf.cc
+/// @brief AMF0 编解码单元测试, 不依赖服务器
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+
+#include "RtmpResponseTemplate.h"
+#include "amf.h"
+
+// 编码一条 connect 命令再用零拷贝读取器读回
+TEST(TestAmfReader, ConnectCommand) {
+  AmfEncoder encoder;
+  AmfObjects objects;
+  objects["app"] = AmfObject(std::string("live"));
+  objects["capabilities"] = AmfObject(255.0);
+  encoder.EncodeString("connect", 7);
+  encoder.EncodeNumber(1.0);
+  encoder.EncodeObjects(objects);
+
+  AmfReader reader(encoder.Data().get(), encoder.Size());
+  AmfStringView method;
+  double transaction_id = 0;
+  AmfValue command_object;
+  EXPECT_TRUE(reader.ReadString(method));
+  EXPECT_TRUE(method == "connect");
+  EXPECT_TRUE(reader.ReadNumber(transaction_id));
+  EXPECT_EQ(transaction_id, 1.0);
+  EXPECT_TRUE(reader.Next(command_object));
+  EXPECT_TRUE(command_object.IsObject());
+  EXPECT_TRUE(reader.IsEnd());
+
+  AmfValue app, capabilities, missing;
+  EXPECT_TRUE(command_object.Find("app", app));
+  EXPECT_EQ(app.string.ToString(), "live");
+  EXPECT_TRUE(command_object.Find("capabilities", capabilities));
+  EXPECT_EQ(capabilities.number, 255.0);
+  EXPECT_FALSE(command_object.Find("tcUrl", missing));
+}
+
+// 截断的数据读取失败且不越界
+TEST(TestAmfReader, Truncated) {
+  AmfEncoder encoder;
+  AmfObjects objects;
+  objects["code"] = AmfObject(std::string("NetStream.Play.Start"));
+  encoder.EncodeObjects(objects);
+
+  for (uint32_t size = 0; size < encoder.Size(); size++) {
+    AmfReader reader(encoder.Data().get(), size);
+    AmfValue value;
+    EXPECT_FALSE(reader.Next(value));
+  }
+}
+
+// 预编码的 createStream 响应改写事务 id 和流 id 之后可以正常解析
+TEST(TestAmfReader, ResponseTemplate) {
+  const AmfTemplate& tpl = RtmpResponseTemplate::Instance().create_stream_result;
+  char buf[128];
+  uint32_t size = tpl.Fill(buf, sizeof(buf), 4.0, 1.0);
+  EXPECT_EQ(size, tpl.size);
+
+  AmfReader reader(buf, size);
+  AmfStringView method;
+  double transaction_id = 0, stream_id = 0;
+  AmfValue null_object;
+  EXPECT_TRUE(reader.ReadString(method));
+  EXPECT_TRUE(method == "_result");
+  EXPECT_TRUE(reader.ReadNumber(transaction_id));
+  EXPECT_TRUE(reader.Next(null_object));
+  EXPECT_TRUE(reader.ReadNumber(stream_id));
+  EXPECT_EQ(transaction_id, 4.0);
+  EXPECT_EQ(stream_id, 1.0);
+}
@@ -0,0 +1,91 @@
+/// @file test_event_notifier.cc
+/// @brief 无锁队列和异步事件通知单元测试, 不依赖服务器
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "MpmcQueue.h"
+#include "RtmpEventNotifier.h"
+
+TEST(TestMpmcQueue, Bounded) {
+  MpmcQueue<int> queue(3);  // 向上取整为 4
+  EXPECT_EQ(queue.Capacity(), 4u);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.Push(i));
+  }
+  EXPECT_FALSE(queue.Push(4));
+
+  int value = -1;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(queue.Pop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_FALSE(queue.Pop(value));
+}
+
+// 多个生产者和消费者, 每个元素恰好被取出一次
+TEST(TestMpmcQueue, Concurrent) {
+  MpmcQueue<int> queue(1024);
+  const int kProducers = 4;
+  const int kPerProducer = 20000;
+  std::atomic<long long> sum(0);
+  std::atomic<int> consumed(0);
+  std::vector<std::thread> threads;
+
+  for (int p = 0; p < kProducers; p++) {
+    threads.emplace_back([&queue, p] {
+      for (int i = 1; i <= kPerProducer; i++) {
+        while (!queue.Push(i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (int c = 0; c < 2; c++) {
+    threads.emplace_back([&] {
+      int value;
+      while (consumed.load() < kProducers * kPerProducer) {
+        if (queue.Pop(value)) {
+          sum += value;
+          consumed++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(sum.load(), (long long)kProducers * kPerProducer * (kPerProducer + 1) / 2);
+}
+
+// 慢回调不阻塞 Post, 队列满时计入丢弃数
+TEST(TestEventNotifier, SlowCallbackDoesNotBlock) {
+  std::atomic<int> delivered(0);
+  {
+    RtmpEventNotifier notifier(8);
+    notifier.AddCallback([&delivered](std::string type, std::string path) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      delivered++;
+    });
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < 100; i++) {
+      notifier.Post("publish.start", "/live/test");
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    EXPECT_LT(elapsed, std::chrono::milliseconds(100));
+    EXPECT_GT(notifier.GetDroppedEvents(), 0u);
+    EXPECT_EQ(notifier.GetPostedEvents() + notifier.GetDroppedEvents(), 100u);
+  }
+  EXPECT_GT(delivered.load(), 0);  // 析构时剩余事件已分发完
+}
@@ -0,0 +1,87 @@
+/// @file test_flv_file.cc
+/// @brief FLV 文件读取
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+#include "FlvFile.h"
+
+namespace {
+
+void AppendTag(std::string &flv, uint8_t type, uint32_t timestamp, const std::string &data) {
+  uint32_t size = (uint32_t)data.size();
+  char header[11] = {(char)type,
+                     (char)(size >> 16),
+                     (char)(size >> 8),
+                     (char)size,
+                     (char)(timestamp >> 16),
+                     (char)(timestamp >> 8),
+                     (char)timestamp,
+                     (char)(timestamp >> 24),
+                     0,
+                     0,
+                     0};
+  flv.append(header, sizeof(header));
+  flv.append(data);
+  uint32_t tag_size = size + 11;
+  char previous[4] = {(char)(tag_size >> 24), (char)(tag_size >> 16), (char)(tag_size >> 8),
+                      (char)tag_size};
+  flv.append(previous, sizeof(previous));
+}
+
+std::string WriteTempFile(const std::string &data) {
+  char path[] = "/tmp/test_flv_XXXXXX";
+  int fd = mkstemp(path);
+  FILE *file = fdopen(fd, "wb");
+  fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+  return path;
+}
+
+}  // namespace
+
+TEST(TestFlvFile, ReadTags) {
+  std::string flv("FLV\x01\x05\x00\x00\x00\x09\x00\x00\x00\x00", 13);
+  AppendTag(flv, FlvFile::kTagVideo, 0, std::string("\x17\x00\x00\x00\x00", 5));
+  AppendTag(flv, FlvFile::kTagAudio, 23, std::string("\xaf\x01\x21", 3));
+  AppendTag(flv, FlvFile::kTagVideo, 0x01000040, std::string("\x27\x01\x00\x00\x00\x41", 6));
+  std::string path = WriteTempFile(flv + std::string("\x09\x00", 2));  // 末尾不完整的 tag
+
+  FlvFile file;
+  ASSERT_TRUE(file.Open(path.c_str()));
+  EXPECT_TRUE(file.HasAudio());
+  EXPECT_TRUE(file.HasVideo());
+
+  FlvTag tag;
+  for (int round = 0; round < 2; round++) {
+    ASSERT_TRUE(file.ReadTag(tag));
+    EXPECT_EQ(tag.type, FlvFile::kTagVideo);
+    EXPECT_EQ(tag.size, 5u);
+    EXPECT_EQ(tag.data[0], 0x17);
+    ASSERT_TRUE(file.ReadTag(tag));
+    EXPECT_EQ(tag.type, FlvFile::kTagAudio);
+    EXPECT_EQ(tag.timestamp, 23u);
+    ASSERT_TRUE(file.ReadTag(tag));
+    EXPECT_EQ(tag.timestamp, 0x01000040u);  // 扩展时间戳是高 8 位
+    EXPECT_EQ(tag.data[5], 0x41);
+    EXPECT_FALSE(file.ReadTag(tag));
+    file.Rewind();
+  }
+
+  file.Close();
+  EXPECT_FALSE(file.IsOpened());
+  remove(path.c_str());
+}
+
+TEST(TestFlvFile, RejectInvalid) {
+  std::string path = WriteTempFile("not an flv file");
+  FlvFile file;
+  EXPECT_FALSE(file.Open(path.c_str()));
+  EXPECT_FALSE(file.Open("/nonexistent/file.flv"));
+  remove(path.c_str());
+}
@@ -0,0 +1,142 @@
+/// @file test_flv_publisher.cc
+/// @brief FLV 文件推流: tag 索引, 按倍速推送, 不限速循环推送时时间戳接着上一轮增长
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "EventLoop.h"
+#include "RtmpClient.h"
+#include "RtmpFlvPublisher.h"
+#include "RtmpServer.h"
+#include "TestHelper.h"
+
+TEST(TestRtmpFlvPublisher, SourceIndex) {
+  char path[] = "/tmp/test_flv_publisher_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_TRUE(WriteTestFlv(path, 500, true));
+
+  EXPECT_EQ(RtmpFlvSource::Open(std::string(path) + ".none"), nullptr);
+  auto source = RtmpFlvSource::Open(path);
+  ASSERT_NE(source, nullptr);
+
+  // 元数据和末尾的关键帧索引不推送, 序列头单独保存
+  EXPECT_EQ(source->GetHeaders().size(), 2u);
+  ASSERT_EQ(source->GetFrames().size(), 100u);
+  EXPECT_EQ(source->GetFrames()[0].timestamp, 0u);
+  EXPECT_EQ(source->GetFrames()[99].timestamp, 1970u);
+  EXPECT_EQ(source->GetDuration(), 2010u);  // 最后一帧加一个视频帧间隔
+  EXPECT_EQ(source->GetBytes(), 50u * 200 + 50u * 3);
+  unlink(path);
+}
+
+TEST(TestRtmpFlvPublisher, PublishAtSpeed) {
+  char path[] = "/tmp/test_flv_publisher_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_TRUE(WriteTestFlv(path, 500, true));
+  auto source = RtmpFlvSource::Open(path);
+  ASSERT_NE(source, nullptr);
+
+  EventLoop server_loop(1);
+  auto server = RtmpServer::Create(&server_loop);
+  EventLoop publisher_loop(1);
+  auto publisher = RtmpFlvPublisher::Create(&publisher_loop, source);
+  publisher->SetSpeed(4.0);  // 2 秒的文件 0.5 秒推完
+
+  auto begin = std::chrono::steady_clock::now();
+  std::string status;
+  ASSERT_EQ(publisher->OpenSocket(AdoptPair(server), "rtmp://127.0.0.1/live/file", 3000, status),
+            0);
+  for (int i = 0; i < 300 && !publisher->IsFinished(); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count();
+
+  EXPECT_TRUE(publisher->IsFinished());
+  EXPECT_EQ(publisher->GetSentFrames(), 100u);
+  EXPECT_EQ(publisher->GetLoops(), 0u);
+  EXPECT_GE(elapsed, 1970 / 4);
+
+  auto session = server->FindSession("/live/file");
+  ASSERT_NE(session, nullptr);
+  for (int i = 0; i < 100 && session->GetStats().video_frames.load() < 50; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(session->GetStats().video_frames.load(), 50u);
+
+  publisher->Close();
+  server->Stop();
+  unlink(path);
+}
+
+TEST(TestRtmpFlvPublisher, UnthrottledLoop) {
+  char path[] = "/tmp/test_flv_publisher_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_TRUE(WriteTestFlv(path, 500, true));
+  auto source = RtmpFlvSource::Open(path);
+  ASSERT_NE(source, nullptr);
+
+  EventLoop server_loop(1);
+  auto server = RtmpServer::Create(&server_loop);
+
+  // 拉流端先进入, 收到推流端从头开始的全部帧
+  std::atomic<int> video(0);
+  std::atomic<bool> monotonic(true);
+  std::atomic<uint32_t> last_timestamp(0);
+  EventLoop client_loop(1);
+  auto client = RtmpClient::Create(&client_loop);
+  client->SetRecvFrameCB([&](uint8_t *payload, uint32_t, uint8_t codec_id, uint32_t timestamp) {
+    if (codec_id == RTMP_CODEC_ID_H264 && payload[1] == 1) {
+      if (video.load() > 0 && timestamp <= last_timestamp.load()) {
+        monotonic = false;
+      }
+      last_timestamp = timestamp;
+      video++;
+    }
+  });
+  std::string status;
+  ASSERT_EQ(client->OpenSocket(AdoptPair(server), "rtmp://127.0.0.1/live/loop", 3000, status), 0);
+
+  EventLoop publisher_loop(1);
+  auto publisher = RtmpFlvPublisher::Create(&publisher_loop, source);
+  publisher->SetSpeed(0);
+  publisher->SetLoop(true);
+  auto begin = std::chrono::steady_clock::now();
+  ASSERT_EQ(publisher->OpenSocket(AdoptPair(server), "rtmp://127.0.0.1/live/loop", 3000, status),
+            0);
+  for (int i = 0; i < 300 && video.load() < 200; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count();
+
+  // 不限速时 4 轮 8 秒的内容远远早于实时推完, 第二轮开始时间戳加上一轮的时长
+  EXPECT_GE(video.load(), 200);
+  EXPECT_TRUE(monotonic.load());
+  EXPECT_GE(last_timestamp.load(), 3u * 2010 + 1960);
+  EXPECT_GE(publisher->GetLoops(), 3u);
+  EXPECT_FALSE(publisher->IsFinished());
+  EXPECT_LT(elapsed, 3000);
+
+  publisher->Close();
+  EXPECT_TRUE(publisher->IsFinished());
+  client->Close();
+  server->Stop();
+  unlink(path);
+}
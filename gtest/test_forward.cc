@@ -0,0 +1,247 @@
+/// @file test_forward.cc
+/// @brief 推流转发: 有界队列拥塞时丢到下一个关键帧, 推流转发到多个上游, 不可达的上游不影响其他上游
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "EventLoop.h"
+#include "RtmpClient.h"
+#include "RtmpFlvPublisher.h"
+#include "RtmpForwarder.h"
+#include "RtmpServer.h"
+#include "TestHelper.h"
+
+namespace {
+
+std::shared_ptr<char> MakeFrame(uint8_t first_byte, uint32_t size) {
+  std::shared_ptr<char> data(new char[size], std::default_delete<char[]>());
+  memset(data.get(), 0, size);
+  data.get()[0] = (char)first_byte;
+  return data;
+}
+
+}  // namespace
+
+TEST(TestRtmpForward, QueueDropsToKeyFrame) {
+  RtmpForwardQueue queue(1000);
+  auto avc_header = MakeFrame(0x17, 20);
+  queue.Push(RTMP_AVC_SEQUENCE_HEADER, 0, avc_header, 20);
+  EXPECT_EQ(queue.Size(), 0u);
+
+  // 从关键帧开始, 先补发序列头
+  queue.Push(RTMP_VIDEO, 0, MakeFrame(0x27, 300), 300);
+  EXPECT_EQ(queue.GetDroppedFrames(), 1u);
+  queue.Push(RTMP_VIDEO, 40, MakeFrame(0x17, 300), 300);
+  queue.Push(RTMP_VIDEO, 80, MakeFrame(0x27, 300), 300);
+  EXPECT_EQ(queue.Size(), 3u);
+  EXPECT_EQ(queue.GetBytes(), 620u);
+
+  // 超过上限: 丢弃排队的帧和之后的非关键帧
+  queue.Push(RTMP_VIDEO, 120, MakeFrame(0x27, 300), 300);
+  queue.Push(RTMP_VIDEO, 160, MakeFrame(0x27, 300), 300);
+  EXPECT_TRUE(queue.IsWaitingKeyFrame());
+  EXPECT_EQ(queue.Size(), 0u);
+  EXPECT_EQ(queue.GetBytes(), 0u);
+  EXPECT_EQ(queue.GetDroppedFrames(), 5u);
+  queue.Push(RTMP_AUDIO, 170, MakeFrame(0xaf, 10), 10);
+  EXPECT_EQ(queue.GetDroppedFrames(), 6u);
+
+  queue.Push(RTMP_VIDEO, 200, MakeFrame(0x17, 300), 300);
+  EXPECT_FALSE(queue.IsWaitingKeyFrame());
+  RtmpForwardQueue::Frame frame;
+  ASSERT_TRUE(queue.Pop(frame));
+  EXPECT_EQ(frame.type, RTMP_AVC_SEQUENCE_HEADER);
+  EXPECT_EQ(frame.data, avc_header);  // 共用数据, 不拷贝
+  ASSERT_TRUE(queue.Pop(frame));
+  EXPECT_EQ(frame.type, RTMP_VIDEO);
+  EXPECT_EQ(frame.timestamp, 200u);
+  EXPECT_FALSE(queue.Pop(frame));
+
+  // 重新连接之后同样从关键帧开始
+  queue.Reset();
+  queue.Push(RTMP_VIDEO, 240, MakeFrame(0x27, 300), 300);
+  EXPECT_EQ(queue.Size(), 0u);
+}
+
+TEST(TestRtmpForward, QueueAudioOnly) {
+  // 没有视频序列头时任意音频帧都是恢复点, 纯音频流不会一直等待关键帧
+  RtmpForwardQueue queue(100);
+  auto aac_header = MakeFrame(0xaf, 4);
+  queue.Push(RTMP_AAC_SEQUENCE_HEADER, 0, aac_header, 4);
+  queue.Push(RTMP_AUDIO, 0, MakeFrame(0xaf, 40), 40);
+  EXPECT_FALSE(queue.IsWaitingKeyFrame());
+  EXPECT_EQ(queue.Size(), 2u);
+  queue.Push(RTMP_AUDIO, 20, MakeFrame(0xaf, 40), 40);
+  EXPECT_EQ(queue.GetDroppedFrames(), 0u);
+
+  // 超过上限时丢弃排队的帧, 当前音频帧立即恢复, 先补发序列头
+  queue.Push(RTMP_AUDIO, 40, MakeFrame(0xaf, 40), 40);
+  EXPECT_FALSE(queue.IsWaitingKeyFrame());
+  EXPECT_EQ(queue.GetDroppedFrames(), 2u);
+  RtmpForwardQueue::Frame frame;
+  ASSERT_TRUE(queue.Pop(frame));
+  EXPECT_EQ(frame.type, RTMP_AAC_SEQUENCE_HEADER);
+  ASSERT_TRUE(queue.Pop(frame));
+  EXPECT_EQ(frame.type, RTMP_AUDIO);
+  EXPECT_EQ(frame.timestamp, 40u);
+  EXPECT_FALSE(queue.Pop(frame));
+
+  // 重新连接之后同样从下一个音频帧开始
+  queue.Reset();
+  EXPECT_TRUE(queue.IsWaitingKeyFrame());
+  queue.Push(RTMP_AUDIO, 60, MakeFrame(0xaf, 40), 40);
+  EXPECT_FALSE(queue.IsWaitingKeyFrame());
+  EXPECT_EQ(queue.Size(), 2u);
+}
+
+TEST(TestRtmpForward, ForwardToUpstreams) {
+  char path[] = "/tmp/test_forward_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_TRUE(WriteTestFlv(path));
+  auto source = RtmpFlvSource::Open(path);
+  ASSERT_NE(source, nullptr);
+
+  EventLoop upstream_loop(1);
+  auto upstream = RtmpServer::Create(&upstream_loop);
+  uint16_t port = FreePort();
+  ASSERT_NE(port, 0);
+  ASSERT_TRUE(upstream->Start("127.0.0.1", port));
+
+  // 第二个上游不可达, 不影响第一个
+  EventLoop ingest_loop(1);
+  auto ingest = RtmpServer::Create(&ingest_loop);
+  RtmpForwardTarget target;
+  target.url = "rtmp://127.0.0.1:" + std::to_string(port) + "/up/";
+  ingest->AddForward("live", target);
+  RtmpForwardTarget dead_target;
+  dead_target.url = "rtmp://127.0.0.1:" + std::to_string(FreePort()) + "/dead";
+  ingest->AddForward("live", dead_target);
+
+  EventLoop publisher_loop(1);
+  auto publisher = RtmpFlvPublisher::Create(&publisher_loop, source);
+  publisher->SetLoop(true);
+  std::string status;
+  ASSERT_EQ(publisher->OpenSocket(AdoptPair(ingest), "rtmp://127.0.0.1/live/fwd", 3000, status),
+            0);
+
+  RtmpSession::Ptr upstream_session;
+  for (int i = 0; i < 300; i++) {
+    upstream_session = upstream->FindSession("/up/fwd");
+    if (upstream_session && upstream_session->GetPublisher()) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_NE(upstream_session, nullptr);
+  ASSERT_NE(upstream_session->GetPublisher(), nullptr);
+
+  EventLoop client_loop(1);
+  std::atomic<int> video{0};
+  std::atomic<bool> has_sequence_header{false};
+  auto client = RtmpClient::Create(&client_loop);
+  client->SetRecvFrameCB([&](uint8_t *payload, uint32_t, uint8_t codec_id, uint32_t) {
+    if (codec_id == RTMP_CODEC_ID_H264 && payload[1] == 0) {
+      has_sequence_header = true;
+    } else if (codec_id == RTMP_CODEC_ID_H264) {
+      video++;
+    }
+  });
+  ASSERT_EQ(client->OpenSocket(AdoptPair(upstream), "rtmp://127.0.0.1/up/fwd", 3000, status), 0);
+  for (int i = 0; i < 300 && video.load() < 25; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_GE(video.load(), 25);
+  EXPECT_TRUE(has_sequence_header.load());
+
+  auto ingest_session = ingest->FindSession("/live/fwd");
+  ASSERT_NE(ingest_session, nullptr);
+  auto forward = ingest_session->GetForward();
+  ASSERT_NE(forward, nullptr);
+  auto stats = forward->GetStats();
+  ASSERT_EQ(stats.size(), 2u);
+  EXPECT_TRUE(stats[0].connected);
+  EXPECT_EQ(stats[0].connects, 1u);
+  EXPECT_GT(stats[0].sent_frames, 0u);
+  EXPECT_FALSE(stats[1].connected);
+  EXPECT_EQ(stats[1].sent_frames, 0u);
+
+  // 推流结束后转发停止, 上游的推流端离开
+  publisher->Close();
+  for (int i = 0; i < 300 && !forward->IsStopped(); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_TRUE(forward->IsStopped());
+  EXPECT_EQ(ingest_session->GetForward(), nullptr);
+  for (int i = 0; i < 300 && upstream_session->GetPublisher() != nullptr; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(upstream_session->GetPublisher(), nullptr);
+
+  client->Close();
+  client.reset();
+  ingest->Stop();
+  upstream->Stop();
+  unlink(path);
+}
+
+TEST(TestRtmpForward, ServerJoinsForwarder) {
+  char path[] = "/tmp/test_forward_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_TRUE(WriteTestFlv(path));
+  auto source = RtmpFlvSource::Open(path);
+  ASSERT_NE(source, nullptr);
+
+  // 上游只监听不握手, 连接线程阻塞在建立连接中
+  int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  ASSERT_EQ(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+  ASSERT_EQ(listen(listen_fd, 4), 0);
+  ASSERT_EQ(getsockname(listen_fd, (struct sockaddr *)&addr, &len), 0);
+
+  EventLoop ingest_loop(1);
+  auto ingest = RtmpServer::Create(&ingest_loop);
+  RtmpForwardTarget target;
+  target.url = "rtmp://127.0.0.1:" + std::to_string(ntohs(addr.sin_port)) + "/up";
+  ingest->AddForward("live", target);
+
+  EventLoop publisher_loop(1);
+  auto publisher = RtmpFlvPublisher::Create(&publisher_loop, source);
+  std::string status;
+  ASSERT_EQ(publisher->OpenSocket(AdoptPair(ingest), "rtmp://127.0.0.1/live/fwd", 3000, status),
+            0);
+  std::shared_ptr<RtmpForwarder> forward;
+  for (int i = 0; i < 300 && forward == nullptr; i++) {
+    auto session = ingest->FindSession("/live/fwd");
+    forward = session ? session->GetForward() : nullptr;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_NE(forward, nullptr);
+  EXPECT_FALSE(forward->IsStopped());
+
+  // 服务器析构时等待连接线程退出, 之后不会再用服务器的事件循环建立连接
+  ingest.reset();
+  EXPECT_TRUE(forward->IsStopped());
+
+  publisher->Close();
+  close(listen_fd);
+  unlink(path);
+}
@@ -0,0 +1,295 @@
+/// @file test_frame_bus.cc
+/// @brief 帧总线: 跨进程读写, 读端被覆盖时跳到关键帧 (纯音频流跳到音频帧), worker 退出后释放槽位, 拉流端播放其他 worker 上的推流
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "RtmpClient.h"
+#include "RtmpFlvPublisher.h"
+#include "RtmpFrameBus.h"
+#include "RtmpServer.h"
+#include "TestHelper.h"
+
+namespace {
+
+struct Frame {
+  uint8_t type;
+  uint64_t timestamp;
+  std::string data;
+};
+
+std::vector<Frame> PollAll(const std::shared_ptr<RtmpFrameBusReader> &reader, int &ret) {
+  std::vector<Frame> frames;
+  ret = reader->Poll(
+      [&frames](uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size) {
+        frames.push_back({type, timestamp, std::string(data.get(), size)});
+      },
+      10000);
+  return frames;
+}
+
+// 帧内容: 第一个字节为 FLV 视频头, 之后是帧序号
+std::string MakeVideo(uint32_t index, bool key_frame, uint32_t size) {
+  std::string frame(size, 'v');
+  frame[0] = key_frame ? 0x17 : 0x27;
+  frame[1] = 0x01;
+  memcpy(&frame[2], &index, sizeof(index));
+  return frame;
+}
+
+uint32_t GetIndex(const Frame &frame) {
+  uint32_t index = 0;
+  memcpy(&index, &frame.data[2], sizeof(index));
+  return index;
+}
+
+}  // namespace
+
+TEST(TestRtmpFrameBus, ReadAcrossProcesses) {
+  RtmpFrameBusOptions options;
+  options.max_streams = 4;
+  options.ring_bytes = 64 * 1024;
+  auto bus = RtmpFrameBus::Create(options);
+  ASSERT_NE(bus, nullptr);
+
+  // 子进程按父进程的指令分三步写入, 每步写完回复一个字节
+  int to_child[2];
+  int to_parent[2];
+  ASSERT_EQ(pipe(to_child), 0);
+  ASSERT_EQ(pipe(to_parent), 0);
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    char step = 0;
+    auto writer = bus->OpenWriter("/live/bus");
+    if (writer == nullptr) {
+      _exit(1);
+    }
+    const char avc_header[] = {0x17, 0x00, 0x00, 0x00, 0x00, 0x01, 0x42};
+    writer->OnMedia(RTMP_AVC_SEQUENCE_HEADER, 0, avc_header, sizeof(avc_header));
+    uint32_t index = 0;
+    for (; index < 10; index++) {
+      std::string frame = MakeVideo(index, index == 0, 1000);
+      writer->OnMedia(RTMP_VIDEO, index * 40, frame.data(), (uint32_t)frame.size());
+    }
+    write(to_parent[1], &step, 1);
+
+    // 写入远超过环大小的数据, 读端被覆盖
+    read(to_child[0], &step, 1);
+    for (; index < 210; index++) {
+      std::string frame = MakeVideo(index, index % 25 == 0, 1000);
+      writer->OnMedia(RTMP_VIDEO, index * 40, frame.data(), (uint32_t)frame.size());
+    }
+    write(to_parent[1], &step, 1);
+
+    read(to_child[0], &step, 1);
+    writer->Close();
+    write(to_parent[1], &step, 1);
+    _exit(0);
+  }
+
+  char step = 0;
+  ASSERT_EQ(read(to_parent[0], &step, 1), 1);
+  EXPECT_TRUE(bus->HasStream("/live/bus"));
+  EXPECT_EQ(bus->GetStreams(), 1u);
+  EXPECT_EQ(bus->OpenWriter("/live/bus"), nullptr);  // 同一个流只能有一个写端
+
+  auto reader = bus->OpenReader("/live/bus");
+  ASSERT_NE(reader, nullptr);
+  int ret = 0;
+  auto frames = PollAll(reader, ret);
+  ASSERT_EQ(ret, 10);
+  ASSERT_EQ(frames.size(), 11u);
+  EXPECT_EQ(frames[0].type, RTMP_AVC_SEQUENCE_HEADER);
+  EXPECT_EQ(frames[0].data.size(), 7u);
+  EXPECT_EQ(frames[1].type, RTMP_VIDEO);
+  EXPECT_EQ(GetIndex(frames[1]), 0u);
+  EXPECT_EQ(GetIndex(frames[10]), 9u);
+  EXPECT_EQ(frames[10].timestamp, 360u);
+
+  // 被覆盖之后从最近的关键帧继续, 之后的帧连续
+  ASSERT_EQ(write(to_child[1], &step, 1), 1);
+  ASSERT_EQ(read(to_parent[0], &step, 1), 1);
+  frames = PollAll(reader, ret);
+  EXPECT_GE(reader->GetOverruns(), 1u);
+  ASSERT_GT(frames.size(), 0u);
+  EXPECT_EQ(GetIndex(frames[0]), 200u);
+  EXPECT_EQ((uint8_t)frames[0].data[0], 0x17);
+  EXPECT_EQ(GetIndex(frames.back()), 209u);
+  EXPECT_EQ(frames.size(), 10u);
+
+  // 写端关闭之后读端返回结束, 槽位可以重新占用
+  ASSERT_EQ(write(to_child[1], &step, 1), 1);
+  ASSERT_EQ(read(to_parent[0], &step, 1), 1);
+  PollAll(reader, ret);
+  EXPECT_EQ(ret, -1);
+  EXPECT_FALSE(bus->HasStream("/live/bus"));
+  EXPECT_EQ(bus->OpenReader("/live/bus"), nullptr);
+
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  EXPECT_NE(bus->OpenWriter("/live/bus"), nullptr);
+}
+
+TEST(TestRtmpFrameBus, AudioOnlyResume) {
+  RtmpFrameBusOptions options;
+  options.max_streams = 1;
+  options.ring_bytes = 64 * 1024;
+  auto bus = RtmpFrameBus::Create(options);
+  ASSERT_NE(bus, nullptr);
+  auto writer = bus->OpenWriter("/live/audio");
+  ASSERT_NE(writer, nullptr);
+
+  // 没有视频序列头, 音频帧就是恢复点, 新的读端从最近的音频帧开始
+  writer->OnMedia(RTMP_AAC_SEQUENCE_HEADER, 0, "\xaf\x00\x12\x10", 4);
+  std::string frame(1000, 'a');
+  frame[0] = (char)0xaf;
+  frame[1] = 0x01;
+  uint32_t index = 0;
+  for (; index < 5; index++) {
+    memcpy(&frame[2], &index, sizeof(index));
+    writer->OnMedia(RTMP_AUDIO, index * 20, frame.data(), (uint32_t)frame.size());
+  }
+  auto reader = bus->OpenReader("/live/audio");
+  ASSERT_NE(reader, nullptr);
+  int ret = 0;
+  auto frames = PollAll(reader, ret);
+  ASSERT_EQ(ret, 1);
+  ASSERT_EQ(frames.size(), 2u);
+  EXPECT_EQ(frames[0].type, RTMP_AAC_SEQUENCE_HEADER);
+  EXPECT_EQ(frames[1].type, RTMP_AUDIO);
+  EXPECT_EQ(GetIndex(frames[1]), 4u);
+
+  // 被覆盖之后从最近的音频帧继续, 不会一直等待视频关键帧
+  for (; index < 200; index++) {
+    memcpy(&frame[2], &index, sizeof(index));
+    writer->OnMedia(RTMP_AUDIO, index * 20, frame.data(), (uint32_t)frame.size());
+  }
+  frames = PollAll(reader, ret);
+  EXPECT_GE(reader->GetOverruns(), 1u);
+  ASSERT_EQ(frames.size(), 1u);
+  EXPECT_EQ(GetIndex(frames[0]), 199u);
+
+  memcpy(&frame[2], &index, sizeof(index));
+  writer->OnMedia(RTMP_AUDIO, index * 20, frame.data(), (uint32_t)frame.size());
+  frames = PollAll(reader, ret);
+  ASSERT_EQ(frames.size(), 1u);
+  EXPECT_EQ(GetIndex(frames[0]), 200u);
+}
+
+TEST(TestRtmpFrameBus, ReleaseCrashedOwner) {
+  RtmpFrameBusOptions options;
+  options.max_streams = 2;
+  options.ring_bytes = 64 * 1024;
+  auto bus = RtmpFrameBus::Create(options);
+  ASSERT_NE(bus, nullptr);
+
+  // 子进程占用槽位之后直接退出, 没有释放
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    auto writer = bus->OpenWriter("/live/crash");
+    _exit(writer ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  // 子进程中 writer 没有析构, 槽位还在
+  EXPECT_TRUE(bus->HasStream("/live/crash"));
+  EXPECT_EQ(bus->ReleaseOwner(pid), 1u);
+  EXPECT_FALSE(bus->HasStream("/live/crash"));
+  EXPECT_EQ(bus->GetStreams(), 0u);
+}
+
+TEST(TestRtmpFrameBus, PlayFromOtherWorker) {
+  char path[] = "/tmp/test_frame_bus_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_TRUE(WriteTestFlv(path));
+  auto source = RtmpFlvSource::Open(path);
+  ASSERT_NE(source, nullptr);
+
+  RtmpFrameBusOptions options;
+  options.max_streams = 4;
+  options.ring_bytes = 1024 * 1024;
+  auto bus = RtmpFrameBus::Create(options);
+  ASSERT_NE(bus, nullptr);
+
+  // 同一个进程中的两个服务器模拟两个 worker
+  EventLoop first_loop(1);
+  auto first_worker = RtmpServer::Create(&first_loop);
+  first_worker->SetFrameBus(bus, 300);
+  EventLoop second_loop(1);
+  auto second_worker = RtmpServer::Create(&second_loop);
+  second_worker->SetFrameBus(bus, 300);
+
+  // 拉流端先进入第二个 worker, 推流端随后在第一个 worker 开始
+  EventLoop client_loop(1);
+  std::atomic<int> video{0};
+  std::atomic<bool> has_sequence_header{false};
+  auto client = RtmpClient::Create(&client_loop);
+  client->SetRecvFrameCB([&](uint8_t *payload, uint32_t, uint8_t codec_id, uint32_t) {
+    if (codec_id == RTMP_CODEC_ID_H264 && payload[1] == 0) {
+      has_sequence_header = true;
+    } else if (codec_id == RTMP_CODEC_ID_H264) {
+      video++;
+    }
+  });
+  std::string status;
+  ASSERT_EQ(client->OpenSocket(AdoptPair(second_worker), "rtmp://127.0.0.1/live/bus", 3000,
+                               status),
+            0);
+
+  EventLoop publisher_loop(1);
+  auto publisher = RtmpFlvPublisher::Create(&publisher_loop, source);
+  publisher->SetLoop(true);
+  ASSERT_EQ(publisher->OpenSocket(AdoptPair(first_worker), "rtmp://127.0.0.1/live/bus", 3000,
+                                  status),
+            0);
+
+  for (int i = 0; i < 300 && video.load() < 25; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_GE(video.load(), 25);
+  EXPECT_TRUE(has_sequence_header.load());
+  EXPECT_TRUE(bus->HasStream("/live/bus"));
+  auto second_session = second_worker->FindSession("/live/bus");
+  ASSERT_NE(second_session, nullptr);
+  EXPECT_EQ(second_session->GetPublisher(), nullptr);
+
+  // 同一个流不能再在另一个 worker 上推
+  auto second_publisher = RtmpFlvPublisher::Create(&publisher_loop, source);
+  second_publisher->OpenSocket(AdoptPair(second_worker), "rtmp://127.0.0.1/live/bus", 1000,
+                               status);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(second_session->GetPublisher(), nullptr);
+  second_publisher->Close();
+
+  // 推流结束后释放槽位
+  publisher->Close();
+  for (int i = 0; i < 300 && bus->HasStream("/live/bus"); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_FALSE(bus->HasStream("/live/bus"));
+
+  client->Close();
+  client.reset();
+  first_worker->Stop();
+  second_worker->Stop();
+  unlink(path);
+}
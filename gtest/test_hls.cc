@@ -0,0 +1,171 @@
+/// @file test_hls.cc
+/// @brief MPEG-TS 封装和内存中的 HLS 切片, HTTP 前缀路由和共享正文
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "HttpServer.h"
+#include "RtmpHls.h"
+#include "TestHelper.h"
+#include "TsMuxer.h"
+#include "rtmp.h"
+
+namespace {
+
+// 一个 NAL 单元的 AVCC 帧
+std::string AvcFrame(bool key_frame, uint32_t nal_size) {
+  std::string data = {(char)(key_frame ? 0x17 : 0x27), 0x01, 0x00, 0x00, 0x00};
+  data += {(char)(nal_size >> 24), (char)(nal_size >> 16), (char)(nal_size >> 8), (char)nal_size};
+  data += (char)(key_frame ? 0x65 : 0x41);
+  data.append(nal_size - 1, (char)0xab);
+  return data;
+}
+
+void Feed(RtmpHls &hls, uint8_t type, uint64_t timestamp, const std::string &data) {
+  hls.OnMedia(type, timestamp, data.data(), (uint32_t)data.size());
+}
+
+// 25 帧每秒, 每 gop_ms 一个关键帧
+void FeedVideo(RtmpHls &hls, uint64_t start_ms, uint64_t end_ms, uint64_t gop_ms) {
+  for (uint64_t ts = start_ms; ts < end_ms; ts += 40) {
+    Feed(hls, RTMP_VIDEO, ts, AvcFrame(ts % gop_ms == 0, 500));
+  }
+}
+
+}  // namespace
+
+TEST(TestHls, Crc32) {
+  const char *check = "123456789";
+  EXPECT_EQ(TsMuxer::Crc32((const uint8_t *)check, 9), 0x0376e6e7u);
+}
+
+TEST(TestHls, TsPackets) {
+  TsMuxer muxer;
+  muxer.SetStreams(true, false);
+  std::string out;
+  muxer.WritePatPmt(out);
+  ASSERT_EQ(out.size(), 2 * TsMuxer::kPacketSize);
+
+  // PAT 和 PMT 的 CRC 覆盖整个 section 时结果为 0
+  const uint8_t *pat = (const uint8_t *)out.data() + 5;
+  EXPECT_EQ(TsMuxer::Crc32(pat, 3 + (((pat[1] & 0x0f) << 8) | pat[2])), 0u);
+  const uint8_t *pmt = (const uint8_t *)out.data() + TsMuxer::kPacketSize + 5;
+  EXPECT_EQ(TsMuxer::Crc32(pmt, 3 + (((pmt[1] & 0x0f) << 8) | pmt[2])), 0u);
+
+  // 不同长度的帧都切成完整的 188 字节包, 连续计数器递增
+  std::vector<uint8_t> frame(1000, 0xab);
+  int packets = 0;
+  for (size_t size : {1, 150, 165, 166, 170, 183, 184, 1000}) {
+    out.clear();
+    muxer.WriteVideo(out, frame.data(), size, 3600, 3600, packets == 0);
+    ASSERT_EQ(out.size() % TsMuxer::kPacketSize, 0u);
+    size_t payload = 0;
+    for (size_t pos = 0; pos < out.size(); pos += TsMuxer::kPacketSize) {
+      const uint8_t *p = (const uint8_t *)out.data() + pos;
+      EXPECT_EQ(p[0], 0x47);
+      EXPECT_EQ(p[3] & 0x0f, packets & 0x0f);
+      size_t header = 4 + ((p[3] & 0x20) ? 1 + p[4] : 0);
+      payload += TsMuxer::kPacketSize - header;
+      packets++;
+    }
+    EXPECT_EQ(payload, size + 14);  // PES 头 9 + 5 字节 PTS
+  }
+}
+
+TEST(TestHls, SegmentAtKeyFrames) {
+  RtmpHls hls("stream", 2000, 3);
+  std::shared_ptr<char> data;
+  uint32_t size = 0;
+  EXPECT_FALSE(hls.GetPlaylist(data, size));
+
+  Feed(hls, RTMP_AVC_SEQUENCE_HEADER, 0, TestAvcSequenceHeader());
+  FeedVideo(hls, 0, 4040, 1000);  // 关键帧 0, 1000, 2000, 3000, 4000
+
+  ASSERT_TRUE(hls.GetPlaylist(data, size));
+  std::string playlist(data.get(), size);
+  EXPECT_NE(playlist.find("#EXT-X-TARGETDURATION:2\n"), std::string::npos);
+  EXPECT_NE(playlist.find("#EXT-X-MEDIA-SEQUENCE:0\n"), std::string::npos);
+  EXPECT_NE(playlist.find("#EXTINF:2.000,\nstream-0.ts\n"), std::string::npos);
+  EXPECT_NE(playlist.find("#EXTINF:2.000,\nstream-1.ts\n"), std::string::npos);
+
+  ASSERT_TRUE(hls.GetSegment(0, data, size));
+  EXPECT_EQ(size % TsMuxer::kPacketSize, 0u);
+  EXPECT_EQ(data.get()[0], 0x47);
+  EXPECT_FALSE(hls.GetSegment(2, data, size));  // 还在写的分片不可读
+
+  // 分片完成后不再修改, 移出播放列表之后引用仍然有效
+  std::shared_ptr<char> first;
+  uint32_t first_size = 0;
+  ASSERT_TRUE(hls.GetSegment(0, first, first_size));
+  FeedVideo(hls, 4040, 10040, 1000);
+  EXPECT_FALSE(hls.GetSegment(0, data, size));
+  EXPECT_TRUE(hls.GetSegment(4, data, size));
+  EXPECT_EQ(first.get()[0], 0x47);
+  EXPECT_EQ(first.use_count(), 1);
+
+  ASSERT_TRUE(hls.GetPlaylist(data, size));
+  playlist.assign(data.get(), size);
+  EXPECT_NE(playlist.find("#EXT-X-MEDIA-SEQUENCE:2\n"), std::string::npos);
+
+  // 推流结束, 最后一个分片也放入列表; 新的推流端序号继续递增
+  hls.Flush();
+  EXPECT_TRUE(hls.GetSegment(5, data, size));
+  hls.Reset();
+  EXPECT_FALSE(hls.GetPlaylist(data, size));
+  Feed(hls, RTMP_AVC_SEQUENCE_HEADER, 0, TestAvcSequenceHeader());
+  FeedVideo(hls, 0, 2040, 1000);
+  EXPECT_TRUE(hls.GetSegment(6, data, size));
+}
+
+TEST(TestHls, PrefixRouteSharedBody) {
+  EventLoop event_loop(1);
+  auto server = HttpServer::Create(&event_loop);
+
+  std::shared_ptr<char> body(new char[5000], std::default_delete<char[]>());
+  memset(body.get(), 'x', 5000);
+  server->AddRoute("/exact", [](const HttpRequest &, HttpResponse &response) {
+    response.body = "exact";
+  });
+  server->AddPrefixRoute("/live/", [body](const HttpRequest &, HttpResponse &response) {
+    response.AddData(body, 5000);
+    response.headers["Cache-Control"] = "no-cache";
+  });
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_TRUE(server->AdoptConnection(fds[0]));
+
+  std::string request = "GET /live/a.m3u8 HTTP/1.1\r\n\r\nGET /exact HTTP/1.1\r\n\r\n";
+  ASSERT_EQ(send(fds[1], request.data(), request.size(), 0), (ssize_t)request.size());
+
+  std::string data;
+  char buf[8192];
+  for (int i = 0; i < 200 && data.find("exact", data.size() > 5 ? data.size() - 5 : 0) ==
+                                 std::string::npos;
+       i++) {
+    ssize_t n = recv(fds[1], buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+      data.append(buf, n);
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+
+  EXPECT_NE(data.find("Content-Length: 5000\r\n"), std::string::npos);
+  EXPECT_NE(data.find("Cache-Control: no-cache\r\n"), std::string::npos);
+  EXPECT_NE(data.find(std::string(5000, 'x')), std::string::npos);
+  EXPECT_NE(data.find("Content-Length: 5\r\n"), std::string::npos);
+
+  close(fds[1]);
+  server->Stop();
+}
@@ -0,0 +1,227 @@
+/// @file test_http_flv.cc
+/// @brief HTTP-FLV 拉流: chunk 封装格式, 起播数据和实时帧, 非法请求
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "HttpFlvConnection.h"
+#include "HttpFlvServer.h"
+#include "RtmpPublisher.h"
+#include "RtmpServer.h"
+#include "TestHelper.h"
+
+namespace {
+
+const char *kUrl = "rtmp://127.0.0.1/live/flv";
+
+// 读到 done 返回 true 或者超时为止
+template <typename Pred>
+void ReadUntil(int fd, std::string &data, Pred done) {
+  char buf[4096];
+  for (int i = 0; i < 200 && !done(data); i++) {
+    ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+      data.append(buf, n);
+    } else if (n == 0) {
+      break;
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+// 解出 chunked 编码的正文, 不完整的 chunk 留在 data 中
+std::string Dechunk(std::string &data) {
+  std::string body;
+  size_t pos = 0;
+  while (true) {
+    size_t crlf = data.find("\r\n", pos);
+    if (crlf == std::string::npos) {
+      break;
+    }
+    size_t size = strtoul(data.c_str() + pos, nullptr, 16);
+    if (crlf + 2 + size + 2 > data.size()) {
+      break;
+    }
+    body.append(data, crlf + 2, size);
+    pos = crlf + 2 + size + 2;
+  }
+  data.erase(0, pos);
+  return body;
+}
+
+struct Tag {
+  uint8_t type;
+  uint32_t timestamp;
+  std::string data;
+};
+
+// 解析 FLV tag 序列, 检查 PreviousTagSize
+bool ParseTags(const std::string &body, std::vector<Tag> &tags) {
+  size_t pos = 0;
+  while (pos + 11 <= body.size()) {
+    const uint8_t *p = (const uint8_t *)body.data() + pos;
+    uint32_t size = (p[1] << 16) | (p[2] << 8) | p[3];
+    if (pos + 11 + size + 4 > body.size()) {
+      return false;
+    }
+    Tag tag;
+    tag.type = p[0];
+    tag.timestamp = ((p[4] << 16) | (p[5] << 8) | p[6]) | (p[7] << 24);
+    tag.data.assign(body, pos + 11, size);
+    const uint8_t *prev = p + 11 + size;
+    if ((uint32_t)((prev[0] << 24) | (prev[1] << 16) | (prev[2] << 8) | prev[3]) != 11 + size) {
+      return false;
+    }
+    tags.push_back(tag);
+    pos += 11 + size + 4;
+  }
+  return pos == body.size();
+}
+
+}  // namespace
+
+TEST(TestHttpFlv, ChunkLayout) {
+  std::shared_ptr<char> payload(new char[300], std::default_delete<char[]>());
+  memset(payload.get(), 0, 300);
+  payload.get()[0] = 0x17;
+  payload.get()[1] = 0x01;
+
+  auto chunk = HttpFlvChunk::Create(RTMP_VIDEO, 0x01020304, payload, 300);
+  EXPECT_TRUE(chunk->is_video);
+  EXPECT_TRUE(chunk->is_key_frame);
+  EXPECT_FALSE(chunk->is_sequence_header);
+  EXPECT_EQ(chunk->payload.get(), payload.get());  // 引用原数据, 不拷贝
+
+  std::string data(chunk->head.get(), chunk->head_size);
+  data.append(chunk->payload.get(), chunk->payload_size);
+  data.append(chunk->tail.get(), chunk->tail_size);
+  ASSERT_EQ(data.compare(0, 5, "13b\r\n"), 0);  // 11 + 300 + 4 = 0x13b
+
+  std::string body = Dechunk(data);
+  EXPECT_TRUE(data.empty());
+  std::vector<Tag> tags;
+  ASSERT_TRUE(ParseTags(body, tags));
+  ASSERT_EQ(tags.size(), 1u);
+  EXPECT_EQ(tags[0].type, RTMP_VIDEO);
+  EXPECT_EQ(tags[0].timestamp, 0x01020304u);
+  EXPECT_EQ(tags[0].data.size(), 300u);
+}
+
+TEST(TestHttpFlv, PlayFromGop) {
+  EventLoop server_loop(1);
+  auto rtmp_server = RtmpServer::Create(&server_loop);
+  rtmp_server->SetGopCache();
+  auto flv_server = HttpFlvServer::Create(&server_loop, rtmp_server);
+
+  std::string status;
+  EventLoop client_loop(1);
+  auto publisher = RtmpPublisher::Create(&client_loop);
+  publisher->SetMediaInfo(TestMediaInfo());
+  ASSERT_EQ(publisher->OpenSocket(AdoptPair(*rtmp_server), kUrl, 3000, status), 0);
+
+  std::vector<uint8_t> frame(1000, 0xab);
+  frame[0] = 0;
+  frame[1] = 0;
+  frame[2] = 0;
+  frame[3] = 1;
+  frame[4] = 0x65;
+  publisher->PushVideoFrame(frame.data(), (uint32_t)frame.size());
+
+  int fd = AdoptPair(*flv_server);
+  ASSERT_NE(fd, INVALID_SOCKET);
+  std::string request = "GET /live/flv.flv HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+  ASSERT_EQ(send(fd, request.data(), request.size(), 0), (ssize_t)request.size());
+
+  std::string data;
+  ReadUntil(fd, data, [](const std::string &d) { return d.find("\r\n\r\n") != std::string::npos; });
+  size_t header_end = data.find("\r\n\r\n");
+  ASSERT_NE(header_end, std::string::npos);
+  EXPECT_EQ(data.compare(0, 15, "HTTP/1.1 200 OK"), 0);
+  EXPECT_NE(data.find("Transfer-Encoding: chunked"), std::string::npos);
+  data.erase(0, header_end + 4);
+
+  // 下一帧到来时起播: 序列头, GOP 中的关键帧, 当前帧
+  frame[4] = 0x41;
+  publisher->PushVideoFrame(frame.data(), (uint32_t)frame.size());
+
+  std::string body;
+  std::vector<Tag> tags;
+  ReadUntil(fd, data, [&body, &tags](std::string &d) {
+    body += Dechunk(d);
+    tags.clear();
+    return body.size() > 13 && ParseTags(body.substr(13), tags) && tags.size() >= 3;
+  });
+
+  ASSERT_GE(body.size(), 13u);
+  EXPECT_EQ(body.compare(0, 3, "FLV"), 0);
+  std::vector<uint8_t> video;
+  for (auto &tag : tags) {
+    if (tag.type == RTMP_VIDEO) {
+      video.push_back((uint8_t)tag.data[0]);
+      video.push_back((uint8_t)tag.data[1]);
+    }
+  }
+  ASSERT_EQ(video.size(), 6u);
+  EXPECT_EQ(video[0], 0x17);  // 序列头
+  EXPECT_EQ(video[1], 0x00);
+  EXPECT_EQ(video[2], 0x17);  // GOP 中的关键帧
+  EXPECT_EQ(video[3], 0x01);
+  EXPECT_EQ(video[4], 0x27);  // 当前帧, 不重复
+  EXPECT_EQ(video[5], 0x01);
+
+  int subscribers = 0;
+  rtmp_server->ForEachSession([&subscribers](const std::string &, const RtmpSession::Ptr &s) {
+    subscribers += s->GetStats().subscribers.load();
+  });
+  EXPECT_EQ(subscribers, 1);
+
+  close(fd);
+  publisher->Close();
+  flv_server->Stop();
+  rtmp_server->Stop();
+}
+
+TEST(TestHttpFlv, NotFound) {
+  EventLoop server_loop(1);
+  auto rtmp_server = RtmpServer::Create(&server_loop);
+  auto flv_server = HttpFlvServer::Create(&server_loop, rtmp_server);
+
+  int fd = AdoptPair(*flv_server);
+  ASSERT_NE(fd, INVALID_SOCKET);
+  std::string request = "GET /live/stream HTTP/1.1\r\n\r\n";
+  ASSERT_EQ(send(fd, request.data(), request.size(), 0), (ssize_t)request.size());
+
+  // 返回 404 之后服务器关闭连接
+  std::string data;
+  char buf[1024];
+  ssize_t n = 0;
+  for (int i = 0; i < 200; i++) {
+    n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+      data.append(buf, n);
+    } else if (n == 0) {
+      break;
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+  EXPECT_EQ(n, 0);
+  EXPECT_EQ(data.compare(0, 22, "HTTP/1.1 404 Not Found"), 0);
+
+  close(fd);
+  flv_server->Stop();
+  rtmp_server->Stop();
+}
@@ -0,0 +1,58 @@
+/// @file test_latency_probe.cc
+/// @brief 延迟探测时间戳的写入和解析
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "RtmpLatencyProbe.h"
+#include "Timestamp.h"
+
+TEST(TestLatencyProbe, SeiRoundTrip) {
+  int64_t now = Timestamp::NowMicros();
+  uint8_t payload[128] = {0x27, 1, 0, 0, 0};
+  uint32_t size = 5;
+  size += RtmpLatencyProbe::WriteSei(payload + size, sizeof(payload) - size, now);
+  EXPECT_EQ(size, 5 + RtmpLatencyProbe::kSeiSize);
+
+  // 探测 SEI 之后跟一个 P 帧 NALU
+  uint8_t nal[] = {0, 0, 0, 4, 0x41, 0x9a, 0x00, 0x00};
+  memcpy(payload + size, nal, sizeof(nal));
+  size += sizeof(nal);
+
+  int64_t stamp = 0;
+  EXPECT_TRUE(RtmpLatencyProbe::ParseSei(payload, size, stamp));
+  EXPECT_EQ(stamp, now);
+
+  // 防竞争: NAL 中不能出现 00 00 0x (x <= 3)
+  const uint8_t *sei = payload + 5 + 4;
+  for (uint32_t i = 0; i + 2 < RtmpLatencyProbe::kSeiSize - 4; i++) {
+    EXPECT_FALSE(sei[i] == 0 && sei[i + 1] == 0 && sei[i + 2] <= 3);
+  }
+}
+
+TEST(TestLatencyProbe, SeiNotFound) {
+  uint8_t payload[] = {0x27, 1, 0, 0, 0, 0, 0, 0, 3, 0x41, 0x9a, 0x01};
+  int64_t stamp = 0;
+  EXPECT_FALSE(RtmpLatencyProbe::ParseSei(payload, sizeof(payload), stamp));
+
+  payload[8] = 200;  // NALU 长度超出消息
+  EXPECT_FALSE(RtmpLatencyProbe::ParseSei(payload, sizeof(payload), stamp));
+  EXPECT_FALSE(RtmpLatencyProbe::ParseSei(payload, 3, stamp));
+}
+
+TEST(TestLatencyProbe, AmfRoundTrip) {
+  int64_t now = Timestamp::NowMicros();
+  char buf[RtmpLatencyProbe::kAmfSize];
+  uint32_t size = RtmpLatencyProbe::WriteAmf(buf, sizeof(buf), now);
+  EXPECT_EQ(size, RtmpLatencyProbe::kAmfSize);
+
+  int64_t stamp = 0;
+  EXPECT_TRUE(RtmpLatencyProbe::ParseAmf(buf, size, stamp));
+  EXPECT_EQ(stamp, now);
+  EXPECT_FALSE(RtmpLatencyProbe::ParseAmf(buf, size - 1, stamp));
+  EXPECT_EQ(RtmpLatencyProbe::WriteAmf(buf, size - 1, now), 0u);
+}
@@ -0,0 +1,387 @@
+/// @file test_ll_hls.cc
+/// @brief CMAF 分片 MP4 封装, 低延迟 HLS 的部分分片, 阻塞的播放列表请求和 chunked 发送的分片
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "Fmp4Muxer.h"
+#include "HttpServer.h"
+#include "RtmpLlHls.h"
+#include "TestHelper.h"
+#include "rtmp.h"
+
+namespace {
+
+std::string AvcFrame(bool key_frame, uint32_t nal_size) {
+  std::string data = {(char)(key_frame ? 0x17 : 0x27), 0x01, 0x00, 0x00, 0x00};
+  data += {(char)(nal_size >> 24), (char)(nal_size >> 16), (char)(nal_size >> 8), (char)nal_size};
+  data += (char)(key_frame ? 0x65 : 0x41);
+  data.append(nal_size - 1, (char)0xab);
+  return data;
+}
+
+// 25 帧每秒, 每 gop_ms 一个关键帧
+void FeedVideo(RtmpLlHls &hls, uint64_t start_ms, uint64_t end_ms, uint64_t gop_ms) {
+  for (uint64_t ts = start_ms; ts < end_ms; ts += 40) {
+    std::string frame = AvcFrame(ts % gop_ms == 0, 200);
+    hls.OnMedia(RTMP_VIDEO, ts, frame.data(), (uint32_t)frame.size());
+  }
+}
+
+uint32_t ReadU32(const std::string &data, size_t pos) {
+  const uint8_t *p = (const uint8_t *)data.data() + pos;
+  return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// 在 [begin, end) 中查找 type 盒子, 返回盒子起始位置
+size_t FindBox(const std::string &data, size_t begin, size_t end, const char *type) {
+  while (begin + 8 <= end) {
+    uint32_t size = ReadU32(data, begin);
+    if (size < 8 || begin + size > end) {
+      break;
+    }
+    if (data.compare(begin + 4, 4, type) == 0) {
+      return begin;
+    }
+    begin += size;
+  }
+  return std::string::npos;
+}
+
+size_t FindPath(const std::string &data, const std::vector<const char *> &path) {
+  size_t begin = 0, end = data.size(), pos = 0;
+  for (const char *type : path) {
+    pos = FindBox(data, begin, end, type);
+    if (pos == std::string::npos) {
+      return pos;
+    }
+    end = pos + ReadU32(data, pos);
+    begin = pos + 8;
+  }
+  return pos;
+}
+
+std::string GetFile(RtmpLlHls &hls, bool playlist) {
+  std::shared_ptr<char> data;
+  uint32_t size = 0;
+  bool found = playlist ? hls.GetPlaylist(data, size) : hls.GetInit(data, size);
+  return found ? std::string(data.get(), size) : std::string();
+}
+
+// 读到 needle 出现或者超时
+bool ReadUntil(int fd, std::string &data, const std::string &needle, int timeout_ms = 2000) {
+  char buf[8192];
+  for (int i = 0; i < timeout_ms / 10; i++) {
+    if (data.find(needle) != std::string::npos) {
+      return true;
+    }
+    ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+      data.append(buf, n);
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+  return data.find(needle) != std::string::npos;
+}
+
+class LlHlsHttpTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    server_ = HttpServer::Create(&event_loop_);
+    server_->AddAsyncPrefixRoute("/ll/", [this](const HttpRequest &request,
+                                                std::shared_ptr<HttpResponder> responder) {
+      hls_.Serve(request.path.substr(request.path.rfind('/') + 1), request, responder);
+    });
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_), 0);
+    ASSERT_TRUE(server_->AdoptConnection(fds_[0]));
+
+    std::string header = TestAvcSequenceHeader();
+    hls_.OnMedia(RTMP_AVC_SEQUENCE_HEADER, 0, header.data(), (uint32_t)header.size());
+  }
+
+  void TearDown() override {
+    close(fds_[1]);
+    server_->Stop();
+  }
+
+  void Request(const std::string &uri) {
+    std::string request = "GET " + uri + " HTTP/1.1\r\n\r\n";
+    ASSERT_EQ(send(fds_[1], request.data(), request.size(), 0), (ssize_t)request.size());
+  }
+
+  EventLoop event_loop_{1};
+  std::shared_ptr<HttpServer> server_;
+  RtmpLlHls hls_{"stream", 1000, 200, 3};
+  int fds_[2] = {-1, -1};
+};
+
+}  // namespace
+
+TEST(TestLlHls, InitSegment) {
+  uint32_t width = 0, height = 0;
+  Fmp4Muxer::ParseAvcSize(TestAvcConfig(), width, height);
+  EXPECT_EQ(width, 1280u);
+  EXPECT_EQ(height, 720u);
+
+  uint32_t sample_rate = 0, channels = 0;
+  ASSERT_TRUE(Fmp4Muxer::ParseAacConfig(std::string({0x12, 0x10}), sample_rate, channels));
+  EXPECT_EQ(sample_rate, 44100u);
+  EXPECT_EQ(channels, 2u);
+
+  std::string init;
+  Fmp4Muxer::WriteInit(init, TestAvcConfig(), std::string({0x12, 0x10}));
+  ASSERT_EQ(FindPath(init, {"ftyp"}), 0u);
+  size_t moov = FindPath(init, {"moov"});
+  ASSERT_NE(moov, std::string::npos);
+  EXPECT_EQ(moov + ReadU32(init, moov), init.size());
+
+  // 视频轨道的 avcC 原样保存编码参数, 音频轨道的时间刻度为采样率
+  size_t avcc = FindPath(init, {"moov", "trak", "mdia", "minf", "stbl", "stsd"});
+  ASSERT_NE(avcc, std::string::npos);
+  EXPECT_NE(init.find(TestAvcConfig(), avcc), std::string::npos);
+  size_t mvex = FindPath(init, {"moov", "mvex", "trex"});
+  ASSERT_NE(mvex, std::string::npos);
+  EXPECT_EQ(ReadU32(init, mvex + 12), (uint32_t)Fmp4Muxer::kVideoTrackId);
+  EXPECT_NE(init.find("mp4a"), std::string::npos);
+  EXPECT_NE(init.find("esds"), std::string::npos);
+}
+
+TEST(TestLlHls, FragmentLayout) {
+  std::string video_data(300, 'v');
+  std::string audio_data(50, 'a');
+  std::vector<Fmp4Muxer::Sample> video(2), audio(1);
+  video[0].size = 100;
+  video[0].duration = 3600;
+  video[1].offset = 100;
+  video[1].size = 200;
+  video[1].duration = 3600;
+  video[1].key_frame = false;
+  audio[0].size = 50;
+  audio[0].duration = 1024;
+
+  Fmp4Muxer::Track video_track;
+  video_track.base_time = 90000;
+  video_track.samples = &video;
+  video_track.data = video_data.data();
+  Fmp4Muxer::Track audio_track;
+  audio_track.samples = &audio;
+  audio_track.data = audio_data.data();
+
+  std::string fragment;
+  Fmp4Muxer::WriteFragment(fragment, 7, video_track, audio_track);
+  size_t moof = FindPath(fragment, {"moof"});
+  size_t mdat = FindPath(fragment, {"mdat"});
+  ASSERT_EQ(moof, 0u);
+  ASSERT_NE(mdat, std::string::npos);
+  EXPECT_EQ(ReadU32(fragment, mdat), 8u + 300 + 50);
+  EXPECT_EQ(fragment.size(), mdat + 8 + 350);
+  EXPECT_EQ(ReadU32(fragment, FindPath(fragment, {"moof", "mfhd"}) + 12), 7u);
+
+  // 两个轨道的 data_offset 分别指向 mdat 中各自的数据
+  size_t traf = FindPath(fragment, {"moof", "traf"});
+  size_t tfdt = FindBox(fragment, traf + 8, traf + ReadU32(fragment, traf), "tfdt");
+  EXPECT_EQ(ReadU32(fragment, tfdt + 16), 90000u);
+  size_t trun = FindBox(fragment, traf + 8, traf + ReadU32(fragment, traf), "trun");
+  EXPECT_EQ(ReadU32(fragment, trun + 12), 2u);
+  EXPECT_EQ(ReadU32(fragment, trun + 16), mdat + 8);
+
+  size_t audio_traf = traf + ReadU32(fragment, traf);
+  size_t audio_trun =
+      FindBox(fragment, audio_traf + 8, audio_traf + ReadU32(fragment, audio_traf), "trun");
+  ASSERT_NE(audio_trun, std::string::npos);
+  EXPECT_EQ(ReadU32(fragment, audio_trun + 16), mdat + 8 + 300);
+  EXPECT_EQ(fragment.substr(mdat + 8 + 300), audio_data);
+}
+
+TEST(TestLlHls, PartsAndPlaylist) {
+  RtmpLlHls hls("stream", 1000, 200, 3);
+  EXPECT_TRUE(GetFile(hls, true).empty());
+
+  std::string header = TestAvcSequenceHeader();
+  hls.OnMedia(RTMP_AVC_SEQUENCE_HEADER, 0, header.data(), (uint32_t)header.size());
+  FeedVideo(hls, 0, 2040, 1000);  // 关键帧 0, 1000, 2000
+
+  std::string init = GetFile(hls, false);
+  EXPECT_EQ(init.compare(4, 4, "ftyp"), 0);
+
+  std::string playlist = GetFile(hls, true);
+  EXPECT_NE(playlist.find("#EXT-X-PART-INF:PART-TARGET=0.200\n"), std::string::npos);
+  EXPECT_NE(playlist.find("CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=0.600\n"), std::string::npos);
+  EXPECT_NE(playlist.find("#EXT-X-MAP:URI=\"stream-init.mp4\"\n"), std::string::npos);
+  EXPECT_NE(playlist.find("#EXT-X-PART:DURATION=0.200,URI=\"stream-0.0.m4s\",INDEPENDENT=YES\n"),
+            std::string::npos);
+  EXPECT_NE(playlist.find("#EXT-X-PART:DURATION=0.200,URI=\"stream-0.4.m4s\"\n"),
+            std::string::npos);
+  EXPECT_EQ(playlist.find("stream-0.5.m4s"), std::string::npos);
+  EXPECT_NE(playlist.find("#EXTINF:1.000,\nstream-0.m4s\n#EXT-X-PART"), std::string::npos);
+  EXPECT_NE(playlist.find("#EXTINF:1.000,\nstream-1.m4s\n"), std::string::npos);
+  EXPECT_NE(playlist.find("#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"stream-2.0.m4s\"\n"),
+            std::string::npos);
+
+  // 推流结束, 剩下的帧切成最后一个部分分片; 新的推流端序号继续递增
+  hls.Flush();
+  playlist = GetFile(hls, true);
+  EXPECT_NE(playlist.find("#EXTINF:0.040,\nstream-2.m4s\n"), std::string::npos);
+  EXPECT_EQ(playlist.find("PRELOAD-HINT"), std::string::npos);
+
+  hls.Reset();
+  EXPECT_TRUE(GetFile(hls, true).empty());
+  hls.OnMedia(RTMP_AVC_SEQUENCE_HEADER, 0, header.data(), (uint32_t)header.size());
+  FeedVideo(hls, 0, 1040, 1000);
+  playlist = GetFile(hls, true);
+  EXPECT_NE(playlist.find("#EXT-X-MEDIA-SEQUENCE:3\n"), std::string::npos);
+}
+
+TEST_F(LlHlsHttpTest, BlockingReload) {
+  FeedVideo(hls_, 0, 1040, 1000);  // 分片 0 完成, 分片 1 还没有部分分片
+
+  // 请求太靠后的分片直接返回 400
+  std::string data;
+  Request("/ll/stream.m3u8?_HLS_msn=9");
+  ASSERT_TRUE(ReadUntil(fds_[1], data, "400 Bad Request"));
+
+  data.clear();
+  Request("/ll/stream.m3u8?_HLS_msn=1&_HLS_part=1");
+  EXPECT_FALSE(ReadUntil(fds_[1], data, "HTTP/1.1", 100));
+
+  // 分片 1 的第二个部分分片生成后响应, 后面的流水线请求按顺序响应
+  Request("/ll/stream-init.mp4");
+  FeedVideo(hls_, 1040, 1440, 1000);
+  ASSERT_TRUE(ReadUntil(fds_[1], data, "ftyp"));
+  size_t playlist = data.find("HTTP/1.1 200 OK");
+  size_t init = data.find("Content-Type: video/mp4");
+  EXPECT_LT(playlist, init);
+  EXPECT_NE(data.find("URI=\"stream-1.1.m4s\""), std::string::npos);
+  EXPECT_NE(data.find("PRELOAD-HINT:TYPE=PART,URI=\"stream-1.2.m4s\""), std::string::npos);
+
+  // 预加载提示的部分分片生成后立即返回
+  data.clear();
+  Request("/ll/stream-1.2.m4s");
+  EXPECT_FALSE(ReadUntil(fds_[1], data, "HTTP/1.1", 100));
+  FeedVideo(hls_, 1440, 1640, 1000);
+  ASSERT_TRUE(ReadUntil(fds_[1], data, "moof"));
+  EXPECT_NE(data.find("Content-Type: video/mp4"), std::string::npos);
+
+  data.clear();
+  Request("/ll/stream-1.9.m4s");
+  EXPECT_TRUE(ReadUntil(fds_[1], data, "404 Not Found"));
+}
+
+TEST_F(LlHlsHttpTest, ChunkedSegment) {
+  FeedVideo(hls_, 0, 1440, 1000);  // 分片 1 已经有两个部分分片
+
+  std::string data;
+  Request("/ll/stream-1.m4s");
+  ASSERT_TRUE(ReadUntil(fds_[1], data, "Transfer-Encoding: chunked\r\n"));
+
+  // 分片在关键帧处结束, 最后一个 chunk 发送后响应结束
+  FeedVideo(hls_, 1440, 2040, 1000);
+  ASSERT_TRUE(ReadUntil(fds_[1], data, "\r\n0\r\n\r\n"));
+
+  size_t pos = data.find("\r\n\r\n") + 4;
+  std::string body;
+  while (pos < data.size()) {
+    size_t line_end = data.find("\r\n", pos);
+    uint32_t size = (uint32_t)strtoul(data.c_str() + pos, nullptr, 16);
+    if (size == 0) {
+      break;
+    }
+    body.append(data, line_end + 2, size);
+    pos = line_end + 2 + size + 2;
+  }
+
+  // chunked 发送的内容和完成后的整个分片相同
+  std::string complete;
+  Request("/ll/stream-1.m4s");
+  ASSERT_TRUE(ReadUntil(fds_[1], complete, "Content-Length: " + std::to_string(body.size())));
+  ASSERT_TRUE(ReadUntil(fds_[1], complete, body));
+  EXPECT_EQ(body.compare(4, 4, "moof"), 0);
+  EXPECT_NE(complete.find("Cache-Control: public"), std::string::npos);
+}
+
+TEST_F(LlHlsHttpTest, ChunkedSegmentTimeout) {
+  FeedVideo(hls_, 0, 1440, 1000);
+
+  // 推流端停顿, 三个目标时长 (3 秒) 之后结束 chunked 响应, 流水线中的下一个请求继续处理
+  std::string data;
+  Request("/ll/stream-1.m4s");
+  Request("/ll/stream-init.mp4");
+  ASSERT_TRUE(ReadUntil(fds_[1], data, "Transfer-Encoding: chunked\r\n"));
+  EXPECT_FALSE(ReadUntil(fds_[1], data, "\r\n0\r\n\r\n", 2000));
+  ASSERT_TRUE(ReadUntil(fds_[1], data, "\r\n0\r\n\r\n", 2000));
+  ASSERT_TRUE(ReadUntil(fds_[1], data, "ftyp"));
+  EXPECT_EQ(data.find("503"), std::string::npos);
+}
+
+// 触发事件队列满时响应投递失败, 连接被关闭而不是一直等待
+TEST(TestHttpResponder, TriggerQueueFullClosesConnection) {
+  EventLoop event_loop(1);
+  auto server = HttpServer::Create(&event_loop);
+  std::shared_ptr<HttpResponder> pending;
+  std::atomic<bool> received{false};
+  server->AddAsyncPrefixRoute("/wait/", [&](const HttpRequest &,
+                                            std::shared_ptr<HttpResponder> responder) {
+    pending = responder;
+    received = true;
+  });
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_TRUE(server->AdoptConnection(fds[0]));
+
+  std::string request = "GET /wait/a HTTP/1.1\r\n\r\n";
+  ASSERT_EQ(send(fds[1], request.data(), request.size(), 0), (ssize_t)request.size());
+  for (int i = 0; i < 200 && !received; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_TRUE(received.load());
+
+  // 阻塞调度器线程并填满触发事件队列
+  std::atomic<bool> release{false};
+  auto scheduler = event_loop.GetTaskScheduler();
+  ASSERT_TRUE(scheduler->AddTriggerEvent([&release] {
+    while (!release) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }));
+  while (scheduler->AddTriggerEvent([] {})) {
+  }
+
+  HttpResponse response;
+  response.body = "late";
+  pending->Send(response);
+  EXPECT_TRUE(pending->IsDone());
+  release = true;
+
+  // 读到 EOF, 没有响应
+  std::string data;
+  char buf[1024];
+  ssize_t n = 0;
+  for (int i = 0; i < 200; i++) {
+    n = recv(fds[1], buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0) {
+      data.append(buf, n);
+    } else if (n == 0) {
+      break;
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+  EXPECT_EQ(n, 0);
+  EXPECT_EQ(data.find("late"), std::string::npos);
+
+  close(fds[1]);
+  pending.reset();
+  server->Stop();
+}
@@ -0,0 +1,46 @@
+/// @file test_logger.cc
+/// @brief 异步日志单元测试, 不依赖服务器
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+
+// 多线程写日志, Exit 之后日志文件中每条都完整且各占一行
+TEST(TestLogger, MultiThreadToFile) {
+  char path[] = "/tmp/rtmp_server_test_logger.log";
+  Logger::Instance().Init(path);
+
+  const int kThreads = 4;
+  const int kLines = 100;  // 小于单个线程日志环的容量, 不会丢弃
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([t] {
+      for (int i = 0; i < kLines; i++) {
+        LOG_INFO("thread %d line %d\n", t, i);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  Logger::Instance().Exit();
+
+  std::ifstream ifs(path);
+  std::string line;
+  int count = 0;
+  while (std::getline(ifs, line)) {
+    if (line.find("[INFO] thread ") != std::string::npos) {
+      count++;
+    }
+  }
+  EXPECT_EQ(count, kThreads * kLines);
+  EXPECT_EQ(Logger::Instance().GetDroppedLogs(), 0u);
+}
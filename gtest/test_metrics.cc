@@ -0,0 +1,201 @@
+/// @file test_metrics.cc
+/// @brief 统计计数器单元测试, 不依赖服务器
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <thread>
+#include <vector>
+
+#include "BufferWriter.h"
+#include "FrameTrace.h"
+#include "HttpServer.h"
+#include "LatencyHistogram.h"
+#include "Metrics.h"
+#include "RtmpStartupStats.h"
+#include "Timestamp.h"
+
+TEST(TestMetrics, CounterAcrossThreads) {
+  MetricCounter counter;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 20; t++) {  // 线程数多于槽位数时共享槽位
+    threads.emplace_back([&counter] {
+      for (int i = 0; i < 10000; i++) {
+        counter.Add();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(counter.Value(), 200000u);
+}
+
+TEST(TestMetrics, StreamGop) {
+  StreamStats stats;
+  // 关键帧 + 4 个 P 帧, 再来一个关键帧时上一个 GOP 结束
+  stats.OnFrame(true, true, 1000);
+  for (int i = 0; i < 4; i++) {
+    stats.OnFrame(true, false, 100);
+  }
+  stats.OnFrame(false, false, 10);
+  stats.OnFrame(true, true, 1000);
+
+  EXPECT_EQ(stats.gop_frames.load(), 5u);
+  EXPECT_EQ(stats.video_frames.load(), 6u);
+  EXPECT_EQ(stats.audio_frames.load(), 1u);
+  EXPECT_EQ(stats.bytes_in.load(), 2410u);
+}
+
+TEST(TestMetrics, StreamRateDecay) {
+  StreamStats stats;
+  // 在单调时钟每秒的 100ms 处推一批帧, 连推三秒, 第三批滚动出第二秒的码率
+  int64_t to_next_second = 1000000000 - Timestamp::NowNanos() % 1000000000;
+  std::this_thread::sleep_for(std::chrono::nanoseconds(to_next_second + 100000000));
+  for (int second = 0; second < 3; second++) {
+    for (int i = 0; i < 10; i++) {
+      stats.OnFrame(true, i == 0, 1000);
+    }
+    if (second < 2) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    }
+  }
+  EXPECT_GT(stats.GetBitrate(), 0u);
+  EXPECT_GT(stats.GetFps(), 0u);
+
+  // 断流之后读取时归零
+  std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+  EXPECT_EQ(stats.GetBitrate(), 0u);
+  EXPECT_EQ(stats.GetFps(), 0u);
+  EXPECT_GT(stats.bitrate_bps.load(), 0u);
+}
+
+TEST(TestMetrics, HttpQuery) {
+  HttpRequest request;
+  request.query = "format=json&stream=/live/a&empty=";
+  EXPECT_EQ(request.GetQuery("format"), "json");
+  EXPECT_EQ(request.GetQuery("stream"), "/live/a");
+  EXPECT_EQ(request.GetQuery("empty"), "");
+  EXPECT_EQ(request.GetQuery("form"), "");
+}
+
+TEST(TestMetrics, HistogramBuckets) {
+  // 每个值都落在上界不小于它的桶中, 且误差不超过 1/16
+  for (uint64_t v : {0ULL, 1ULL, 15ULL, 16ULL, 17ULL, 100ULL, 1000ULL, 123456789ULL}) {
+    int index = LatencyHistogram::BucketIndex(v);
+    uint64_t upper = LatencyHistogram::BucketUpperBound(index);
+    EXPECT_GE(upper, v);
+    EXPECT_LE(upper - v, v / 16 + 1);
+    if (index > 0) {
+      EXPECT_LT(LatencyHistogram::BucketUpperBound(index - 1), v);
+    }
+  }
+  EXPECT_LT(LatencyHistogram::BucketIndex(~0ULL), LatencyHistogram::kBucketCount);
+}
+
+TEST(TestMetrics, HistogramPercentile) {
+  LatencyHistogram histogram;
+  for (uint64_t i = 1; i <= 1000; i++) {
+    histogram.Record(i * 1000);  // 1us ~ 1ms
+  }
+
+  LatencyHistogram::Snapshot snapshot = histogram.GetSnapshot();
+  EXPECT_EQ(snapshot.count, 1000u);
+  EXPECT_EQ(snapshot.max, 1000000u);
+  EXPECT_NEAR((double)snapshot.Percentile(0.5), 500000.0, 500000.0 / 16);
+  EXPECT_NEAR((double)snapshot.Percentile(0.99), 990000.0, 990000.0 / 16);
+  EXPECT_EQ(snapshot.Percentile(1.0), 1000000u);
+  EXPECT_NEAR(snapshot.Mean(), 500500.0, 1.0);
+
+  // 单写者版本记录的结果相同
+  LatencyHistogram single;
+  for (uint64_t i = 1; i <= 1000; i++) {
+    single.RecordSingleWriter(i * 1000);
+  }
+  LatencyHistogram::Snapshot single_snapshot = single.GetSnapshot();
+  EXPECT_EQ(single_snapshot.count, snapshot.count);
+  EXPECT_EQ(single_snapshot.sum, snapshot.sum);
+  EXPECT_EQ(single_snapshot.max, snapshot.max);
+  EXPECT_EQ(single_snapshot.buckets, snapshot.buckets);
+}
+
+// 带 trace 的包全部写入内核后记录 send 和 total 阶段
+TEST(TestMetrics, EgressTraceOnSent) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+  auto frame = std::make_shared<FrameTrace>();
+  frame->latency = std::make_shared<StreamLatency>();
+  frame->recv_ns = Timestamp::NowNanos();
+  auto egress = std::make_shared<EgressTrace>();
+  egress->frame = frame;
+  egress->run_ns = Timestamp::NowNanos();
+
+  BufferWriter writer;
+  std::shared_ptr<char> data(new char[100](), std::default_delete<char[]>());
+  EXPECT_TRUE(writer.Append(data, 100, 0, egress));
+  EXPECT_TRUE(writer.Append(data, 100));  // 未采样的包
+  EXPECT_EQ(writer.QueuedBytes(), 200u);
+  writer.Send(fds[0]);
+  writer.Send(fds[0]);
+  EXPECT_TRUE(writer.IsEmpty());
+  EXPECT_EQ(writer.SentBytes(), 200u);
+
+  EXPECT_EQ(frame->latency->send_ns.Count(), 1u);
+  EXPECT_EQ(frame->latency->total_ns.Count(), 1u);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+TEST(TestMetrics, PlayerStartupStages) {
+  RtmpStartupStats stats;
+  auto startup = std::make_shared<StartupTrace>();
+  startup->accept_ns = 1000;
+  startup->handshake_ns = 2000;
+  startup->connect_ns = 3000;
+  startup->create_stream_ns = 4000;
+  startup->play_ns = 5000;
+  startup->sequence_header_ns = 6000;
+  startup->latency = stats.Get("live");
+  EXPECT_EQ(stats.Get("live"), startup->latency);
+
+  auto trace = std::make_shared<StartupPacketTrace>();
+  trace->startup = startup;
+  trace->OnSent(10000);
+  trace->OnSent(20000);  // 只记录第一次
+
+  const StartupLatency &latency = *startup->latency;
+  EXPECT_EQ(latency.handshake_ns.Count(), 1u);
+  EXPECT_EQ(latency.play_ns.Count(), 1u);
+  EXPECT_EQ(latency.first_keyframe_ns.Count(), 1u);
+  EXPECT_EQ(latency.total_ns.GetSnapshot().sum, 9000u);
+  EXPECT_EQ(latency.first_keyframe_ns.GetSnapshot().sum, 4000u);
+
+  // 没有发生的阶段不记录
+  auto partial = std::make_shared<StartupTrace>();
+  partial->accept_ns = 1000;
+  partial->latency = startup->latency;
+  partial->OnFirstKeyFrameSent(3000);
+  EXPECT_EQ(latency.handshake_ns.Count(), 1u);
+  EXPECT_EQ(latency.total_ns.Count(), 2u);
+}
+
+TEST(TestMetrics, PlayerStartupAppLimit) {
+  RtmpStartupStats stats;
+  for (size_t i = 0; i < RtmpStartupStats::kMaxApps + 10; i++) {
+    stats.Get("app" + std::to_string(i));
+  }
+  size_t apps = 0;
+  bool has_overflow = false;
+  stats.ForEach([&](const std::string &app, const StartupLatency &) {
+    apps++;
+    has_overflow |= (app == RtmpStartupStats::kOverflowApp);
+  });
+  EXPECT_EQ(apps, RtmpStartupStats::kMaxApps + 1);
+  EXPECT_TRUE(has_overflow);
+}
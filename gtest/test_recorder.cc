@@ -0,0 +1,300 @@
+/// @file test_recorder.cc
+/// @brief FLV 写文件和写线程录制
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FlvFile.h"
+#include "FlvWriter.h"
+#include "RtmpRecorder.h"
+#include "rtmp.h"
+
+namespace {
+
+std::shared_ptr<char> MakeData(const std::string &data) {
+  std::shared_ptr<char> buffer(new char[data.size()], std::default_delete<char[]>());
+  memcpy(buffer.get(), data.data(), data.size());
+  return buffer;
+}
+
+std::vector<std::string> ListFiles(const std::string &dir) {
+  std::vector<std::string> files;
+  DIR *d = opendir(dir.c_str());
+  while (struct dirent *entry = readdir(d)) {
+    if (entry->d_name[0] != '.') {
+      files.push_back(dir + "/" + entry->d_name);
+    }
+  }
+  closedir(d);
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+void RemoveDir(const std::string &dir) {
+  for (auto &file : ListFiles(dir)) {
+    unlink(file.c_str());
+  }
+  rmdir(dir.c_str());
+}
+
+}  // namespace
+
+TEST(TestFlvWriter, WriteAndIndex) {
+  char path[] = "/tmp/test_flv_writer_XXXXXX";
+  close(mkstemp(path));
+
+  // 缓冲区比数据小, 覆盖多次写满后落盘
+  FlvWriter writer(4096, 1 << 20, true);
+  ASSERT_TRUE(writer.Open(path, true, true));
+  std::string key(3000, 'k'), inter(1000, 'i');
+  key[0] = 0x17;
+  inter[0] = 0x27;
+  ASSERT_TRUE(writer.WriteTag(9, 0, "\x17\x00\x00\x00\x00", 5));  // 序列头不进索引
+  uint64_t first_key = writer.GetSize();
+  ASSERT_TRUE(writer.WriteTag(9, 0, key.data(), (uint32_t)key.size()));
+  ASSERT_TRUE(writer.WriteTag(9, 40, inter.data(), (uint32_t)inter.size()));
+  uint64_t second_key = writer.GetSize();
+  ASSERT_TRUE(writer.WriteTag(9, 2000, key.data(), (uint32_t)key.size()));
+  ASSERT_TRUE(writer.WriteTag(8, 2010, "\xaf\x01\x21", 3));
+  EXPECT_EQ(writer.GetKeyFrames(), 2u);
+  EXPECT_EQ(writer.GetDuration(), 2010u);
+  writer.Close();
+  EXPECT_FALSE(writer.IsOpened());
+
+  FlvFile file;
+  ASSERT_TRUE(file.Open(path));
+  EXPECT_TRUE(file.HasAudio());
+  EXPECT_TRUE(file.HasVideo());
+
+  FlvTag tag;
+  std::vector<FlvTag> tags;
+  while (file.ReadTag(tag)) {
+    tags.push_back(tag);
+  }
+  ASSERT_EQ(tags.size(), 6u);
+  EXPECT_EQ(tags[1].size, key.size());
+  EXPECT_EQ(memcmp(tags[3].data, key.data(), key.size()), 0);
+  EXPECT_EQ(tags[4].type, 8);
+
+  // 末尾的索引 tag: "keyframes" {times: [0, 2], filepositions: [...]}
+  const FlvTag &index = tags[5];
+  EXPECT_EQ(index.type, 18);
+  EXPECT_EQ(index.timestamp, 2010u);
+  std::string body((const char *)index.data, index.size);
+  EXPECT_EQ(body.compare(0, 12, std::string("\x02\x00\x09keyframes", 12)), 0);
+  auto number_at = [&body](size_t pos) {
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) {
+      bits = (bits << 8) | (uint8_t)body[pos + i];
+    }
+    double value = 0;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  };
+  size_t times = body.find("times") + 5;
+  ASSERT_EQ(body.compare(times, 5, std::string("\x0a\x00\x00\x00\x02", 5)), 0);
+  EXPECT_EQ(number_at(times + 6), 0.0);
+  EXPECT_EQ(number_at(times + 15), 2.0);
+  size_t positions = body.find("filepositions") + 13;
+  EXPECT_EQ(number_at(positions + 6), (double)first_key);
+  EXPECT_EQ(number_at(positions + 15), (double)second_key);
+
+  // 直接 I/O 补齐的部分已经截断
+  size_t end = (size_t)(index.data - tags[0].data) + index.size + 4 + 11 + 13;
+  EXPECT_EQ(file.Size(), end);
+  file.Close();
+  unlink(path);
+}
+
+TEST(TestRtmpRecorder, RotateAtKeyFrame) {
+  char dir[] = "/tmp/test_recorder_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+
+  RtmpRecordOptions options;
+  options.dir = dir;
+  options.segment_ms = 1000;
+  options.buffer_size = 4096;
+  options.preallocate = 0;
+  auto recorder = RtmpRecorder::Create(options);
+  auto stream = recorder->OpenStream("/live/test");
+
+  auto meta = MakeData(std::string("\x02\x00\x0aonMetaData", 13));
+  auto avc = MakeData(std::string("\x17\x00\x00\x00\x00\x01\x42", 7));
+  auto aac = MakeData(std::string("\xaf\x00\x12\x10", 4));
+  auto key = MakeData(std::string("\x17\x01\x00\x00\x00\x65", 6));
+  auto inter = MakeData(std::string("\x27\x01\x00\x00\x00\x41", 6));
+  auto audio = MakeData(std::string("\xaf\x01\x21", 3));
+
+  stream->OnMedia(RTMP_DATA_MESSAGE, 0, meta, 13);
+  stream->OnMedia(RTMP_AVC_SEQUENCE_HEADER, 0, avc, 7);
+  stream->OnMedia(RTMP_AAC_SEQUENCE_HEADER, 0, aac, 4);
+  stream->OnMedia(RTMP_VIDEO, 0, inter, 6);  // 文件从关键帧开始
+  for (uint32_t ts = 0; ts < 2500; ts += 100) {
+    bool is_key = ts % 500 == 0;
+    stream->OnMedia(RTMP_VIDEO, ts, is_key ? key : inter, 6);
+    stream->OnMedia(RTMP_AUDIO, ts + 10, audio, 3);
+  }
+  stream->Close();
+  stream.reset();
+  recorder.reset();  // 等写线程写完
+
+  auto files = ListFiles(dir);
+  ASSERT_EQ(files.size(), 3u);  // 0, 1000, 2000 处的关键帧
+  uint32_t starts[] = {0, 1000, 2000};
+  for (size_t i = 0; i < files.size(); i++) {
+    EXPECT_NE(files[i].find("/live_test_"), std::string::npos);
+    EXPECT_EQ(files[i].substr(files[i].size() - 6), "_" + std::to_string(i) + ".flv");
+
+    // 每个文件开头都有元数据和序列头, 第一帧是关键帧
+    FlvFile file;
+    ASSERT_TRUE(file.Open(files[i].c_str()));
+    FlvTag tag;
+    ASSERT_TRUE(file.ReadTag(tag));
+    EXPECT_EQ(tag.type, FlvFile::kTagScript);
+    ASSERT_TRUE(file.ReadTag(tag));
+    EXPECT_EQ(tag.type, FlvFile::kTagVideo);
+    EXPECT_EQ(tag.data[1], 0);
+    ASSERT_TRUE(file.ReadTag(tag));
+    EXPECT_EQ(tag.type, FlvFile::kTagAudio);
+    EXPECT_EQ(tag.data[1], 0);
+    ASSERT_TRUE(file.ReadTag(tag));
+    EXPECT_EQ(tag.data[0], 0x17);
+    EXPECT_EQ(tag.timestamp, starts[i]);
+
+    uint32_t frames = 1;
+    FlvTag last;
+    while (file.ReadTag(tag)) {
+      frames += tag.type == FlvFile::kTagVideo ? 1 : 0;
+      last = tag;
+    }
+    EXPECT_EQ(last.type, FlvFile::kTagScript);  // 关键帧索引
+    EXPECT_EQ(frames, i < 2 ? 10u : 5u);
+  }
+  RemoveDir(dir);
+}
+
+TEST(TestRtmpRecorder, DropUntilKeyFrameWhenFull) {
+  char dir[] = "/tmp/test_recorder_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+
+  RtmpRecordOptions options;
+  options.dir = dir;
+  options.queue_size = 4;
+  options.preallocate = 0;
+  auto recorder = RtmpRecorder::Create(options);
+  auto stream = recorder->OpenStream("live/full");
+
+  auto key = MakeData(std::string("\x17\x01\x00\x00\x00\x65", 6));
+  auto inter = MakeData(std::string("\x27\x01\x00\x00\x00\x41", 6));
+  for (uint32_t i = 0; i < 10000; i++) {
+    stream->OnMedia(RTMP_VIDEO, i * 40, i % 25 == 0 ? key : inter, 6);
+  }
+  stream->Close();
+  stream.reset();
+  uint64_t dropped = recorder->GetDroppedFrames();
+  recorder.reset();
+
+  // 写线程在队列空时才睡眠, 推流速度远大于写入速度时一定会丢帧, 但不会阻塞推流
+  EXPECT_GT(dropped, 0u);
+  auto files = ListFiles(dir);
+  ASSERT_EQ(files.size(), 1u);
+  FlvFile file;
+  ASSERT_TRUE(file.Open(files[0].c_str()));
+  FlvTag tag;
+  ASSERT_TRUE(file.ReadTag(tag));
+  EXPECT_EQ(tag.data[0], 0x17);
+  RemoveDir(dir);
+}
+
+// 队列满时 Close 也不等待, 写线程写完已有的帧之后关闭文件, 不需要等到录制器析构
+TEST(TestRtmpRecorder, CloseWhenQueueFull) {
+  char dir[] = "/tmp/test_recorder_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+
+  RtmpRecordOptions options;
+  options.dir = dir;
+  options.queue_size = 2;
+  options.preallocate = 0;
+  auto recorder = RtmpRecorder::Create(options);
+  auto stream = recorder->OpenStream("live/close");
+
+  auto key = MakeData(std::string("\x17\x01\x00\x00\x00\x65", 6));
+  for (uint32_t i = 0; i < 10000; i++) {
+    stream->OnMedia(RTMP_VIDEO, i * 40, key, 6);
+  }
+  stream->Close();
+  stream.reset();
+
+  // 文件关闭时在末尾写入关键帧索引
+  bool closed = false;
+  for (int i = 0; i < 200 && !closed; i++) {
+    auto files = ListFiles(dir);
+    FlvFile file;
+    FlvTag tag, last;
+    if (files.size() == 1 && file.Open(files[0].c_str())) {
+      while (file.ReadTag(tag)) {
+        last = tag;
+      }
+      closed = last.type == FlvFile::kTagScript;
+    }
+    if (!closed) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+  EXPECT_TRUE(closed);
+  recorder.reset();
+  RemoveDir(dir);
+}
+
+TEST(TestRtmpRecorder, CloseAfterTrailingFrames) {
+  char dir[] = "/tmp/test_recorder_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+
+  RtmpRecordOptions options;
+  options.dir = dir;
+  options.preallocate = 0;
+  auto recorder = RtmpRecorder::Create(options);
+  auto key = MakeData(std::string("\x17\x01\x00\x00\x00\x65", 6));
+  auto inter = MakeData(std::string("\x27\x01\x00\x00\x00\x41", 6));
+
+  // 写线程空闲时推流端写完最后几帧立即关闭, 这些帧都写入同一个文件, 不会多出文件
+  const uint32_t kStreams = 20;
+  for (uint32_t i = 0; i < kStreams; i++) {
+    auto stream = recorder->OpenStream("/live/tail" + std::to_string(i));
+    stream->OnMedia(RTMP_VIDEO, 0, key, 6);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    for (uint32_t j = 1; j <= 5; j++) {
+      stream->OnMedia(RTMP_VIDEO, j * 40, inter, 6);
+    }
+    stream->OnMedia(RTMP_VIDEO, 240, key, 6);
+    stream->Close();
+  }
+  recorder.reset();
+
+  auto files = ListFiles(dir);
+  ASSERT_EQ(files.size(), kStreams);
+  for (const auto &path : files) {
+    EXPECT_EQ(path.substr(path.size() - 6), "_0.flv");
+    FlvFile file;
+    ASSERT_TRUE(file.Open(path.c_str()));
+    FlvTag tag;
+    uint32_t frames = 0;
+    while (file.ReadTag(tag)) {
+      frames += tag.type == FlvFile::kTagVideo ? 1 : 0;
+    }
+    EXPECT_EQ(frames, 7u);
+  }
+  RemoveDir(dir);
+}
@@ -0,0 +1,129 @@
+/// @file test_relay.cc
+/// @brief 边缘回源: 多个拉流端共用一个回源连接, 最后一个拉流端离开后空闲超时断开
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "EventLoop.h"
+#include "RtmpClient.h"
+#include "RtmpFlvPublisher.h"
+#include "RtmpServer.h"
+#include "TestHelper.h"
+
+namespace {
+
+struct Player {
+  std::shared_ptr<RtmpClient> client;
+  std::atomic<int> video{0};
+  std::atomic<bool> has_sequence_header{false};
+};
+
+void Play(EventLoop *loop, const std::shared_ptr<RtmpServer> &server, Player &player) {
+  player.client = RtmpClient::Create(loop);
+  player.client->SetRecvFrameCB([&player](uint8_t *payload, uint32_t, uint8_t codec_id, uint32_t) {
+    if (codec_id == RTMP_CODEC_ID_H264 && payload[1] == 0) {
+      player.has_sequence_header = true;
+    } else if (codec_id == RTMP_CODEC_ID_H264) {
+      player.video++;
+    }
+  });
+  std::string status;
+  ASSERT_EQ(player.client->OpenSocket(AdoptPair(server), "rtmp://127.0.0.1/live/relay", 3000,
+                                      status),
+            0);
+}
+
+}  // namespace
+
+TEST(TestRtmpRelay, SharedUpstreamAndIdleTeardown) {
+  char path[] = "/tmp/test_relay_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  ASSERT_TRUE(WriteTestFlv(path));
+  auto source = RtmpFlvSource::Open(path);
+  ASSERT_NE(source, nullptr);
+
+  EventLoop origin_loop(1);
+  auto origin = RtmpServer::Create(&origin_loop);
+  uint16_t port = FreePort();
+  ASSERT_NE(port, 0);
+  ASSERT_TRUE(origin->Start("127.0.0.1", port));
+
+  EventLoop edge_loop(1);
+  auto edge = RtmpServer::Create(&edge_loop);
+  edge->SetEdge("rtmp://127.0.0.1:" + std::to_string(port) + "/", 300);
+
+  EventLoop publisher_loop(1);
+  auto publisher = RtmpFlvPublisher::Create(&publisher_loop, source);
+  publisher->SetLoop(true);
+  std::string status;
+  ASSERT_EQ(publisher->OpenSocket(AdoptPair(origin), "rtmp://127.0.0.1/live/relay", 3000, status),
+            0);
+
+  // 两个拉流端进入边缘, 共用一个回源连接
+  EventLoop client_loop(1);
+  Player first;
+  Player second;
+  Play(&client_loop, edge, first);
+  Play(&client_loop, edge, second);
+  for (int i = 0; i < 300 && (first.video.load() < 25 || second.video.load() < 25); i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_GE(first.video.load(), 25);
+  EXPECT_GE(second.video.load(), 25);
+  EXPECT_TRUE(first.has_sequence_header.load());
+  EXPECT_TRUE(second.has_sequence_header.load());
+
+  auto relay = edge->FindRelay("/live/relay");
+  ASSERT_NE(relay, nullptr);
+  EXPECT_TRUE(relay->IsConnected());
+  EXPECT_EQ(relay->GetConnects(), 1u);
+  EXPECT_GT(relay->GetFrames(), 0u);
+  auto origin_session = origin->FindSession("/live/relay");
+  ASSERT_NE(origin_session, nullptr);
+  EXPECT_EQ(origin_session->GetStats().subscribers.load(), 1u);
+  relay.reset();
+
+  // 最后一个拉流端离开后等待空闲超时再断开回源
+  // 客户端释放时才关闭 socket
+  first.client->Close();
+  second.client->Close();
+  first.client.reset();
+  second.client.reset();
+  for (int i = 0; i < 300 && edge->FindRelay("/live/relay") != nullptr; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(edge->FindRelay("/live/relay"), nullptr);
+  for (int i = 0; i < 300 && origin_session->GetStats().subscribers.load() > 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(origin_session->GetStats().subscribers.load(), 0u);
+
+  publisher->Close();
+  edge->Stop();
+  origin->Stop();
+  unlink(path);
+}
+
+TEST(TestRtmpRelay, DisabledWithoutOrigin) {
+  EventLoop edge_loop(1);
+  auto edge = RtmpServer::Create(&edge_loop);
+
+  EventLoop client_loop(1);
+  Player player;
+  Play(&client_loop, edge, player);
+  EXPECT_EQ(edge->FindRelay("/live/relay"), nullptr);
+
+  player.client->Close();
+  edge->Stop();
+}
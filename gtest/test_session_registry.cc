@@ -0,0 +1,128 @@
+/// @file test_session_registry.cc
+/// @brief 分片会话注册表单元测试, 不依赖服务器
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "RtmpSessionRegistry.h"
+
+TEST(TestSessionRegistry, FindOrCreate) {
+  RtmpSessionRegistry registry;
+  std::string path = "/live/test";
+  uint64_t hash = RtmpSessionRegistry::Hash(path);
+
+  EXPECT_EQ(registry.Find(hash, path), nullptr);  // 只读查找不创建
+  EXPECT_EQ(registry.Size(), 0u);
+
+  auto session = registry.FindOrCreate(hash, path);
+  EXPECT_NE(session, nullptr);
+  EXPECT_EQ(registry.FindOrCreate(hash, path), session);
+  EXPECT_EQ(registry.Find(hash, path), session);
+  EXPECT_EQ(registry.Size(), 1u);
+
+  EXPECT_TRUE(registry.Remove(hash, path));
+  EXPECT_FALSE(registry.Remove(hash, path));
+  EXPECT_EQ(registry.Find(hash, path), nullptr);
+}
+
+// 人为构造哈希冲突, 不同路径必须对应不同会话
+TEST(TestSessionRegistry, HashCollision) {
+  RtmpSessionRegistry registry;
+  auto a = registry.FindOrCreate(42, "/live/a");
+  auto b = registry.FindOrCreate(42, "/live/b");
+  EXPECT_NE(a, b);
+  EXPECT_EQ(registry.Find(42, "/live/a"), a);
+  EXPECT_EQ(registry.Find(42, "/live/b"), b);
+  EXPECT_EQ(registry.Find(42, "/live/c"), nullptr);
+
+  EXPECT_EQ(registry.RemoveIf([&a](const RtmpSession::Ptr &s) { return s == a; }), 1u);
+  EXPECT_EQ(registry.Find(42, "/live/a"), nullptr);
+  EXPECT_EQ(registry.Find(42, "/live/b"), b);
+}
+
+// 多线程同时创建同一批流, 每个流只能有一个会话
+TEST(TestSessionRegistry, Concurrent) {
+  RtmpSessionRegistry registry;
+  const int kStreams = 1000;
+  const int kThreads = 4;
+  std::vector<std::vector<RtmpSession::Ptr>> results(kThreads);
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&registry, &results, t] {
+      for (int i = 0; i < kStreams; i++) {
+        std::string path = "/live/" + std::to_string(i);
+        results[t].push_back(registry.FindOrCreate(RtmpSessionRegistry::Hash(path), path));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(registry.Size(), (size_t)kStreams);
+  for (int t = 1; t < kThreads; t++) {
+    EXPECT_EQ(results[t], results[0]);
+  }
+}
+
+// 分段计算的哈希和整个路径相同, 已经注册的流返回注册表中的同一个字符串
+TEST(TestSessionRegistry, InternPath) {
+  RtmpSessionRegistry registry;
+  uint64_t hash = 0;
+  auto path = registry.InternPath("live", "test", hash);
+  EXPECT_EQ(*path, "/live/test");
+  EXPECT_EQ(hash, RtmpSessionRegistry::Hash("/live/test"));
+  EXPECT_NE(registry.InternPath("live", "test", hash), path);  // 没有注册时每次新建
+
+  registry.FindOrCreate(hash, *path);
+  auto interned = registry.InternPath("live", "test", hash);
+  EXPECT_EQ(*interned, "/live/test");
+  EXPECT_EQ(registry.InternPath("live", "test", hash), interned);
+  EXPECT_EQ(registry.InternPath("/live/test.flv", 10, hash), interned);
+  EXPECT_EQ(hash, RtmpSessionRegistry::Hash("/live/test"));
+  EXPECT_NE(registry.InternPath("liv", "e/test2", hash), interned);
+}
+
+// 读者和写者同时进行, 读者拿到的会话始终有效, 旧表在没有读者之后释放
+TEST(TestSessionRegistry, ConcurrentReadWrite) {
+  RtmpSessionRegistry registry;
+  std::string path = "/live/stable";
+  uint64_t hash = RtmpSessionRegistry::Hash(path);
+  auto stable = registry.FindOrCreate(hash, path);
+
+  std::atomic<bool> quit{false};
+  std::atomic<int> mismatches{0};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&] {
+      while (!quit.load()) {
+        if (registry.Find(hash, path) != stable) {
+          mismatches++;
+        }
+        uint64_t h = 0;
+        registry.InternPath("live", "stable", h);
+      }
+    });
+  }
+
+  for (int i = 0; i < 5000; i++) {
+    std::string other = "/live/" + std::to_string(i % 50);
+    uint64_t other_hash = RtmpSessionRegistry::Hash(other);
+    registry.FindOrCreate(other_hash, other);
+    registry.Remove(other_hash, other);
+  }
+  quit = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(mismatches.load(), 0);
+  EXPECT_EQ(registry.RemoveIf([](const RtmpSession::Ptr &) { return false; }), 0u);
+  EXPECT_EQ(registry.Size(), 1u);
+}
@@ -0,0 +1,121 @@
+/// @file test_timeshift.cc
+/// @brief 时移缓存: 关键帧定位, 时长和内存预算淘汰, 溢出到环形文件
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+#include "RtmpTimeshift.h"
+#include "rtmp.h"
+
+namespace {
+
+std::shared_ptr<char> MakeFrame(bool key_frame, uint32_t size, char fill) {
+  std::shared_ptr<char> data(new char[size], std::default_delete<char[]>());
+  memset(data.get(), fill, size);
+  data.get()[0] = key_frame ? 0x17 : 0x27;
+  return data;
+}
+
+// 25 帧一个 GOP, 40ms 一帧
+void Feed(RtmpTimeshift &timeshift, uint32_t frames, uint32_t size) {
+  for (uint32_t i = 0; i < frames; i++) {
+    timeshift.OnMedia(RTMP_VIDEO, i * 40, MakeFrame(i % 25 == 0, size, (char)i), size);
+  }
+}
+
+}  // namespace
+
+TEST(TestRtmpTimeshift, SeekKeyFrame) {
+  RtmpTimeshiftOptions options;
+  options.max_ms = 60000;
+  RtmpTimeshift timeshift("live/test", options);
+  EXPECT_FALSE(timeshift.HasSpill());
+
+  uint64_t seq = 0;
+  EXPECT_FALSE(timeshift.Seek(0, seq));
+
+  Feed(timeshift, 100, 100);
+  EXPECT_EQ(timeshift.GetEnd() - timeshift.GetBegin(), 100u);
+  EXPECT_EQ(timeshift.GetKeyFrames(), 4u);
+  EXPECT_EQ(timeshift.GetDuration(), 3960u);
+
+  // 直播之前 2 秒 (1960ms) 之前最近的关键帧是 1000ms 处的第 25 帧
+  ASSERT_TRUE(timeshift.Seek(timeshift.GetLastTimestamp() - 2000, seq));
+  EXPECT_EQ(seq, 25u);
+  ASSERT_TRUE(timeshift.Seek(2000, seq));
+  EXPECT_EQ(seq, 50u);
+
+  // 帧引用的是推流端的 payload
+  RtmpTimeshift::Frame frame;
+  ASSERT_TRUE(timeshift.Get(seq, frame));
+  EXPECT_EQ(frame.timestamp, 2000u);
+  EXPECT_EQ(frame.data.get()[0], 0x17);
+  EXPECT_EQ(frame.data.get()[1], (char)50);
+  EXPECT_FALSE(timeshift.Get(100, frame));
+
+  // 重新推流后序号继续增长, 之前的位置读不到新的帧
+  timeshift.Reset();
+  EXPECT_FALSE(timeshift.Get(50, frame));
+  EXPECT_FALSE(timeshift.Seek(0, seq));
+  Feed(timeshift, 1, 100);
+  ASSERT_TRUE(timeshift.Seek(0, seq));
+  EXPECT_EQ(seq, 100u);
+}
+
+TEST(TestRtmpTimeshift, EvictByDurationAndBytes) {
+  RtmpTimeshiftOptions options;
+  options.max_ms = 2000;
+  RtmpTimeshift timeshift("live/test", options);
+  Feed(timeshift, 100, 100);
+
+  // 只保留最近 2 秒, 最早的关键帧是第 50 帧
+  EXPECT_EQ(timeshift.GetDuration(), 2000u);
+  EXPECT_EQ(timeshift.GetBegin(), 49u);
+  EXPECT_EQ(timeshift.GetKeyFrames(), 2u);
+  uint64_t seq = 0;
+  ASSERT_TRUE(timeshift.Seek(0, seq));  // 请求的延迟超过缓存时从最早的关键帧开始
+  EXPECT_EQ(seq, 50u);
+
+  options.max_ms = 60000;
+  options.max_bytes = 1000;
+  RtmpTimeshift budget("live/test", options);
+  Feed(budget, 100, 100);
+  EXPECT_EQ(budget.GetMemoryBytes(), 1000u);
+  EXPECT_EQ(budget.GetBegin(), 90u);
+  EXPECT_EQ(budget.GetKeyFrames(), 0u);
+}
+
+TEST(TestRtmpTimeshift, SpillToFileRing) {
+  RtmpTimeshiftOptions options;
+  options.max_ms = 60000;
+  options.max_bytes = 1000;  // 内存中 9 帧
+  options.spill_dir = "/tmp";
+  options.spill_bytes = 5050;  // 文件中 50 帧, 写到末尾时放不下的部分回到开头
+  RtmpTimeshift timeshift("live/spill", options);
+  ASSERT_TRUE(timeshift.HasSpill());
+
+  Feed(timeshift, 200, 101);
+  EXPECT_EQ(timeshift.GetEnd(), 200u);
+  EXPECT_EQ(timeshift.GetBegin(), 141u);
+  EXPECT_EQ(timeshift.GetMemoryBytes(), 909u);
+  EXPECT_EQ(timeshift.GetKeyFrames(), 2u);  // 150 和 175 都已经溢出到文件中
+
+  // 文件中的帧读出时拷贝一份, 内容和写入时相同
+  for (uint64_t seq = timeshift.GetBegin(); seq < timeshift.GetEnd(); seq++) {
+    RtmpTimeshift::Frame frame;
+    ASSERT_TRUE(timeshift.Get(seq, frame));
+    EXPECT_EQ(frame.timestamp, seq * 40);
+    EXPECT_EQ(frame.size, 101u);
+    EXPECT_EQ(frame.data.get()[0], seq % 25 == 0 ? 0x17 : 0x27);
+    EXPECT_EQ(frame.data.get()[100], (char)seq);
+  }
+
+  uint64_t seq = 0;
+  ASSERT_TRUE(timeshift.Seek(0, seq));
+  EXPECT_EQ(seq, 150u);
+}
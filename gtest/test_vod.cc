@@ -0,0 +1,113 @@
+/// @file test_vod.cc
+/// @brief FLV 点播: 映射文件的关键帧索引, 文件缓存, 没有推流端时拉流播放点播文件
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "EventLoop.h"
+#include "RtmpClient.h"
+#include "RtmpServer.h"
+#include "RtmpVod.h"
+#include "TestHelper.h"
+
+TEST(TestRtmpVod, FileIndexAndCache) {
+  char dir[] = "/tmp/test_vod_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+  std::string path = std::string(dir) + "/movie.flv";
+  ASSERT_TRUE(WriteTestFlv(path, 0, true));
+
+  RtmpVodCache cache(1);
+  EXPECT_EQ(cache.Get(std::string(dir) + "/none.flv"), nullptr);
+  EXPECT_EQ(cache.Get(dir), nullptr);  // 不是普通文件
+
+  auto file = cache.Get(path);
+  ASSERT_NE(file, nullptr);
+  EXPECT_EQ(cache.Get(path), file);  // 同一个映射
+  EXPECT_EQ(file->GetMetaData().at("duration").amf_number, 2.0);
+
+  RtmpVodFrame frame;
+  ASSERT_TRUE(file->GetAvcSequenceHeader(frame));
+  EXPECT_TRUE(RtmpVodFile::IsAvcSequenceHeader(frame));
+  ASSERT_TRUE(file->GetAacSequenceHeader(frame));
+  EXPECT_TRUE(RtmpVodFile::IsAacSequenceHeader(frame));
+
+  // 关键帧索引: 0 和 1000ms, FlvWriter 追加在末尾的索引 tag 不是关键帧
+  EXPECT_EQ(file->GetKeyFrames(), 2u);
+  size_t pos = file->Seek(1500);
+  ASSERT_TRUE(file->Read(pos, frame));
+  EXPECT_EQ(frame.timestamp, 1000u);
+  EXPECT_TRUE(RtmpVodFile::IsKeyFrame(frame));
+  EXPECT_EQ(frame.data.get()[5], 25);
+
+  // payload 持有文件, 缓存淘汰之后仍然有效
+  EXPECT_EQ(cache.Get(path + ".none"), nullptr);
+  std::string other = std::string(dir) + "/other.flv";
+  ASSERT_TRUE(WriteTestFlv(other, 0, true));
+  ASSERT_NE(cache.Get(other), nullptr);
+  EXPECT_EQ(cache.GetFiles(), 1u);
+  file.reset();
+  EXPECT_EQ(frame.data.get()[5], 25);
+
+  // 文件变化后重新打开
+  auto first = cache.Get(other);
+  truncate(other.c_str(), 13);
+  EXPECT_NE(cache.Get(other), first);
+
+  unlink(path.c_str());
+  unlink(other.c_str());
+  rmdir(dir);
+}
+
+TEST(TestRtmpVod, PlayWithoutPublisher) {
+  char dir[] = "/tmp/test_vod_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+  std::string app_dir = std::string(dir) + "/vod";
+  ASSERT_EQ(mkdir(app_dir.c_str(), 0755), 0);
+  std::string path = app_dir + "/movie.flv";
+  ASSERT_TRUE(WriteTestFlv(path, 0, true));
+
+  EventLoop server_loop(1);
+  auto server = RtmpServer::Create(&server_loop);
+  server->SetVod(dir, 4.0);  // 4 倍速, 2 秒的文件 0.5 秒发完
+
+  std::atomic<int> video(0);
+  std::atomic<uint32_t> last_timestamp(0);
+  EventLoop client_loop(1);
+  auto client = RtmpClient::Create(&client_loop);
+  client->SetRecvFrameCB([&](uint8_t *payload, uint32_t, uint8_t codec_id, uint32_t timestamp) {
+    if (codec_id == RTMP_CODEC_ID_H264 && payload[1] == 1) {
+      video++;
+      last_timestamp = timestamp;
+    }
+  });
+
+  auto begin = std::chrono::steady_clock::now();
+  std::string status;
+  ASSERT_EQ(client->OpenSocket(AdoptPair(server), "rtmp://127.0.0.1/vod/movie", 3000, status), 0);
+  for (int i = 0; i < 300 && video.load() < 50; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count();
+
+  EXPECT_EQ(video.load(), 50);
+  EXPECT_EQ(last_timestamp.load(), 1960u);
+  // 起播时立即发送 kBurstMs, 剩下的按倍速
+  EXPECT_GE(elapsed, (1960 - (int)RtmpVodPlayer::kBurstMs) / 4);
+
+  client->Close();
+  server->Stop();
+  unlink(path.c_str());
+  rmdir(app_dir.c_str());
+  rmdir(dir);
+}
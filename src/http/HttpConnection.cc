@@ -0,0 +1,332 @@
+/// @file HttpConnection.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "HttpConnection.h"
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+HttpConnection::HttpConnection(std::shared_ptr<HttpServer> server, TaskScheduler *scheduler,
+                               SOCKET sockfd)
+    : TcpConnection(scheduler, sockfd), http_server_(server) {
+  this->SetReadCallback([this](std::shared_ptr<TcpConnection> conn, BufferReader &buffer) {
+    return this->OnRead(buffer);
+  });
+}
+
+bool HttpConnection::OnRead(BufferReader &buffer) {
+  // 一次读到的数据中可能有多个流水线请求
+  // 异步响应完成之前不处理后续请求, 保证响应顺序
+  while (buffer.ReadableBytes() > 0 && !close_after_write_ && !pending_) {
+    const char *header_end = buffer.FindFirstCrlfCrlf();
+    if (header_end == nullptr) {
+      // 请求头不完整, 超过上限认为是非法请求
+      return buffer.ReadableBytes() <= kMaxHeaderSize;
+    }
+
+    HttpRequest request;
+    if (!ParseRequest(buffer.Peek(), header_end, request)) {
+      return false;
+    }
+    buffer.RetrieveUntil(header_end + 4);
+
+    auto server = http_server_.lock();
+    if (!server) {
+      return false;
+    }
+
+    std::string connection = request.GetHeader("connection");
+    std::transform(connection.begin(), connection.end(), connection.begin(), ::tolower);
+    if (connection == "close" || (request.version == "HTTP/1.0" && connection != "keep-alive")) {
+      close_after_write_ = true;
+    }
+
+    bool is_head = request.method == "HEAD";
+    HttpResponse response;
+    if (request.method != "GET" && !is_head) {
+      response.status = 405;
+      response.body = "Method Not Allowed\n";
+    } else if (auto handler = server->FindAsync(request.path)) {
+      pending_ = true;
+      auto conn = std::dynamic_pointer_cast<HttpConnection>(shared_from_this());
+      (*handler)(request, std::make_shared<HttpResponder>(conn, is_head));
+      continue;
+    } else {
+      server->Dispatch(request, response);
+    }
+
+    SendResponse(is_head, response);
+  }
+
+  return true;
+}
+
+bool HttpConnection::ParseRequest(const char *begin, const char *header_end,
+                                  HttpRequest &request) {
+  const char *line_end = std::search(begin, header_end + 2, "\r\n", "\r\n" + 2);
+
+  // 请求行: METHOD SP URI SP VERSION
+  const char *sp1 = std::find(begin, line_end, ' ');
+  if (sp1 == line_end) {
+    return false;
+  }
+  const char *sp2 = std::find(sp1 + 1, line_end, ' ');
+  if (sp2 == line_end) {
+    return false;
+  }
+
+  request.method.assign(begin, sp1);
+  request.version.assign(sp2 + 1, line_end);
+  const char *uri = sp1 + 1;
+  const char *question = std::find(uri, sp2, '?');
+  request.path.assign(uri, question);
+  if (question != sp2) {
+    request.query.assign(question + 1, sp2);
+  }
+
+  // 请求头: key: value
+  const char *line = line_end + 2;
+  while (line < header_end) {
+    line_end = std::search(line, header_end + 2, "\r\n", "\r\n" + 2);
+    const char *colon = std::find(line, line_end, ':');
+    if (colon != line_end) {
+      std::string key(line, colon);
+      std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+      const char *value = colon + 1;
+      while (value < line_end && *value == ' ') {
+        value++;
+      }
+      request.headers[key].assign(value, line_end);
+    }
+    line = line_end + 2;
+  }
+
+  return true;
+}
+
+void HttpConnection::SendResponse(bool is_head, const HttpResponse &response, bool chunked) {
+  uint32_t body_size = (uint32_t)response.body.size();
+  if (!response.data.empty()) {
+    body_size = 0;
+    for (auto &iter : response.data) {
+      body_size += iter.second;
+    }
+  }
+
+  char header[512];
+  int size = snprintf(header, sizeof(header),
+                      "HTTP/1.1 %d %s\r\n"
+                      "Content-Type: %s\r\n"
+                      "Connection: %s\r\n",
+                      response.status, StatusText(response.status), response.content_type.c_str(),
+                      close_after_write_ ? "close" : "keep-alive");
+
+  std::string data(header, std::min<size_t>(size, sizeof(header) - 1));
+  if (chunked) {
+    data += "Transfer-Encoding: chunked\r\n";
+  } else {
+    data += "Content-Length: " + std::to_string(body_size) + "\r\n";
+  }
+  for (auto &iter : response.headers) {
+    data += iter.first + ": " + iter.second + "\r\n";
+  }
+  data += "\r\n";
+
+  // 头和正文放入发送队列后一次发送, 避免发完头部就触发 close_after_write_ 的关闭,
+  // 共享的正文直接引用, 和头部合并成一次 writev
+  if (!is_head && response.data.empty() && !chunked) {
+    data += response.body;
+  }
+  if (IsClosed() || !write_buffer_->HasRoom(1 + (uint32_t)response.data.size())) {
+    stats_.dropped_packets.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  write_buffer_->Append(data.data(), (uint32_t)data.size());
+  if (!is_head) {
+    for (auto &iter : response.data) {
+      if (chunked) {
+        SendChunk(iter.first, iter.second);
+      } else if (iter.second > 0) {
+        write_buffer_->Append(iter.first, iter.second);
+      }
+    }
+  }
+  this->HandleWrite();
+}
+
+void HttpConnection::SendChunk(std::shared_ptr<char> data, uint32_t size) {
+  static std::shared_ptr<char> crlf(const_cast<char *>("\r\n"), [](char *) {});
+
+  // 大小为 0 的 chunk 表示结束, 由 FinishAsync 发送
+  if (IsClosed() || size == 0) {
+    return;
+  }
+
+  // 观看端消费太慢时无法只丢弃一部分数据, 直接断开, 播放器会重新请求
+  if (!write_buffer_->HasRoom(3)) {
+    stats_.dropped_packets.fetch_add(1, std::memory_order_relaxed);
+    this->Disconnect();
+    return;
+  }
+
+  char head[16];
+  int head_size = snprintf(head, sizeof(head), "%x\r\n", size);
+  write_buffer_->Append(head, (uint32_t)head_size);
+  write_buffer_->Append(data, size);
+  write_buffer_->Append(crlf, 2);
+}
+
+void HttpConnection::FinishAsync(bool chunked) {
+  if (IsClosed()) {
+    return;
+  }
+  if (chunked && write_buffer_->HasRoom(1)) {
+    write_buffer_->Append("0\r\n\r\n", 5);
+  }
+  pending_ = false;
+  this->HandleWrite();
+
+  // 继续处理等待期间收到的流水线请求
+  if (!IsClosed() && !OnRead(*read_buffer_)) {
+    this->Disconnect();
+  }
+}
+
+void HttpConnection::HandleWrite() {
+  TcpConnection::HandleWrite();
+  if (close_after_write_ && !pending_ && write_buffer_->IsEmpty() && !IsClosed()) {
+    this->Disconnect();
+  }
+}
+
+void HttpResponder::Send(const HttpResponse &response) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto conn = conn_.lock();
+  if (done_ || chunked_ || !conn) {
+    return;
+  }
+  done_ = true;
+
+  bool is_head = is_head_;
+  Post(conn, [conn, is_head, response] {
+    conn->SendResponse(is_head, response);
+    conn->FinishAsync(false);
+  });
+}
+
+void HttpResponder::BeginChunked(const HttpResponse &response) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto conn = conn_.lock();
+  if (done_ || chunked_ || !conn) {
+    return;
+  }
+  chunked_ = true;
+
+  // HEAD 请求只有响应头, 直接完成
+  bool is_head = is_head_;
+  if (is_head) {
+    done_ = true;
+  }
+  Post(conn, [conn, is_head, response] {
+    conn->SendResponse(is_head, response, true);
+    if (is_head) {
+      conn->FinishAsync(false);
+    }
+  });
+}
+
+void HttpResponder::SendChunk(std::shared_ptr<char> data, uint32_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto conn = conn_.lock();
+  if (done_ || !chunked_ || !conn) {
+    return;
+  }
+
+  Post(conn, [conn, data, size] {
+    conn->SendChunk(data, size);
+    conn->HandleWrite();
+  });
+}
+
+void HttpResponder::EndChunked() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto conn = conn_.lock();
+  if (done_ || !chunked_ || !conn) {
+    return;
+  }
+  done_ = true;
+
+  Post(conn, [conn] { conn->FinishAsync(true); });
+}
+
+void HttpResponder::Post(const std::shared_ptr<HttpConnection> &conn,
+                         std::function<void()> task) {
+  if (!conn->GetTaskScheduler()->AddTriggerEvent(std::move(task))) {
+    done_ = true;
+    // Disconnect 也要经过触发事件队列, 这里直接关闭读写
+    ::shutdown(conn->GetSocket(), SHUT_RDWR);
+  }
+}
+
+void HttpResponder::Expire(const HttpResponse &response) {
+  // 在锁内判断并投递, 和推流线程中的 BeginChunked 之间不会漏掉结束
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto conn = conn_.lock();
+  if (done_ || !conn) {
+    return;
+  }
+  done_ = true;
+
+  if (chunked_) {
+    Post(conn, [conn] { conn->FinishAsync(true); });
+    return;
+  }
+  bool is_head = is_head_;
+  Post(conn, [conn, is_head, response] {
+    conn->SendResponse(is_head, response);
+    conn->FinishAsync(false);
+  });
+}
+
+const char *HttpConnection::StatusText(int status) {
+  switch (status) {
+    case 200:
+      return "OK";
+    case 400:
+      return "Bad Request";
+    case 404:
+      return "Not Found";
+    case 405:
+      return "Method Not Allowed";
+    case 500:
+      return "Internal Server Error";
+    case 503:
+      return "Service Unavailable";
+    default:
+      return "Unknown";
+  }
+}
+
+void HttpResponder::SetTimeout(uint32_t msec, const HttpResponse &response) {
+  auto conn = conn_.lock();
+  if (!conn) {
+    return;
+  }
+
+  std::weak_ptr<HttpResponder> weak_responder = shared_from_this();
+  conn->GetTaskScheduler()->AddTimer(
+      [weak_responder, response] {
+        auto responder = weak_responder.lock();
+        if (responder) {
+          responder->Expire(response);
+        }
+        return false;
+      },
+      msec);
+}
@@ -0,0 +1,47 @@
+/// @file HttpConnection.h
+/// @brief HTTP/1.1 连接, 解析请求头并调用 HttpServer 中注册的处理函数, 支持 keep-alive
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_HTTP_CONNECTION_H
+#define RTMP_SERVER_HTTP_CONNECTION_H
+
+#include <memory>
+
+#include "HttpServer.h"
+#include "TcpConnection.h"
+
+class HttpConnection : public TcpConnection {
+ public:
+  HttpConnection(std::shared_ptr<HttpServer> server, TaskScheduler *scheduler, SOCKET sockfd);
+  ~HttpConnection() override {};
+
+  // 从 header_end 之前的数据解析出请求, 格式错误返回 false, HttpFlvConnection 共用
+  static bool ParseRequest(const char *begin, const char *header_end, HttpRequest &request);
+
+  static const char *StatusText(int status);
+
+ private:
+  friend class HttpResponder;
+
+  bool OnRead(BufferReader &buffer);
+
+  // chunked 为 true 时不写 Content-Length, 正文中的每段数据各作为一个 chunk
+  void SendResponse(bool is_head, const HttpResponse &response, bool chunked = false);
+
+  // 以下由 HttpResponder 投递到连接所在线程调用
+  void SendChunk(std::shared_ptr<char> data, uint32_t size);
+  void FinishAsync(bool chunked);
+
+  // 发送完毕后如果需要关闭连接则关闭
+  void HandleWrite() override;
+
+  std::weak_ptr<HttpServer> http_server_;
+  bool close_after_write_ = false;
+  bool pending_ = false;  // 异步响应还没有完成
+
+  static const uint32_t kMaxHeaderSize = 8192;
+};
+
+#endif  // RTMP_SERVER_HTTP_CONNECTION_H
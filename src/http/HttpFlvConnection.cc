@@ -0,0 +1,231 @@
+/// @file HttpFlvConnection.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "HttpFlvConnection.h"
+
+#include <cstdio>
+
+#include "HttpConnection.h"
+#include "RtmpServer.h"
+#include "RtmpSession.h"
+
+std::shared_ptr<const HttpFlvChunk> HttpFlvChunk::Create(uint8_t tag_type, uint64_t timestamp,
+                                                         std::shared_ptr<char> payload,
+                                                         uint32_t size) {
+  auto chunk = std::make_shared<HttpFlvChunk>();
+  uint32_t tag_size = 11 + size;
+
+  // 头和尾放在同一块内存中, 尾部用别名构造的 shared_ptr 引用
+  std::shared_ptr<char> buffer(new char[40], std::default_delete<char[]>());
+  char *head = buffer.get();
+  int len = snprintf(head, 16, "%x\r\n", tag_size + 4);
+  char *tag = head + len;
+  tag[0] = (char)tag_type;
+  WriteUint24BE(tag + 1, size);
+  WriteUint24BE(tag + 4, (uint32_t)timestamp & 0xffffff);
+  tag[7] = (char)((timestamp >> 24) & 0xff);  // 扩展时间戳
+  WriteUint24BE(tag + 8, 0);                  // stream id
+  chunk->head = buffer;
+  chunk->head_size = len + 11;
+
+  char *tail = buffer.get() + 32;
+  WriteUint32BE(tail, tag_size);
+  tail[4] = '\r';
+  tail[5] = '\n';
+  chunk->tail = std::shared_ptr<char>(buffer, tail);
+  chunk->tail_size = 6;
+
+  chunk->payload = payload;
+  chunk->payload_size = size;
+
+  if (tag_type == RTMP_VIDEO && size > 0) {
+    uint8_t *data = (uint8_t *)payload.get();
+    uint8_t frame_type = (data[0] >> 4) & 0x0f;
+    uint8_t codec_id = data[0] & 0x0f;
+    chunk->is_video = true;
+    if (codec_id == RTMP_CODEC_ID_H264 && size > 1) {
+      chunk->is_sequence_header = (data[1] == 0);
+      chunk->is_key_frame = (frame_type == 1 && data[1] == 1);
+    } else {
+      chunk->is_key_frame = (frame_type == 1);
+    }
+  }
+
+  return chunk;
+}
+
+HttpFlvConnection::HttpFlvConnection(std::shared_ptr<RtmpServer> server, TaskScheduler *scheduler,
+                                     SOCKET sockfd)
+    : TcpConnection(scheduler, sockfd), rtmp_server_(server) {
+  this->SetReadCallback([this](std::shared_ptr<TcpConnection> conn, BufferReader &buffer) {
+    return this->OnRead(buffer);
+  });
+
+  this->SetCloseCallback([this](std::shared_ptr<TcpConnection> conn) { this->OnClose(); });
+}
+
+bool HttpFlvConnection::OnRead(BufferReader &buffer) {
+  if (has_request_) {  // 开始播放之后不再处理请求, 丢弃收到的数据
+    buffer.RetrieveAll();
+    return true;
+  }
+
+  const char *header_end = buffer.FindFirstCrlfCrlf();
+  if (header_end == nullptr) {
+    return buffer.ReadableBytes() <= kMaxHeaderSize;
+  }
+
+  HttpRequest request;
+  if (!HttpConnection::ParseRequest(buffer.Peek(), header_end, request)) {
+    return false;
+  }
+  buffer.RetrieveAll();
+  has_request_ = true;
+
+  HandlePlay(request);
+  return true;
+}
+
+void HttpFlvConnection::HandlePlay(const HttpRequest &request) {
+  if (request.method != "GET") {
+    SendError(405);
+    return;
+  }
+
+  // /app/stream.flv 对应 RTMP 的流路径 /app/stream
+  const std::string &path = request.path;
+  if (path.size() <= 5 || path[0] != '/' || path.compare(path.size() - 4, 4, ".flv") != 0) {
+    SendError(404);
+    return;
+  }
+
+  auto server = rtmp_server_.lock();
+  if (!server) {
+    SendError(503);
+    return;
+  }
+
+  uint64_t stream_hash = 0;
+  stream_path_ = server->rtmp_sessions_.InternPath(path.data(), path.size() - 4, stream_hash);
+
+  // 响应头和 FLV 文件头 (9 字节文件头 + 4 字节 PreviousTagSize0) 一起发送
+  static const char kFlvHeader[] = {'F', 'L', 'V', 0x01, 0x05, 0x00, 0x00, 0x00, 0x09,
+                                    0x00, 0x00, 0x00, 0x00};
+  std::string data =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: video/x-flv\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "Connection: close\r\n"
+      "Cache-Control: no-cache\r\n"
+      "Access-Control-Allow-Origin: *\r\n"
+      "\r\n"
+      "d\r\n";
+  data.append(kFlvHeader, sizeof(kFlvHeader));
+  data.append("\r\n");
+  this->Send(data.data(), (uint32_t)data.size());
+
+  // 和 RTMP 拉流端一样, 推流端还没开始时先创建会话等待, 边缘模式下从源站拉流
+  server->StartRelay(*stream_path_, stream_hash);
+  auto session = server->GetSession(*stream_path_, stream_hash);
+  rtmp_session_ = session;
+  if (session) {
+    session->AddHttpFlvConn(std::dynamic_pointer_cast<HttpFlvConnection>(shared_from_this()));
+  }
+
+  server->NotifyEvent("play.start", *stream_path_);
+}
+
+void HttpFlvConnection::SendError(int status) {
+  char header[256];
+  const char *text = HttpConnection::StatusText(status);
+  int size = snprintf(header, sizeof(header),
+                      "HTTP/1.1 %d %s\r\n"
+                      "Content-Type: text/plain; charset=utf-8\r\n"
+                      "Content-Length: %zu\r\n"
+                      "Connection: close\r\n"
+                      "\r\n"
+                      "%s\n",
+                      status, text, strlen(text) + 1, text);
+  close_after_write_ = true;
+  this->Send(header, (uint32_t)size);
+}
+
+void HttpFlvConnection::OnClose() {
+  auto session = rtmp_session_.lock();
+  if (session) {
+    session->RemoveHttpFlvConn(std::dynamic_pointer_cast<HttpFlvConnection>(shared_from_this()));
+    rtmp_session_.reset();
+
+    auto server = rtmp_server_.lock();
+    if (server) {
+      server->NotifyEvent("play.stop", *stream_path_);
+    }
+  }
+}
+
+void HttpFlvConnection::SendChunk(HttpFlvChunkPtr chunk) {
+  if (this->IsClosed()) {
+    return;
+  }
+
+  auto conn = std::dynamic_pointer_cast<HttpFlvConnection>(shared_from_this());
+  task_scheduler_->AddTriggerEvent([conn, chunk] {
+    conn->AppendChunk(*chunk);
+    conn->HandleWrite();
+  });
+}
+
+void HttpFlvConnection::SendChunks(std::vector<HttpFlvChunkPtr> chunks) {
+  if (this->IsClosed() || chunks.empty()) {
+    return;
+  }
+
+  auto conn = std::dynamic_pointer_cast<HttpFlvConnection>(shared_from_this());
+  auto batch = std::make_shared<std::vector<HttpFlvChunkPtr>>(std::move(chunks));
+  task_scheduler_->AddTriggerEvent([conn, batch] {
+    for (auto &chunk : *batch) {
+      conn->AppendChunk(*chunk);
+    }
+    conn->HandleWrite();
+  });
+}
+
+void HttpFlvConnection::AppendChunk(const HttpFlvChunk &chunk) {
+  if (this->IsClosed()) {
+    return;
+  }
+
+  // 没有关键帧之前的视频帧无法解码, 跳过
+  if (chunk.is_video && !chunk.is_sequence_header && !has_key_frame_) {
+    if (!chunk.is_key_frame) {
+      stats_.dropped_frames.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    has_key_frame_ = true;
+  }
+
+  // 拉流端消费太慢, 整个 tag 一起丢弃以免破坏 FLV 流, 视频从下一个关键帧恢复
+  if (!write_buffer_->HasRoom(3)) {
+    stats_.dropped_packets.fetch_add(1, std::memory_order_relaxed);
+    if (chunk.is_video) {
+      has_key_frame_ = false;
+    }
+    return;
+  }
+
+  write_buffer_->Append(chunk.head, chunk.head_size);
+  if (chunk.payload_size > 0) {
+    write_buffer_->Append(chunk.payload, chunk.payload_size);
+  }
+  write_buffer_->Append(chunk.tail, chunk.tail_size);
+}
+
+void HttpFlvConnection::HandleWrite() {
+  TcpConnection::HandleWrite();
+  if (close_after_write_ && write_buffer_->IsEmpty() && !IsClosed()) {
+    this->Disconnect();
+  }
+}
@@ -0,0 +1,80 @@
+/// @file HttpFlvConnection.h
+/// @brief HTTP-FLV 拉流连接: GET /app/stream.flv 加入 RtmpSession, 以 chunked 编码持续发送 FLV tag
+///        每个媒体消息在会话中只封装一次 HttpFlvChunk, 所有 HTTP-FLV 拉流端共享引用,
+///        连接只把 chunk 的三段放入发送队列, 一次 writev 发出
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_HTTP_FLV_CONNECTION_H
+#define RTMP_SERVER_HTTP_FLV_CONNECTION_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HttpServer.h"
+#include "TcpConnection.h"
+
+class RtmpServer;
+class RtmpSession;
+
+// 一个 FLV tag 对应的 HTTP chunk, 分三段发送, payload 直接引用 RTMP 消息的数据不拷贝
+//   head: "<chunk 长度十六进制>\r\n" + 11 字节 tag 头
+//   payload: tag 数据
+//   tail: 4 字节 PreviousTagSize + "\r\n"
+struct HttpFlvChunk {
+  std::shared_ptr<char> head;
+  uint32_t head_size = 0;
+  std::shared_ptr<char> payload;
+  uint32_t payload_size = 0;
+  std::shared_ptr<char> tail;
+  uint32_t tail_size = 0;
+  bool is_video = false;
+  bool is_sequence_header = false;
+  bool is_key_frame = false;  // 视频关键帧, 拉流端从这里开始解码
+
+  // tag_type: 8 音频, 9 视频, 18 脚本数据, timestamp 取低 32 位
+  static std::shared_ptr<const HttpFlvChunk> Create(uint8_t tag_type, uint64_t timestamp,
+                                                    std::shared_ptr<char> payload, uint32_t size);
+};
+
+using HttpFlvChunkPtr = std::shared_ptr<const HttpFlvChunk>;
+
+class HttpFlvConnection : public TcpConnection {
+ public:
+  HttpFlvConnection(std::shared_ptr<RtmpServer> server, TaskScheduler *scheduler, SOCKET sockfd);
+  ~HttpFlvConnection() override {};
+
+  /* 以下函数由 session 调用, 投递到连接所在线程发送 */
+
+  void SendChunk(HttpFlvChunkPtr chunk);
+
+  // 起播时的元数据, 序列头和 GOP 缓存, 和之后的实时帧一起合并发送
+  void SendChunks(std::vector<HttpFlvChunkPtr> chunks);
+
+ private:
+  bool OnRead(BufferReader &buffer);
+  void OnClose();
+
+  // 校验请求并加入会话, 失败时发送错误响应
+  void HandlePlay(const HttpRequest &request);
+  void SendError(int status);
+
+  // 在连接所在线程调用, 放入发送队列但不发送
+  void AppendChunk(const HttpFlvChunk &chunk);
+
+  // 发送完毕后如果需要关闭连接则关闭
+  void HandleWrite() override;
+
+  std::weak_ptr<RtmpServer> rtmp_server_;
+  std::weak_ptr<RtmpSession> rtmp_session_;
+  std::shared_ptr<const std::string> stream_path_;  // 共用注册表中的路径字符串
+  bool has_request_ = false;
+  bool has_key_frame_ = false;  // 队列满丢帧之后等下一个关键帧再继续发送视频
+  bool close_after_write_ = false;
+
+  static const uint32_t kMaxHeaderSize = 8192;
+};
+
+#endif  // RTMP_SERVER_HTTP_FLV_CONNECTION_H
@@ -0,0 +1,28 @@
+/// @file HttpFlvServer.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "HttpFlvServer.h"
+
+#include "HttpFlvConnection.h"
+#include "RtmpServer.h"
+
+HttpFlvServer::HttpFlvServer(EventLoop *event_loop, std::shared_ptr<RtmpServer> rtmp_server)
+    : TcpServer(event_loop), rtmp_server_(rtmp_server) {}
+
+std::shared_ptr<HttpFlvServer> HttpFlvServer::Create(EventLoop *event_loop,
+                                                     std::shared_ptr<RtmpServer> rtmp_server) {
+  std::shared_ptr<HttpFlvServer> server(new HttpFlvServer(event_loop, rtmp_server));
+  return server;
+}
+
+TcpConnection::Ptr HttpFlvServer::OnConnect(SOCKET sockfd) {
+  auto rtmp_server = rtmp_server_.lock();
+  if (!rtmp_server) {
+    return nullptr;
+  }
+  return std::make_shared<HttpFlvConnection>(rtmp_server, event_loop_->GetTaskScheduler().get(),
+                                             sockfd);
+}
@@ -0,0 +1,32 @@
+/// @file HttpFlvServer.h
+/// @brief HTTP-FLV 拉流服务器, 和 RtmpServer 共用流会话, GET http://ip:port/app/stream.flv
+///        播放 rtmp://ip/app/stream 推上来的流, 可以和 RtmpServer 共用一个 EventLoop
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_HTTP_FLV_SERVER_H
+#define RTMP_SERVER_HTTP_FLV_SERVER_H
+
+#include <memory>
+
+#include "EventLoop.h"
+#include "TcpServer.h"
+
+class RtmpServer;
+
+class HttpFlvServer : public TcpServer {
+ public:
+  static std::shared_ptr<HttpFlvServer> Create(EventLoop *event_loop,
+                                               std::shared_ptr<RtmpServer> rtmp_server);
+  ~HttpFlvServer() = default;
+
+ private:
+  HttpFlvServer(EventLoop *event_loop, std::shared_ptr<RtmpServer> rtmp_server);
+
+  TcpConnection::Ptr OnConnect(SOCKET sockfd) override;
+
+  std::weak_ptr<RtmpServer> rtmp_server_;
+};
+
+#endif  // RTMP_SERVER_HTTP_FLV_SERVER_H
@@ -0,0 +1,89 @@
+/// @file HttpServer.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "HttpServer.h"
+
+#include "HttpConnection.h"
+
+std::string HttpRequest::GetQuery(const std::string &key) const {
+  size_t pos = 0;
+  while (pos <= query.size()) {
+    size_t end = query.find('&', pos);
+    if (end == std::string::npos) {
+      end = query.size();
+    }
+
+    size_t eq = query.find('=', pos);
+    if (eq != std::string::npos && eq < end && query.compare(pos, eq - pos, key) == 0 &&
+        eq - pos == key.size()) {
+      return query.substr(eq + 1, end - eq - 1);
+    }
+    pos = end + 1;
+  }
+  return std::string();
+}
+
+HttpServer::HttpServer(EventLoop *event_loop) : TcpServer(event_loop) {}
+
+std::shared_ptr<HttpServer> HttpServer::Create(EventLoop *event_loop) {
+  std::shared_ptr<HttpServer> server(new HttpServer(event_loop));
+  return server;
+}
+
+void HttpServer::AddRoute(const std::string &path, const Handler &handler) {
+  routes_[path] = handler;
+}
+
+void HttpServer::AddPrefixRoute(const std::string &prefix, const Handler &handler) {
+  prefix_routes_.emplace_back(prefix, handler);
+}
+
+void HttpServer::Dispatch(const HttpRequest &request, HttpResponse &response) const {
+  auto iter = routes_.find(request.path);
+  if (iter != routes_.end()) {
+    iter->second(request, response);
+    return;
+  }
+
+  const Handler *handler = nullptr;
+  size_t longest = 0;
+  for (auto &route : prefix_routes_) {
+    if (route.first.size() >= longest &&
+        request.path.compare(0, route.first.size(), route.first) == 0) {
+      handler = &route.second;
+      longest = route.first.size();
+    }
+  }
+
+  if (handler == nullptr) {
+    response.status = 404;
+    response.body = "Not Found\n";
+    return;
+  }
+
+  (*handler)(request, response);
+}
+
+void HttpServer::AddAsyncPrefixRoute(const std::string &prefix, const AsyncHandler &handler) {
+  async_routes_.emplace_back(prefix, handler);
+}
+
+const HttpServer::AsyncHandler *HttpServer::FindAsync(const std::string &path) const {
+  const AsyncHandler *handler = nullptr;
+  size_t longest = 0;
+  for (auto &route : async_routes_) {
+    if (route.first.size() >= longest && path.compare(0, route.first.size(), route.first) == 0) {
+      handler = &route.second;
+      longest = route.first.size();
+    }
+  }
+  return handler;
+}
+
+TcpConnection::Ptr HttpServer::OnConnect(SOCKET sockfd) {
+  return std::make_shared<HttpConnection>(shared_from_this(),
+                                          event_loop_->GetTaskScheduler().get(), sockfd);
+}
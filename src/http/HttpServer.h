@@ -0,0 +1,125 @@
+/// @file HttpServer.h
+/// @brief 内嵌的轻量 HTTP 服务器, 只支持 GET/HEAD 和按路径注册的处理函数,
+///        用于暴露统计信息等管理接口
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_HTTP_SERVER_H
+#define RTMP_SERVER_HTTP_SERVER_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "EventLoop.h"
+#include "TcpServer.h"
+
+struct HttpRequest {
+  std::string method;
+  std::string path;   // 不含查询参数
+  std::string query;  // '?' 之后的部分
+  std::string version;
+  std::map<std::string, std::string> headers;  // 键统一转为小写
+
+  // 查询参数中 key 对应的值, 不存在返回空字符串
+  std::string GetQuery(const std::string &key) const;
+
+  std::string GetHeader(const std::string &key) const {
+    auto iter = headers.find(key);
+    return iter == headers.end() ? std::string() : iter->second;
+  }
+};
+
+struct HttpResponse {
+  int status = 200;
+  std::string content_type = "text/plain; charset=utf-8";
+  std::string body;
+  std::map<std::string, std::string> headers;  // 额外的响应头, 如 Cache-Control
+
+  // 非空时代替 body 发送, 直接引用共享的只读缓冲区, 不拷贝, 多段合并成一次 writev
+  std::vector<std::pair<std::shared_ptr<char>, uint32_t>> data;
+
+  void AddData(std::shared_ptr<char> buffer, uint32_t size) { data.emplace_back(buffer, size); }
+};
+
+class HttpConnection;
+
+// 异步响应, 可以在任意线程调用, 投递到连接所在线程发送. 连接在响应完成之前不处理后续的流水线请求
+// 只能调用一次 Send, 或者 BeginChunked 之后多次 SendChunk 再 EndChunked; 连接已经关闭时调用无效
+class HttpResponder : public std::enable_shared_from_this<HttpResponder> {
+ public:
+  HttpResponder(std::weak_ptr<HttpConnection> conn, bool is_head) : conn_(conn), is_head_(is_head) {}
+
+  void Send(const HttpResponse &response);
+
+  // 只发送响应头 (Transfer-Encoding: chunked) 和 response.data 中已有的数据, 每段一个 chunk
+  void BeginChunked(const HttpResponse &response);
+  void SendChunk(std::shared_ptr<char> data, uint32_t size);
+  void EndChunked();
+
+  // msec 毫秒后仍未响应则发送 response, 已经开始 chunked 响应时结束 chunked 响应,
+  // 只能在处理函数中调用 (定时器属于连接所在线程)
+  void SetTimeout(uint32_t msec, const HttpResponse &response);
+
+  bool IsDone() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return done_;
+  }
+
+ private:
+  // 超时: 还没有开始响应时发送 response, 否则结束 chunked 响应
+  void Expire(const HttpResponse &response);
+
+  // 持有 mutex_ 时调用, 把 task 投递到连接所在线程. 触发事件队列满时响应已经不完整,
+  // 置为完成并关闭套接字的读写, 连接所在线程读到 EOF 后关闭连接, 不会一直等待 FinishAsync
+  void Post(const std::shared_ptr<HttpConnection> &conn, std::function<void()> task);
+
+  std::weak_ptr<HttpConnection> conn_;
+  const bool is_head_;
+  mutable std::mutex mutex_;  // 检查状态和投递在锁内完成, 保证各段按调用顺序发送
+  bool chunked_ = false;
+  bool done_ = false;
+};
+
+class HttpServer : public TcpServer, public std::enable_shared_from_this<HttpServer> {
+ public:
+  using Handler = std::function<void(const HttpRequest &request, HttpResponse &response)>;
+  using AsyncHandler =
+      std::function<void(const HttpRequest &request, std::shared_ptr<HttpResponder> responder)>;
+
+  static std::shared_ptr<HttpServer> Create(EventLoop *event_loop);
+  ~HttpServer() = default;
+
+  // 在 Start 之前注册, 之后只读, 处理请求时不需要加锁
+  void AddRoute(const std::string &path, const Handler &handler);
+
+  // 以 prefix 开头的路径, 在精确匹配的路径之后匹配, 多个前缀都匹配时取最长的
+  void AddPrefixRoute(const std::string &prefix, const Handler &handler);
+
+  // 以 prefix 开头的路径, 稍后通过 responder 响应, 如阻塞的播放列表请求. 先于同步路径匹配
+  void AddAsyncPrefixRoute(const std::string &prefix, const AsyncHandler &handler);
+
+ private:
+  friend class HttpConnection;
+
+  HttpServer(EventLoop *event_loop);
+
+  // 找到路径对应的处理函数并填充响应, 没有则返回 404
+  void Dispatch(const HttpRequest &request, HttpResponse &response) const;
+
+  // 没有匹配的异步处理函数返回 nullptr
+  const AsyncHandler *FindAsync(const std::string &path) const;
+
+  TcpConnection::Ptr OnConnect(SOCKET sockfd) override;
+
+  std::map<std::string, Handler> routes_;
+  std::vector<std::pair<std::string, Handler>> prefix_routes_;
+  std::vector<std::pair<std::string, AsyncHandler>> async_routes_;
+};
+
+#endif  // RTMP_SERVER_HTTP_SERVER_H
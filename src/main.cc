@@ -6,24 +6,72 @@
 
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
 #include <string>
 #include "EventLoop.h"
+#include "FrameTrace.h"
+#include "HttpFlvServer.h"
+#include "HttpServer.h"
 #include "RtmpClient.h"
+#include "RtmpHls.h"
+#include "RtmpLlHls.h"
+#include "RtmpMetrics.h"
 #include "RtmpPublisher.h"
 #include "RtmpServer.h"
+#include "WorkerPool.h"
 
 
 int TestRtmpPublisher(EventLoop *event_loop);
 
-int main(int argc, const char **argv) {
-  uint16_t port = 1935;
-  uint32_t thread_num = std::thread::hardware_concurrency();
+// 单进程模式下运行在 main 中, 多进程模式下运行在每个 worker 中, frame_bus 为空表示单进程
+int RunServer(uint16_t port, const char *origin_url, uint32_t thread_num,
+              std::shared_ptr<RtmpFrameBus> frame_bus) {
   EventLoop event_loop(thread_num);
 
   auto rtmp_server = RtmpServer::Create(&event_loop);
   rtmp_server->SetChunkSize(60000);
   
   rtmp_server->SetGopCache();
+
+  // HLS 输出: http://ip:8080/app/stream.m3u8, 2 秒一个分片, 播放列表保留 5 个, 默认关闭,
+  // 只用于单进程模式
+  // rtmp_server->SetHls(2000, 5);
+
+  // 低延迟 HLS 输出: http://ip:8080/ll/app/stream.m3u8, 200ms 一个部分分片, 默认关闭,
+  // 只用于单进程模式
+  // rtmp_server->SetLlHls(2000, 200, 5);
+
+  // 每 100 帧采样一帧统计服务器内部的分阶段延迟, 设为 0 关闭
+  FrameTracer::SetSampleInterval(100);
+
+  // 推流连接的入口抓包, 用 replay_bench 离线回放, 默认关闭
+  // rtmp_server->SetIngressCapture("./capture");
+
+  // 时移: rtmp 拉流端 play 命令的 start 参数 (毫秒) 大于 0 时从直播之前 start 处开始播放,
+  // 每路流在内存中保存最近 10 分钟, 最多 256MB, 默认关闭
+  // RtmpTimeshiftOptions timeshift;
+  // timeshift.max_ms = 10 * 60 * 1000;
+  // rtmp_server->SetTimeshift(timeshift);
+
+  // 点播: rtmp://ip/app/stream 没有推流端时播放 ./vod/app/stream.flv 或 ./vod/stream.flv
+  // rtmp_server->SetVod("./vod");
+
+  // 边缘模式: ./rtmp_server 1936 rtmp://127.0.0.1:1935, 本机没有推流端的流从源站拉取,
+  // 同一个流的拉流端共用一个回源连接, 最后一个拉流端离开 10 秒之后断开
+  if (origin_url != nullptr) {
+    rtmp_server->SetEdge(origin_url, 10000);
+  }
+
+  // 多进程模式: 推流写入共享内存中的帧总线, 拉流端连到任意一个 worker 都可以播放其他 worker 上的推流
+  if (frame_bus) {
+    rtmp_server->SetFrameBus(frame_bus, 10000);
+  }
+
+  // FLV 录制, 在单独的写线程中写文件, 每 10 分钟切换一个文件, 默认关闭
+  // RtmpRecordOptions record;
+  // record.dir = "./record";
+  // record.segment_ms = 10 * 60 * 1000;
+  // rtmp_server->SetRecord(record);
   
   rtmp_server->SetEventCallback([](std::string type, std::string stream_path) {
     printf("[Event] %s, stream path: %s\n\n", type.c_str(), stream_path.c_str());
@@ -33,6 +81,27 @@ int main(int argc, const char **argv) {
     printf("RTMP Server listen on %d failed.\n", port);
   }
 
+  // 统计信息: http://ip:8080/metrics (Prometheus), http://ip:8080/metrics.json
+  // 多进程模式下不开启: HLS 的分片和统计只在各自的 worker 中, 请求会落到任意一个 worker 上
+  std::shared_ptr<HttpServer> http_server;
+  if (!frame_bus) {
+    uint16_t http_port = 8080;
+    http_server = HttpServer::Create(&event_loop);
+    RtmpMetrics::RegisterRoutes(*http_server, rtmp_server);
+    RtmpHls::RegisterRoutes(*http_server, rtmp_server);
+    RtmpLlHls::RegisterRoutes(*http_server, rtmp_server);
+    if (!http_server->Start("0.0.0.0", http_port)) {
+      printf("HTTP Server listen on %d failed.\n", http_port);
+    }
+  }
+
+  // HTTP-FLV 拉流: http://ip:8081/app/stream.flv
+  uint16_t http_flv_port = 8081;
+  auto http_flv_server = HttpFlvServer::Create(&event_loop, rtmp_server);
+  if (!http_flv_server->Start("0.0.0.0", http_flv_port)) {
+    printf("HTTP-FLV Server listen on %d failed.\n", http_flv_port);
+  }
+
   while (true) {
     std::this_thread::sleep_for(std::chrono::seconds(5));
   }
@@ -40,3 +109,39 @@ int main(int argc, const char **argv) {
   rtmp_server->Stop();
   return 0;
 }
+
+// ./rtmp_server [port] [origin_url] [--workers=N]
+// --workers 大于 1 时为 master/worker 多进程模式, 每个 worker 监听同样的端口 (SO_REUSEPORT)
+int main(int argc, const char **argv) {
+  uint16_t port = 1935;
+  const char *origin_url = nullptr;
+  uint32_t workers = 1;
+  int position = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 10, "--workers=") == 0) {
+      workers = (uint32_t)atoi(arg.c_str() + 10);
+    } else if (position++ == 0) {
+      port = (uint16_t)atoi(argv[i]);
+    } else {
+      origin_url = argv[i];
+    }
+  }
+
+  uint32_t thread_num = std::thread::hardware_concurrency();
+  if (workers <= 1) {
+    return RunServer(port, origin_url, thread_num, nullptr);
+  }
+
+  // 帧总线在 fork 之前映射, master 不创建任何线程
+  auto frame_bus = RtmpFrameBus::Create(RtmpFrameBusOptions());
+  if (!frame_bus) {
+    printf("Create frame bus failed.\n");
+    return -1;
+  }
+  thread_num = thread_num > workers ? thread_num / workers : 1;
+  return WorkerPool::Run(
+      workers,
+      [&](uint32_t) { return RunServer(port, origin_url, thread_num, frame_bus); },
+      [&](uint32_t, pid_t pid, int) { frame_bus->ReleaseOwner(pid); });
+}
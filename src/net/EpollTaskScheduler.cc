@@ -12,6 +12,7 @@
 #include <cstdio>
 
 #include "Logger.h"
+#include "Timestamp.h"
 
 EpollTaskScheduler::EpollTaskScheduler(int id) : TaskScheduler(id) {
   epollfd_ = epoll_create(1024);  // 1024 is just a hint for the kernel
@@ -76,10 +77,15 @@ bool EpollTaskScheduler::HandleEvent(int timeout) {
   }
 
   // 通过 Channel 调用相应事件的回调函数
+  int64_t begin = Timestamp::NowNanos();
   for (int i = 0; i < num_events; i++) {
     if (events[i].data.ptr) {
       ((Channel*)events[i].data.ptr)->HandleEvent(events[i].events);
     }
   }
+  if (num_events > 0) {
+    last_io_events_ = num_events;
+    last_io_dispatch_ns_ = Timestamp::NowNanos() - begin;
+  }
   return true;
 }
@@ -36,6 +36,11 @@ std::shared_ptr<TaskScheduler> EventLoop::GetTaskScheduler() {
   return nullptr;
 }
 
+std::vector<std::shared_ptr<TaskScheduler>> EventLoop::GetTaskSchedulers() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return task_schedulers_;
+}
+
 void EventLoop::Loop() {
   std::lock_guard<std::mutex> lock(mutex_);
 
@@ -45,6 +45,9 @@ class EventLoop {
 
   std::shared_ptr<TaskScheduler> GetTaskScheduler();
 
+  // 返回全部 TaskScheduler, 用于统计
+  std::vector<std::shared_ptr<TaskScheduler>> GetTaskSchedulers();
+
   bool AddTriggerEvent(TriggerEvent callback);
   TimerId AddTimer(TimerEvent timerEvent, uint32_t msec);
   void RemoveTimer(TimerId timerId);
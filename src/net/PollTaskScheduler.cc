@@ -11,6 +11,7 @@
 #include <mutex>
 
 #include "Socket.h"
+#include "Timestamp.h"
 
 PollTaskScheduler::PollTaskScheduler(int id) : TaskScheduler(id) {
   pollfds_.push_back({ wakeup_channel_->GetSocket(), static_cast<short>(wakeup_channel_->GetEvents()), 0});
@@ -79,9 +80,12 @@ bool PollTaskScheduler::HandleEvent(int timeout) {
       }
     }
 
+    int64_t begin = Timestamp::NowNanos();
     for (auto& it : active_events) {
       it.first->HandleEvent(it.second);
     }
+    last_io_events_ = num_events;
+    last_io_dispatch_ns_ = Timestamp::NowNanos() - begin;
   }
   return true;
 }
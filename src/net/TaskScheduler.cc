@@ -8,11 +8,13 @@
 
 #include <signal.h>
 
+#include "Timestamp.h"
+
 TaskScheduler::TaskScheduler(int id)
     : id_(id),
       is_shutdown_(false),
       wakeup_pipe_(new Pipe()),
-      trigger_events_(new RingBuffer<TriggerEvent>(kMaxTriggetEvents)) {
+      trigger_events_(new RingBuffer<TriggerTask>(kMaxTriggetEvents)) {
   static std::once_flag flag;
   std::call_once(flag, [] {
 
@@ -35,15 +37,29 @@ void TaskScheduler::Start() {
   ::signal(SIGTERM, SIG_IGN);
   ::signal(SIGKILL, SIG_IGN);
 
-  is_shutdown_ = false;
+  // is_shutdown_ 在构造时已置为 false, 这里不再重置, 否则线程启动之前调用的 Stop 会丢失
   // 事件循环, 这个才是真正的 muduo 中的 EventLoop
   while (!is_shutdown_) {
-    this->HandleTriggerEvent();
+    loop_iterations_.store(loop_iterations_.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+    int64_t begin = Timestamp::NowNanos();
+    uint32_t triggers = this->HandleTriggerEvent();
+    int64_t trigger_end = Timestamp::NowNanos();
     this->timer_queue_.HandleTimerEvent();
+    int64_t timer_end = Timestamp::NowNanos();
+
+    stats_.trigger_ns.RecordSingleWriter(trigger_end - begin);
+    stats_.timer_ns.RecordSingleWriter(timer_end - trigger_end);
+    stats_.triggers.RecordSingleWriter(triggers);
+
     // 获取定时列中下一个事件的剩余时间作为阻塞等待的时间, 队列为空时候 epoll 一直阻塞等待事件到达
     // 阻塞的这段时间内可被 wakeup_pipe 上的可读事件唤醒
     int64_t timeout = this->timer_queue_.GetTimeRemaining();
+    last_io_events_ = 0;
+    last_io_dispatch_ns_ = 0;
     this->HandleEvent((int)timeout);
+    stats_.io_ns.RecordSingleWriter(last_io_dispatch_ns_);
+    stats_.io_events.RecordSingleWriter(last_io_events_);
   }
 }
 
@@ -71,7 +87,10 @@ bool TaskScheduler::AddTriggerEvent(TriggerEvent callback) {
   if (trigger_events_->Size() < kMaxTriggetEvents) {
     std::lock_guard<std::mutex> lock(mutex_);
     char event = kTriggetEvent;
-    trigger_events_->Push(std::move(callback));
+    TriggerTask task;
+    task.callback = std::move(callback);
+    task.post_time_ns = Timestamp::NowNanos();
+    trigger_events_->Push(std::move(task));
     wakeup_pipe_->Write(&event, 1);
     return true;
   }
@@ -86,11 +105,15 @@ void TaskScheduler::Wake() {
     ;
 }
 
-void TaskScheduler::HandleTriggerEvent() {
+uint32_t TaskScheduler::HandleTriggerEvent() {
+  uint32_t count = 0;
   do {
-    TriggerEvent callback;
-    if (trigger_events_->Pop(callback)) {
-      callback();
+    TriggerTask task;
+    if (trigger_events_->Pop(task)) {
+      stats_.trigger_lag_ns.RecordSingleWriter(Timestamp::NowNanos() - task.post_time_ns);
+      task.callback();
+      count++;
     }
   } while (trigger_events_->Size() > 0);
+  return count;
 }
@@ -10,12 +10,23 @@
 #define RTMP_SERVER_TASK_SCHEDULER_H
 
 #include "Channel.h"
+#include "LatencyHistogram.h"
 #include "Pipe.h"
 #include "RingBuffer.h"
 #include "Timer.h"
 
 typedef std::function<void(void)> TriggerEvent;
 
+// 事件循环的运行时统计, 只由调度器线程记录 (RecordSingleWriter), 其他线程随时读取
+struct SchedulerStats {
+  LatencyHistogram trigger_ns;        // 每轮 HandleTriggerEvent 耗时
+  LatencyHistogram timer_ns;          // 每轮 HandleTimerEvent 耗时
+  LatencyHistogram io_ns;             // 每轮 I/O 事件分发耗时, 不含阻塞等待
+  LatencyHistogram trigger_lag_ns;    // 触发事件从投递到开始执行的延迟
+  LatencyHistogram triggers;          // 每轮执行的触发事件数
+  LatencyHistogram io_events;         // 每轮处理的 I/O 事件数
+};
+
 class TaskScheduler {
  public:
   TaskScheduler(int id = 1);
@@ -40,10 +51,24 @@ class TaskScheduler {
 
   int GetId() const { return id_; }
 
+  /* 以下统计信息由调度器线程更新, 任意线程无锁读取 */
+
+  uint64_t GetLoopIterations() const { return loop_iterations_.load(std::memory_order_relaxed); }
+
+  int GetTriggerQueueDepth() const { return trigger_events_->Size(); }
+
+  int GetConnectionsNum() const { return num_connections_.load(std::memory_order_relaxed); }
+
+  const SchedulerStats& GetStats() const { return stats_; }
+
+  // 由 TcpConnection 在创建和销毁时调用
+  void AddConnectionsNum(int n) { num_connections_.fetch_add(n, std::memory_order_relaxed); }
+
  protected:
   // 在等待 I/O 事件时, 添加 Trigger 事件或 Timer 事件(部分情况下)需要从阻塞中唤醒
   void Wake();
-  void HandleTriggerEvent();
+  // 返回本轮执行的触发事件数
+  uint32_t HandleTriggerEvent();
 
   int id_ = 0;
   std::atomic_bool is_shutdown_;
@@ -51,11 +76,25 @@ class TaskScheduler {
   // 其他类可通过 wakeup 管道可读事件唤醒 TaskScheduler 执行任务
   std::unique_ptr<Pipe> wakeup_pipe_;
   std::shared_ptr<Channel> wakeup_channel_;
-  std::unique_ptr<RingBuffer<TriggerEvent>> trigger_events_;
+  // 触发事件和投递时间, 用于统计调度延迟
+  struct TriggerTask {
+    TriggerEvent callback;
+    int64_t post_time_ns = 0;
+  };
+
+  std::unique_ptr<RingBuffer<TriggerTask>> trigger_events_;
 
   std::mutex mutex_;
   TimerQueue timer_queue_;  // 内部取消了锁
 
+  std::atomic<uint64_t> loop_iterations_{0};
+  std::atomic_int num_connections_{0};
+  SchedulerStats stats_;
+
+  // 由子类的 HandleEvent 填写: 本轮处理的 I/O 事件数和分发耗时
+  int last_io_events_ = 0;
+  int64_t last_io_dispatch_ns_ = 0;
+
   static const char kTriggetEvent = 1;  // 写管道时标识来源为触发事件
   static const char kTimerEvent = 2;  // 写管道时标识来源为定时事件
   static const int kMaxTriggetEvents = 50000;
@@ -26,22 +26,27 @@ TcpConnection::TcpConnection(TaskScheduler *task_scheduler, SOCKET sockfd)
 
   channel_->EnableReading();
   task_scheduler_->UpdateChannel(channel_);
+  task_scheduler_->AddConnectionsNum(1);
 }
 
 TcpConnection::~TcpConnection() {
+  task_scheduler_->AddConnectionsNum(-1);
   SOCKET fd = channel_->GetSocket();
   if (fd > 0) {
     SocketUtil::Close(fd);
   }
 }
 
-void TcpConnection::Send(std::shared_ptr<char> data, uint32_t size) {
+void TcpConnection::Send(std::shared_ptr<char> data, uint32_t size,
+                         std::shared_ptr<const PacketTrace> trace) {
   if (!is_closed_) {
     {
 #ifdef THEAD_SAFE_TCP_CONNECTION
       std::lock_guard<std::mutex> lock(mutex_);
 #endif
-      write_buffer_->Append(data, size);
+      if (!write_buffer_->Append(data, size, 0, std::move(trace))) {  // 发送队列满, 对端消费太慢
+        stats_.dropped_packets.fetch_add(1, std::memory_order_relaxed);
+      }
     }
     this->HandleWrite();
   }
@@ -53,7 +58,9 @@ void TcpConnection::Send(const char *data, uint32_t size) {
 #ifdef THEAD_SAFE_TCP_CONNECTION
       std::lock_guard<std::mutex> lock(mutex_);
 #endif
-      write_buffer_->Append(data, size);
+      if (!write_buffer_->Append(data, size)) {  // 发送队列满, 对端消费太慢
+        stats_.dropped_packets.fetch_add(1, std::memory_order_relaxed);
+      }
     }
     this->HandleWrite();
   }
@@ -82,6 +89,9 @@ void TcpConnection::HandleRead() {
       this->Close();
       return;
     }
+
+    stats_.bytes_in.fetch_add(ret, std::memory_order_relaxed);
+    GlobalMetrics::Instance().bytes_in.Add(ret);
   }
 
   if (read_cb_) {
@@ -120,6 +130,8 @@ void TcpConnection::HandleWrite() {
     empty = write_buffer_->IsEmpty();
   } while (0);
 
+  UpdateWriteStats();
+
   if (empty) {
     if (channel_->IsWriting()) {
       channel_->DisableWriting();
@@ -135,9 +147,20 @@ void TcpConnection::HandleWrite() {
 #endif
 }
 
+void TcpConnection::UpdateWriteStats() {
+  uint64_t sent = write_buffer_->SentBytes();
+  uint64_t last_sent = stats_.bytes_out.load(std::memory_order_relaxed);
+  if (sent != last_sent) {
+    GlobalMetrics::Instance().bytes_out.Add(sent - last_sent);
+    stats_.bytes_out.store(sent, std::memory_order_relaxed);
+  }
+  stats_.queued_bytes.store(write_buffer_->QueuedBytes(), std::memory_order_relaxed);
+}
+
 void TcpConnection::Close() {
   if (!is_closed_) {
     is_closed_ = true;
+    GlobalMetrics::Instance().connections_closed.Add();
     task_scheduler_->RemoveChannel(channel_);
 
     if (close_cb_) {
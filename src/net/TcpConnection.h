@@ -17,6 +17,7 @@
 #include "BufferReader.h"
 #include "BufferWriter.h"
 #include "Channel.h"
+#include "Metrics.h"
 #include "SocketUtil.h"
 #include "TaskScheduler.h"
 
@@ -37,7 +38,8 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
 
   void SetCloseCallback(const CloseCallback& cb) { close_cb_ = cb; }
 
-  void Send(std::shared_ptr<char> data, uint32_t size);
+  void Send(std::shared_ptr<char> data, uint32_t size,
+            std::shared_ptr<const PacketTrace> trace = nullptr);
   void Send(const char* data, uint32_t size);
 
   void Disconnect();
@@ -50,6 +52,8 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
 
   std::string GetIp() const { return SocketUtil::GetPeerIp(channel_->GetSocket()); }
 
+  const ConnectionStats& GetStats() const { return stats_; }
+
  protected:
   friend class TcpServer;
 
@@ -64,10 +68,14 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
   std::unique_ptr<BufferReader> read_buffer_;
   std::unique_ptr<BufferWriter> write_buffer_;
   std::atomic_bool is_closed_;  // 可能被 server 线程 session 线程访问, 需要原子操作
+  ConnectionStats stats_;
 
  private:
   void Close();
 
+  // 发送后同步发送队列的统计信息
+  void UpdateWriteStats();
+
   std::shared_ptr<Channel> channel_;
 
 #ifdef THEAD_SAFE_TCP_CONNECTION
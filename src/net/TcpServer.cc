@@ -12,25 +12,14 @@
 #include "Acceptor.h"
 #include "EventLoop.h"
 #include "Logger.h"
+#include "Metrics.h"
+#include "SocketUtil.h"
 
 TcpServer::TcpServer(EventLoop* event_loop)
     : event_loop_(event_loop), port_(0), acceptor_(new Acceptor(event_loop_)), is_started_(false) {
   acceptor_->SetNewConnectionCallback([this](SOCKET sockfd) {
-    TcpConnection::Ptr conn = this->OnConnect(sockfd);
-    if (conn) {
-      this->AddConnection(sockfd, conn);
-      conn->SetDisconnectCallback([this](TcpConnection::Ptr conn) {
-        auto scheduler = conn->GetTaskScheduler();
-        SOCKET sockfd = conn->GetSocket();
-        if (!scheduler->AddTriggerEvent([this, sockfd] { this->RemoveConnection(sockfd); })) {
-          scheduler->AddTimer(
-              [this, sockfd]() {
-                this->RemoveConnection(sockfd);
-                return false;
-              },
-              100);
-        }
-      });
+    if (!this->AdoptConnection(sockfd)) {
+      SocketUtil::Close(sockfd);
     }
   });
 }
@@ -55,18 +44,28 @@ bool TcpServer::Start(std::string ip, uint16_t port) {
 }
 
 void TcpServer::Stop() {
-  if (is_started_) {
+  bool has_connections = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_connections = !connections_.empty();
+  }
+
+  // 没有 Start 时也可能有 AdoptConnection 接管的连接
+  if (is_started_ || has_connections) {
     {
       std::lock_guard<std::mutex> lock(mutex_);
       for (auto iter : connections_) {
         iter.second->Disconnect();
       }
     }
-    acceptor_->Close();
-    is_started_ = false;
+    if (is_started_) {
+      acceptor_->Close();
+      is_started_ = false;
+    }
 
     while (true) {
       Timer::SleepMilliseconds(10);
+      std::lock_guard<std::mutex> lock(mutex_);
       if (connections_.empty()) {
         break;
       }
@@ -74,6 +73,29 @@ void TcpServer::Stop() {
   }
 }
 
+bool TcpServer::AdoptConnection(SOCKET sockfd) {
+  TcpConnection::Ptr conn = this->OnConnect(sockfd);
+  if (!conn) {
+    return false;
+  }
+
+  GlobalMetrics::Instance().connections_accepted.Add();
+  this->AddConnection(sockfd, conn);
+  conn->SetDisconnectCallback([this](TcpConnection::Ptr conn) {
+    auto scheduler = conn->GetTaskScheduler();
+    SOCKET sockfd = conn->GetSocket();
+    if (!scheduler->AddTriggerEvent([this, sockfd] { this->RemoveConnection(sockfd); })) {
+      scheduler->AddTimer(
+          [this, sockfd]() {
+            this->RemoveConnection(sockfd);
+            return false;
+          },
+          100);
+    }
+  });
+  return true;
+}
+
 TcpConnection::Ptr TcpServer::OnConnect(SOCKET sockfd) {
   return std::make_shared<TcpConnection>(event_loop_->GetTaskScheduler().get(), sockfd);
 }
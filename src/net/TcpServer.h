@@ -30,6 +30,10 @@ class TcpServer {
 
   uint16_t GetPort() const { return port_; }
 
+  // 接管一个已经建立好的连接 (例如 socketpair 的一端), 和 accept 得到的连接走同样的流程,
+  // 不需要 Start 监听端口, 用于进程内的压测. 成功后 sockfd 归连接所有
+  bool AdoptConnection(SOCKET sockfd);
+
  protected:
   // 连接建立之后的调用的函数, 默认实现 Round Robin 分发到下一个 TaskScheduler
   virtual TcpConnection::Ptr OnConnect(SOCKET sockfd);
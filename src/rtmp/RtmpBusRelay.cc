@@ -0,0 +1,74 @@
+/// @file RtmpBusRelay.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpBusRelay.h"
+
+#include "Logger.h"
+#include "rtmp.h"
+
+RtmpBusRelay::RtmpBusRelay(EventLoop *loop, std::shared_ptr<RtmpFrameBus> bus,
+                           const std::string &stream_path, RtmpSession::Ptr session,
+                           uint32_t idle_ms)
+    : event_loop_(loop), bus_(bus), stream_path_(stream_path), sink_(session, idle_ms) {}
+
+void RtmpBusRelay::Start() {
+  // 定时器队列不是线程安全的, 在调度器自己的线程中添加
+  std::weak_ptr<RtmpBusRelay> weak_relay = shared_from_this();
+  TaskScheduler *scheduler = event_loop_->GetTaskScheduler().get();
+  bool posted = scheduler->AddTriggerEvent([weak_relay, scheduler]() {
+    scheduler->AddTimer(
+        [weak_relay]() {
+          auto relay = weak_relay.lock();
+          return relay != nullptr && relay->OnTimer();
+        },
+        kPollMs);
+  });
+  if (!posted) {
+    stopped_ = true;
+  }
+}
+
+bool RtmpBusRelay::OnTimer() {
+  if (quit_ || sink_.IsIdle()) {
+    reader_.reset();
+    connected_ = false;
+    stopped_ = true;
+    LOG_INFO("[BusRelay] %s stopped.\n", stream_path_.c_str());
+    return false;
+  }
+
+  // 本 worker 上有推流端时以本 worker 为准, 不再读取总线
+  if (sink_.GetSession()->GetPublisher() != nullptr) {
+    reader_.reset();
+    connected_ = false;
+    return true;
+  }
+
+  if (reader_ == nullptr) {
+    reader_ = bus_->OpenReader(stream_path_);
+    if (reader_ == nullptr) {
+      return true;
+    }
+    connected_ = true;
+    LOG_INFO("[BusRelay] %s attached.\n", stream_path_.c_str());
+  }
+
+  int frames = reader_->Poll(
+      [this](uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size) {
+        if (type == RTMP_DATA_MESSAGE) {
+          sink_.OnMetaData(data.get(), size);
+        } else {
+          sink_.OnMedia(type, timestamp, data, size);
+        }
+      },
+      kMaxFramesPerPoll);
+  if (frames < 0) {
+    // 推流结束, 拉流端还在时等待新的推流端
+    reader_.reset();
+    connected_ = false;
+  }
+  return true;
+}
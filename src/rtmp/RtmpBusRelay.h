@@ -0,0 +1,66 @@
+/// @file RtmpBusRelay.h
+/// @brief 多进程模式下, 拉流的流在本 worker 没有推流端时从帧总线读取其他 worker 写入的帧, 写入本 worker 的会话,
+///        由会话扇出给本 worker 的拉流端. 在事件循环的定时器中轮询, 每帧只从共享内存拷贝一次.
+///        推流端稍后才开始时先等待, 最后一个拉流端离开 idle_ms 之后退出
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_BUS_RELAY_H
+#define RTMP_SERVER_RTMP_BUS_RELAY_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "EventLoop.h"
+#include "RtmpFrameBus.h"
+#include "RtmpRelaySink.h"
+#include "RtmpSession.h"
+
+class RtmpBusRelay : public std::enable_shared_from_this<RtmpBusRelay> {
+ public:
+  RtmpBusRelay(EventLoop *loop, std::shared_ptr<RtmpFrameBus> bus, const std::string &stream_path,
+               RtmpSession::Ptr session, uint32_t idle_ms);
+  RtmpBusRelay(const RtmpBusRelay &) = delete;
+  RtmpBusRelay &operator=(const RtmpBusRelay &) = delete;
+
+  // 在事件循环的一个线程上启动轮询定时器, 只调用一次
+  void Start();
+
+  // 下一次轮询时退出, 不等待
+  void Stop() { quit_ = true; }
+
+  // 拉流端进入时调用, 见 RtmpRelaySink::Touch
+  void Touch() { sink_.Touch(); }
+
+  bool IsStopped() const { return stopped_.load(std::memory_order_acquire); }
+
+  // 正在读取其他 worker 上的推流
+  bool IsConnected() const { return connected_.load(std::memory_order_relaxed); }
+
+  RtmpSession::Ptr GetSession() const { return sink_.GetSession(); }
+
+  uint64_t GetFrames() const { return sink_.GetFrames(); }
+
+  static const uint32_t kPollMs = 2;
+  static const uint32_t kMaxFramesPerPoll = 256;
+
+ private:
+  // 定时器回调, 返回 false 时停止
+  bool OnTimer();
+
+  EventLoop *event_loop_;
+  std::shared_ptr<RtmpFrameBus> bus_;
+  const std::string stream_path_;
+
+  // 只在定时器所在的线程中访问, sink_ 的 Touch 除外
+  RtmpRelaySink sink_;
+  std::shared_ptr<RtmpFrameBusReader> reader_;
+
+  std::atomic_bool quit_{false};
+  std::atomic_bool stopped_{false};
+  std::atomic_bool connected_{false};
+};
+
+#endif  // RTMP_SERVER_RTMP_BUS_RELAY_H
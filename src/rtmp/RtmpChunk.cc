@@ -213,6 +213,11 @@ int RtmpChunk::CreateMessageHeader(uint8_t fmt, RtmpMessage& rtmp_msg, char* buf
 }
 
 int RtmpChunk::CreateChunk(uint32_t csid, RtmpMessage& rtmp_msg, char* buf, uint32_t buf_size) {
+  return CreateChunk(csid, rtmp_msg, rtmp_msg.payload.get(), buf, buf_size);
+}
+
+int RtmpChunk::CreateChunk(uint32_t csid, RtmpMessage& rtmp_msg, const char* payload, char* buf,
+                           uint32_t buf_size) {
   uint32_t buf_offset = 0, payload_offset = 0;
   // 计算分 chunk 之后至少需要多少空间
   // rtmp_msg.length / out_chunk_size_ * 5 是分出来的多的块的块头长度
@@ -231,7 +236,7 @@ int RtmpChunk::CreateChunk(uint32_t csid, RtmpMessage& rtmp_msg, char* buf, uint
 
   while (rtmp_msg.length > 0) {
     if (rtmp_msg.length > out_chunk_size_) {
-      memcpy(buf + buf_offset, rtmp_msg.payload.get() + payload_offset, out_chunk_size_);
+      memcpy(buf + buf_offset, payload + payload_offset, out_chunk_size_);
       payload_offset += out_chunk_size_;
       buf_offset += out_chunk_size_;
       rtmp_msg.length -= out_chunk_size_;
@@ -242,7 +247,7 @@ int RtmpChunk::CreateChunk(uint32_t csid, RtmpMessage& rtmp_msg, char* buf, uint
         buf_offset += 4;
       }
     } else {
-      memcpy(buf + buf_offset, rtmp_msg.payload.get() + payload_offset, rtmp_msg.length);
+      memcpy(buf + buf_offset, payload + payload_offset, rtmp_msg.length);
       buf_offset += rtmp_msg.length;
       rtmp_msg.length = 0;
       break;
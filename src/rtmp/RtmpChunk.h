@@ -31,10 +31,16 @@ class RtmpChunk {
   // 将信息封装成块, 由 buf 数组传出, 返回 buf 中存的块的大小, -1 失败
   int CreateChunk(uint32_t csid, RtmpMessage& rtmp_msg, char* buf, uint32_t buf_size);
 
+  // 同上, payload 由调用方给出而不是取 rtmp_msg.payload, 用于预编码的响应模板
+  int CreateChunk(uint32_t csid, RtmpMessage& rtmp_msg, const char* payload, char* buf,
+                  uint32_t buf_size);
+
   void SetInChunkSize(uint32_t in_chunk_size) { in_chunk_size_ = in_chunk_size; }
 
   void SetOutChunkSize(uint32_t out_chunk_size) { out_chunk_size_ = out_chunk_size; }
 
+  uint32_t GetOutChunkSize() const { return out_chunk_size_; }
+
   void Clear() { rtmp_messages_.clear(); }
 
   int GetStreamId() const { return stream_id_; }
@@ -7,6 +7,7 @@
 #include "RtmpClient.h"
 
 #include "Logger.h"
+#include "SocketUtil.h"
 
 RtmpClient::RtmpClient(EventLoop* event_loop) : event_loop_(event_loop) {}
 
@@ -22,7 +23,31 @@ void RtmpClient::SetRecvFrameCB(const FrameCallback& cb) {
   recv_frame_cb_ = cb;
 }
 
+void RtmpClient::SetRecvMediaCB(const MediaCallback& cb) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  recv_media_cb_ = cb;
+}
+
+void RtmpClient::SetRecvDataCB(const DataCallback& cb) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  recv_data_cb_ = cb;
+}
+
+void RtmpClient::SetLatencyProbe(RtmpLatencyProbe::Mode mode, const LatencyCallback& cb) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  probe_mode_ = mode;
+  latency_cb_ = cb;
+}
+
 int RtmpClient::OpenUrl(std::string url, int msec, std::string& status) {
+  return Open(url, msec, status, INVALID_SOCKET);
+}
+
+int RtmpClient::OpenSocket(SOCKET sockfd, std::string url, int msec, std::string& status) {
+  return Open(url, msec, status, sockfd);
+}
+
+int RtmpClient::Open(std::string url, int msec, std::string& status, SOCKET sockfd) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   static Timestamp timestamp;
@@ -35,6 +60,9 @@ int RtmpClient::OpenUrl(std::string url, int msec, std::string& status) {
 
   if (this->ParseRtmpUrl(url) != 0) {
     LOG_INFO("[RtmpPublisher] rtmp url(%s) was illegal.\n", url.c_str());
+    if (sockfd != INVALID_SOCKET) {
+      SocketUtil::Close(sockfd);
+    }
     return -1;
   }
 
@@ -47,18 +75,57 @@ int RtmpClient::OpenUrl(std::string url, int msec, std::string& status) {
     rtmp_conn_ = nullptr;
   }
 
-  TcpSocket tcp_socket;
-  tcp_socket.Create();
-  if (!tcp_socket.Connect(ip_, port_, timeout)) {
-    tcp_socket.Close();
-    return -1;
+  if (sockfd == INVALID_SOCKET) {
+    TcpSocket tcp_socket;
+    tcp_socket.Create();
+    if (!tcp_socket.Connect(ip_, port_, timeout)) {
+      tcp_socket.Close();
+      return -1;
+    }
+    sockfd = tcp_socket.GetSocket();
   }
 
   task_scheduler_ = event_loop_->GetTaskScheduler().get();
-  rtmp_conn_.reset(new RtmpConnection(shared_from_this(), task_scheduler_, tcp_socket.GetSocket()));
-  task_scheduler_->AddTriggerEvent([this]() {
-    if (recv_frame_cb_) {
-      rtmp_conn_->SetPlayCB(recv_frame_cb_);
+  rtmp_conn_.reset(new RtmpConnection(shared_from_this(), task_scheduler_, sockfd));
+  FrameCallback frame_cb = recv_frame_cb_;
+  RtmpConnection::DataCallback data_cb = recv_data_cb_;
+  if (latency_cb_ && probe_mode_ == RtmpLatencyProbe::PROBE_SEI) {
+    LatencyCallback latency_cb = latency_cb_;
+    frame_cb = [frame_cb, latency_cb](uint8_t* payload, uint32_t length, uint8_t codec_id,
+                                      uint32_t timestamp) {
+      int64_t stamp_us = 0;
+      if (codec_id == RTMP_CODEC_ID_H264 &&
+          RtmpLatencyProbe::ParseSei(payload, length, stamp_us)) {
+        latency_cb(Timestamp::NowMicros() - stamp_us);
+      }
+      if (frame_cb) {
+        frame_cb(payload, length, codec_id, timestamp);
+      }
+    };
+  } else if (latency_cb_ && probe_mode_ == RtmpLatencyProbe::PROBE_AMF) {
+    LatencyCallback latency_cb = latency_cb_;
+    DataCallback recv_data_cb = recv_data_cb_;
+    data_cb = [latency_cb, recv_data_cb](const char* payload, uint32_t length) {
+      int64_t stamp_us = 0;
+      if (RtmpLatencyProbe::ParseAmf(payload, length, stamp_us)) {
+        latency_cb(Timestamp::NowMicros() - stamp_us);
+      }
+      if (recv_data_cb) {
+        recv_data_cb(payload, length);
+      }
+    };
+  }
+
+  MediaCallback media_cb = recv_media_cb_;
+  task_scheduler_->AddTriggerEvent([this, frame_cb, media_cb, data_cb]() {
+    if (frame_cb) {
+      rtmp_conn_->SetPlayCB(frame_cb);
+    }
+    if (media_cb) {
+      rtmp_conn_->SetMediaCB(media_cb);
+    }
+    if (data_cb) {
+      rtmp_conn_->SetDataCB(data_cb);
     }
     rtmp_conn_->Handshake();
   });
@@ -68,9 +135,10 @@ int RtmpClient::OpenUrl(std::string url, int msec, std::string& status) {
     timeout = 1000;
   }
 
+  // 进程内 socketpair 的握手只需要几百微秒, 轮询间隔不宜太长
   do {
-    Timer::SleepMilliseconds(100);
-    timeout -= 100;
+    Timer::SleepMilliseconds(10);
+    timeout -= 10;
   } while (!rtmp_conn_->IsClosed() && !rtmp_conn_->IsPlaying() && timeout > 0);
 
   status = rtmp_conn_->GetStatus();
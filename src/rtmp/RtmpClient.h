@@ -12,18 +12,31 @@
 
 #include "EventLoop.h"
 #include "RtmpConnection.h"
+#include "RtmpLatencyProbe.h"
 #include "Timestamp.h"
 
 class RtmpClient : public Rtmp, public std::enable_shared_from_this<RtmpClient> {
  public:
   using FrameCallback =
       std::function<void(uint8_t* payload, uint32_t length, uint8_t codecId, uint32_t timestamp)>;
+  // latency_us: 推流端写入时间戳到拉流端收到的端到端延迟, 微秒
+  using LatencyCallback = std::function<void(int64_t latency_us)>;
+  using MediaCallback = RtmpConnection::MediaCallback;
+  using DataCallback = RtmpConnection::DataCallback;
 
   static std::shared_ptr<RtmpClient> Create(EventLoop* loop);
   ~RtmpClient();
 
   void SetRecvFrameCB(const FrameCallback& cb);
+  // 收到音视频消息时回调, payload 和收到的消息共用, 转发时不需要拷贝, 需在 OpenUrl 之前设置
+  void SetRecvMediaCB(const MediaCallback& cb);
+  // 收到数据消息 (例如 onMetaData) 时回调, 需在 OpenUrl 之前设置
+  void SetRecvDataCB(const DataCallback& cb);
+  // 从收到的帧中取出 RtmpPublisher::SetLatencyProbe 写入的时间戳, 需在 OpenUrl 之前设置
+  void SetLatencyProbe(RtmpLatencyProbe::Mode mode, const LatencyCallback& cb);
   int OpenUrl(std::string url, int msec, std::string& status);
+  // 在已经连接好的 sockfd 上拉流, 用法同 RtmpPublisher::OpenSocket
+  int OpenSocket(SOCKET sockfd, std::string url, int msec, std::string& status);
   void Close();
   bool IsConnected();
 
@@ -31,12 +44,18 @@ class RtmpClient : public Rtmp, public std::enable_shared_from_this<RtmpClient>
   friend class RtmpConnection;
 
   RtmpClient(EventLoop* event_loop);
+  // sockfd 为 INVALID_SOCKET 时按 url 建立 TCP 连接
+  int Open(std::string url, int msec, std::string& status, SOCKET sockfd);
 
   std::mutex mutex_;  // 此处的锁不是必要的, SetFrameCB 和 conn 都是只有一个线程会调用
   EventLoop* event_loop_;
   TaskScheduler* task_scheduler_;
   std::shared_ptr<RtmpConnection> rtmp_conn_;
   FrameCallback recv_frame_cb_;
+  MediaCallback recv_media_cb_;
+  DataCallback recv_data_cb_;
+  RtmpLatencyProbe::Mode probe_mode_ = RtmpLatencyProbe::PROBE_NONE;
+  LatencyCallback latency_cb_;
 };
 
 #endif  // RTMP_SERVER_RTMP_CLIENT_H
\ No newline at end of file
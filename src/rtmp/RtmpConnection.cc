@@ -6,12 +6,17 @@
 
 #include "RtmpConnection.h"
 
+#include <algorithm>
+#include <cstdlib>
 #include <random>
 
 #include "Logger.h"
 #include "RtmpClient.h"
+#include "RtmpLatencyProbe.h"
 #include "RtmpPublisher.h"
+#include "RtmpResponseTemplate.h"
 #include "RtmpServer.h"
+#include "Timestamp.h"
 
 RtmpConnection::RtmpConnection(TaskScheduler *task_scheduler, SOCKET sockfd, Rtmp *rtmp)
     : TcpConnection(task_scheduler, sockfd),
@@ -23,7 +28,7 @@ RtmpConnection::RtmpConnection(TaskScheduler *task_scheduler, SOCKET sockfd, Rtm
   acknowledgement_size_out_ = rtmp->GetAcknowledgementSize();
   max_gop_cache_len_ = rtmp->GetGopCacheLen();
   max_chunk_size_ = rtmp->GetChunkSize();
-  stream_path_ = rtmp->GetStreamPath();
+  stream_path_ = std::make_shared<const std::string>(rtmp->GetStreamPath());
   stream_name_ = rtmp->GetStreamName();
   app_ = rtmp->GetApp();
 
@@ -41,6 +46,11 @@ RtmpConnection::RtmpConnection(std::shared_ptr<RtmpServer> rtmp_server,
   handshake_.reset(new RtmpHandshake(RtmpHandshake::HANDSHAKE_C0C1));
   rtmp_server_ = rtmp_server;
   connection_mode_ = RTMP_SERVER;
+  startup_ = std::make_shared<StartupTrace>();
+  startup_->accept_ns = Timestamp::NowNanos();
+  if (!rtmp_server->capture_dir_.empty()) {
+    capture_.reset(new RtmpIngressCapture(rtmp_server->capture_max_bytes_));
+  }
 }
 
 RtmpConnection::RtmpConnection(std::shared_ptr<RtmpPublisher> rtmp_publisher,
@@ -65,18 +75,24 @@ bool RtmpConnection::OnRead(BufferReader &buffer) {
   if (handshake_->IsCompleted()) {
     ret = HandleChunk(buffer);
   } else {
-    // 还未完成握手则解析握手数据并返回握手响应数据
-    std::shared_ptr<char> res(new char[4096], std::default_delete<char[]>());
-    int res_size = handshake_->Parse(buffer, res.get(), 4096);
+    // 还未完成握手则解析握手数据并返回握手响应数据.
+    // Send 会把数据拷贝进发送队列, 所以响应缓冲区可以在同一线程的所有连接间复用
+    static thread_local char res[kHandshakeBufferSize];
+    int res_size = handshake_->Parse(buffer, res, kHandshakeBufferSize);
     if (res_size < 0) {
       ret = false;
     }
 
     if (res_size > 0) {
-      this->Send(res.get(), res_size);
+      this->Send(res, res_size);
     }
 
     if (handshake_->IsCompleted()) {
+      GlobalMetrics::Instance().handshakes.Add();
+      if (startup_) {
+        startup_->handshake_ns = Timestamp::NowNanos();
+      }
+
       // 完成握手还有额外数据则继续解析
       if (buffer.ReadableBytes() > 0) {
         ret = HandleChunk(buffer);
@@ -101,14 +117,43 @@ void RtmpConnection::OnClose() {
   }
 }
 
+void RtmpConnection::SetStreamName(const AmfStringView& stream_name) {
+  // 同一连接上的 publish/play/deleteStream 通常是同一个流名, 不变时不重建路径和哈希
+  if (!stream_path_->empty() && stream_name.Equals(stream_name_.data(), stream_name_.size())) {
+    return;
+  }
+
+  stream_name_.assign(stream_name.data, stream_name.size);
+  auto server = rtmp_server_.lock();
+  if (server) {
+    // 已经注册的流直接共用注册表中的路径字符串
+    stream_path_ = server->rtmp_sessions_.InternPath(app_, stream_name_, stream_hash_);
+  } else {
+    stream_path_ = std::make_shared<const std::string>("/" + app_ + "/" + stream_name_);
+    stream_hash_ = RtmpSessionRegistry::Hash(*stream_path_);
+  }
+}
+
 bool RtmpConnection::HandleChunk(BufferReader &buffer) {
   int ret = -1;
 
   do {
     RtmpMessage rtmp_msg;
+    const char *data = buffer.Peek();
     ret = rtmp_chunk_->Parse(buffer, rtmp_msg);
+    if (ret > 0 && capture_) {  // Parse 只移动读位置, data 仍然有效
+      capture_->Append(data, (uint32_t)ret);
+    }
     if (ret >= 0) {
       if (rtmp_msg.IsCompleted()) {
+        if ((rtmp_msg.type_id == RTMP_VIDEO || rtmp_msg.type_id == RTMP_AUDIO) &&
+            connection_mode_ == RTMP_SERVER && FrameTracer::ShouldSample(traced_frames_)) {
+          rtmp_msg.trace = std::make_shared<FrameTrace>();
+          rtmp_msg.trace->parsed_ns = Timestamp::NowNanos();
+          // 采样刚开启时可能还没有记录 recv 时间
+          int64_t recv_ns = buffer.GetLastReadTime();
+          rtmp_msg.trace->recv_ns = recv_ns > 0 ? recv_ns : rtmp_msg.trace->parsed_ns;
+        }
         if (!HandleMessage(rtmp_msg)) {
           return false;
         }
@@ -169,55 +214,134 @@ bool RtmpConnection::HandleMessage(RtmpMessage &rtmp_msg) {
   return ret;
 }
 
+/// 命令名到处理函数的分派表. 命令集合固定, 用 (长度 + 首字符 + 尾字符) & 31 作为完美哈希,
+/// 启动时建表并检查无冲突, 查表只需一次哈希和一次 memcmp, 替代逐个字符串比较.
+enum RtmpCommand {
+  RTMP_CMD_UNKNOWN = 0,
+  RTMP_CMD_CONNECT,
+  RTMP_CMD_CREATE_STREAM,
+  RTMP_CMD_PUBLISH,
+  RTMP_CMD_PLAY,
+  RTMP_CMD_PLAY2,
+  RTMP_CMD_DELETE_STREAM,
+  RTMP_CMD_RELEASE_STREAM,
+  RTMP_CMD_RESULT,
+  RTMP_CMD_ON_STATUS,
+};
+
+struct RtmpCommandEntry {
+  const char *name = nullptr;
+  uint32_t len = 0;
+  RtmpCommand command = RTMP_CMD_UNKNOWN;
+};
+
+static const uint32_t kCommandTableSize = 32;
+
+static inline uint32_t CommandHash(const char *name, uint32_t len) {
+  return (len + (uint8_t)name[0] + (uint8_t)name[len - 1]) & (kCommandTableSize - 1);
+}
+
+static const RtmpCommandEntry *BuildCommandTable() {
+  static RtmpCommandEntry table[kCommandTableSize];
+  static const RtmpCommandEntry commands[] = {
+      {"connect", 7, RTMP_CMD_CONNECT},
+      {"createStream", 12, RTMP_CMD_CREATE_STREAM},
+      {"publish", 7, RTMP_CMD_PUBLISH},
+      {"play", 4, RTMP_CMD_PLAY},
+      {"play2", 5, RTMP_CMD_PLAY2},
+      {"DeleteStream", 12, RTMP_CMD_DELETE_STREAM},
+      {"releaseStream", 13, RTMP_CMD_RELEASE_STREAM},
+      {"_result", 7, RTMP_CMD_RESULT},
+      {"onStatus", 8, RTMP_CMD_ON_STATUS},
+  };
+
+  for (auto &cmd : commands) {
+    RtmpCommandEntry &slot = table[CommandHash(cmd.name, cmd.len)];
+    if (slot.name != nullptr) {
+      // 新增命令导致冲突时需要调整哈希函数, 启动时立即暴露
+      LOG_ERROR("rtmp command table collision: %s, %s\n", slot.name, cmd.name);
+      abort();
+    }
+    slot = cmd;
+  }
+  return table;
+}
+
+static RtmpCommand LookupCommand(const AmfStringView &method) {
+  static const RtmpCommandEntry *table = BuildCommandTable();
+  if (method.Empty()) {
+    return RTMP_CMD_UNKNOWN;
+  }
+
+  const RtmpCommandEntry &entry = table[CommandHash(method.data, method.size)];
+  if (entry.name != nullptr && method.Equals(entry.name, entry.len)) {
+    return entry.command;
+  }
+  return RTMP_CMD_UNKNOWN;
+}
+
 bool RtmpConnection::HandleCommand(RtmpMessage &rtmp_msg) {
   bool ret = true;
-  amf_decoder_.Reset();
 
-  int bytes_used = amf_decoder_.Decode((const char *)rtmp_msg.payload.get(), rtmp_msg.length, 1);
-  if (bytes_used < 0) {
-    return false;
+  // 命令消息格式: 命令名, 事务 id, 命令对象(或 null), 可选参数...
+  AmfReader reader(rtmp_msg.payload.get(), rtmp_msg.length);
+  AmfStringView method;
+  if (!reader.ReadString(method)) {
+    return true;
   }
 
-  std::string method = amf_decoder_.GetString();
-  // LOG_INFO("[Method] %s\n", method.c_str());
+  double transaction_id = 0;
+  reader.ReadNumber(transaction_id);
+  AmfValue command_object;
+  reader.Next(command_object);
+
+  RtmpCommand command = LookupCommand(method);
+  // LOG_INFO("[Method] %.*s\n", (int)method.size, method.data);
 
   if (connection_mode_ == RTMP_PUBLISHER || connection_mode_ == RTMP_CLIENT) {
-    bytes_used +=
-        amf_decoder_.Decode(rtmp_msg.payload.get() + bytes_used, rtmp_msg.length - bytes_used);
-    if (method == "_result") {  // 建立连接阶段和建立流阶段, 服务器发送的最后一个命令 "_result" 
-      ret = HandleResult(rtmp_msg);
-    } else if (method == "onStatus") {  // 推流端 push 阶段 或 拉流端 play 阶段服务器返回的状态命令
-      ret = HandleOnStatus(rtmp_msg);
+    // _result 和 onStatus 的第四个值是状态信息对象, createStream 的 _result 则是流 id
+    AmfValue info;
+    reader.Next(info);
+    if (command == RTMP_CMD_RESULT) {  // 建立连接阶段和建立流阶段, 服务器发送的最后一个命令 "_result" 
+      ret = HandleResult(info);
+    } else if (command == RTMP_CMD_ON_STATUS) {  // 推流端 push 阶段 或 拉流端 play 阶段服务器返回的状态命令
+      ret = HandleOnStatus(info);
     }
   } else if (connection_mode_ == RTMP_SERVER) {
     if (rtmp_msg.stream_id == 0) {
-      bytes_used +=
-          amf_decoder_.Decode(rtmp_msg.payload.get() + bytes_used, rtmp_msg.length - bytes_used);
-      if (method == "connect") {
-        ret = HandleConnect();
-      } else if (method == "createStream") {
-        ret = HandleCreateStream();
+      if (command == RTMP_CMD_CONNECT) {
+        ret = HandleConnect(transaction_id, command_object);
+      } else if (command == RTMP_CMD_CREATE_STREAM) {
+        ret = HandleCreateStream(transaction_id);
       }
     } else if (rtmp_msg.stream_id == stream_id_) {  // 处理已经建立完流的一些状态: publish/play/play2 等
-      bytes_used += amf_decoder_.Decode((const char *)rtmp_msg.payload.get() + bytes_used,
-                                        rtmp_msg.length - bytes_used, 3);
-      stream_name_ = amf_decoder_.GetString();
-      stream_path_ = "/" + app_ + "/" + stream_name_;
-
-      if ((int)rtmp_msg.length > bytes_used) {
-        bytes_used += amf_decoder_.Decode((const char *)rtmp_msg.payload.get() + bytes_used,
-                                          rtmp_msg.length - bytes_used);
+      AmfStringView stream_name;
+      if (!reader.ReadString(stream_name)) {
+        stream_name = AmfStringView();
       }
-
-      if (method == "publish") {
-        ret = HandlePublish();
-      } else if (method == "play") {
-        ret = HandlePlay();
-      } else if (method == "play2") {
-        ret = HandlePlay2();
-      } else if (method == "DeleteStream") {
-        ret = HandleDeleteStream();
-      } else if (method == "releaseStream") {
+      SetStreamName(stream_name);
+
+      switch (command) {
+        case RTMP_CMD_PUBLISH:
+          ret = HandlePublish();
+          break;
+        case RTMP_CMD_PLAY: {
+          // start 在线上以毫秒发送 (Flash 和 FFmpeg 都是这样), -1 和 -2 表示直播
+          double start = -2;
+          reader.ReadNumber(start);
+          play_start_ms_ = start > 0 ? (uint32_t)std::min(start, (double)UINT32_MAX) : 0;
+          ret = HandlePlay();
+          break;
+        }
+        case RTMP_CMD_PLAY2:
+          ret = HandlePlay2();
+          break;
+        case RTMP_CMD_DELETE_STREAM:
+          ret = HandleDeleteStream();
+          break;
+        case RTMP_CMD_RELEASE_STREAM:
+        default:
+          break;
       }
     }
   }
@@ -226,24 +350,30 @@ bool RtmpConnection::HandleCommand(RtmpMessage &rtmp_msg) {
 }
 
 bool RtmpConnection::HandleData(RtmpMessage &rtmp_msg) {
-  amf_decoder_.Reset();
-  int bytes_used = amf_decoder_.Decode((const char *)rtmp_msg.payload.get(), rtmp_msg.length, 1);
-  if (bytes_used < 0) {
-    return false;
+  if (connection_mode_ == RTMP_CLIENT) {
+    if (data_cb_) {
+      data_cb_(rtmp_msg.payload.get(), rtmp_msg.length);
+    }
+    return true;
+  }
+
+  AmfReader reader(rtmp_msg.payload.get(), rtmp_msg.length);
+  AmfStringView name;
+  if (!reader.ReadString(name)) {
+    return true;
   }
 
   // 收到元信息之后立即设置到 session 并发送给拉流客户端
-  if (amf_decoder_.GetString() == "@setDataFrame") {
-    amf_decoder_.Reset();
-    bytes_used = amf_decoder_.Decode((const char *)rtmp_msg.payload.get() + bytes_used,
-                                     rtmp_msg.length - bytes_used, 1);
-    if (bytes_used < 0) {
-      return false;
+  if (name == "@setDataFrame") {
+    if (!reader.ReadString(name)) {
+      return true;
     }
 
-    if (amf_decoder_.GetString() == "onMetaData") {
-      amf_decoder_.Decode((const char *)rtmp_msg.payload.get() + bytes_used,
-                          rtmp_msg.length - bytes_used);
+    if (name == "onMetaData") {
+      // 元数据需要长期保存并转发, 仍然展开成 AmfObjects
+      amf_decoder_.Reset();
+      amf_decoder_.Decode((const char *)rtmp_msg.payload.get() + reader.Position(),
+                          rtmp_msg.length - reader.Position());
       meta_data_ = amf_decoder_.GetObjects();
 
       auto server = rtmp_server_.lock();
@@ -257,6 +387,12 @@ bool RtmpConnection::HandleData(RtmpMessage &rtmp_msg) {
         session->SendMetaData(meta_data_);
       }
     }
+  } else if (name == RtmpLatencyProbe::kAmfName && connection_state_ == START_PUBLISH) {
+    // 推流端的延迟探测消息, 按媒体顺序原样转发给拉流端
+    auto session = rtmp_session_.lock();
+    if (session) {
+      session->SendDataFrame(rtmp_msg.absolute_timestamp, rtmp_msg.payload, rtmp_msg.length);
+    }
   }
 
   return true;
@@ -274,6 +410,9 @@ bool RtmpConnection::HandleVideo(RtmpMessage &rtmp_msg) {
       if (play_cb_) {
         play_cb_(payload, length, codec_id, (uint32_t)rtmp_msg.absolute_timestamp);
       }
+      if (media_cb_) {
+        media_cb_(RTMP_VIDEO, rtmp_msg.absolute_timestamp, rtmp_msg.payload, length);
+      }
     }
   } else if (connection_mode_ == RTMP_SERVER) {
     auto server = rtmp_server_.lock();
@@ -296,7 +435,8 @@ bool RtmpConnection::HandleVideo(RtmpMessage &rtmp_msg) {
       }
     }
 
-    session->SendMediaData(type, rtmp_msg.absolute_timestamp, rtmp_msg.payload, rtmp_msg.length);
+    session->SendMediaData(type, rtmp_msg.absolute_timestamp, rtmp_msg.payload, rtmp_msg.length,
+                           rtmp_msg.trace);
   }
 
   return true;
@@ -317,6 +457,9 @@ bool RtmpConnection::HandleAudio(RtmpMessage &rtmp_msg) {
       if (play_cb_) {
         play_cb_(payload, length, codec_id, (uint32_t)rtmp_msg.absolute_timestamp);
       }
+      if (media_cb_) {
+        media_cb_(RTMP_AUDIO, rtmp_msg.absolute_timestamp, rtmp_msg.payload, length);
+      }
     }
   } else {
     auto server = rtmp_server_.lock();
@@ -337,7 +480,8 @@ bool RtmpConnection::HandleAudio(RtmpMessage &rtmp_msg) {
       type = RTMP_AAC_SEQUENCE_HEADER;
     }
 
-    session->SendMediaData(type, rtmp_msg.absolute_timestamp, rtmp_msg.payload, rtmp_msg.length);
+    session->SendMediaData(type, rtmp_msg.absolute_timestamp, rtmp_msg.payload, rtmp_msg.length,
+                           rtmp_msg.trace);
   }
 
   return true;
@@ -437,59 +581,60 @@ bool RtmpConnection::DeleteStream() {
   return true;
 }
 
-bool RtmpConnection::HandleConnect() {
-  if (!amf_decoder_.HasObject("app")) {
+bool RtmpConnection::HandleConnect(double transaction_id, const AmfValue &command_object) {
+  AmfValue app;
+  if (!command_object.Find("app", app) || !app.IsString()) {
     return false;
   }
 
-  AmfObject amfObj = amf_decoder_.GetObject("app");
-  app_ = amfObj.amf_string;
+  app_.assign(app.string.data, app.string.size);
   if (app_ == "") {
     return false;
   }
 
-  SendAcknowledgement();
-  SetPeerBandwidth();
-  SetChunkSize();
+  // Window Acknowledgement Size, Set Peer Bandwidth, Set Chunk Size, _result 合并成一次写
+  const RtmpResponseTemplate &templates = RtmpResponseTemplate::Instance();
+  ChunkBatch batch;
+  AppendAcknowledgement(batch);
+  AppendPeerBandwidth(batch);
+  AppendChunkSize(batch);
 
   // 返回成功状态的 _result 消息
-  AmfObjects objects;
-  amf_encoder_.Reset();
-  amf_encoder_.EncodeString("_result", 7);
-  amf_encoder_.EncodeNumber(amf_decoder_.GetNumber());
-
-  objects["fmsVer"] = AmfObject(std::string("FMS/4,5,0,297"));  // fms服务器版本
-  objects["capabilities"] = AmfObject(255.0);  // 服务器支持的功能, 取全部
-  amf_encoder_.EncodeObjects(objects);
-  objects.clear();
-  objects["level"] = AmfObject(std::string("status"));
-  objects["code"] = AmfObject(std::string("NetConnection.Connect.Success"));
-  objects["description"] = AmfObject(std::string("Connection succeeded."));
-  objects["objectEncoding"] = AmfObject(0.0);
-  amf_encoder_.EncodeObjects(objects);
+  char payload[512];
+  uint32_t size = templates.connect_result.Fill(payload, sizeof(payload), transaction_id);
+  if (!AppendRtmpChunks(batch, RTMP_CHUNK_COMMAND_ID, RTMP_COMMAND_MESSAGE, payload, size)) {
+    return false;
+  }
 
-  SendCommandMessage(RTMP_CHUNK_COMMAND_ID, amf_encoder_.Data(), amf_encoder_.Size());
+  SendBatch(batch);
+  if (startup_ && startup_->connect_ns == 0) {
+    startup_->connect_ns = Timestamp::NowNanos();
+  }
   return true;
 }
 
-bool RtmpConnection::HandleCreateStream() {
+bool RtmpConnection::HandleCreateStream(double transaction_id) {
   int stream_id = rtmp_chunk_->GetStreamId();
 
-  AmfObjects objects;
-  amf_encoder_.Reset();
-  amf_encoder_.EncodeString("_result", 7);
-  amf_encoder_.EncodeNumber(amf_decoder_.GetNumber());
-  amf_encoder_.EncodeObjects(objects);
-  amf_encoder_.EncodeNumber(stream_id);
+  char payload[128];
+  uint32_t size = RtmpResponseTemplate::Instance().create_stream_result.Fill(
+      payload, sizeof(payload), transaction_id, stream_id);
+  ChunkBatch batch;
+  if (!AppendRtmpChunks(batch, RTMP_CHUNK_COMMAND_ID, RTMP_COMMAND_MESSAGE, payload, size)) {
+    return false;
+  }
 
-  SendCommandMessage(RTMP_CHUNK_COMMAND_ID, amf_encoder_.Data(), amf_encoder_.Size());
+  SendBatch(batch);
   stream_id_ = stream_id;
+  if (startup_ && startup_->create_stream_ns == 0) {
+    startup_->create_stream_ns = Timestamp::NowNanos();
+  }
   return true;
 }
 
 bool RtmpConnection::HandlePublish() {
   // LOG_INFO("[Publish] app: %s, stream name: %s, stream path: %s\n", app_.c_str(),
-  //           stream_name_.c_str(), stream_path_.c_str());
+  //           stream_name_.c_str(), stream_path_->c_str());
 
   // User Control(StreamBegin)
 
@@ -498,116 +643,145 @@ bool RtmpConnection::HandlePublish() {
     return false;
   }
 
-  AmfObjects objects;
-  amf_encoder_.Reset();
-  amf_encoder_.EncodeString("onStatus", 8);
-  amf_encoder_.EncodeNumber(0);
-  amf_encoder_.EncodeObjects(objects);
-
+  const RtmpResponseTemplate &templates = RtmpResponseTemplate::Instance();
+  const AmfTemplate *status = nullptr;
   bool is_error = false;
+  std::shared_ptr<RtmpFrameBusWriter> bus_writer;
 
-  if (server->HasPublisher(stream_path_)) {  // 已经有人在推这个 url 对应的流了
+  if (server->HasPublisher(*stream_path_, stream_hash_)) {  // 已经有人在推这个 url 对应的流了
     is_error = true;
-    objects["level"] = AmfObject(std::string("error"));
-    objects["code"] = AmfObject(std::string("NetStream.Publish.BadName"));
-    objects["description"] = AmfObject(std::string("Stream already publishing."));
+    status = &templates.publish_bad_name;
   } else if (connection_state_ == START_PUBLISH) {  // 该连接已经存在推流, 不能一个连接多个推流
     is_error = true;
-    objects["level"] = AmfObject(std::string("error"));
-    objects["code"] = AmfObject(std::string("NetStream.Publish.BadConnection"));
-    objects["description"] = AmfObject(std::string("Connection already publishing."));
+    status = &templates.publish_bad_connection;
+  } else if (server->frame_bus_ &&
+             !(bus_writer = server->frame_bus_->OpenWriter(*stream_path_))) {
+    // 其他 worker 已经在推这个流, 或者总线的槽位用完了
+    is_error = true;
+    status = &templates.publish_bad_name;
   } else {
-    objects["level"] = AmfObject(std::string("status"));
-    objects["code"] = AmfObject(std::string("NetStream.Publish.Start"));
-    objects["description"] = AmfObject(std::string("Start publishing."));
-    server->AddSession(stream_path_);
-    rtmp_session_ = server->GetSession(stream_path_);
-
-    if (server) {
-      server->NotifyEvent("publish.start", stream_path_);
-    }
+    status = &templates.publish_start;
   }
 
-  amf_encoder_.EncodeObjects(objects);
-  SendCommandMessage(RTMP_CHUNK_COMMAND_ID, amf_encoder_.Data(), amf_encoder_.Size());
+  // 回复编码失败时推流端收不到应答, 和 HandlePlay 一样关闭连接, bus_writer 析构时释放槽位
+  ChunkBatch batch;
+  if (!AppendRtmpChunks(batch, RTMP_CHUNK_COMMAND_ID, RTMP_COMMAND_MESSAGE, status->data.get(),
+                        status->size)) {
+    return false;
+  }
+  SendBatch(batch);
 
   // 设置状态并加入 session 中来转发数据
   if (is_error) {
     return false;
-  } else {
-    connection_state_ = START_PUBLISH;
-    is_publishing_ = true;
   }
+  connection_state_ = START_PUBLISH;
+  is_publishing_ = true;
+  server->AddSession(*stream_path_, stream_hash_);
+  rtmp_session_ = server->GetSession(*stream_path_, stream_hash_);
+  server->NotifyEvent("publish.start", *stream_path_);
 
   auto session = rtmp_session_.lock();
   if (session) {
     session->SetGopCacheLen(max_gop_cache_len_);
+    if (server->hls_segment_ms_ > 0) {
+      session->SetHls(stream_name_, server->hls_segment_ms_, server->hls_list_size_);
+    }
+    if (server->ll_hls_segment_ms_ > 0) {
+      session->SetLlHls(stream_name_, server->ll_hls_segment_ms_, server->ll_hls_part_ms_,
+                        server->ll_hls_list_size_);
+    }
+    if (server->timeshift_options_.max_ms > 0) {
+      session->SetTimeshift(*stream_path_, server->timeshift_options_);
+    }
+    if (server->recorder_) {
+      session->SetRecord(server->recorder_->OpenStream(*stream_path_));
+    }
+    server->StartForward(app_, stream_name_, *stream_path_, session);
+    if (bus_writer) {
+      session->SetBusWriter(bus_writer);
+    }
     session->AddConn(std::dynamic_pointer_cast<RtmpConnection>(shared_from_this()));
   }
 
+  if (capture_) {
+    std::string path = server->capture_dir_ + "/" +
+                       RtmpIngressCapture::MakeFileName(*stream_path_, GetId());
+    if (capture_->Open(path)) {
+      LOG_INFO("[Capture] %s -> %s\n", stream_path_->c_str(), path.c_str());
+    } else {
+      capture_.reset();
+    }
+  }
+
   return true;
 }
 
 bool RtmpConnection::HandlePlay() {
   LOG_INFO("[Play] app: %s, stream name: %s, stream path: %s\n", app_.c_str(), 
-            stream_name_.c_str(), stream_path_.c_str());
+            stream_name_.c_str(), stream_path_->c_str());
 
   auto server = rtmp_server_.lock();
   if (!server) {
     return false;
   }
 
-  // User Control (StreamIsRecorded) 不需要, 没有实现录制功能
-  // User Control (StreamBegin) 可以有, 但是不需要, 有数据就开始播放
-
-  // 1. 返回 NetStream.Play.Reset 控制消息
-  AmfObjects objects;
-  amf_encoder_.Reset();
-  amf_encoder_.EncodeString("onStatus", 8);
-  amf_encoder_.EncodeNumber(0);
-  amf_encoder_.EncodeObjects(objects);
-  objects["level"] = AmfObject(std::string("status"));
-  objects["code"] = AmfObject(std::string("NetStream.Play.Reset"));
-  objects["description"] = AmfObject(std::string("Resetting and playing stream."));
-  amf_encoder_.EncodeObjects(objects);
-  if (!SendCommandMessage(RTMP_CHUNK_COMMAND_ID, amf_encoder_.Data(), amf_encoder_.Size())) {
+  if (this->IsClosed()) {
     return false;
   }
 
-  // 2. 返回 NetStream.Play.Start 控制消息
-  objects.clear();
-  amf_encoder_.Reset();
-  amf_encoder_.EncodeString("onStatus", 8);
-  amf_encoder_.EncodeNumber(0);
-  amf_encoder_.EncodeObjects(objects);
-  objects["level"] = AmfObject(std::string("status"));
-  objects["code"] = AmfObject(std::string("NetStream.Play.Start"));
-  objects["description"] = AmfObject(std::string("Started playing."));
-  amf_encoder_.EncodeObjects(objects);
-  if (!SendCommandMessage(RTMP_CHUNK_COMMAND_ID, amf_encoder_.Data(), amf_encoder_.Size())) {
-    return false;
-  }
+  capture_.reset();  // 只抓推流连接
 
-  // 3. 返回 |RtmpSampleAccess Data 消息
-  amf_encoder_.Reset();
-  amf_encoder_.EncodeString("|RtmpSampleAccess", 17);
-  amf_encoder_.EncodeBoolean(true);
-  amf_encoder_.EncodeBoolean(true);
-  if (!this->SendDataMessage(RTMP_CHUNK_DATA_ID, amf_encoder_.Data(), amf_encoder_.Size())) {
+  // User Control (StreamIsRecorded) 不发送: 录制只在服务器端写 FLV 文件,
+  // 点播文件也和直播一样按时间戳发送
+  // User Control (StreamBegin) 可以有, 但是不需要, 有数据就开始播放
+
+  // 1. NetStream.Play.Reset 控制消息, 2. NetStream.Play.Start 控制消息,
+  // 3. |RtmpSampleAccess Data 消息, 三条消息合并成一次写
+  const RtmpResponseTemplate &templates = RtmpResponseTemplate::Instance();
+  ChunkBatch batch;
+  if (!AppendRtmpChunks(batch, RTMP_CHUNK_COMMAND_ID, RTMP_COMMAND_MESSAGE,
+                        templates.play_reset.data.get(), templates.play_reset.size) ||
+      !AppendRtmpChunks(batch, RTMP_CHUNK_COMMAND_ID, RTMP_COMMAND_MESSAGE,
+                        templates.play_start.data.get(), templates.play_start.size) ||
+      !AppendRtmpChunks(batch, RTMP_CHUNK_DATA_ID, RTMP_DATA_MESSAGE,
+                        templates.sample_access.data.get(), templates.sample_access.size)) {
     return false;
   }
+  SendBatch(batch);
 
   // 设置 START_PLAY 状态, 将连接加入到 session 中来转发数据
   connection_state_ = START_PLAY;
 
-  rtmp_session_ = server->GetSession(stream_path_);
+  // 加入 session 之前绑定 app 的统计, 之后 session 线程可以直接读取
+  if (startup_ && !startup_->latency) {
+    startup_->play_ns = Timestamp::NowNanos();
+    startup_->latency = server->startup_stats_.Get(app_);
+  }
+
+  // 没有直播时播放点播文件, 不加入 session
+  if (!server->HasPublisher(*stream_path_, stream_hash_)) {
+    auto file = server->FindVod(app_, stream_name_);
+    if (file) {
+      LOG_INFO("[Vod] stream path: %s, start: %u\n", stream_path_->c_str(), play_start_ms_);
+      vod_ = std::make_shared<RtmpVodPlayer>(file, server->vod_speed_);
+      vod_->Start(std::dynamic_pointer_cast<RtmpConnection>(shared_from_this()), play_start_ms_);
+      server->NotifyEvent("play.start", *stream_path_);
+      return true;
+    }
+
+    // 边缘模式下从源站拉流, 写入同一个会话
+    server->StartRelay(*stream_path_, stream_hash_);
+  }
+
+  rtmp_session_ = server->GetSession(*stream_path_, stream_hash_);
   auto session = rtmp_session_.lock();
   if (session) {
     session->AddConn(std::dynamic_pointer_cast<RtmpConnection>(shared_from_this()));
   }
 
   if (server) {
-    server->NotifyEvent("play.start", stream_path_);
+    server->NotifyEvent("play.start", *stream_path_);
   }
 
   return true;
@@ -616,7 +790,7 @@ bool RtmpConnection::HandlePlay() {
 bool RtmpConnection::HandlePlay2() {
   /// @todo 根据客户端比特率要求来发送数据
   HandlePlay();
-  LOG_INFO("[Play2] stream path: %s\n", stream_path_.c_str());
+  LOG_INFO("[Play2] stream path: %s\n", stream_path_->c_str());
   return false;
 }
 
@@ -626,7 +800,7 @@ bool RtmpConnection::HandleDeleteStream() {
     return false;
   }
 
-  if (stream_path_ != "") {
+  if (!stream_path_->empty()) {
     auto session = rtmp_session_.lock();
     if (session) {
       auto conn = std::dynamic_pointer_cast<RtmpConnection>(shared_from_this());
@@ -638,9 +812,9 @@ bool RtmpConnection::HandleDeleteStream() {
           1);
 
       if (is_publishing_) {
-        server->NotifyEvent("publish.stop", stream_path_);
+        server->NotifyEvent("publish.stop", *stream_path_);
       } else if (is_playing_) {
-        server->NotifyEvent("play.stop", stream_path_);
+        server->NotifyEvent("play.stop", *stream_path_);
       }
     }
 
@@ -653,22 +827,20 @@ bool RtmpConnection::HandleDeleteStream() {
   return true;
 }
 
-bool RtmpConnection::HandleResult(RtmpMessage &rtmp_msg) {
+bool RtmpConnection::HandleResult(const AmfValue &info) {
   bool ret = false;
 
   if (connection_state_ == START_CONNECT) {
     // 连接建立成功之后立即建立流
-    if (amf_decoder_.HasObject("code")) {
-      AmfObject amfObj = amf_decoder_.GetObject("code");
-      if (amfObj.amf_string == "NetConnection.Connect.Success") {
-        CreateStream();
-        ret = true;
-      }
+    AmfValue code;
+    if (info.Find("code", code) && code.string == "NetConnection.Connect.Success") {
+      CreateStream();
+      ret = true;
     }
   } else if (connection_state_ == START_CREATE_STREAM) {
     // 流建立成功之后就可以开始推/拉流了
-    if (amf_decoder_.GetNumber() > 0) {
-      stream_id_ = (uint32_t)amf_decoder_.GetNumber();
+    if (info.IsNumber() && info.number > 0) {
+      stream_id_ = (uint32_t)info.number;
       if (connection_mode_ == RTMP_PUBLISHER) {
         this->Publish();
       } else if (connection_mode_ == RTMP_CLIENT) {
@@ -682,37 +854,36 @@ bool RtmpConnection::HandleResult(RtmpMessage &rtmp_msg) {
   return ret;
 }
 
-bool RtmpConnection::HandleOnStatus(RtmpMessage &rtmp_msg) {
+bool RtmpConnection::HandleOnStatus(const AmfValue &info) {
   bool ret = true;
 
+  AmfValue code;
+  if (!info.Find("code", code)) {
+    return ret;
+  }
+
   if (connection_state_ == START_PUBLISH || connection_state_ == START_PLAY) {
-    if (amf_decoder_.HasObject("code")) {
-      AmfObject amfObj = amf_decoder_.GetObject("code");
-      status_ = amfObj.amf_string;
-      if (connection_mode_ == RTMP_PUBLISHER) {
-        if (status_ == "NetStream.Publish.Start") {
-          is_publishing_ = true;
-        } else if (status_ == "NetStream.Publish.BadConnection" ||
-                   status_ == "NetStream.Publish.BadName") {
-          ret = false;
-        }
-      } else if (connection_mode_ == RTMP_CLIENT) {
-        if (status_ == "NetStream.Play.Start") {
-          is_playing_ = true;
-        } else if (status_ == "NetStream.Play.UnpublishNotify" ||
-                   status_ == "NetStream.Play.BadConnection") {
-          ret = false;
-        }
+    status_.assign(code.string.data, code.string.size);
+    if (connection_mode_ == RTMP_PUBLISHER) {
+      if (status_ == "NetStream.Publish.Start") {
+        is_publishing_ = true;
+      } else if (status_ == "NetStream.Publish.BadConnection" ||
+                 status_ == "NetStream.Publish.BadName") {
+        ret = false;
+      }
+    } else if (connection_mode_ == RTMP_CLIENT) {
+      if (status_ == "NetStream.Play.Start") {
+        is_playing_ = true;
+      } else if (status_ == "NetStream.Play.UnpublishNotify" ||
+                 status_ == "NetStream.Play.BadConnection") {
+        ret = false;
       }
     }
   }
 
   if (connection_state_ == START_DELETE_STREAM) {
-    if (amf_decoder_.HasObject("code")) {
-      AmfObject amfObj = amf_decoder_.GetObject("code");
-      if (amfObj.amf_string != "NetStream.Unpublish.Success") {
-        ret = false;
-      }
+    if (code.string != "NetStream.Unpublish.Success") {
+      ret = false;
     }
   }
 
@@ -739,42 +910,76 @@ bool RtmpConnection::SendMetaData(AmfObjects meta_data) {
 }
 
 void RtmpConnection::SetPeerBandwidth() {
+  ChunkBatch batch;
+  AppendPeerBandwidth(batch);
+  SendBatch(batch);
+}
+
+void RtmpConnection::AppendPeerBandwidth(ChunkBatch &batch) {
   //  4 Byte 的大端序的限制带宽大小的数 + 1 Byte 的限制类型
-  std::shared_ptr<char> data(new char[5], std::default_delete<char[]>());
-  WriteUint32BE(data.get(), peer_bandwidth_);
+  char data[5];
+  WriteUint32BE(data, peer_bandwidth_);
   /// 限制类型取值如下： 
   /// 0 Hard：收到消息的一端需要按照消息中设置的 Window size 进行限制
   /// 1 Soft：收到消息的一端按照消息中设置的 Window size 或者已经生效的限制进行限制，以两者中较小的为准
   /// 2 Dynamic：如果之前的类型为 Hard，则此消息也为 Hard 类型，否则忽略该类型
-  data.get()[4] = 2;
-  RtmpMessage rtmp_msg;
-  rtmp_msg.type_id = RTMP_BANDWIDTH_SIZE;
-  rtmp_msg.payload = data;
-  rtmp_msg.length = 5;
-  SendRtmpChunks(RTMP_CHUNK_CONTROL_ID, rtmp_msg);
+  data[4] = 2;
+  AppendRtmpChunks(batch, RTMP_CHUNK_CONTROL_ID, RTMP_BANDWIDTH_SIZE, data, 5);
 }
 
 void RtmpConnection::SendAcknowledgement() {
-  std::shared_ptr<char> data(new char[4], std::default_delete<char[]>());
-  WriteUint32BE(data.get(), acknowledgement_size_out_);
+  ChunkBatch batch;
+  AppendAcknowledgement(batch);
+  SendBatch(batch);
+}
 
-  RtmpMessage rtmp_msg;
-  rtmp_msg.type_id = RTMP_ACK_SIZE;
-  rtmp_msg.payload = data;
-  rtmp_msg.length = 4;
-  SendRtmpChunks(RTMP_CHUNK_CONTROL_ID, rtmp_msg);
+void RtmpConnection::AppendAcknowledgement(ChunkBatch &batch) {
+  char data[4];
+  WriteUint32BE(data, acknowledgement_size_out_);
+  AppendRtmpChunks(batch, RTMP_CHUNK_CONTROL_ID, RTMP_ACK_SIZE, data, 4);
 }
 
 void RtmpConnection::SetChunkSize() {
+  ChunkBatch batch;
+  AppendChunkSize(batch);
+  SendBatch(batch);
+}
+
+void RtmpConnection::AppendChunkSize(ChunkBatch &batch) {
   rtmp_chunk_->SetOutChunkSize(max_chunk_size_);
-  std::shared_ptr<char> data(new char[4], std::default_delete<char[]>());
-  WriteUint32BE((char *)data.get(), max_chunk_size_);
+  char data[4];
+  WriteUint32BE(data, max_chunk_size_);
+  AppendRtmpChunks(batch, RTMP_CHUNK_CONTROL_ID, RTMP_SET_CHUNK_SIZE, data, 4);
+}
+
+bool RtmpConnection::AppendRtmpChunks(ChunkBatch &batch, uint32_t csid, uint8_t type_id,
+                                      const char *payload, uint32_t payload_size) {
+  // 最长块头: 3 Byte 基本头 + 11 Byte 消息头 + 4 Byte 扩展时间戳, 后续块头最多 5 Byte
+  uint32_t capacity = payload_size + payload_size / rtmp_chunk_->GetOutChunkSize() * 5 + 18;
+  if (payload_size == 0 || capacity > sizeof(batch.data) - batch.size) {
+    return false;
+  }
 
   RtmpMessage rtmp_msg;
-  rtmp_msg.type_id = RTMP_SET_CHUNK_SIZE;
-  rtmp_msg.payload = data;
-  rtmp_msg.length = 4;
-  SendRtmpChunks(RTMP_CHUNK_CONTROL_ID, rtmp_msg);
+  rtmp_msg.type_id = type_id;
+  rtmp_msg.timestamp_delta = 0;
+  rtmp_msg.stream_id = stream_id_;
+  rtmp_msg.length = payload_size;
+  int size = rtmp_chunk_->CreateChunk(csid, rtmp_msg, payload, batch.data + batch.size,
+                                      sizeof(batch.data) - batch.size);
+  if (size <= 0) {
+    return false;
+  }
+
+  batch.size += size;
+  return true;
+}
+
+void RtmpConnection::SendBatch(ChunkBatch &batch) {
+  if (batch.size > 0) {
+    this->Send(batch.data, batch.size);
+    batch.size = 0;
+  }
 }
 
 bool RtmpConnection::SendCommandMessage(uint32_t csid, std::shared_ptr<char> payload,
@@ -816,7 +1021,7 @@ bool RtmpConnection::IsKeyFrame(std::shared_ptr<char> payload, uint32_t payload_
 }
 
 bool RtmpConnection::SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload,
-                                   uint32_t payload_size) {
+                                   uint32_t payload_size, std::shared_ptr<const FrameTrace> trace) {
   if (this->IsClosed()) {
     return false;
   }
@@ -836,13 +1041,14 @@ bool RtmpConnection::SendMediaData(uint8_t type, uint64_t timestamp, std::shared
   }
 
   auto conn = std::dynamic_pointer_cast<RtmpConnection>(shared_from_this());
-  task_scheduler_->AddTriggerEvent([conn, type, timestamp, payload, payload_size] {
+  task_scheduler_->AddTriggerEvent([conn, type, timestamp, payload, payload_size, trace] {
     // 如果此前没有 I 帧先检查一下当前帧是否为 I 帧
     if (!conn->has_key_frame_ && conn->avc_sequence_header_size_ > 0 &&
         (type != RTMP_AVC_SEQUENCE_HEADER) && (type != RTMP_AAC_SEQUENCE_HEADER)) {
       if (conn->IsKeyFrame(payload, payload_size)) {
         conn->has_key_frame_ = true;
       } else {  // 没有 I 帧就先不发送数据, 继续等待 I 帧到达
+        conn->stats_.dropped_frames.fetch_add(1, std::memory_order_relaxed);
         return;
       }
     }
@@ -853,12 +1059,27 @@ bool RtmpConnection::SendMediaData(uint8_t type, uint64_t timestamp, std::shared
     rtmp_msg.payload = payload;
     rtmp_msg.length = payload_size;
 
+    std::shared_ptr<const PacketTrace> egress;
+    if (trace) {
+      auto egress_trace = std::make_shared<EgressTrace>();
+      egress_trace->frame = trace;
+      egress_trace->run_ns = Timestamp::NowNanos();
+      trace->latency->queue_ns.Record(egress_trace->run_ns - trace->dispatch_ns);
+      egress = std::move(egress_trace);
+    }
+
+    // 起播的第一个关键帧一个连接只有一次, 和帧采样冲突时优先记录起播
+    auto startup = conn->TraceStartup(type, payload, payload_size);
+    if (startup) {
+      egress = std::move(startup);
+    }
+
     if (type == RTMP_VIDEO || type == RTMP_AVC_SEQUENCE_HEADER) {
       rtmp_msg.type_id = RTMP_VIDEO;
-      conn->SendRtmpChunks(RTMP_CHUNK_VIDEO_ID, rtmp_msg);
+      conn->SendRtmpChunks(RTMP_CHUNK_VIDEO_ID, rtmp_msg, egress);
     } else if (type == RTMP_AUDIO || type == RTMP_AAC_SEQUENCE_HEADER) {
       rtmp_msg.type_id = RTMP_AUDIO;
-      conn->SendRtmpChunks(RTMP_CHUNK_AUDIO_ID, rtmp_msg);
+      conn->SendRtmpChunks(RTMP_CHUNK_AUDIO_ID, rtmp_msg, egress);
     }
   });
 
@@ -873,13 +1094,19 @@ bool RtmpConnection::SendVideoData(uint64_t timestamp, std::shared_ptr<char> pay
 
   auto conn = std::dynamic_pointer_cast<RtmpConnection>(shared_from_this());
   task_scheduler_->AddTriggerEvent([conn, timestamp, payload, payload_size] {
+    // GOP 缓存从关键帧开始, 发送后紧跟的非关键帧不需要再等下一个关键帧
+    if (conn->IsKeyFrame(payload, payload_size)) {
+      conn->has_key_frame_ = true;
+    }
+
     RtmpMessage rtmp_msg;
     rtmp_msg.type_id = RTMP_VIDEO;
     rtmp_msg.absolute_timestamp = timestamp;
     rtmp_msg.stream_id = conn->stream_id_;
     rtmp_msg.payload = payload;
     rtmp_msg.length = payload_size;
-    conn->SendRtmpChunks(RTMP_CHUNK_VIDEO_ID, rtmp_msg);
+    conn->SendRtmpChunks(RTMP_CHUNK_VIDEO_ID, rtmp_msg,
+                         conn->TraceStartup(RTMP_VIDEO, payload, payload_size));
   });
 
   return true;
@@ -904,12 +1131,60 @@ bool RtmpConnection::SendAudioData(uint64_t timestamp, std::shared_ptr<char> pay
   return true;
 }
 
-void RtmpConnection::SendRtmpChunks(uint32_t csid, RtmpMessage &rtmp_msg) {
+std::shared_ptr<const PacketTrace> RtmpConnection::TraceStartup(uint8_t type,
+                                                                std::shared_ptr<char> payload,
+                                                                uint32_t payload_size) {
+  if (!startup_) {
+    return nullptr;
+  }
+
+  if (type == RTMP_AVC_SEQUENCE_HEADER || type == RTMP_AAC_SEQUENCE_HEADER) {
+    if (startup_->sequence_header_ns == 0) {
+      startup_->sequence_header_ns = Timestamp::NowNanos();
+    }
+  } else if (type == RTMP_VIDEO && !startup_->keyframe_queued &&
+             IsKeyFrame(payload, payload_size)) {
+    startup_->keyframe_queued = true;
+    auto trace = std::make_shared<StartupPacketTrace>();
+    trace->startup = startup_;
+    return trace;
+  }
+  return nullptr;
+}
+
+void RtmpConnection::RecordGopBurst(uint64_t bytes) {
+  if (startup_ && startup_->latency) {
+    startup_->latency->gop_burst_bytes.Record(bytes);
+  }
+}
+
+bool RtmpConnection::SendDataFrame(uint64_t timestamp, std::shared_ptr<char> payload,
+                                   uint32_t payload_size) {
+  if (payload_size == 0) {
+    return false;
+  }
+
+  auto conn = std::dynamic_pointer_cast<RtmpConnection>(shared_from_this());
+  task_scheduler_->AddTriggerEvent([conn, timestamp, payload, payload_size] {
+    RtmpMessage rtmp_msg;
+    rtmp_msg.type_id = RTMP_DATA_MESSAGE;
+    rtmp_msg.absolute_timestamp = timestamp;
+    rtmp_msg.stream_id = conn->stream_id_;
+    rtmp_msg.payload = payload;
+    rtmp_msg.length = payload_size;
+    conn->SendRtmpChunks(RTMP_CHUNK_DATA_ID, rtmp_msg);
+  });
+  return true;
+}
+
+void RtmpConnection::SendRtmpChunks(uint32_t csid, RtmpMessage &rtmp_msg,
+                                    std::shared_ptr<const PacketTrace> trace) {
   uint32_t capacity = rtmp_msg.length + rtmp_msg.length / max_chunk_size_ * 5 + 1024;  // 除了额外头空间外, 预留 1K 的空间
   std::shared_ptr<char> buffer(new char[capacity], std::default_delete<char[]>());
 
   int size = rtmp_chunk_->CreateChunk(csid, rtmp_msg, buffer.get(), capacity);
   if (size > 0) {
-    this->Send(buffer.get(), size);
+    // buffer 是新分配的, 直接交给发送队列, 不需要再拷贝一次
+    this->Send(buffer, size, std::move(trace));
   }
 }
@@ -10,11 +10,15 @@
 #define RTMP_SERVER_RTMP_CONNECTION_H
 
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 #include "EventLoop.h"
 #include "RtmpChunk.h"
 #include "RtmpHandshake.h"
+#include "RtmpIngressCapture.h"
+#include "RtmpVod.h"
+#include "RtmpStartupStats.h"
 #include "TcpConnection.h"
 #include "amf.h"
 #include "rtmp.h"
@@ -28,6 +32,10 @@ class RtmpConnection : public TcpConnection {
  public:
   using PlayCallback =
       std::function<void(uint8_t* payload, uint32_t length, uint8_t codecId, uint32_t timestamp)>;
+  using DataCallback = std::function<void(const char* payload, uint32_t length)>;
+  // type: RTMP_VIDEO 或 RTMP_AUDIO, payload 为收到的完整消息, 可以直接转发不拷贝
+  using MediaCallback = std::function<void(uint8_t type, uint64_t timestamp,
+                                           std::shared_ptr<char> payload, uint32_t length)>;
 
   enum ConnectionState {
     HANDSHAKE,
@@ -45,7 +53,7 @@ class RtmpConnection : public TcpConnection {
   RtmpConnection(std::shared_ptr<RtmpClient> client, TaskScheduler* scheduler, SOCKET sockfd);
   ~RtmpConnection() override {};
 
-  std::string GetStreamPath() const { return stream_path_; }
+  std::string GetStreamPath() const { return *stream_path_; }
 
   std::string GetStreamName() const { return stream_name_; }
 
@@ -61,6 +69,9 @@ class RtmpConnection : public TcpConnection {
 
   bool IsPublishing() { return is_publishing_; }
 
+  // play 命令的 start 参数, 大于 0 时表示比直播延迟多少毫秒开始播放, 点播时表示开始播放的位置
+  uint32_t GetPlayStart() const { return play_start_ms_; }
+
   uint32_t GetId() { return (uint32_t)this->GetSocket(); }
 
   std::string GetStatus() {
@@ -70,16 +81,27 @@ class RtmpConnection : public TcpConnection {
     return status_;
   }
 
+  // 离线回放: 把 buffer 当作握手之后收到的数据解析和处理, 跳过握手,
+  // 只能在连接所属的 TaskScheduler 线程中调用
+  bool ReplayChunks(BufferReader& buffer) { return HandleChunk(buffer); }
+
  private:
   friend class RtmpSession;
   friend class RtmpServer;
   friend class RtmpPublisher;
   friend class RtmpClient;
+  friend class RtmpVodPlayer;
 
   RtmpConnection(TaskScheduler* scheduler, SOCKET sockfd, Rtmp* rtmp);
 
   void SetPlayCB(const PlayCallback& cb) { play_cb_ = cb; }
 
+  // 拉流客户端收到数据消息 (AMF) 时回调
+  void SetDataCB(const DataCallback& cb) { data_cb_ = cb; }
+
+  // 拉流客户端收到音视频消息时回调, 和 PlayCallback 同时设置时两个都回调
+  void SetMediaCB(const MediaCallback& cb) { media_cb_ = cb; }
+
   // TCP 层接收的新数据到来的入口函数
   bool OnRead(BufferReader& buffer);
   void OnClose();
@@ -91,17 +113,33 @@ class RtmpConnection : public TcpConnection {
   bool SendDataMessage(uint32_t csid, std::shared_ptr<char> payload, uint32_t payload_size);
 
   // 发送块, 会根据消息大小和 max_chunk_size_ 内部分块发送
-  void SendRtmpChunks(uint32_t csid, RtmpMessage& rtmp_msg);
+  // trace 非空时, 数据全部写入内核后回调 trace->OnSent
+  void SendRtmpChunks(uint32_t csid, RtmpMessage& rtmp_msg,
+                      std::shared_ptr<const PacketTrace> trace = nullptr);
+
+  // 响应批次: 多条控制消息分块后先拼到同一个缓冲区, 最后一次 Send 出去, 减少分配和系统调用
+  struct ChunkBatch {
+    char data[4096];
+    uint32_t size = 0;
+  };
+
+  // 将一条消息分块追加到 batch, 空间不足返回 false
+  bool AppendRtmpChunks(ChunkBatch& batch, uint32_t csid, uint8_t type_id, const char* payload,
+                        uint32_t payload_size);
+  void SendBatch(ChunkBatch& batch);
 
   /* 以下一些函数用来处理客户端 RTMP 协议的几个请求 */
 
-  bool HandleConnect();
-  bool HandleCreateStream();
+  bool HandleConnect(double transaction_id, const AmfValue& command_object);
+  bool HandleCreateStream(double transaction_id);
   bool HandlePublish();
   bool HandlePlay();
   bool HandlePlay2();
   bool HandleDeleteStream();
 
+  // 设置流名, 更新 stream_path_ 和 stream_hash_
+  void SetStreamName(const AmfStringView& stream_name);
+
   bool HandleChunk(BufferReader& buffer);
   bool HandleMessage(RtmpMessage& rtmp_msg);
   bool HandleCommand(RtmpMessage& rtmp_msg);
@@ -111,12 +149,15 @@ class RtmpConnection : public TcpConnection {
 
   // 服务器接收并设置对等带宽消息, 目的是限制服务器输出带宽
   void SetPeerBandwidth();
+  void AppendPeerBandwidth(ChunkBatch& batch);
 
   // 确认窗口大小消息, 在处理连接消息时候返回
   void SendAcknowledgement();
+  void AppendAcknowledgement(ChunkBatch& batch);
 
   // 设置块大小, 并发送一个块告知给对端
   void SetChunkSize();
+  void AppendChunkSize(ChunkBatch& batch);
 
   // 从 payload 中解析视频帧是否是关键帧
   bool IsKeyFrame(std::shared_ptr<char> payload, uint32_t payload_size);
@@ -132,10 +173,10 @@ class RtmpConnection : public TcpConnection {
   bool Handshake();
 
   // 推拉流客户端用, 解析 _result 命令消息, 判断状态是成功之后开始推流/拉流
-  bool HandleResult(RtmpMessage& rtmp_msg);
+  bool HandleResult(const AmfValue& info);
 
   // 推拉流客户端用, 解析推流或播放时候服务器返回的状态信息
-  bool HandleOnStatus(RtmpMessage& rtmp_msg);
+  bool HandleOnStatus(const AmfValue& info);
 
   // 推流客户端用, 主动发起断开流消息
   bool DeleteStream();
@@ -144,9 +185,19 @@ class RtmpConnection : public TcpConnection {
 
   bool SendMetaData(AmfObjects metaData);
   bool SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload,
-                     uint32_t payload_size);
+                     uint32_t payload_size, std::shared_ptr<const FrameTrace> trace = nullptr);
   bool SendVideoData(uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size);
   bool SendAudioData(uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size);
+  // 和音视频帧走同一个队列的数据消息, 保证和媒体数据的先后顺序
+  bool SendDataFrame(uint64_t timestamp, std::shared_ptr<char> payload, uint32_t payload_size);
+
+  // 拉流端起播统计: 记录第一个序列头的时间, 第一个关键帧返回发送回调, 其余返回 nullptr
+  // 在连接所在线程调用
+  std::shared_ptr<const PacketTrace> TraceStartup(uint8_t type, std::shared_ptr<char> payload,
+                                                  uint32_t payload_size);
+
+  // 起播时从 GOP 缓存发送的字节数, 由 session 在 SendGop 之后调用
+  void RecordGopBurst(uint64_t bytes);
 
   std::weak_ptr<RtmpServer> rtmp_server_;
   std::weak_ptr<RtmpPublisher> rtmp_publisher_;
@@ -170,7 +221,8 @@ class RtmpConnection : public TcpConnection {
   uint32_t number_ = 0;  // 控制命令的事务id, 不需要可以设为 0, 这里方便 debug 每次控制消息都 +1
   std::string app_;          // 应用名称, rtmp://ip:port/app/stream_name
   std::string stream_name_;  // 流名称, rtmp://ip:port/app/stream_name
-  std::string stream_path_;
+  std::shared_ptr<const std::string> stream_path_;  // 不为空, 服务器模式下共用注册表中的字符串
+  uint64_t stream_hash_ = 0;  // stream_path_ 的哈希, 用于在 RtmpSessionRegistry 中查找会话
   std::string status_;  // 控制命令或通知命令使用, 当前状态信息, "NetStream.xxx.xxx"
 
   AmfObjects meta_data_;
@@ -179,12 +231,21 @@ class RtmpConnection : public TcpConnection {
 
   bool is_playing_ = false;
   bool is_publishing_ = false;
+  uint32_t play_start_ms_ = 0;
   bool has_key_frame_ = false;
   std::shared_ptr<char> avc_sequence_header_;
   std::shared_ptr<char> aac_sequence_header_;
   uint32_t avc_sequence_header_size_ = 0;
   uint32_t aac_sequence_header_size_ = 0;
   PlayCallback play_cb_;
+  DataCallback data_cb_;
+  MediaCallback media_cb_;
+  uint32_t traced_frames_ = 0;  // 推流端收到的音视频帧计数, 用于帧采样
+  std::shared_ptr<StartupTrace> startup_;  // 起播时间线, 只有服务器端的连接记录
+  std::unique_ptr<RtmpIngressCapture> capture_;
+  std::shared_ptr<RtmpVodPlayer> vod_;  // 点播, 没有推流端并且找到点播文件时才有  // 入口抓包, 服务器开启抓包时才有, 成为拉流端后释放
+
+  static const uint32_t kHandshakeBufferSize = 4096;  // 最大的握手响应 S0S1S2 为 3073 Byte
 };
 
 #endif  // RTMP_SERVER_RTMP_CONNECTION_H
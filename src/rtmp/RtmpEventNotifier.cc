@@ -0,0 +1,99 @@
+/// @file RtmpEventNotifier.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpEventNotifier.h"
+
+#include <chrono>
+
+#include "Logger.h"
+
+RtmpEventNotifier::RtmpEventNotifier(size_t capacity) : queue_(capacity) {
+  thread_ = std::thread(&RtmpEventNotifier::Run, this);
+}
+
+RtmpEventNotifier::~RtmpEventNotifier() {
+  quit_ = true;
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    wait_cond_.notify_one();
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void RtmpEventNotifier::AddCallback(const EventCallback& event_cb) {
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  event_callbacks_.push_back(event_cb);
+}
+
+bool RtmpEventNotifier::Post(const char* event_type, const std::string& stream_path) {
+  Event event;
+  event.type = event_type;
+  event.stream_path = stream_path;
+  if (!queue_.Push(std::move(event))) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  posted_.fetch_add(1, std::memory_order_relaxed);
+
+  // 与 Run 中 "设置 waiting_ 后再检查队列" 配对, 保证不会丢失唤醒
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    wait_cond_.notify_one();
+  }
+  return true;
+}
+
+void RtmpEventNotifier::Run() {
+  std::vector<Event> events;
+  events.reserve(kMaxBatch);
+  uint64_t reported_dropped = 0;
+
+  while (true) {
+    Event event;
+    while (events.size() < kMaxBatch && queue_.Pop(event)) {
+      events.push_back(std::move(event));
+    }
+
+    if (!events.empty()) {
+      Dispatch(events);
+      events.clear();
+      continue;
+    }
+
+    uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reported_dropped) {
+      LOG_ERROR("event queue overflow, %llu events dropped\n",
+                (unsigned long long)(dropped - reported_dropped));
+      reported_dropped = dropped;
+    }
+
+    if (quit_) {  // 退出前已经把队列中剩余的事件分发完
+      break;
+    }
+
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    waiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // 超时只是兜底, 正常情况下由 Post 唤醒
+    wait_cond_.wait_for(lock, std::chrono::milliseconds(100),
+                        [this] { return quit_ || !queue_.IsEmpty(); });
+    waiting_.store(false, std::memory_order_relaxed);
+  }
+}
+
+void RtmpEventNotifier::Dispatch(const std::vector<Event>& events) {
+  std::lock_guard<std::mutex> lock(callbacks_mutex_);
+  for (const auto& event : events) {
+    for (const auto& event_cb : event_callbacks_) {
+      if (event_cb) {
+        event_cb(event.type, event.stream_path);
+      }
+    }
+  }
+}
@@ -0,0 +1,62 @@
+/// @file RtmpEventNotifier.h
+/// @brief 异步事件分发: I/O 线程只把事件放进有界无锁队列, 由专门的通知线程批量调用事件回调,
+///        回调 (日志, webhook 等) 再慢也不会阻塞媒体转发; 队列满时丢弃事件并计数
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_EVENT_NOTIFIER_H
+#define RTMP_SERVER_RTMP_EVENT_NOTIFIER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MpmcQueue.h"
+
+class RtmpEventNotifier {
+ public:
+  using EventCallback = std::function<void(std::string event_type, std::string stream_path)>;
+
+  explicit RtmpEventNotifier(size_t capacity = 4096);
+  ~RtmpEventNotifier();
+
+  void AddCallback(const EventCallback& event_cb);
+
+  // 任意线程调用, 不阻塞; 队列满返回 false 并计入丢弃数
+  bool Post(const char* event_type, const std::string& stream_path);
+
+  uint64_t GetPostedEvents() const { return posted_.load(std::memory_order_relaxed); }
+  uint64_t GetDroppedEvents() const { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Event {
+    const char* type = nullptr;  // 事件类型都是字符串常量
+    std::string stream_path;
+  };
+
+  void Run();
+  void Dispatch(const std::vector<Event>& events);
+
+  static const size_t kMaxBatch = 64;
+
+  MpmcQueue<Event> queue_;
+  std::atomic<uint64_t> posted_{0};
+  std::atomic<uint64_t> dropped_{0};
+
+  std::mutex callbacks_mutex_;  // 只在通知线程和 AddCallback 之间竞争
+  std::vector<EventCallback> event_callbacks_;
+
+  std::mutex wait_mutex_;
+  std::condition_variable wait_cond_;
+  std::atomic_bool waiting_{false};  // 通知线程是否在等待, 生产者只在此时才去唤醒
+  std::atomic_bool quit_{false};
+  std::thread thread_;
+};
+
+#endif  // RTMP_SERVER_RTMP_EVENT_NOTIFIER_H
@@ -0,0 +1,188 @@
+/// @file RtmpFlvPublisher.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpFlvPublisher.h"
+
+#include <algorithm>
+
+#include "Logger.h"
+#include "TaskScheduler.h"
+#include "Timestamp.h"
+#include "rtmp.h"
+
+std::shared_ptr<const RtmpFlvSource> RtmpFlvSource::Open(const std::string &path) {
+  auto file = RtmpVodFile::Open(path);
+  if (file == nullptr) {
+    return nullptr;
+  }
+
+  // 帧的 payload 持有文件, 源对象不被文件引用, 不会形成循环
+  std::shared_ptr<RtmpFlvSource> source(new RtmpFlvSource);
+  size_t pos = file->GetFirstTag();
+  RtmpVodFrame frame;
+  bool has_avc_header = false;
+  bool has_aac_header = false;
+  uint32_t last_video = 0;
+  uint32_t video_interval = 0;
+  bool has_video = false;
+  while (file->Read(pos, frame)) {
+    if (RtmpVodFile::IsAvcSequenceHeader(frame)) {
+      if (!has_avc_header) {
+        source->headers_.push_back(frame);
+        has_avc_header = true;
+      }
+      continue;
+    }
+    if (RtmpVodFile::IsAacSequenceHeader(frame)) {
+      if (!has_aac_header) {
+        source->headers_.push_back(frame);
+        has_aac_header = true;
+      }
+      continue;
+    }
+    // 脚本 tag (元数据, 录制文件末尾的关键帧索引) 不推送
+    if (frame.type != RTMP_VIDEO && frame.type != RTMP_AUDIO) {
+      continue;
+    }
+
+    uint32_t first_timestamp = file->GetFirstTimestamp();
+    frame.timestamp = frame.timestamp > first_timestamp ? frame.timestamp - first_timestamp : 0;
+    if (frame.type == RTMP_VIDEO) {
+      if (has_video && frame.timestamp > last_video) {
+        video_interval = frame.timestamp - last_video;
+      }
+      last_video = frame.timestamp;
+      has_video = true;
+    }
+    source->bytes_ += frame.size;
+    source->frames_.push_back(frame);
+  }
+
+  if (source->frames_.empty()) {
+    return nullptr;
+  }
+
+  uint32_t last_timestamp = 0;
+  for (const RtmpVodFrame &media : source->frames_) {
+    last_timestamp = std::max(last_timestamp, media.timestamp);
+  }
+  // 下一轮的第一帧和这一轮的最后一帧之间保持一个帧间隔
+  source->duration_ = last_timestamp + (video_interval > 0 ? video_interval : 1);
+  return source;
+}
+
+RtmpFlvPublisher::RtmpFlvPublisher(EventLoop *loop, std::shared_ptr<const RtmpFlvSource> source)
+    : publisher_(RtmpPublisher::Create(loop)), source_(source) {}
+
+RtmpFlvPublisher::~RtmpFlvPublisher() { publisher_->Close(); }
+
+std::shared_ptr<RtmpFlvPublisher> RtmpFlvPublisher::Create(
+    EventLoop *loop, std::shared_ptr<const RtmpFlvSource> source) {
+  if (source == nullptr) {
+    return nullptr;
+  }
+  std::shared_ptr<RtmpFlvPublisher> publisher(new RtmpFlvPublisher(loop, source));
+  return publisher;
+}
+
+int RtmpFlvPublisher::OpenUrl(std::string url, int msec, std::string &status) {
+  if (publisher_->OpenUrl(url, msec, status) != 0) {
+    return -1;
+  }
+  Start();
+  return 0;
+}
+
+int RtmpFlvPublisher::OpenSocket(SOCKET sockfd, std::string url, int msec, std::string &status) {
+  if (publisher_->OpenSocket(sockfd, url, msec, status) != 0) {
+    return -1;
+  }
+  Start();
+  return 0;
+}
+
+void RtmpFlvPublisher::Close() {
+  finished_ = true;
+  publisher_->Close();
+}
+
+void RtmpFlvPublisher::Start() {
+  // 定时器队列不是线程安全的, 转到推流连接所属的线程中添加
+  std::weak_ptr<RtmpFlvPublisher> weak_publisher = shared_from_this();
+  TaskScheduler *task_scheduler = publisher_->GetTaskScheduler();
+  uint32_t interval = speed_ > 0 ? kIntervalMs : 1;
+  bool added = task_scheduler->AddTriggerEvent([weak_publisher, task_scheduler, interval] {
+    auto publisher = weak_publisher.lock();
+    if (publisher == nullptr) {
+      return;
+    }
+
+    for (const RtmpVodFrame &frame : publisher->source_->GetHeaders()) {
+      publisher->publisher_->PushMediaData(frame.type, 0, frame.data, frame.size);
+    }
+    publisher->start_ns_ = Timestamp::NowNanos();
+    if (publisher->OnTimer()) {
+      task_scheduler->AddTimer(
+          [weak_publisher] {
+            auto publisher = weak_publisher.lock();
+            return publisher != nullptr && publisher->OnTimer();
+          },
+          interval);
+    }
+  });
+
+  if (!added) {
+    LOG_ERROR("[RtmpFlvPublisher] trigger queue is full, publisher not started.\n");
+    Close();
+  }
+}
+
+bool RtmpFlvPublisher::OnTimer() {
+  if (finished_) {
+    return false;
+  }
+
+  // 发送队列或者触发队列积压时等下一次, 限速时下一次会把到期的帧一起推送
+  if (publisher_->GetQueuedBytes() > kMaxQueuedBytes ||
+      publisher_->GetTaskScheduler()->GetTriggerQueueDepth() > kMaxTriggerDepth) {
+    return true;
+  }
+
+  const std::vector<RtmpVodFrame> &frames = source_->GetFrames();
+  uint32_t batch = kMaxBatchFrames;
+  uint64_t deadline = 0;
+  if (speed_ > 0) {
+    deadline = (uint64_t)((Timestamp::NowNanos() - start_ns_) / 1000000.0 * speed_);
+    batch = (uint32_t)-1;
+  }
+
+  for (uint32_t i = 0; i < batch; i++) {
+    if (index_ >= frames.size()) {
+      if (!loop_) {
+        finished_ = true;
+        return false;
+      }
+      index_ = 0;
+      base_timestamp_ += source_->GetDuration();
+      loops_++;
+    }
+
+    const RtmpVodFrame &frame = frames[index_];
+    uint64_t timestamp = base_timestamp_ + frame.timestamp;
+    if (speed_ > 0 && timestamp > deadline) {
+      break;
+    }
+
+    if (publisher_->PushMediaData(frame.type, timestamp, frame.data, frame.size) != 0) {
+      finished_ = true;  // 连接已经断开
+      return false;
+    }
+    index_++;
+    sent_frames_.fetch_add(1, std::memory_order_relaxed);
+    sent_bytes_.fetch_add(frame.size, std::memory_order_relaxed);
+  }
+  return true;
+}
@@ -0,0 +1,105 @@
+/// @file RtmpFlvPublisher.h
+/// @brief FLV 文件推流: 文件映射到内存并预先建立 tag 索引, 多个推流端共用一份, payload 引用映射不拷贝
+///        按文件中的时间戳推送, 可以实时, 按倍速或者不限速, 循环推送时时间戳接着上一轮增长
+///        推送在推流连接所属的 TaskScheduler 的定时器中进行, 一个 EventLoop 可以跑上千路, 用于测试入口吞吐
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_FLV_PUBLISHER_H
+#define RTMP_SERVER_RTMP_FLV_PUBLISHER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "EventLoop.h"
+#include "RtmpPublisher.h"
+#include "RtmpVod.h"
+
+// 预先建立好索引的 FLV 源, 只读, 多个推流端共用
+class RtmpFlvSource {
+ public:
+  // 映射文件并读出所有音视频 tag, 没有音视频 tag 时返回 nullptr
+  static std::shared_ptr<const RtmpFlvSource> Open(const std::string &path);
+
+  // 序列头, 每次推流开始时推送一次
+  const std::vector<RtmpVodFrame> &GetHeaders() const { return headers_; }
+
+  // 音视频帧, 时间戳从 0 开始
+  const std::vector<RtmpVodFrame> &GetFrames() const { return frames_; }
+
+  // 循环一轮的时长, 最后一帧的时长按前两个视频帧的间隔估算
+  uint32_t GetDuration() const { return duration_; }
+
+  uint64_t GetBytes() const { return bytes_; }
+
+ private:
+  RtmpFlvSource() = default;
+
+  std::vector<RtmpVodFrame> headers_;
+  std::vector<RtmpVodFrame> frames_;
+  uint32_t duration_ = 0;
+  uint64_t bytes_ = 0;
+};
+
+class RtmpFlvPublisher : public std::enable_shared_from_this<RtmpFlvPublisher> {
+ public:
+  static std::shared_ptr<RtmpFlvPublisher> Create(EventLoop *loop,
+                                                  std::shared_ptr<const RtmpFlvSource> source);
+  ~RtmpFlvPublisher();
+  RtmpFlvPublisher(const RtmpFlvPublisher &) = delete;
+  RtmpFlvPublisher &operator=(const RtmpFlvPublisher &) = delete;
+
+  // speed: 1 为实时, N 为 N 倍速, 0 为不限速 (只受发送队列限制), 需在 OpenUrl 之前设置
+  void SetSpeed(double speed) { speed_ = speed > 0 ? speed : 0; }
+
+  // 推完一轮后从头循环, 需在 OpenUrl 之前设置
+  void SetLoop(bool loop) { loop_ = loop; }
+
+  void SetChunkSize(uint32_t size) { publisher_->SetChunkSize(size); }
+
+  // 建立推流连接并开始推送, 参数和返回值同 RtmpPublisher
+  int OpenUrl(std::string url, int msec, std::string &status);
+  int OpenSocket(SOCKET sockfd, std::string url, int msec, std::string &status);
+  void Close();
+
+  // 没有循环时推完最后一帧, 或者连接断开
+  bool IsFinished() const { return finished_.load(std::memory_order_relaxed); }
+
+  uint64_t GetSentFrames() const { return sent_frames_.load(std::memory_order_relaxed); }
+  uint64_t GetSentBytes() const { return sent_bytes_.load(std::memory_order_relaxed); }
+  uint32_t GetLoops() const { return loops_.load(std::memory_order_relaxed); }
+
+  static const uint32_t kIntervalMs = 10;           // 限速时的推送间隔
+  static const uint32_t kMaxQueuedBytes = 1 << 20;  // 发送队列超过这个大小暂停推送
+  static const uint32_t kMaxBatchFrames = 64;       // 不限速时每次最多推送的帧数
+  static const int kMaxTriggerDepth = 10000;        // 调度器触发队列超过这个深度时暂停推送
+
+ private:
+  RtmpFlvPublisher(EventLoop *loop, std::shared_ptr<const RtmpFlvSource> source);
+
+  // 在推流连接所属的线程中添加定时器
+  void Start();
+
+  // 推送到期的帧, 推完或者连接断开时返回 false 停止定时器
+  bool OnTimer();
+
+  std::shared_ptr<RtmpPublisher> publisher_;
+  std::shared_ptr<const RtmpFlvSource> source_;
+  double speed_ = 1.0;
+  bool loop_ = false;
+
+  // 只在定时器线程中访问
+  size_t index_ = 0;
+  uint64_t base_timestamp_ = 0;  // 本轮的起始时间戳, 每循环一次增加一轮的时长
+  int64_t start_ns_ = 0;
+
+  std::atomic_bool finished_{false};
+  std::atomic<uint64_t> sent_frames_{0};
+  std::atomic<uint64_t> sent_bytes_{0};
+  std::atomic<uint32_t> loops_{0};
+};
+
+#endif  // RTMP_SERVER_RTMP_FLV_PUBLISHER_H
@@ -0,0 +1,327 @@
+/// @file RtmpForwarder.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpForwarder.h"
+
+#include <chrono>
+#include <thread>
+
+#include "Logger.h"
+#include "RtmpPublisher.h"
+#include "rtmp.h"
+
+void RtmpForwardQueue::Push(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data,
+                            uint32_t size) {
+  if (data == nullptr || size == 0) {
+    return;
+  }
+
+  if (type == RTMP_AVC_SEQUENCE_HEADER || type == RTMP_AAC_SEQUENCE_HEADER) {
+    Frame &header = (type == RTMP_AVC_SEQUENCE_HEADER) ? avc_sequence_header_
+                                                       : aac_sequence_header_;
+    header.type = type;
+    header.data = data;
+    header.size = size;
+    // 等待关键帧期间只保存, 恢复时和关键帧一起发送
+    if (!waiting_key_frame_) {
+      PushFrame(type, 0, data, size);
+    }
+    return;
+  }
+
+  // 没有收到过 AVC 序列头时按纯音频流处理, 任意音频帧都可以作为恢复点
+  bool has_video = (avc_sequence_header_.data != nullptr);
+  bool can_resume = (type == RTMP_VIDEO) ? (((uint8_t)data.get()[0] >> 4) & 0x0f) == 1
+                                         : !has_video;
+  if (!waiting_key_frame_ && bytes_ + size > max_bytes_) {
+    // 上游跟不上, 丢弃已经排队的帧, 从下一个关键帧开始恢复, 拉流端不会看到花屏
+    for (auto &frame : frames_) {
+      if (frame.type == RTMP_VIDEO || frame.type == RTMP_AUDIO) {
+        dropped_frames_++;
+      }
+    }
+    frames_.clear();
+    bytes_ = 0;
+    waiting_key_frame_ = true;
+  }
+
+  if (waiting_key_frame_) {
+    if (!can_resume) {
+      dropped_frames_++;
+      return;
+    }
+    waiting_key_frame_ = false;
+    PushHeaders();
+  }
+  PushFrame(type, timestamp, data, size);
+}
+
+bool RtmpForwardQueue::Pop(Frame &frame) {
+  if (frames_.empty()) {
+    return false;
+  }
+  frame = std::move(frames_.front());
+  frames_.pop_front();
+  bytes_ -= frame.size;
+  return true;
+}
+
+void RtmpForwardQueue::Reset() {
+  frames_.clear();
+  bytes_ = 0;
+  waiting_key_frame_ = true;
+}
+
+void RtmpForwardQueue::PushFrame(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data,
+                                 uint32_t size) {
+  Frame frame;
+  frame.type = type;
+  frame.timestamp = timestamp;
+  frame.data = std::move(data);
+  frame.size = size;
+  bytes_ += size;
+  frames_.push_back(std::move(frame));
+}
+
+void RtmpForwardQueue::PushHeaders() {
+  for (const Frame *header : {&avc_sequence_header_, &aac_sequence_header_}) {
+    if (header->data) {
+      PushFrame(header->type, 0, header->data, header->size);
+    }
+  }
+}
+
+// 一个上游: 连接由连接线程建立, 入队在推流线程, 发送在上游连接所属的线程
+class RtmpForwarder::Sink : public std::enable_shared_from_this<Sink> {
+ public:
+  Sink(const RtmpForwardTarget &target, const std::string &stream_name)
+      : url_(target.url + "/" + stream_name), queue_(target.max_queue_bytes) {}
+
+  const std::string &GetUrl() const { return url_; }
+
+  // 连接建立之后先发送元数据, 之后的帧从关键帧开始
+  void Attach(std::shared_ptr<RtmpPublisher> publisher, const AmfObjects &meta_data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    publisher_ = publisher;
+    scheduler_ = publisher->GetTaskScheduler();
+    queue_.Reset();
+    drain_pending_ = false;
+    if (!meta_data.empty()) {
+      publisher_->PushMetaData(meta_data);
+    }
+    connects_++;
+  }
+
+  // 断开当前连接, 返回 false 表示没有连接
+  bool Detach() {
+    std::shared_ptr<RtmpPublisher> publisher;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      publisher.swap(publisher_);
+      scheduler_ = nullptr;
+      queue_.Reset();
+      drain_pending_ = false;
+    }
+    if (publisher == nullptr) {
+      return false;
+    }
+    publisher->Close();
+    return true;
+  }
+
+  bool IsConnected() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return publisher_ != nullptr && publisher_->IsConnected();
+  }
+
+  void Push(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 没有连接时不排队, 只记下序列头, 连接之后从关键帧开始
+    bool is_header = (type == RTMP_AVC_SEQUENCE_HEADER || type == RTMP_AAC_SEQUENCE_HEADER);
+    if (publisher_ == nullptr && !is_header) {
+      return;
+    }
+    queue_.Push(type, timestamp, std::move(data), size);
+    if (publisher_ != nullptr && !drain_pending_ && queue_.Size() > 0) {
+      std::weak_ptr<Sink> weak_sink = shared_from_this();
+      TaskScheduler *scheduler = scheduler_;
+      drain_pending_ = scheduler_->AddTriggerEvent([weak_sink, scheduler]() {
+        auto sink = weak_sink.lock();
+        if (sink) {
+          sink->Drain(scheduler);
+        }
+      });
+    }
+  }
+
+  void OnMetaData(const AmfObjects &meta_data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (publisher_ != nullptr) {
+      publisher_->PushMetaData(meta_data);
+    }
+  }
+
+  RtmpForwardStats GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RtmpForwardStats stats;
+    stats.url = url_;
+    stats.connected = publisher_ != nullptr && publisher_->IsConnected();
+    stats.connects = connects_;
+    stats.sent_frames = sent_frames_;
+    stats.dropped_frames = queue_.GetDroppedFrames();
+    stats.queued_bytes = queue_.GetBytes();
+    return stats;
+  }
+
+ private:
+  // 在 scheduler 的线程中执行, 上游连接的发送缓冲满时留在队列中, 稍后再发
+  void Drain(TaskScheduler *scheduler) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 重新连接之后, 旧连接线程上的发送任务直接放弃
+    if (publisher_ == nullptr || scheduler != scheduler_) {
+      return;
+    }
+    drain_pending_ = false;
+
+    uint64_t pending_bytes = publisher_->GetQueuedBytes();
+    RtmpForwardQueue::Frame frame;
+    while (pending_bytes < kMaxSendBytes && queue_.Pop(frame)) {
+      bool is_video = (frame.type == RTMP_VIDEO || frame.type == RTMP_AVC_SEQUENCE_HEADER);
+      publisher_->PushMediaData(is_video ? RTMP_VIDEO : RTMP_AUDIO, frame.timestamp, frame.data,
+                                frame.size);
+      pending_bytes += frame.size;
+      sent_frames_++;
+    }
+
+    if (queue_.Size() > 0) {
+      std::weak_ptr<Sink> weak_sink = shared_from_this();
+      drain_pending_ = true;
+      scheduler_->AddTimer(
+          [weak_sink, scheduler]() {
+            auto sink = weak_sink.lock();
+            if (sink) {
+              sink->Drain(scheduler);
+            }
+            return false;
+          },
+          kDrainRetryMs);
+    }
+  }
+
+  const std::string url_;
+  std::mutex mutex_;
+  std::shared_ptr<RtmpPublisher> publisher_;
+  TaskScheduler *scheduler_ = nullptr;
+  RtmpForwardQueue queue_;
+  bool drain_pending_ = false;  // 已经投递了发送任务, 避免每帧都投递
+  uint32_t connects_ = 0;
+  uint64_t sent_frames_ = 0;
+};
+
+std::shared_ptr<RtmpForwarder> RtmpForwarder::Create(
+    EventLoop *loop, const std::string &stream_name,
+    const std::vector<RtmpForwardTarget> &targets) {
+  return std::shared_ptr<RtmpForwarder>(new RtmpForwarder(loop, stream_name, targets));
+}
+
+RtmpForwarder::RtmpForwarder(EventLoop *loop, const std::string &stream_name,
+                             const std::vector<RtmpForwardTarget> &targets)
+    : event_loop_(loop), stream_name_(stream_name) {
+  for (const auto &target : targets) {
+    sinks_.push_back(std::make_shared<Sink>(target, stream_name));
+  }
+}
+
+RtmpForwarder::~RtmpForwarder() {
+  Close();
+  Join();
+}
+
+void RtmpForwarder::Start() { thread_ = std::thread(&RtmpForwarder::Run, this); }
+
+void RtmpForwarder::Close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  cond_.notify_all();
+}
+
+void RtmpForwarder::Join() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+bool RtmpForwarder::Wait(uint32_t msec) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return !cond_.wait_for(lock, std::chrono::milliseconds(msec), [this] { return quit_; });
+}
+
+void RtmpForwarder::Run() {
+  bool quit = false;
+  while (!quit) {
+    bool all_connected = true;
+    for (auto &sink : sinks_) {
+      if (sink->IsConnected()) {
+        continue;
+      }
+      if (sink->Detach()) {
+        LOG_INFO("[Forward] %s disconnected.\n", sink->GetUrl().c_str());
+      }
+
+      auto publisher = RtmpPublisher::Create(event_loop_);
+      publisher->SetChunkSize(kChunkSize);
+      std::string status;
+      if (publisher->OpenUrl(sink->GetUrl(), kOpenTimeoutMs, status) != 0) {
+        LOG_INFO("[Forward] %s failed: %s\n", sink->GetUrl().c_str(), status.c_str());
+        all_connected = false;
+        continue;
+      }
+
+      AmfObjects meta_data;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        meta_data = meta_data_;
+      }
+      sink->Attach(publisher, meta_data);
+      LOG_INFO("[Forward] %s connected.\n", sink->GetUrl().c_str());
+    }
+
+    quit = !Wait(all_connected ? kCheckMs : kRetryMs);
+  }
+
+  for (auto &sink : sinks_) {
+    sink->Detach();
+  }
+  stopped_ = true;
+  LOG_INFO("[Forward] %s stopped.\n", stream_name_.c_str());
+}
+
+void RtmpForwarder::OnMedia(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data,
+                            uint32_t size) {
+  for (auto &sink : sinks_) {
+    sink->Push(type, timestamp, data, size);
+  }
+}
+
+void RtmpForwarder::OnMetaData(const AmfObjects &meta_data) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    meta_data_ = meta_data;
+  }
+  for (auto &sink : sinks_) {
+    sink->OnMetaData(meta_data);
+  }
+}
+
+std::vector<RtmpForwardStats> RtmpForwarder::GetStats() const {
+  std::vector<RtmpForwardStats> stats;
+  for (auto &sink : sinks_) {
+    stats.push_back(sink->GetStats());
+  }
+  return stats;
+}
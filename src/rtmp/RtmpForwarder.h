@@ -0,0 +1,134 @@
+/// @file RtmpForwarder.h
+/// @brief 推流转发: 推流端开始推流时, 按 app 的转发规则用 RtmpPublisher 把流重新推到一个或多个上游,
+///        转发的帧和会话共用引用计数的数据, 不拷贝.
+///        每个上游有自己的有界队列, 上游发送慢导致队列超过上限时丢弃到下一个关键帧,
+///        推流线程只做入队, 一个慢的上游不会拖慢推流端和其他上游
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_FORWARDER_H
+#define RTMP_SERVER_RTMP_FORWARDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.h"
+#include "amf.h"
+
+struct RtmpForwardTarget {
+  std::string url;                            // 上游的 app 地址, 例如 rtmp://10.0.0.1/live
+  uint32_t max_queue_bytes = 4 * 1024 * 1024;  // 等待发送的字节数上限, 超过时丢到下一个关键帧
+};
+
+// 一个上游的发送队列, 不加锁, 由 RtmpForwarder 在锁内使用
+// 序列头单独保存, 从关键帧恢复发送时先补发序列头. 没有视频序列头的纯音频流从任意音频帧恢复
+class RtmpForwardQueue {
+ public:
+  struct Frame {
+    uint8_t type = 0;  // RTMP_VIDEO, RTMP_AUDIO 或者序列头
+    uint64_t timestamp = 0;
+    std::shared_ptr<char> data;
+    uint32_t size = 0;
+  };
+
+  explicit RtmpForwardQueue(uint32_t max_bytes) : max_bytes_(max_bytes) {}
+
+  // type 同 RtmpSession::SendMediaData, 包括 RTMP_AVC_SEQUENCE_HEADER 和 RTMP_AAC_SEQUENCE_HEADER
+  void Push(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size);
+  bool Pop(Frame &frame);
+
+  // 清空队列并等待下一个关键帧, 上游重新连接时调用, 序列头保留
+  void Reset();
+
+  size_t Size() const { return frames_.size(); }
+  uint64_t GetBytes() const { return bytes_; }
+  uint64_t GetDroppedFrames() const { return dropped_frames_; }
+  bool IsWaitingKeyFrame() const { return waiting_key_frame_; }
+
+ private:
+  void PushFrame(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size);
+  void PushHeaders();
+
+  const uint32_t max_bytes_;
+  std::deque<Frame> frames_;
+  uint64_t bytes_ = 0;
+  uint64_t dropped_frames_ = 0;
+  bool waiting_key_frame_ = true;
+  Frame avc_sequence_header_;
+  Frame aac_sequence_header_;
+};
+
+struct RtmpForwardStats {
+  std::string url;
+  bool connected = false;
+  uint32_t connects = 0;
+  uint64_t sent_frames = 0;
+  uint64_t dropped_frames = 0;
+  uint64_t queued_bytes = 0;
+};
+
+class RtmpForwarder {
+ public:
+  // stream_name: 上游的流名, 每个上游推到 <target.url>/<stream_name>
+  static std::shared_ptr<RtmpForwarder> Create(EventLoop *loop, const std::string &stream_name,
+                                               const std::vector<RtmpForwardTarget> &targets);
+  ~RtmpForwarder();
+  RtmpForwarder(const RtmpForwarder &) = delete;
+  RtmpForwarder &operator=(const RtmpForwarder &) = delete;
+
+  // 启动连接线程, 只调用一次. 析构时 Close 并等待线程退出
+  void Start();
+
+  // 通知连接线程断开所有上游并退出, 不等待, 线程退出后 IsStopped 返回 true
+  void Close();
+
+  // 等待连接线程退出, 建立连接时最长等待 kOpenTimeoutMs, 不能在连接线程中调用
+  void Join();
+
+  bool IsStopped() const { return stopped_.load(std::memory_order_acquire); }
+
+  // 推流线程在会话锁内调用, 只入队, 发送在各上游连接所属的线程中进行
+  void OnMedia(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size);
+  void OnMetaData(const AmfObjects &meta_data);
+
+  std::vector<RtmpForwardStats> GetStats() const;
+
+  static const uint32_t kCheckMs = 100;         // 检查上游连接状态的间隔
+  static const uint32_t kRetryMs = 1000;        // 上游连接失败或者断开之后重连的间隔
+  static const uint32_t kOpenTimeoutMs = 5000;
+  static const uint32_t kDrainRetryMs = 10;     // 上游发送缓冲满时重试发送的间隔
+  static const uint32_t kMaxSendBytes = 512 * 1024;  // 交给上游连接但还没写出的字节数上限
+  static const uint32_t kChunkSize = 60000;
+
+ private:
+  class Sink;
+
+  RtmpForwarder(EventLoop *loop, const std::string &stream_name,
+                const std::vector<RtmpForwardTarget> &targets);
+
+  // 连接线程: 建立各上游的连接, 断开后重连
+  void Run();
+
+  // 等待 msec 毫秒, 期间 Close 时返回 false
+  bool Wait(uint32_t msec);
+
+  EventLoop *event_loop_;
+  const std::string stream_name_;
+  std::vector<std::shared_ptr<Sink>> sinks_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  bool quit_ = false;
+  AmfObjects meta_data_;  // 上游连接建立之后先发送
+  std::atomic_bool stopped_{false};
+  std::thread thread_;
+};
+
+#endif  // RTMP_SERVER_RTMP_FORWARDER_H
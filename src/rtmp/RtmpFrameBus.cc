@@ -0,0 +1,473 @@
+/// @file RtmpFrameBus.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpFrameBus.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <new>
+
+#include "rtmp.h"
+
+namespace {
+
+// 环中每个帧的记录头, 记录按 8 字节对齐, 不跨越环的末尾
+struct RecordHeader {
+  uint32_t size;  // payload 字节数
+  uint8_t type;   // RTMP_VIDEO 或 RTMP_AUDIO, 0 表示填充到环的末尾
+  uint8_t reserved[3];
+  uint64_t timestamp;
+};
+
+const uint64_t kNoPos = UINT64_MAX;
+
+inline uint64_t Align(uint64_t size, uint64_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+// 读端可以从这个帧开始播放: 视频关键帧, 或者没有 AVC 序列头的纯音频流中的任意音频帧
+inline bool IsResumePoint(uint8_t type, const char *data, bool has_video) {
+  if (type == RTMP_VIDEO) {
+    return ((((uint8_t)data[0]) >> 4) & 0x0f) == 1;
+  }
+  return type == RTMP_AUDIO && !has_video;
+}
+
+std::shared_ptr<char> CopyData(const char *data, uint32_t size) {
+  std::shared_ptr<char> copy(new char[size], std::default_delete<char[]>());
+  memcpy(copy.get(), data, size);
+  return copy;
+}
+
+}  // namespace
+
+struct RtmpFrameBus::Header {
+  pthread_mutex_t mutex;
+  uint32_t max_streams = 0;
+  uint32_t ring_bytes = 0;
+};
+
+// 占用和释放在锁内修改, 读写位置只由占用的进程写入
+struct RtmpFrameBus::Slot {
+  enum State : uint32_t { kFree = 0, kLive = 1 };
+
+  std::atomic<uint32_t> state{kFree};
+  std::atomic<uint64_t> generation{0};  // 每次占用和释放加 1, 读端据此判断流是否结束
+  pid_t owner = 0;
+  uint32_t path_size = 0;
+  char path[kMaxPathBytes];
+
+  alignas(64) std::atomic<uint64_t> reserve_pos{0};  // 写端即将写到的位置, 之前一圈的数据不再可靠
+  std::atomic<uint64_t> write_pos{0};                // 已经提交的位置
+  std::atomic<uint64_t> key_pos{kNoPos};             // 最近一个关键帧 (纯音频流是音频帧) 记录的位置
+
+  alignas(64) std::atomic<uint32_t> config_version{0};  // 奇数表示写端正在更新
+  uint32_t avc_size = 0;
+  uint32_t aac_size = 0;
+  uint32_t meta_size = 0;
+  char avc[kMaxHeaderBytes];
+  char aac[kMaxHeaderBytes];
+  char meta[kMaxMetaBytes];
+};
+
+std::shared_ptr<RtmpFrameBus> RtmpFrameBus::Create(const RtmpFrameBusOptions &options) {
+  if (options.max_streams == 0 || options.ring_bytes < 64 * 1024) {
+    return nullptr;
+  }
+
+  uint64_t ring_bytes = Align(options.ring_bytes, 64);
+  size_t slot_bytes = Align(sizeof(Slot), 64) + ring_bytes;
+  size_t map_size = Align(sizeof(Header), 64) + slot_bytes * options.max_streams;
+  // 匿名共享映射在 fork 之后父子进程共用, 环只在写入时占用物理内存
+  void *addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (addr == MAP_FAILED) {
+    return nullptr;
+  }
+
+  std::shared_ptr<RtmpFrameBus> bus(new RtmpFrameBus());
+  bus->base_ = (char *)addr;
+  bus->map_size_ = map_size;
+  bus->slot_bytes_ = slot_bytes;
+  bus->header_ = new (addr) Header();
+  bus->header_->max_streams = options.max_streams;
+  bus->header_->ring_bytes = (uint32_t)ring_bytes;
+
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&bus->header_->mutex, &attr);
+  pthread_mutexattr_destroy(&attr);
+
+  for (uint32_t i = 0; i < options.max_streams; i++) {
+    new (bus->GetSlot(i)) Slot();
+  }
+  return bus;
+}
+
+RtmpFrameBus::~RtmpFrameBus() {
+  if (base_ != nullptr) {
+    munmap(base_, map_size_);
+  }
+}
+
+RtmpFrameBus::Slot *RtmpFrameBus::GetSlot(uint32_t index) const {
+  return (Slot *)(base_ + Align(sizeof(Header), 64) + slot_bytes_ * index);
+}
+
+char *RtmpFrameBus::GetRing(Slot *slot) const { return (char *)slot + Align(sizeof(Slot), 64); }
+
+void RtmpFrameBus::Lock() {
+  // 持有锁的 worker 崩溃时锁内只可能改了一个槽位的状态, 直接恢复
+  if (pthread_mutex_lock(&header_->mutex) == EOWNERDEAD) {
+    pthread_mutex_consistent(&header_->mutex);
+  }
+}
+
+void RtmpFrameBus::Unlock() { pthread_mutex_unlock(&header_->mutex); }
+
+RtmpFrameBus::Slot *RtmpFrameBus::FindSlot(const std::string &stream_path) {
+  for (uint32_t i = 0; i < header_->max_streams; i++) {
+    Slot *slot = GetSlot(i);
+    if (slot->state.load(std::memory_order_relaxed) == Slot::kLive &&
+        slot->path_size == stream_path.size() &&
+        memcmp(slot->path, stream_path.data(), stream_path.size()) == 0) {
+      return slot;
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<RtmpFrameBusWriter> RtmpFrameBus::OpenWriter(const std::string &stream_path) {
+  if (stream_path.empty() || stream_path.size() > kMaxPathBytes) {
+    return nullptr;
+  }
+
+  Lock();
+  Slot *slot = nullptr;
+  if (FindSlot(stream_path) == nullptr) {
+    for (uint32_t i = 0; i < header_->max_streams && slot == nullptr; i++) {
+      if (GetSlot(i)->state.load(std::memory_order_relaxed) == Slot::kFree) {
+        slot = GetSlot(i);
+      }
+    }
+  }
+  if (slot == nullptr) {
+    Unlock();
+    return nullptr;
+  }
+
+  uint64_t generation = slot->generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+  slot->owner = getpid();
+  slot->path_size = (uint32_t)stream_path.size();
+  memcpy(slot->path, stream_path.data(), stream_path.size());
+  slot->reserve_pos.store(0, std::memory_order_relaxed);
+  slot->write_pos.store(0, std::memory_order_relaxed);
+  slot->key_pos.store(kNoPos, std::memory_order_relaxed);
+  slot->avc_size = 0;
+  slot->aac_size = 0;
+  slot->meta_size = 0;
+  slot->config_version.fetch_add(2, std::memory_order_relaxed);
+  slot->state.store(Slot::kLive, std::memory_order_release);
+  Unlock();
+
+  return std::shared_ptr<RtmpFrameBusWriter>(
+      new RtmpFrameBusWriter(shared_from_this(), slot, generation));
+}
+
+std::shared_ptr<RtmpFrameBusReader> RtmpFrameBus::OpenReader(const std::string &stream_path) {
+  Lock();
+  Slot *slot = FindSlot(stream_path);
+  uint64_t generation = slot ? slot->generation.load(std::memory_order_acquire) : 0;
+  Unlock();
+  if (slot == nullptr) {
+    return nullptr;
+  }
+
+  std::shared_ptr<RtmpFrameBusReader> reader(
+      new RtmpFrameBusReader(shared_from_this(), slot, generation));
+  reader->Seek();
+  return reader;
+}
+
+bool RtmpFrameBus::HasStream(const std::string &stream_path) {
+  Lock();
+  bool found = FindSlot(stream_path) != nullptr;
+  Unlock();
+  return found;
+}
+
+void RtmpFrameBus::ReleaseSlot(Slot *slot, uint64_t generation) {
+  Lock();
+  if (slot->state.load(std::memory_order_relaxed) == Slot::kLive &&
+      slot->generation.load(std::memory_order_relaxed) == generation) {
+    slot->generation.fetch_add(1, std::memory_order_acq_rel);
+    slot->state.store(Slot::kFree, std::memory_order_release);
+  }
+  Unlock();
+}
+
+uint32_t RtmpFrameBus::ReleaseOwner(pid_t pid) {
+  uint32_t released = 0;
+  Lock();
+  for (uint32_t i = 0; i < header_->max_streams; i++) {
+    Slot *slot = GetSlot(i);
+    if (slot->state.load(std::memory_order_relaxed) == Slot::kLive && slot->owner == pid) {
+      slot->generation.fetch_add(1, std::memory_order_acq_rel);
+      slot->state.store(Slot::kFree, std::memory_order_release);
+      released++;
+    }
+  }
+  Unlock();
+  return released;
+}
+
+uint32_t RtmpFrameBus::GetStreams() {
+  uint32_t streams = 0;
+  Lock();
+  for (uint32_t i = 0; i < header_->max_streams; i++) {
+    if (GetSlot(i)->state.load(std::memory_order_relaxed) == Slot::kLive) {
+      streams++;
+    }
+  }
+  Unlock();
+  return streams;
+}
+
+RtmpFrameBusWriter::RtmpFrameBusWriter(std::shared_ptr<RtmpFrameBus> bus,
+                                       RtmpFrameBus::Slot *slot, uint64_t generation)
+    : bus_(bus), slot_(slot), ring_(bus->GetRing(slot)), generation_(generation) {}
+
+RtmpFrameBusWriter::~RtmpFrameBusWriter() { Close(); }
+
+void RtmpFrameBusWriter::Close() {
+  if (!closed_) {
+    closed_ = true;
+    bus_->ReleaseSlot(slot_, generation_);
+  }
+}
+
+void RtmpFrameBusWriter::OnMedia(uint8_t type, uint64_t timestamp, const char *data,
+                                 uint32_t size) {
+  if (closed_ || data == nullptr || size == 0) {
+    return;
+  }
+  if (type == RTMP_AVC_SEQUENCE_HEADER || type == RTMP_AAC_SEQUENCE_HEADER) {
+    UpdateConfig(type, data, size);
+    return;
+  }
+  if (type != RTMP_VIDEO && type != RTMP_AUDIO) {
+    return;
+  }
+
+  const uint64_t ring_bytes = bus_->header_->ring_bytes;
+  uint64_t record = Align(sizeof(RecordHeader) + size, 8);
+  if (record > ring_bytes / 2) {
+    dropped_frames_++;
+    return;
+  }
+
+  uint64_t pos = slot_->write_pos.load(std::memory_order_relaxed);
+  uint64_t offset = pos % ring_bytes;
+  uint64_t skip = (ring_bytes - offset < record) ? ring_bytes - offset : 0;
+
+  // 先公布要覆盖到的位置再写数据, 读端拷贝之后检查这个位置判断数据是否完整
+  slot_->reserve_pos.store(pos + skip + record, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if (skip >= sizeof(RecordHeader)) {
+    RecordHeader padding = {};
+    padding.size = (uint32_t)(skip - sizeof(RecordHeader));
+    memcpy(ring_ + offset, &padding, sizeof(padding));
+  }
+  pos += skip;
+  offset = pos % ring_bytes;
+
+  RecordHeader header = {};
+  header.size = size;
+  header.type = type;
+  header.timestamp = timestamp;
+  memcpy(ring_ + offset, &header, sizeof(header));
+  memcpy(ring_ + offset + sizeof(header), data, size);
+
+  slot_->write_pos.store(pos + record, std::memory_order_release);
+  if (IsResumePoint(type, data, slot_->avc_size != 0)) {
+    slot_->key_pos.store(pos, std::memory_order_release);
+  }
+  frames_++;
+}
+
+void RtmpFrameBusWriter::OnMetaData(AmfObjects meta_data) {
+  if (closed_ || meta_data.empty()) {
+    return;
+  }
+
+  AmfEncoder encoder;
+  encoder.EncodeString("onMetaData", 10);
+  encoder.EncodeECMA(meta_data);
+  UpdateConfig(RTMP_DATA_MESSAGE, encoder.Data().get(), encoder.Size());
+}
+
+void RtmpFrameBusWriter::UpdateConfig(uint8_t type, const char *data, uint32_t size) {
+  uint32_t limit = RtmpFrameBus::kMaxHeaderBytes;
+  if (type == RTMP_DATA_MESSAGE) {
+    limit = RtmpFrameBus::kMaxMetaBytes;
+  }
+  if (size > limit) {
+    dropped_frames_++;
+    return;
+  }
+
+  uint32_t version = slot_->config_version.load(std::memory_order_relaxed);
+  slot_->config_version.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if (type == RTMP_AVC_SEQUENCE_HEADER) {
+    memcpy(slot_->avc, data, size);
+    slot_->avc_size = size;
+  } else if (type == RTMP_AAC_SEQUENCE_HEADER) {
+    memcpy(slot_->aac, data, size);
+    slot_->aac_size = size;
+  } else {
+    memcpy(slot_->meta, data, size);
+    slot_->meta_size = size;
+  }
+
+  slot_->config_version.store(version + 2, std::memory_order_release);
+}
+
+RtmpFrameBusReader::RtmpFrameBusReader(std::shared_ptr<RtmpFrameBus> bus,
+                                       RtmpFrameBus::Slot *slot, uint64_t generation)
+    : bus_(bus), slot_(slot), ring_(bus->GetRing(slot)), generation_(generation) {}
+
+bool RtmpFrameBusReader::IsEnded() const {
+  return slot_->generation.load(std::memory_order_acquire) != generation_;
+}
+
+void RtmpFrameBusReader::Resync() {
+  overruns_++;
+  Seek();
+}
+
+void RtmpFrameBusReader::Seek() {
+  const uint64_t ring_bytes = bus_->header_->ring_bytes;
+  uint64_t key_pos = slot_->key_pos.load(std::memory_order_acquire);
+  uint64_t reserve_pos = slot_->reserve_pos.load(std::memory_order_acquire);
+  if (key_pos != kNoPos && reserve_pos <= key_pos + ring_bytes) {
+    read_pos_ = key_pos;
+    waiting_key_frame_ = false;
+  } else {
+    read_pos_ = slot_->write_pos.load(std::memory_order_acquire);
+    waiting_key_frame_ = true;
+  }
+}
+
+void RtmpFrameBusReader::PollConfig(const RtmpFrameBus::FrameCallback &callback) {
+  uint32_t version = slot_->config_version.load(std::memory_order_acquire);
+  if (version == config_version_ || (version & 1) != 0) {
+    return;
+  }
+
+  // 写端正在更新时读到的长度可能不对, 先限制在区域之内, 拷贝之后再校验版本
+  uint32_t meta_size = slot_->meta_size;
+  uint32_t avc_size = slot_->avc_size;
+  uint32_t aac_size = slot_->aac_size;
+  meta_size = meta_size > RtmpFrameBus::kMaxMetaBytes ? 0 : meta_size;
+  avc_size = avc_size > RtmpFrameBus::kMaxHeaderBytes ? 0 : avc_size;
+  aac_size = aac_size > RtmpFrameBus::kMaxHeaderBytes ? 0 : aac_size;
+  std::shared_ptr<char> meta = meta_size ? CopyData(slot_->meta, meta_size) : nullptr;
+  std::shared_ptr<char> avc = avc_size ? CopyData(slot_->avc, avc_size) : nullptr;
+  std::shared_ptr<char> aac = aac_size ? CopyData(slot_->aac, aac_size) : nullptr;
+
+  // 拷贝期间写端在更新, 下次再读
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot_->config_version.load(std::memory_order_relaxed) != version) {
+    return;
+  }
+  config_version_ = version;
+  has_video_ = (avc != nullptr);
+
+  if (meta) {
+    callback(RTMP_DATA_MESSAGE, 0, meta, meta_size);
+  }
+  if (avc) {
+    callback(RTMP_AVC_SEQUENCE_HEADER, 0, avc, avc_size);
+  }
+  if (aac) {
+    callback(RTMP_AAC_SEQUENCE_HEADER, 0, aac, aac_size);
+  }
+}
+
+int RtmpFrameBusReader::Poll(const RtmpFrameBus::FrameCallback &callback, uint32_t max_frames) {
+  if (IsEnded()) {
+    return -1;
+  }
+  PollConfig(callback);
+
+  const uint64_t ring_bytes = bus_->header_->ring_bytes;
+  int frames = 0;
+  // 跳过填充和重新定位也算一次, 写端一直领先时不会在这里停不下来
+  for (uint32_t loops = 0; frames < (int)max_frames && loops < max_frames * 2; loops++) {
+    uint64_t write_pos = slot_->write_pos.load(std::memory_order_acquire);
+    if (read_pos_ >= write_pos) {
+      break;
+    }
+    if (slot_->reserve_pos.load(std::memory_order_acquire) > read_pos_ + ring_bytes) {
+      Resync();
+      continue;
+    }
+
+    uint64_t offset = read_pos_ % ring_bytes;
+    uint64_t remaining = ring_bytes - offset;
+    if (remaining < sizeof(RecordHeader)) {
+      read_pos_ += remaining;
+      continue;
+    }
+
+    RecordHeader header;
+    memcpy(&header, ring_ + offset, sizeof(header));
+    bool valid = header.size > 0 && sizeof(header) + header.size <= remaining;
+    std::shared_ptr<char> data;
+    if (valid && header.type != 0) {
+      data = CopyData(ring_ + offset + sizeof(header), header.size);
+    }
+
+    // 拷贝期间被覆盖的记录不能使用
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (IsEnded()) {
+      return -1;
+    }
+    if (slot_->reserve_pos.load(std::memory_order_relaxed) > read_pos_ + ring_bytes) {
+      Resync();
+      continue;
+    }
+
+    if (header.type == 0) {
+      read_pos_ += remaining;
+      continue;
+    }
+    if (!valid) {
+      Resync();
+      continue;
+    }
+    read_pos_ += Align(sizeof(header) + header.size, 8);
+
+    if (waiting_key_frame_) {
+      if (!IsResumePoint(header.type, data.get(), has_video_)) {
+        continue;
+      }
+      waiting_key_frame_ = false;
+    }
+    callback(header.type, header.timestamp, data, header.size);
+    frames++;
+  }
+  return frames;
+}
@@ -0,0 +1,164 @@
+/// @file RtmpFrameBus.h
+/// @brief 多进程模式下各 worker 共用的帧总线.
+///        master 在 fork 之前映射一块共享内存, 分成固定数量的流槽位, 每个槽位是一个单写多读的环形缓冲区.
+///        推流所在的 worker 把帧写入槽位, 其他 worker 直接从共享内存读取, 不经过 socket.
+///        读端不加锁, 用写端预留的位置判断读到的记录是否已经被覆盖, 被覆盖时跳到最近的关键帧.
+///        序列头和元数据单独保存在槽位中, 用版本号保护, 新的读端先收到序列头和元数据
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_FRAME_BUS_H
+#define RTMP_SERVER_RTMP_FRAME_BUS_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "amf.h"
+
+struct RtmpFrameBusOptions {
+  uint32_t max_streams = 64;             // 同时推流的流数上限
+  uint32_t ring_bytes = 4 * 1024 * 1024;  // 每路流的环形缓冲区大小, 单帧不能超过一半
+};
+
+class RtmpFrameBusWriter;
+class RtmpFrameBusReader;
+
+class RtmpFrameBus : public std::enable_shared_from_this<RtmpFrameBus> {
+ public:
+  // type 同 RtmpSession::SendMediaData, 元数据为 RTMP_DATA_MESSAGE (onMetaData + ECMA 数组)
+  using FrameCallback = std::function<void(uint8_t type, uint64_t timestamp,
+                                           std::shared_ptr<char> data, uint32_t size)>;
+
+  // 需在 fork 之前创建, 子进程继承映射. 失败返回 nullptr
+  static std::shared_ptr<RtmpFrameBus> Create(const RtmpFrameBusOptions &options);
+  ~RtmpFrameBus();
+  RtmpFrameBus(const RtmpFrameBus &) = delete;
+  RtmpFrameBus &operator=(const RtmpFrameBus &) = delete;
+
+  // 占用一个槽位写入 stream_path, 任意进程中已经有同名的流或者槽位用完时返回 nullptr
+  std::shared_ptr<RtmpFrameBusWriter> OpenWriter(const std::string &stream_path);
+
+  // 从最近的关键帧开始读取 stream_path, 没有这个流时返回 nullptr
+  std::shared_ptr<RtmpFrameBusReader> OpenReader(const std::string &stream_path);
+
+  bool HasStream(const std::string &stream_path);
+
+  // 释放进程 pid 占用的槽位, worker 异常退出之后由 master 调用, 返回释放的个数
+  uint32_t ReleaseOwner(pid_t pid);
+
+  // 正在写入的流数
+  uint32_t GetStreams();
+
+  static const uint32_t kMaxPathBytes = 256;
+  static const uint32_t kMaxHeaderBytes = 4096;
+  static const uint32_t kMaxMetaBytes = 16384;
+
+ private:
+  friend class RtmpFrameBusWriter;
+  friend class RtmpFrameBusReader;
+
+  struct Header;
+  struct Slot;
+
+  RtmpFrameBus() = default;
+
+  Slot *GetSlot(uint32_t index) const;
+  char *GetRing(Slot *slot) const;
+
+  // 槽位的占用和释放用进程间共享的锁, 持有锁的进程退出时由下一个加锁的进程恢复
+  void Lock();
+  void Unlock();
+
+  // 找到名为 stream_path 的槽位, 需持有锁
+  Slot *FindSlot(const std::string &stream_path);
+
+  // generation 和槽位当前的一致时释放
+  void ReleaseSlot(Slot *slot, uint64_t generation);
+
+  char *base_ = nullptr;
+  size_t map_size_ = 0;
+  size_t slot_bytes_ = 0;
+  Header *header_ = nullptr;
+};
+
+// 推流所在的 worker 写入, 只在推流线程中调用
+class RtmpFrameBusWriter {
+ public:
+  ~RtmpFrameBusWriter();
+  RtmpFrameBusWriter(const RtmpFrameBusWriter &) = delete;
+  RtmpFrameBusWriter &operator=(const RtmpFrameBusWriter &) = delete;
+
+  // type 同 RtmpSession::SendMediaData, 序列头写入槽位的序列头区域
+  void OnMedia(uint8_t type, uint64_t timestamp, const char *data, uint32_t size);
+  void OnMetaData(AmfObjects meta_data);
+
+  // 释放槽位, 读端随后返回流结束
+  void Close();
+
+  uint64_t GetFrames() const { return frames_; }
+  uint64_t GetDroppedFrames() const { return dropped_frames_; }
+
+ private:
+  friend class RtmpFrameBus;
+
+  RtmpFrameBusWriter(std::shared_ptr<RtmpFrameBus> bus, RtmpFrameBus::Slot *slot,
+                     uint64_t generation);
+
+  // 按版本号更新序列头或者元数据, 读端读到奇数版本或者前后版本不一致时重试
+  void UpdateConfig(uint8_t type, const char *data, uint32_t size);
+
+  std::shared_ptr<RtmpFrameBus> bus_;
+  RtmpFrameBus::Slot *slot_;
+  char *ring_;
+  const uint64_t generation_;
+  bool closed_ = false;
+  uint64_t frames_ = 0;
+  uint64_t dropped_frames_ = 0;
+};
+
+// 不加锁的读端, 只在一个线程中调用
+class RtmpFrameBusReader {
+ public:
+  RtmpFrameBusReader(const RtmpFrameBusReader &) = delete;
+  RtmpFrameBusReader &operator=(const RtmpFrameBusReader &) = delete;
+
+  // 读取最多 max_frames 个已经写入的帧, 序列头或者元数据变化时先回调,
+  // 每帧从共享内存拷贝一次, 由调用者扇出. 返回读到的帧数, 流已经结束返回 -1
+  int Poll(const RtmpFrameBus::FrameCallback &callback, uint32_t max_frames);
+
+  // 读得太慢被写端覆盖的次数, 每次跳到最近的关键帧
+  uint64_t GetOverruns() const { return overruns_; }
+
+ private:
+  friend class RtmpFrameBus;
+
+  RtmpFrameBusReader(std::shared_ptr<RtmpFrameBus> bus, RtmpFrameBus::Slot *slot,
+                     uint64_t generation);
+
+  bool IsEnded() const;
+  void PollConfig(const RtmpFrameBus::FrameCallback &callback);
+
+  // 从最近的关键帧开始读, 关键帧已经被覆盖时从最新的位置开始并等待下一个关键帧.
+  // 没有 AVC 序列头的纯音频流以音频帧作为关键帧
+  void Seek();
+
+  // 读到的记录已经被覆盖, 重新 Seek
+  void Resync();
+
+  std::shared_ptr<RtmpFrameBus> bus_;
+  RtmpFrameBus::Slot *slot_;
+  const char *ring_;
+  const uint64_t generation_;
+  uint64_t read_pos_ = 0;
+  uint32_t config_version_ = 0;
+  bool waiting_key_frame_ = false;
+  bool has_video_ = false;  // 读到过 AVC 序列头
+  uint64_t overruns_ = 0;
+};
+
+#endif  // RTMP_SERVER_RTMP_FRAME_BUS_H
@@ -12,6 +12,31 @@
 #include "Logger.h"
 #include "rtmp.h"
 
+/// 握手随机数不需要密码学强度, 每个线程用 OS 随机源播种一次 xorshift128+, 之后每次生成 8 字节,
+/// 替代每次握手构造 std::random_device 并逐字节调用(可能每个字节一次 getrandom 系统调用)
+static void FillRandom(uint8_t* buf, uint32_t size) {
+  static thread_local uint64_t s[2] = {0, 0};
+  if (s[0] == 0 && s[1] == 0) {
+    std::random_device rd;
+    s[0] = ((uint64_t)rd() << 32) | rd();
+    s[1] = ((uint64_t)rd() << 32) | rd() | 1;
+  }
+
+  uint32_t pos = 0;
+  while (pos < size) {
+    uint64_t x = s[0];
+    const uint64_t y = s[1];
+    s[0] = y;
+    x ^= x << 23;
+    s[1] = x ^ y ^ (x >> 17) ^ (y >> 26);
+    uint64_t value = s[1] + y;
+
+    uint32_t n = (size - pos) < 8 ? (size - pos) : 8;
+    memcpy(buf + pos, &value, n);
+    pos += n;
+  }
+}
+
 RtmpHandshake::RtmpHandshake(State state) { handshake_state_ = state; }
 
 RtmpHandshake::~RtmpHandshake() {}
@@ -21,7 +46,6 @@ int RtmpHandshake::Parse(BufferReader& buffer, char* res_buf, uint32_t res_buf_s
   uint32_t buf_size = buffer.ReadableBytes();
   uint32_t pos = 0;
   uint32_t res_size = 0;
-  std::random_device rd;
 
   switch (handshake_state_) {
     case HANDSHAKE_C0C1:
@@ -36,15 +60,15 @@ int RtmpHandshake::Parse(BufferReader& buffer, char* res_buf, uint32_t res_buf_s
 
         pos += 1537;
         res_size = 1 + 1536 + 1536;
-        memset(res_buf, 0, 1537);  // S0 S1 S2
-        res_buf[0] = RTMP_VERSION;
-
-        char* p = res_buf;
-        p += 9;
-        for (int i = 0; i < 1528; i++) {
-          *p++ = rd();
+        if (res_buf_size < res_size) {
+          return -1;
         }
-        memcpy(p, buf + 1, 1536);
+
+        // S0 S1 S2, S1 的 4 Byte 时间戳和 4 Byte 0 之后全是随机数, 只需清零前 9 字节
+        memset(res_buf, 0, 9);
+        res_buf[0] = RTMP_VERSION;
+        FillRandom((uint8_t*)res_buf + 9, 1528);
+        memcpy(res_buf + 1537, buf + 1, 1536);
         handshake_state_ = HANDSHAKE_C2;
       }
       break;
@@ -61,6 +85,9 @@ int RtmpHandshake::Parse(BufferReader& buffer, char* res_buf, uint32_t res_buf_s
 
       pos += 1 + 1536 + 1536;
       res_size = 1536;
+      if (res_buf_size < res_size) {
+        return -1;
+      }
       memcpy(res_buf, buf + 1, 1536);  // C2
       handshake_state_ = HANDSHAKE_COMPLETE;
       break;
@@ -84,15 +111,13 @@ int RtmpHandshake::Parse(BufferReader& buffer, char* res_buf, uint32_t res_buf_s
 
 int RtmpHandshake::BuildC0C1(char* buf, uint32_t buf_size) {
   uint32_t size = 1 + 1536;  // COC1
-  memset(buf, 0, 1537);
-  buf[0] = RTMP_VERSION;
-
-  std::random_device rd;
-  uint8_t* p = (uint8_t*)buf;
-  p += 9;
-  for (int i = 0; i < 1528; i++) {
-    *p++ = rd();
+  if (buf_size < size) {
+    return -1;
   }
 
+  memset(buf, 0, 9);
+  buf[0] = RTMP_VERSION;
+  FillRandom((uint8_t*)buf + 9, 1528);
+
   return size;
 }
\ No newline at end of file
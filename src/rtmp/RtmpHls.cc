@@ -0,0 +1,348 @@
+/// @file RtmpHls.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpHls.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "HttpServer.h"
+#include "RtmpServer.h"
+#include "rtmp.h"
+
+namespace {
+
+const uint8_t kStartCode[4] = {0x00, 0x00, 0x00, 0x01};
+const uint8_t kAud[6] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xf0};
+
+uint32_t ReadNalLength(const uint8_t *p, uint32_t size) {
+  uint32_t length = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    length = (length << 8) | p[i];
+  }
+  return length;
+}
+
+}  // namespace
+
+RtmpHls::RtmpHls(const std::string &name, uint32_t segment_ms, uint32_t list_size)
+    : name_(name), segment_ms_(segment_ms), list_size_(list_size > 0 ? list_size : 1) {}
+
+void RtmpHls::OnMedia(uint8_t type, uint64_t timestamp, const char *data, uint32_t size) {
+  const uint8_t *payload = (const uint8_t *)data;
+  if (type == RTMP_AVC_SEQUENCE_HEADER) {
+    ParseAvcConfig(payload, size);
+  } else if (type == RTMP_AAC_SEQUENCE_HEADER) {
+    ParseAacConfig(payload, size);
+  } else if (type == RTMP_VIDEO) {
+    if (has_video_ && size > 5 && (payload[0] & 0x0f) == RTMP_CODEC_ID_H264 && payload[1] == 1) {
+      WriteVideo(timestamp, payload, size, ((payload[0] >> 4) & 0x0f) == 1);
+    }
+  } else if (type == RTMP_AUDIO) {
+    if (has_audio_ && size > 2 && ((payload[0] >> 4) & 0x0f) == RTMP_CODEC_ID_AAC &&
+        payload[1] == 1) {
+      WriteAudio(timestamp, payload, size);
+    }
+  }
+}
+
+void RtmpHls::ParseAvcConfig(const uint8_t *data, uint32_t size) {
+  // 5 字节 FLV 视频头之后是 AVCDecoderConfigurationRecord
+  if (size < 5 + 7) {
+    return;
+  }
+
+  const uint8_t *p = data + 5;
+  const uint8_t *end = data + size;
+  nal_length_size_ = (p[4] & 0x03) + 1;
+  avc_prefix_.assign((const char *)kAud, sizeof(kAud));
+
+  p += 5;
+  for (int i = 0; i < 2 && p < end; i++) {  // 先 SPS 后 PPS
+    int count = (i == 0) ? (*p++ & 0x1f) : *p++;
+    for (int j = 0; j < count && p + 2 <= end; j++) {
+      uint32_t length = (p[0] << 8) | p[1];
+      p += 2;
+      if (p + length > end) {
+        return;
+      }
+      avc_prefix_.append((const char *)kStartCode, sizeof(kStartCode));
+      avc_prefix_.append((const char *)p, length);
+      p += length;
+    }
+  }
+
+  has_video_ = true;
+}
+
+void RtmpHls::ParseAacConfig(const uint8_t *data, uint32_t size) {
+  // 2 字节 FLV 音频头之后是 AudioSpecificConfig
+  if (size < 2 + 2) {
+    return;
+  }
+
+  aac_profile_ = (data[2] >> 3) & 0x1f;
+  aac_sample_rate_index_ = ((data[2] & 0x07) << 1) | (data[3] >> 7);
+  aac_channels_ = (data[3] >> 3) & 0x0f;
+  has_audio_ = aac_profile_ > 0;
+}
+
+void RtmpHls::WriteVideo(uint64_t timestamp, const uint8_t *data, uint32_t size, bool key_frame) {
+  // 分片从关键帧开始, 音频先到时打开的分片没有视频流, 也在关键帧处重新切片
+  if (key_frame) {
+    if (!has_segment_) {
+      OpenSegment(timestamp);
+    } else if (timestamp >= segment_start_ + segment_ms_ || !muxer_.HasVideo()) {
+      CloseSegment(timestamp);
+      OpenSegment(timestamp);
+    }
+  } else if (!has_segment_ || !muxer_.HasVideo()) {
+    return;
+  }
+
+  int32_t cts = (int32_t)((data[2] << 16) | (data[3] << 8) | data[4]);
+  if (cts & 0x800000) {
+    cts |= 0xff000000;  // 24 位有符号数
+  }
+
+  // AVCC 转 Annex B, 长度前缀换成起始码
+  frame_.clear();
+  if (key_frame) {
+    frame_.append(avc_prefix_);
+  } else {
+    frame_.append((const char *)kAud, sizeof(kAud));
+  }
+
+  const uint8_t *p = data + 5;
+  const uint8_t *end = data + size;
+  while (p + nal_length_size_ <= end) {
+    uint32_t length = ReadNalLength(p, nal_length_size_);
+    p += nal_length_size_;
+    if (length == 0 || p + length > end) {
+      break;
+    }
+    uint8_t nal_type = p[0] & 0x1f;
+    if (nal_type != 9 && !(key_frame && (nal_type == 7 || nal_type == 8))) {
+      frame_.append((const char *)kStartCode, sizeof(kStartCode));
+      frame_.append((const char *)p, length);
+    }
+    p += length;
+  }
+
+  uint64_t dts = timestamp * 90;
+  uint64_t pts = (uint64_t)((int64_t)dts + (int64_t)cts * 90);
+  muxer_.WriteVideo(current_, (const uint8_t *)frame_.data(), frame_.size(), pts, dts, key_frame);
+  last_timestamp_ = timestamp;
+}
+
+void RtmpHls::WriteAudio(uint64_t timestamp, const uint8_t *data, uint32_t size) {
+  if (!has_segment_) {
+    if (has_video_) {  // 有视频时等关键帧打开分片
+      return;
+    }
+    OpenSegment(timestamp);
+  } else if (!has_video_ && timestamp >= segment_start_ + segment_ms_) {
+    CloseSegment(timestamp);
+    OpenSegment(timestamp);
+  }
+
+  if (!muxer_.HasAudio()) {
+    return;
+  }
+
+  // 加上 7 字节 ADTS 头
+  uint32_t length = size - 2 + 7;
+  uint8_t adts[7];
+  adts[0] = 0xff;
+  adts[1] = 0xf1;
+  adts[2] = (uint8_t)((((aac_profile_ - 1) & 0x03) << 6) | ((aac_sample_rate_index_ & 0x0f) << 2) |
+                      ((aac_channels_ >> 2) & 0x01));
+  adts[3] = (uint8_t)(((aac_channels_ & 0x03) << 6) | ((length >> 11) & 0x03));
+  adts[4] = (uint8_t)(length >> 3);
+  adts[5] = (uint8_t)(((length & 0x07) << 5) | 0x1f);
+  adts[6] = 0xfc;
+
+  frame_.assign((const char *)adts, sizeof(adts));
+  frame_.append((const char *)data + 2, size - 2);
+  muxer_.WriteAudio(current_, (const uint8_t *)frame_.data(), frame_.size(), timestamp * 90);
+  if (timestamp > last_timestamp_) {
+    last_timestamp_ = timestamp;
+  }
+}
+
+void RtmpHls::OpenSegment(uint64_t timestamp) {
+  muxer_.SetStreams(has_video_, has_audio_);
+  current_.clear();
+  muxer_.WritePatPmt(current_);
+  has_segment_ = true;
+  segment_start_ = timestamp;
+  last_timestamp_ = timestamp;
+}
+
+void RtmpHls::CloseSegment(uint64_t timestamp) {
+  if (!has_segment_) {
+    return;
+  }
+  has_segment_ = false;
+
+  // 分片的数据移交给引用计数的缓冲区, 之后只读
+  uint32_t size = (uint32_t)current_.size();
+  auto holder = std::make_shared<std::string>(std::move(current_));
+  current_ = std::string();
+  current_.reserve(size + size / 4);
+
+  Segment segment;
+  segment.sequence = next_sequence_++;
+  segment.duration_ms = (uint32_t)(timestamp > segment_start_ ? timestamp - segment_start_ : 0);
+  segment.data = std::shared_ptr<char>(holder, &(*holder)[0]);
+  segment.size = size;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  segments_.push_back(segment);
+  while (segments_.size() > list_size_) {
+    segments_.pop_front();
+  }
+  UpdatePlaylist();
+}
+
+void RtmpHls::Flush() {
+  // 最后一帧的时长未知, 按一帧 40ms 估算
+  CloseSegment(last_timestamp_ + 40);
+}
+
+void RtmpHls::Reset() {
+  has_segment_ = false;
+  current_.clear();
+  has_video_ = false;
+  has_audio_ = false;
+  avc_prefix_.clear();
+  muxer_.Reset();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  segments_.clear();
+  playlist_ = nullptr;
+  playlist_size_ = 0;
+}
+
+void RtmpHls::UpdatePlaylist() {
+  uint32_t target = 1;
+  for (auto &segment : segments_) {
+    uint32_t seconds = (segment.duration_ms + 999) / 1000;
+    if (seconds > target) {
+      target = seconds;
+    }
+  }
+
+  std::string playlist;
+  playlist.reserve(128 + segments_.size() * (name_.size() + 48));
+  playlist += "#EXTM3U\n#EXT-X-VERSION:3\n";
+  playlist += "#EXT-X-TARGETDURATION:" + std::to_string(target) + "\n";
+  playlist += "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(segments_.front().sequence) + "\n";
+  char line[64];
+  for (auto &segment : segments_) {
+    snprintf(line, sizeof(line), "#EXTINF:%.3f,\n", segment.duration_ms / 1000.0);
+    playlist += line;
+    playlist += name_ + "-" + std::to_string(segment.sequence) + ".ts\n";
+  }
+
+  playlist_.reset(new char[playlist.size()], std::default_delete<char[]>());
+  memcpy(playlist_.get(), playlist.data(), playlist.size());
+  playlist_size_ = (uint32_t)playlist.size();
+}
+
+bool RtmpHls::GetPlaylist(std::shared_ptr<char> &data, uint32_t &size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!playlist_) {
+    return false;
+  }
+  data = playlist_;
+  size = playlist_size_;
+  return true;
+}
+
+bool RtmpHls::GetSegment(uint64_t sequence, std::shared_ptr<char> &data, uint32_t &size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (segments_.empty() || sequence < segments_.front().sequence ||
+      sequence > segments_.back().sequence) {
+    return false;
+  }
+
+  const Segment &segment = segments_[sequence - segments_.front().sequence];
+  data = segment.data;
+  size = segment.size;
+  return true;
+}
+
+void RtmpHls::RegisterRoutes(HttpServer &http_server, std::shared_ptr<RtmpServer> server) {
+  std::weak_ptr<RtmpServer> weak_server = server;
+
+  http_server.AddPrefixRoute("/", [weak_server](const HttpRequest &request,
+                                                HttpResponse &response) {
+    const std::string &path = request.path;
+    bool is_playlist = path.size() > 5 && path.compare(path.size() - 5, 5, ".m3u8") == 0;
+    bool is_segment = path.size() > 3 && path.compare(path.size() - 3, 3, ".ts") == 0;
+    if (!is_playlist && !is_segment) {
+      response.status = 404;
+      response.body = "Not Found\n";
+      return;
+    }
+
+    auto server = weak_server.lock();
+    if (!server) {
+      response.status = 503;
+      return;
+    }
+
+    // /app/stream.m3u8 和 /app/stream-12.ts 都对应流路径 /app/stream
+    std::string stream_path;
+    uint64_t sequence = 0;
+    if (is_playlist) {
+      stream_path = path.substr(0, path.size() - 5);
+    } else {
+      size_t dash = path.rfind('-');
+      if (dash == std::string::npos || dash < path.rfind('/')) {
+        response.status = 404;
+        response.body = "Not Found\n";
+        return;
+      }
+      stream_path = path.substr(0, dash);
+      sequence = strtoull(path.c_str() + dash + 1, nullptr, 10);
+    }
+
+    std::shared_ptr<RtmpHls> hls;
+    auto session = server->FindSession(stream_path);
+    if (session) {
+      hls = session->GetHls();
+    }
+
+    bool found = false;
+    std::shared_ptr<char> data;
+    uint32_t size = 0;
+    if (hls && is_playlist) {
+      found = hls->GetPlaylist(data, size);
+      response.content_type = "application/vnd.apple.mpegurl";
+      response.headers["Cache-Control"] = "no-cache";
+    } else if (hls) {
+      found = hls->GetSegment(sequence, data, size);
+      response.content_type = "video/mp2t";
+      // 分片内容不会改变, 可以被 CDN 缓存到移出播放列表之后
+      response.headers["Cache-Control"] =
+          "public, max-age=" +
+          std::to_string((uint64_t)hls->GetSegmentMs() * hls->GetListSize() * 2 / 1000 + 1);
+    }
+
+    if (found) {
+      response.AddData(data, size);
+    } else {
+      response.status = 404;
+      response.content_type = "text/plain; charset=utf-8";
+      response.headers.clear();
+      response.body = "Not Found\n";
+    }
+    response.headers["Access-Control-Allow-Origin"] = "*";
+  });
+}
@@ -0,0 +1,102 @@
+/// @file RtmpHls.h
+/// @brief 每个流会话一个 HLS 分片器: 推流线程把 AVC/AAC 帧封装成 MPEG-TS, 在关键帧处切片,
+///        最近 N 个分片和 m3u8 播放列表保存在内存中, 不写磁盘
+///        封装只在推流端做一次, 和拉流端数量无关. 分片完成后不再修改, HTTP 线程引用计数共享, 发送不拷贝
+///        播放地址: http://ip:port/app/stream.m3u8, 分片: /app/stream-<序号>.ts
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_HLS_H
+#define RTMP_SERVER_RTMP_HLS_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "TsMuxer.h"
+
+class HttpServer;
+class RtmpServer;
+
+class RtmpHls {
+ public:
+  // name: 分片文件名前缀, 即流名; segment_ms: 目标分片时长; list_size: 播放列表中的分片数
+  RtmpHls(const std::string &name, uint32_t segment_ms, uint32_t list_size);
+  RtmpHls(const RtmpHls &) = delete;
+  RtmpHls &operator=(const RtmpHls &) = delete;
+
+  /* 以下函数由 session 在推流线程中调用 */
+
+  // type: RTMP_AUDIO, RTMP_VIDEO, RTMP_AVC_SEQUENCE_HEADER 或 RTMP_AAC_SEQUENCE_HEADER
+  void OnMedia(uint8_t type, uint64_t timestamp, const char *data, uint32_t size);
+
+  // 推流结束, 当前分片写完后放入播放列表
+  void Flush();
+
+  // 新的推流端开始推流, 丢弃已有分片和编码参数, 分片序号继续递增
+  void Reset();
+
+  /* 以下函数由 HTTP 线程调用 */
+
+  // 还没有完整的分片时返回 false
+  bool GetPlaylist(std::shared_ptr<char> &data, uint32_t &size);
+
+  // 分片已经移出播放列表时返回 false
+  bool GetSegment(uint64_t sequence, std::shared_ptr<char> &data, uint32_t &size);
+
+  uint32_t GetSegmentMs() const { return segment_ms_; }
+  uint32_t GetListSize() const { return list_size_; }
+
+  // 注册 /app/stream.m3u8 和 /app/stream-<序号>.ts, 以前缀路由匹配所有流
+  static void RegisterRoutes(HttpServer &http_server, std::shared_ptr<RtmpServer> server);
+
+ private:
+  struct Segment {
+    uint64_t sequence = 0;
+    uint32_t duration_ms = 0;
+    std::shared_ptr<char> data;  // 完成后不再修改
+    uint32_t size = 0;
+  };
+
+  void ParseAvcConfig(const uint8_t *data, uint32_t size);
+  void ParseAacConfig(const uint8_t *data, uint32_t size);
+
+  void WriteVideo(uint64_t timestamp, const uint8_t *data, uint32_t size, bool key_frame);
+  void WriteAudio(uint64_t timestamp, const uint8_t *data, uint32_t size);
+
+  void OpenSegment(uint64_t timestamp);
+  void CloseSegment(uint64_t timestamp);
+
+  // 需持有 mutex_
+  void UpdatePlaylist();
+
+  const std::string name_;
+  const uint32_t segment_ms_;
+  const uint32_t list_size_;
+
+  // 只在推流线程访问
+  TsMuxer muxer_;
+  std::string current_;  // 正在写的分片
+  bool has_segment_ = false;
+  uint64_t segment_start_ = 0;
+  uint64_t last_timestamp_ = 0;
+  uint64_t next_sequence_ = 0;
+  std::string avc_prefix_;  // 关键帧前面加上 AUD, SPS 和 PPS (Annex B)
+  uint32_t nal_length_size_ = 4;
+  bool has_video_ = false;
+  bool has_audio_ = false;
+  uint8_t aac_profile_ = 0;
+  uint8_t aac_sample_rate_index_ = 0;
+  uint8_t aac_channels_ = 0;
+  std::string frame_;  // 转换成 Annex B 或 ADTS 的帧, 重复使用
+
+  std::mutex mutex_;  // 保护 segments_ 和 playlist_
+  std::deque<Segment> segments_;
+  std::shared_ptr<char> playlist_;
+  uint32_t playlist_size_ = 0;
+};
+
+#endif  // RTMP_SERVER_RTMP_HLS_H
@@ -0,0 +1,80 @@
+/// @file RtmpIngressCapture.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpIngressCapture.h"
+
+#include <cctype>
+
+#include "Timestamp.h"
+
+const char RtmpIngressCapture::kMagic[8] = {'R', 'T', 'M', 'P', 'C', 'A', 'P', '1'};
+const uint32_t RtmpIngressCapture::kMaxPendingBytes;
+
+void RtmpIngressCapture::Append(const char *data, uint32_t size) {
+  if (stopped_ || size == 0) {
+    return;
+  }
+
+  if (file_ == nullptr) {
+    if (pending_.size() + size > kMaxPendingBytes) {
+      stopped_ = true;
+      pending_.clear();
+      return;
+    }
+    pending_.append(data, size);
+    return;
+  }
+
+  if (bytes_ + size > max_bytes_ || fwrite(data, 1, size, file_) != size) {
+    stopped_ = true;
+    Close();
+    return;
+  }
+  bytes_ += size;
+}
+
+bool RtmpIngressCapture::Open(const std::string &path) {
+  if (stopped_ || file_ != nullptr) {
+    return false;
+  }
+
+  file_ = fopen(path.c_str(), "wb");
+  if (file_ == nullptr) {
+    stopped_ = true;
+    pending_.clear();
+    return false;
+  }
+
+  // 全缓冲, 在事件循环线程中写文件时尽量减少系统调用
+  setvbuf(file_, nullptr, _IOFBF, 256 * 1024);
+  fwrite(kMagic, 1, sizeof(kMagic), file_);
+
+  std::string pending;
+  pending.swap(pending_);
+  Append(pending.data(), (uint32_t)pending.size());
+  return file_ != nullptr;
+}
+
+void RtmpIngressCapture::Close() {
+  if (file_ != nullptr) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+std::string RtmpIngressCapture::MakeFileName(const std::string &stream_path, uint32_t conn_id) {
+  std::string name;
+  for (char c : stream_path) {
+    if (isalnum((unsigned char)c) || c == '-') {
+      name.push_back(c);
+    } else if (!name.empty()) {
+      name.push_back('_');
+    }
+  }
+  name += "_" + std::to_string(Timestamp::NowMicros() / 1000000) + "_" + std::to_string(conn_id) +
+          ".rtmpcap";
+  return name;
+}
@@ -0,0 +1,49 @@
+/// @file RtmpIngressCapture.h
+/// @brief 推流连接的入口抓包: 记录握手之后收到的原始字节, 供 replay_bench 离线回放 chunk 解析和消息处理
+///        文件格式: 8 字节魔数 "RTMPCAP1" + 握手之后的原始字节流, 不含时间信息
+///        连接是不是推流端要等 publish 命令才知道, 之前的字节 (connect/createStream/publish) 先缓存在内存中
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_INGRESS_CAPTURE_H
+#define RTMP_SERVER_RTMP_INGRESS_CAPTURE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+class RtmpIngressCapture {
+ public:
+  static const char kMagic[8];
+  static const uint32_t kMaxPendingBytes = 64 * 1024;  // Open 之前最多缓存的字节数
+
+  // max_bytes: 单个文件最多写入的字节数, 超过后停止抓包
+  explicit RtmpIngressCapture(uint64_t max_bytes) : max_bytes_(max_bytes) {}
+  ~RtmpIngressCapture() { Close(); }
+  RtmpIngressCapture(const RtmpIngressCapture &) = delete;
+  RtmpIngressCapture &operator=(const RtmpIngressCapture &) = delete;
+
+  // 追加收到的字节, Open 之前缓存在内存中
+  void Append(const char *data, uint32_t size);
+
+  // 创建文件并写入缓存的字节, 失败返回 false
+  bool Open(const std::string &path);
+  void Close();
+
+  bool IsOpened() const { return file_ != nullptr; }
+
+  uint64_t GetBytes() const { return bytes_; }
+
+  // 流路径 "/app/stream" 转成可以作为文件名的形式, 非字母数字的字符替换为 '_'
+  static std::string MakeFileName(const std::string &stream_path, uint32_t conn_id);
+
+ private:
+  uint64_t max_bytes_ = 0;
+  uint64_t bytes_ = 0;
+  FILE *file_ = nullptr;
+  std::string pending_;
+  bool stopped_ = false;  // 缓存或文件超出上限后不再记录, 避免写出不连续的字节流
+};
+
+#endif  // RTMP_SERVER_RTMP_INGRESS_CAPTURE_H
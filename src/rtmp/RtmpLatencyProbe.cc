@@ -0,0 +1,131 @@
+/// @file RtmpLatencyProbe.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpLatencyProbe.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "BufferReader.h"
+#include "BufferWriter.h"
+#include "amf.h"
+
+const uint32_t RtmpLatencyProbe::kSeiSize;
+const uint32_t RtmpLatencyProbe::kAmfSize;
+const char *const RtmpLatencyProbe::kAmfName = "onFPTimestamp";
+
+namespace {
+
+// user data unregistered 的 16 字节 UUID, 用可见字符避免出现需要防竞争字节的 00 00
+const uint8_t kProbeUuid[16] = {'r', 't', 'm', 'p', '_', 'l', 'a', 't',
+                                'e', 'n', 'c', 'y', '_', 'p', 'r', 'b'};
+
+// 时间戳写成 16 个十六进制字符, 同样不会出现 00 00
+const uint32_t kStampSize = 16;
+const uint32_t kSeiPayloadSize = sizeof(kProbeUuid) + kStampSize;
+
+const uint8_t kNalTypeSei = 6;
+const uint8_t kSeiUserDataUnregistered = 5;
+
+bool ParseHex(const uint8_t *data, uint32_t size, int64_t &value) {
+  uint64_t v = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    uint8_t c = data[i];
+    if (c >= '0' && c <= '9') {
+      v = (v << 4) | (c - '0');
+    } else if (c >= 'a' && c <= 'f') {
+      v = (v << 4) | (c - 'a' + 10);
+    } else {
+      return false;
+    }
+  }
+  value = (int64_t)v;
+  return true;
+}
+
+}  // namespace
+
+uint32_t RtmpLatencyProbe::WriteSei(uint8_t *buf, uint32_t capacity, int64_t timestamp_us) {
+  if (capacity < kSeiSize) {
+    return 0;
+  }
+
+  uint32_t nal_size = kSeiSize - 4;
+  WriteUint32BE((char *)buf, nal_size);
+  uint8_t *nal = buf + 4;
+  nal[0] = kNalTypeSei;
+  nal[1] = kSeiUserDataUnregistered;
+  nal[2] = kSeiPayloadSize;
+  memcpy(nal + 3, kProbeUuid, sizeof(kProbeUuid));
+
+  char stamp[kStampSize + 1];
+  snprintf(stamp, sizeof(stamp), "%016llx", (unsigned long long)timestamp_us);
+  memcpy(nal + 3 + sizeof(kProbeUuid), stamp, kStampSize);
+  nal[nal_size - 1] = 0x80;  // rbsp_trailing_bits
+  return kSeiSize;
+}
+
+bool RtmpLatencyProbe::ParseSei(const uint8_t *payload, uint32_t size, int64_t &timestamp_us) {
+  // 1 字节帧类型和编码 + 1 字节 AVCPacketType (1: NALU) + 3 字节 composition time
+  if (size < 5 || (payload[0] & 0x0f) != 7 || payload[1] != 1) {
+    return false;
+  }
+
+  uint32_t pos = 5;
+  while (pos + 4 <= size) {
+    uint32_t nal_size = ReadUint32BE((char *)payload + pos);
+    pos += 4;
+    if (nal_size > size - pos) {
+      return false;
+    }
+
+    const uint8_t *nal = payload + pos;
+    if (nal_size >= kSeiSize - 4 && (nal[0] & 0x1f) == kNalTypeSei &&
+        nal[1] == kSeiUserDataUnregistered && nal[2] == kSeiPayloadSize &&
+        memcmp(nal + 3, kProbeUuid, sizeof(kProbeUuid)) == 0) {
+      return ParseHex(nal + 3 + sizeof(kProbeUuid), kStampSize, timestamp_us);
+    }
+
+    // 探测 SEI 总是放在帧的最前面, 遇到图像数据就不用再找了
+    uint8_t nal_type = nal_size > 0 ? (nal[0] & 0x1f) : 0;
+    if (nal_type >= 1 && nal_type <= 5) {
+      return false;
+    }
+    pos += nal_size;
+  }
+
+  return false;
+}
+
+uint32_t RtmpLatencyProbe::WriteAmf(char *buf, uint32_t capacity, int64_t timestamp_us) {
+  if (capacity < kAmfSize) {
+    return 0;
+  }
+
+  uint32_t name_size = (uint32_t)strlen(kAmfName);
+  uint32_t index = 0;
+  buf[index++] = AMF0_STRING;
+  WriteUint16BE(buf + index, (uint16_t)name_size);
+  index += 2;
+  memcpy(buf + index, kAmfName, name_size);
+  index += name_size;
+  buf[index++] = AMF0_NUMBER;
+  WriteDoubleBE(buf + index, (double)timestamp_us);
+  index += 8;
+  return index;
+}
+
+bool RtmpLatencyProbe::ParseAmf(const char *payload, uint32_t size, int64_t &timestamp_us) {
+  AmfReader reader(payload, size);
+  AmfStringView name;
+  double value = 0;
+  if (!reader.ReadString(name) || !(name == kAmfName) || !reader.ReadNumber(value)) {
+    return false;
+  }
+
+  timestamp_us = (int64_t)value;
+  return true;
+}
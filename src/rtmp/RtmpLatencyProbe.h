@@ -0,0 +1,38 @@
+/// @file RtmpLatencyProbe.h
+/// @brief 端到端 (推流端 -> 服务器 -> 拉流端) 延迟探测
+///        推流端把发送时的系统时间写入帧中, 拉流端收到后取出并计算延迟, 两种方式:
+///        1. SEI: 在视频帧前插入一个 user data unregistered SEI NAL, 服务器原样转发
+///        2. AMF: 每个视频帧后发送一条 onFPTimestamp 数据消息, 服务器按媒体顺序转发
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_LATENCY_PROBE_H
+#define RTMP_SERVER_RTMP_LATENCY_PROBE_H
+
+#include <cstdint>
+
+class RtmpLatencyProbe {
+ public:
+  enum Mode { PROBE_NONE, PROBE_SEI, PROBE_AMF };
+
+  // SEI NAL 加上 4 字节长度前缀的大小
+  static const uint32_t kSeiSize = 4 + 36;
+  // onFPTimestamp 数据消息的大小
+  static const uint32_t kAmfSize = 3 + 13 + 9;
+
+  static const char *const kAmfName;  // "onFPTimestamp"
+
+  // 写入带 4 字节长度前缀 (AVCC 格式) 的 SEI NAL, 返回写入的字节数, 空间不足返回 0
+  static uint32_t WriteSei(uint8_t *buf, uint32_t capacity, int64_t timestamp_us);
+
+  // 在 RTMP 视频消息 (5 字节 AVC 头 + AVCC NALU 序列) 中查找探测 SEI
+  static bool ParseSei(const uint8_t *payload, uint32_t size, int64_t &timestamp_us);
+
+  // 写入 onFPTimestamp 数据消息, 返回写入的字节数, 空间不足返回 0
+  static uint32_t WriteAmf(char *buf, uint32_t capacity, int64_t timestamp_us);
+
+  static bool ParseAmf(const char *payload, uint32_t size, int64_t &timestamp_us);
+};
+
+#endif  // RTMP_SERVER_RTMP_LATENCY_PROBE_H
@@ -0,0 +1,670 @@
+/// @file RtmpLlHls.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpLlHls.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "HttpConnection.h"
+#include "HttpServer.h"
+#include "RtmpServer.h"
+#include "rtmp.h"
+
+namespace {
+
+HttpResponse MakeResponse(const char *content_type, const std::string &cache_control) {
+  HttpResponse response;
+  response.content_type = content_type;
+  response.headers["Cache-Control"] = cache_control;
+  response.headers["Access-Control-Allow-Origin"] = "*";
+  return response;
+}
+
+HttpResponse MakeError(int status) {
+  HttpResponse response;
+  response.status = status;
+  response.body = std::string(HttpConnection::StatusText(status)) + "\n";
+  response.headers["Access-Control-Allow-Origin"] = "*";
+  return response;
+}
+
+// 字符串移交给引用计数的缓冲区, 之后只读
+std::shared_ptr<char> ToShared(std::string &&data) {
+  auto holder = std::make_shared<std::string>(std::move(data));
+  return std::shared_ptr<char>(holder, &(*holder)[0]);
+}
+
+// 丢弃已经封装的前 count 个帧, 剩下的帧移到缓冲区开头
+void Consume(std::vector<Fmp4Muxer::Sample> &samples, std::vector<uint64_t> &times,
+             std::string &data, size_t count) {
+  if (count == 0) {
+    return;
+  }
+  uint32_t bytes = count < samples.size() ? samples[count].offset : (uint32_t)data.size();
+  data.erase(0, bytes);
+  samples.erase(samples.begin(), samples.begin() + count);
+  times.erase(times.begin(), times.begin() + count);
+  for (auto &sample : samples) {
+    sample.offset -= bytes;
+  }
+}
+
+}  // namespace
+
+RtmpLlHls::RtmpLlHls(const std::string &name, uint32_t segment_ms, uint32_t part_ms,
+                     uint32_t list_size)
+    : name_(name),
+      segment_ms_(segment_ms),
+      part_ms_(part_ms > 0 ? part_ms : 1),
+      list_size_(list_size > 0 ? list_size : 1) {}
+
+void RtmpLlHls::OnMedia(uint8_t type, uint64_t timestamp, const char *data, uint32_t size) {
+  const uint8_t *payload = (const uint8_t *)data;
+  if (type == RTMP_AVC_SEQUENCE_HEADER) {
+    // 5 字节 FLV 视频头之后是 AVCDecoderConfigurationRecord, 原样放入 avcC
+    if (size > 5 + 7) {
+      avc_config_.assign(data + 5, size - 5);
+    }
+  } else if (type == RTMP_AAC_SEQUENCE_HEADER) {
+    uint32_t channels = 0;
+    std::string config(data + 2, size > 2 ? size - 2 : 0);
+    if (Fmp4Muxer::ParseAacConfig(config, audio_sample_rate_, channels)) {
+      aac_config_ = config;
+    }
+  } else if (type == RTMP_VIDEO) {
+    if (!avc_config_.empty() && size > 5 && (payload[0] & 0x0f) == RTMP_CODEC_ID_H264 &&
+        payload[1] == 1) {
+      WriteVideo(timestamp, payload, size, ((payload[0] >> 4) & 0x0f) == 1);
+    }
+  } else if (type == RTMP_AUDIO) {
+    if (!aac_config_.empty() && size > 2 && ((payload[0] >> 4) & 0x0f) == RTMP_CODEC_ID_AAC &&
+        payload[1] == 1) {
+      WriteAudio(timestamp, payload, size);
+    }
+  }
+}
+
+void RtmpLlHls::WriteVideo(uint64_t timestamp, const uint8_t *data, uint32_t size,
+                           bool key_frame) {
+  if (!has_segment_ || init_avc_config_ != avc_config_) {
+    // 分片从关键帧开始; 分片打开时还没有视频或者编码参数改变, 在关键帧处重新切片
+    if (!key_frame) {
+      return;
+    }
+    if (has_segment_) {
+      CutPart(video_samples_.size(), timestamp);
+      CloseSegment(timestamp);
+    }
+    OpenSegment(timestamp);
+  } else {
+    // 上一帧的时长现在才确定
+    if (!video_samples_.empty()) {
+      uint64_t last = video_times_.back();
+      video_samples_.back().duration = (uint32_t)((timestamp > last ? timestamp - last : 0) * 90);
+    }
+
+    // 部分分片不超过 part_ms, 放不下的上一帧留给下一个部分分片
+    bool new_segment = key_frame && timestamp >= segment_start_ + segment_ms_;
+    size_t count = video_samples_.size();
+    if (count > 1 && timestamp > part_start_ + part_ms_) {
+      CutPart(count - 1, video_times_[count - 1]);
+    }
+    if (new_segment || timestamp >= part_start_ + part_ms_) {
+      CutPart(video_samples_.size(), timestamp);
+    }
+    if (new_segment) {
+      CloseSegment(timestamp);
+      OpenSegment(timestamp);
+    }
+  }
+
+  int32_t cts = (int32_t)((data[2] << 16) | (data[3] << 8) | data[4]);
+  if (cts & 0x800000) {
+    cts |= 0xff000000;  // 24 位有符号数
+  }
+
+  // AVCC 格式的帧和 avcC 一致, 直接作为样本数据
+  Fmp4Muxer::Sample sample;
+  sample.offset = (uint32_t)video_data_.size();
+  sample.size = size - 5;
+  sample.composition_offset = cts * 90;
+  sample.key_frame = key_frame;
+  video_samples_.push_back(sample);
+  video_times_.push_back(timestamp);
+  video_data_.append((const char *)data + 5, size - 5);
+}
+
+void RtmpLlHls::WriteAudio(uint64_t timestamp, const uint8_t *data, uint32_t size) {
+  if (!has_segment_) {
+    if (!avc_config_.empty()) {  // 有视频时等关键帧打开分片
+      return;
+    }
+    OpenSegment(timestamp);
+  } else if (avc_config_.empty()) {
+    bool new_segment = timestamp >= segment_start_ + segment_ms_;
+    if (new_segment || timestamp >= part_start_ + part_ms_) {
+      CutPart(0, timestamp);
+    }
+    if (new_segment) {
+      CloseSegment(timestamp);
+      OpenSegment(timestamp);
+    }
+  }
+
+  if (init_aac_config_.empty()) {  // 初始化段中没有音频轨道
+    return;
+  }
+
+  Fmp4Muxer::Sample sample;
+  sample.offset = (uint32_t)audio_data_.size();
+  sample.size = size - 2;
+  sample.duration = Fmp4Muxer::kAacFrameSamples;
+  audio_samples_.push_back(sample);
+  audio_times_.push_back(timestamp);
+  audio_data_.append((const char *)data + 2, size - 2);
+}
+
+void RtmpLlHls::CutPart(size_t video_count, uint64_t end) {
+  size_t audio_count = 0;
+  while (audio_count < audio_times_.size() && audio_times_[audio_count] < end) {
+    audio_count++;
+  }
+  if (video_count == 0 && audio_count == 0) {
+    return;
+  }
+
+  std::vector<Fmp4Muxer::Sample> video(video_samples_.begin(),
+                                       video_samples_.begin() + video_count);
+  std::vector<Fmp4Muxer::Sample> audio(audio_samples_.begin(),
+                                       audio_samples_.begin() + audio_count);
+  Fmp4Muxer::Track video_track;
+  video_track.samples = &video;
+  video_track.data = video_data_.data();
+  if (video_count > 0) {
+    video_track.base_time = video_times_[0] * Fmp4Muxer::kVideoTimescale / 1000;
+  }
+  Fmp4Muxer::Track audio_track;
+  audio_track.samples = &audio;
+  audio_track.data = audio_data_.data();
+  if (audio_count > 0) {
+    audio_track.base_time = audio_times_[0] * audio_sample_rate_ / 1000;
+  }
+
+  std::string fragment;
+  Fmp4Muxer::WriteFragment(fragment, next_fragment_++, video_track, audio_track);
+
+  Part part;
+  part.size = (uint32_t)fragment.size();
+  part.data = ToShared(std::move(fragment));
+  part.duration_ms = (uint32_t)(end > part_start_ ? end - part_start_ : 0);
+  part.independent = video_count > 0 ? video[0].key_frame : true;
+  part_start_ = end;
+
+  Consume(video_samples_, video_times_, video_data_, video_count);
+  Consume(audio_samples_, audio_times_, audio_data_, audio_count);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!segments_.empty() && !segments_.back().complete) {
+      segments_.back().parts.push_back(part);
+    }
+    UpdatePlaylist();
+  }
+  Notify();
+}
+
+void RtmpLlHls::OpenSegment(uint64_t timestamp) {
+  has_segment_ = true;
+  segment_start_ = timestamp;
+  part_start_ = timestamp;
+
+  Segment segment;
+  segment.sequence = next_sequence_++;
+
+  // 编码参数改变后重新生成初始化段
+  std::shared_ptr<char> init;
+  uint32_t init_size = 0;
+  if (init_avc_config_ != avc_config_ || init_aac_config_ != aac_config_ || init_size_ == 0) {
+    init_avc_config_ = avc_config_;
+    init_aac_config_ = aac_config_;
+    std::string data;
+    Fmp4Muxer::WriteInit(data, init_avc_config_, init_aac_config_);
+    init_size = (uint32_t)data.size();
+    init = ToShared(std::move(data));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (init) {
+    init_ = init;
+    init_size_ = init_size;
+  }
+  segments_.push_back(segment);
+  UpdatePlaylist();  // 预加载提示指向新分片
+}
+
+void RtmpLlHls::CloseSegment(uint64_t timestamp) {
+  if (!has_segment_) {
+    return;
+  }
+  has_segment_ = false;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!segments_.empty() && !segments_.back().complete) {
+      segments_.back().complete = true;
+      segments_.back().duration_ms =
+          (uint32_t)(timestamp > segment_start_ ? timestamp - segment_start_ : 0);
+    }
+    while (segments_.size() > list_size_) {
+      segments_.pop_front();
+    }
+    UpdatePlaylist();
+  }
+  Notify();
+}
+
+void RtmpLlHls::Flush() {
+  if (!has_segment_) {
+    return;
+  }
+
+  // 最后一个视频帧的时长未知, 按前一帧估算, 没有时按 40ms
+  uint64_t end = part_start_;
+  if (!video_samples_.empty()) {
+    size_t count = video_samples_.size();
+    uint32_t duration = count > 1 ? video_samples_[count - 2].duration : 40 * 90;
+    video_samples_.back().duration = duration;
+    end = std::max(end, video_times_.back() + duration / 90);
+  }
+  if (!audio_times_.empty() && audio_sample_rate_ > 0) {
+    end = std::max(end, audio_times_.back() + Fmp4Muxer::kAacFrameSamples * 1000 /
+                                                  audio_sample_rate_ + 1);
+  }
+
+  CutPart(video_samples_.size(), end);
+  CloseSegment(end);
+  Consume(video_samples_, video_times_, video_data_, video_samples_.size());
+  Consume(audio_samples_, audio_times_, audio_data_, audio_samples_.size());
+}
+
+void RtmpLlHls::Reset() {
+  has_segment_ = false;
+  avc_config_.clear();
+  aac_config_.clear();
+  init_avc_config_.clear();
+  init_aac_config_.clear();
+  audio_sample_rate_ = 0;
+  video_samples_.clear();
+  video_times_.clear();
+  video_data_.clear();
+  audio_samples_.clear();
+  audio_times_.clear();
+  audio_data_.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    segments_.clear();
+    init_ = nullptr;
+    init_size_ = 0;
+    playlist_ = nullptr;
+    playlist_size_ = 0;
+  }
+  Notify();  // 正在发送的分片结束
+}
+
+void RtmpLlHls::UpdatePlaylist() {
+  bool has_part = false;
+  uint32_t target = (segment_ms_ + 999) / 1000;
+  for (auto &segment : segments_) {
+    has_part = has_part || !segment.parts.empty();
+    target = std::max(target, (segment.duration_ms + 999) / 1000);
+  }
+  target_duration_ = std::max(target, 1u);
+  if (!has_part) {
+    playlist_ = nullptr;
+    playlist_size_ = 0;
+    return;
+  }
+
+  char line[256];
+  std::string playlist;
+  playlist.reserve(256 + segments_.size() * (segment_ms_ / part_ms_ + 1) * (name_.size() + 64));
+  playlist += "#EXTM3U\n#EXT-X-VERSION:9\n";
+  playlist += "#EXT-X-TARGETDURATION:" + std::to_string(target_duration_) + "\n";
+  snprintf(line, sizeof(line),
+           "#EXT-X-PART-INF:PART-TARGET=%.3f\n"
+           "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=%.3f\n",
+           part_ms_ / 1000.0, part_ms_ * 3 / 1000.0);
+  playlist += line;
+  playlist += "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(segments_.front().sequence) + "\n";
+  playlist += "#EXT-X-MAP:URI=\"" + name_ + "-init.mp4\"\n";
+
+  // 只有最近的几个分片列出部分分片, 更早的分片播放器按完整分片请求
+  uint64_t current = segments_.back().sequence;
+  for (auto &segment : segments_) {
+    if (segment.sequence + 2 >= current) {
+      for (size_t i = 0; i < segment.parts.size(); i++) {
+        snprintf(line, sizeof(line), "#EXT-X-PART:DURATION=%.3f,URI=\"%s-%llu.%zu.m4s\"%s\n",
+                 segment.parts[i].duration_ms / 1000.0, name_.c_str(),
+                 (unsigned long long)segment.sequence, i,
+                 segment.parts[i].independent ? ",INDEPENDENT=YES" : "");
+        playlist += line;
+      }
+    }
+    if (segment.complete) {
+      snprintf(line, sizeof(line), "#EXTINF:%.3f,\n", segment.duration_ms / 1000.0);
+      playlist += line;
+      playlist += name_ + "-" + std::to_string(segment.sequence) + ".m4s\n";
+    }
+  }
+
+  const Segment &last = segments_.back();
+  if (!last.complete) {
+    snprintf(line, sizeof(line), "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s-%llu.%zu.m4s\"\n",
+             name_.c_str(), (unsigned long long)last.sequence, last.parts.size());
+    playlist += line;
+  }
+
+  playlist_size_ = (uint32_t)playlist.size();
+  playlist_ = ToShared(std::move(playlist));
+}
+
+const RtmpLlHls::Segment *RtmpLlHls::FindSegment(uint64_t sequence) const {
+  if (segments_.empty() || sequence < segments_.front().sequence ||
+      sequence > segments_.back().sequence) {
+    return nullptr;
+  }
+  return &segments_[sequence - segments_.front().sequence];
+}
+
+bool RtmpLlHls::HasPart(uint64_t sequence, int64_t part) const {
+  if (segments_.empty()) {
+    return false;
+  }
+  if (sequence < segments_.front().sequence) {
+    return true;
+  }
+  const Segment *segment = FindSegment(sequence);
+  if (segment == nullptr) {
+    return false;
+  }
+  return segment->complete || (part >= 0 && (int64_t)segment->parts.size() > part);
+}
+
+bool RtmpLlHls::GetPlaylist(std::shared_ptr<char> &data, uint32_t &size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!playlist_) {
+    return false;
+  }
+  data = playlist_;
+  size = playlist_size_;
+  return true;
+}
+
+bool RtmpLlHls::GetInit(std::shared_ptr<char> &data, uint32_t &size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!init_) {
+    return false;
+  }
+  data = init_;
+  size = init_size_;
+  return true;
+}
+
+void RtmpLlHls::WaitFor(std::shared_ptr<HttpResponder> responder,
+                        const std::function<bool()> &attempt, uint32_t timeout_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (attempt()) {
+    return;
+  }
+
+  // 顺便清理已经超时的请求
+  watchers_.erase(std::remove_if(watchers_.begin(), watchers_.end(),
+                                 [](const Watcher &watcher) {
+                                   return watcher.responder->IsDone();
+                                 }),
+                  watchers_.end());
+
+  Watcher watcher;
+  watcher.responder = responder;
+  watcher.callback = [this, attempt] {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return attempt();
+  };
+  watchers_.push_back(watcher);
+
+  if (timeout_ms > 0) {
+    responder->SetTimeout(timeout_ms, MakeError(503));
+  }
+}
+
+void RtmpLlHls::Notify() {
+  std::vector<Watcher> watchers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (watchers_.empty()) {
+      return;
+    }
+    watchers.swap(watchers_);
+  }
+
+  std::vector<Watcher> waiting;
+  for (auto &watcher : watchers) {
+    if (!watcher.responder->IsDone() && !watcher.callback()) {
+      waiting.push_back(std::move(watcher));
+    }
+  }
+
+  if (!waiting.empty()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    watchers_.insert(watchers_.end(), std::make_move_iterator(waiting.begin()),
+                     std::make_move_iterator(waiting.end()));
+  }
+}
+
+void RtmpLlHls::Serve(const std::string &file, const HttpRequest &request,
+                      std::shared_ptr<HttpResponder> responder) {
+  if (file == name_ + ".m3u8") {
+    ServePlaylist(request, responder);
+    return;
+  }
+
+  if (file == name_ + "-init.mp4") {
+    std::shared_ptr<char> data;
+    uint32_t size = 0;
+    if (!GetInit(data, size)) {
+      responder->Send(MakeError(404));
+      return;
+    }
+    HttpResponse response = MakeResponse("video/mp4", "no-cache");
+    response.AddData(data, size);
+    responder->Send(response);
+    return;
+  }
+
+  // name-N.m4s 或 name-N.P.m4s
+  std::string prefix = name_ + "-";
+  if (file.size() <= prefix.size() + 4 || file.compare(0, prefix.size(), prefix) != 0 ||
+      file.compare(file.size() - 4, 4, ".m4s") != 0) {
+    responder->Send(MakeError(404));
+    return;
+  }
+
+  const char *begin = file.c_str() + prefix.size();
+  char *end = nullptr;
+  uint64_t sequence = strtoull(begin, &end, 10);
+  if (end == begin) {
+    responder->Send(MakeError(404));
+  } else if (*end == '.' && end[1] != 'm') {
+    ServePart(sequence, (uint32_t)strtoul(end + 1, nullptr, 10), responder);
+  } else {
+    ServeSegment(sequence, responder);
+  }
+}
+
+void RtmpLlHls::ServePlaylist(const HttpRequest &request,
+                              std::shared_ptr<HttpResponder> responder) {
+  std::string msn = request.GetQuery("_HLS_msn");
+  std::string part = request.GetQuery("_HLS_part");
+  uint64_t sequence = strtoull(msn.c_str(), nullptr, 10);
+  int64_t part_index = part.empty() ? -1 : strtoll(part.c_str(), nullptr, 10);
+  bool blocking = !msn.empty();
+
+  // 阻塞请求等到播放列表包含指定的部分分片, 请求太靠后的分片返回 400
+  auto attempt = [this, responder, blocking, sequence, part_index] {
+    if (blocking && !segments_.empty() && sequence > segments_.back().sequence + 2) {
+      responder->Send(MakeError(400));
+      return true;
+    }
+    if (blocking && !HasPart(sequence, part_index)) {
+      return false;
+    }
+    if (!playlist_) {
+      responder->Send(MakeError(404));
+      return true;
+    }
+    HttpResponse response = MakeResponse("application/vnd.apple.mpegurl", "no-cache");
+    response.AddData(playlist_, playlist_size_);
+    responder->Send(response);
+    return true;
+  };
+
+  uint32_t timeout_ms = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timeout_ms = target_duration_ * 3000;
+  }
+  WaitFor(responder, attempt, timeout_ms);
+}
+
+void RtmpLlHls::ServeSegment(uint64_t sequence, std::shared_ptr<HttpResponder> responder) {
+  // 已经完成的分片由部分分片拼成一次发送; 正在写的分片用 chunked 编码, 每生成一个部分分片发送一个
+  auto sent = std::make_shared<size_t>(0);
+  auto begun = std::make_shared<bool>(false);
+  std::string cache_control =
+      "public, max-age=" + std::to_string((uint64_t)segment_ms_ * list_size_ * 2 / 1000 + 1);
+
+  auto attempt = [this, responder, sequence, sent, begun, cache_control] {
+    const Segment *segment = FindSegment(sequence);
+    if (segment == nullptr) {
+      // 发送过程中推流端重新开始, 已经发送的部分作为完整的响应结束
+      if (*begun) {
+        responder->EndChunked();
+      } else {
+        responder->Send(MakeError(404));
+      }
+      return true;
+    }
+
+    if (!*begun) {
+      HttpResponse response = MakeResponse("video/mp4", cache_control);
+      for (auto &part : segment->parts) {
+        response.AddData(part.data, part.size);
+      }
+      if (segment->complete) {
+        responder->Send(response);
+        return true;
+      }
+      response.headers["Cache-Control"] = "no-cache";
+      responder->BeginChunked(response);
+      *begun = true;
+    } else {
+      for (size_t i = *sent; i < segment->parts.size(); i++) {
+        responder->SendChunk(segment->parts[i].data, segment->parts[i].size);
+      }
+    }
+    *sent = segment->parts.size();
+
+    if (segment->complete) {
+      responder->EndChunked();
+      return true;
+    }
+    return false;
+  };
+
+  // 推流端停顿但没有结束推流时, 超时结束已经开始的 chunked 响应, 后面的流水线请求继续处理
+  uint32_t timeout_ms = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timeout_ms = target_duration_ * 3000;
+  }
+  WaitFor(responder, attempt, timeout_ms);
+}
+
+void RtmpLlHls::ServePart(uint64_t sequence, uint32_t part,
+                          std::shared_ptr<HttpResponder> responder) {
+  std::string cache_control =
+      "public, max-age=" + std::to_string((uint64_t)segment_ms_ * list_size_ * 2 / 1000 + 1);
+
+  // 预加载提示的部分分片 (当前分片的下一个或者下一个分片的第一个) 等到生成后响应
+  auto attempt = [this, responder, sequence, part, cache_control] {
+    const Segment *segment = FindSegment(sequence);
+    if (segment != nullptr && segment->parts.size() > part) {
+      HttpResponse response = MakeResponse("video/mp4", cache_control);
+      response.AddData(segment->parts[part].data, segment->parts[part].size);
+      responder->Send(response);
+      return true;
+    }
+
+    bool hinted = false;
+    if (segment != nullptr) {
+      hinted = !segment->complete && segment->parts.size() == part;
+    } else if (!segments_.empty()) {
+      hinted = sequence == segments_.back().sequence + 1 && part == 0;
+    }
+    if (!hinted) {
+      responder->Send(MakeError(404));
+      return true;
+    }
+    return false;
+  };
+
+  uint32_t timeout_ms = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timeout_ms = target_duration_ * 3000;
+  }
+  WaitFor(responder, attempt, timeout_ms);
+}
+
+void RtmpLlHls::RegisterRoutes(HttpServer &http_server, std::shared_ptr<RtmpServer> server) {
+  std::weak_ptr<RtmpServer> weak_server = server;
+
+  http_server.AddAsyncPrefixRoute("/ll/", [weak_server](const HttpRequest &request,
+                                                        std::shared_ptr<HttpResponder> responder) {
+    // /ll/app/stream.m3u8 和 /ll/app/stream-12.3.m4s 都对应流路径 /app/stream
+    std::string path = request.path.substr(3);
+    size_t slash = path.rfind('/');
+    std::string file = path.substr(slash + 1);
+    std::string stream_name;
+    if (file.size() > 5 && file.compare(file.size() - 5, 5, ".m3u8") == 0) {
+      stream_name = file.substr(0, file.size() - 5);
+    } else if (file.rfind('-') != std::string::npos) {
+      stream_name = file.substr(0, file.rfind('-'));
+    }
+
+    auto server = weak_server.lock();
+    if (stream_name.empty() || !server) {
+      responder->Send(MakeError(404));
+      return;
+    }
+
+    std::shared_ptr<RtmpLlHls> hls;
+    auto session = server->FindSession(path.substr(0, slash + 1) + stream_name);
+    if (session) {
+      hls = session->GetLlHls();
+    }
+    if (!hls) {
+      responder->Send(MakeError(404));
+      return;
+    }
+    hls->Serve(file, request, responder);
+  });
+}
@@ -0,0 +1,150 @@
+/// @file RtmpLlHls.h
+/// @brief 每个流会话一个低延迟 HLS 分片器: 推流线程把 AVC/AAC 帧封装成 CMAF 分片 MP4,
+///        每 part_ms 切出一个部分分片 (part), 在关键帧处切分片, 最近 N 个分片保存在内存中
+///        部分分片只封装一次, 所有观看端引用计数共享; 分片由它的部分分片拼成, 发送不拷贝
+///        支持阻塞的播放列表请求 (_HLS_msn/_HLS_part), 预加载提示的部分分片在生成后立即响应,
+///        正在写的分片用 chunked 编码边生成边发送 (LL-DASH 风格的观看端也可以直接使用)
+///        播放地址: http://ip:port/ll/app/stream.m3u8, 初始化段: /ll/app/stream-init.mp4,
+///        分片: /ll/app/stream-<序号>.m4s, 部分分片: /ll/app/stream-<序号>.<部分序号>.m4s
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_LL_HLS_H
+#define RTMP_SERVER_RTMP_LL_HLS_H
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Fmp4Muxer.h"
+
+class HttpServer;
+class HttpResponder;
+class RtmpServer;
+struct HttpRequest;
+struct HttpResponse;
+
+class RtmpLlHls {
+ public:
+  // name: 文件名前缀, 即流名; segment_ms: 目标分片时长; part_ms: 部分分片时长;
+  // list_size: 播放列表中完整分片的个数
+  RtmpLlHls(const std::string &name, uint32_t segment_ms, uint32_t part_ms, uint32_t list_size);
+  RtmpLlHls(const RtmpLlHls &) = delete;
+  RtmpLlHls &operator=(const RtmpLlHls &) = delete;
+
+  /* 以下函数由 session 在推流线程中调用 */
+
+  // type: RTMP_AUDIO, RTMP_VIDEO, RTMP_AVC_SEQUENCE_HEADER 或 RTMP_AAC_SEQUENCE_HEADER
+  void OnMedia(uint8_t type, uint64_t timestamp, const char *data, uint32_t size);
+
+  // 推流结束, 剩余的帧切成最后一个部分分片, 当前分片放入播放列表
+  void Flush();
+
+  // 新的推流端开始推流, 丢弃已有分片和编码参数, 分片序号继续递增
+  void Reset();
+
+  /* 以下函数由 HTTP 线程调用 */
+
+  // 还没有部分分片时返回 false
+  bool GetPlaylist(std::shared_ptr<char> &data, uint32_t &size);
+
+  bool GetInit(std::shared_ptr<char> &data, uint32_t &size);
+
+  // 处理 name.m3u8, name-init.mp4, name-N.m4s 和 name-N.P.m4s 的请求, 数据还没有生成时等待,
+  // 必须在 HTTP 连接的线程中调用 (异步路由的处理函数中)
+  void Serve(const std::string &file, const HttpRequest &request,
+             std::shared_ptr<HttpResponder> responder);
+
+  uint32_t GetSegmentMs() const { return segment_ms_; }
+  uint32_t GetPartMs() const { return part_ms_; }
+
+  // 注册 /ll/app/stream.m3u8 等路径, 以异步前缀路由匹配所有流
+  static void RegisterRoutes(HttpServer &http_server, std::shared_ptr<RtmpServer> server);
+
+ private:
+  struct Part {
+    std::shared_ptr<char> data;  // moof + mdat, 完成后不再修改
+    uint32_t size = 0;
+    uint32_t duration_ms = 0;
+    bool independent = false;  // 以关键帧开始
+  };
+
+  struct Segment {
+    uint64_t sequence = 0;
+    uint32_t duration_ms = 0;
+    std::vector<Part> parts;
+    bool complete = false;
+  };
+
+  // 等待数据生成的请求, callback 返回 true 表示已经响应, 在推流线程中不持有 mutex_ 调用
+  struct Watcher {
+    std::shared_ptr<HttpResponder> responder;
+    std::function<bool()> callback;
+  };
+
+  void WriteVideo(uint64_t timestamp, const uint8_t *data, uint32_t size, bool key_frame);
+  void WriteAudio(uint64_t timestamp, const uint8_t *data, uint32_t size);
+
+  // 前 video_count 个视频帧和 end 之前的音频帧封装成一个部分分片
+  void CutPart(size_t video_count, uint64_t end);
+  void OpenSegment(uint64_t timestamp);
+  void CloseSegment(uint64_t timestamp);
+
+  // attempt 在持有 mutex_ 时调用, 返回 true 表示已经响应; 否则在数据更新时再次尝试,
+  // timeout_ms 不为 0 时超时返回 503, 已经开始 chunked 响应时结束响应
+  void WaitFor(std::shared_ptr<HttpResponder> responder, const std::function<bool()> &attempt,
+               uint32_t timeout_ms);
+
+  // 唤醒等待的请求
+  void Notify();
+
+  void ServePlaylist(const HttpRequest &request, std::shared_ptr<HttpResponder> responder);
+  void ServeSegment(uint64_t sequence, std::shared_ptr<HttpResponder> responder);
+  void ServePart(uint64_t sequence, uint32_t part, std::shared_ptr<HttpResponder> responder);
+
+  /* 以下函数需持有 mutex_ */
+  void UpdatePlaylist();
+  const Segment *FindSegment(uint64_t sequence) const;
+
+  // 播放列表已经包含分片 sequence 的第 part 个部分分片 (part < 0 时为整个分片)
+  bool HasPart(uint64_t sequence, int64_t part) const;
+
+  const std::string name_;
+  const uint32_t segment_ms_;
+  const uint32_t part_ms_;
+  const uint32_t list_size_;
+
+  // 只在推流线程访问
+  std::string avc_config_;
+  std::string aac_config_;
+  std::string init_avc_config_;  // 当前初始化段对应的编码参数
+  std::string init_aac_config_;
+  uint32_t audio_sample_rate_ = 0;
+  bool has_segment_ = false;
+  uint64_t segment_start_ = 0;
+  uint64_t part_start_ = 0;
+  uint64_t next_sequence_ = 0;
+  uint32_t next_fragment_ = 1;  // mfhd 序号
+  std::vector<Fmp4Muxer::Sample> video_samples_;  // 最后一个视频帧的时长在下一帧到达时确定
+  std::vector<uint64_t> video_times_;
+  std::string video_data_;
+  std::vector<Fmp4Muxer::Sample> audio_samples_;
+  std::vector<uint64_t> audio_times_;
+  std::string audio_data_;
+
+  std::mutex mutex_;  // 保护以下成员
+  std::deque<Segment> segments_;  // 最后一个可能还在写
+  std::shared_ptr<char> init_;
+  uint32_t init_size_ = 0;
+  std::shared_ptr<char> playlist_;
+  uint32_t playlist_size_ = 0;
+  uint32_t target_duration_ = 1;
+  std::vector<Watcher> watchers_;
+};
+
+#endif  // RTMP_SERVER_RTMP_LL_HLS_H
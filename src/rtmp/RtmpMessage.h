@@ -10,6 +10,8 @@
 #include <cstdint>
 #include <memory>
 
+#include "FrameTrace.h"
+
 /// chunk header: basic header + rtmp message header + extend message timestamp
 /// 依据 chunk type (basic header 中 fmt字段) 不同, 分成 4 种类型
 ///   type-0(11 Byte):
@@ -81,6 +83,8 @@ struct RtmpMessage {
   std::shared_ptr<char> payload = nullptr;  // 消息有效负载, 存实际数据
   uint32_t index = 0;  // payload 的当前正处理的下标
 
+  std::shared_ptr<FrameTrace> trace;  // 被采样的音视频帧才有, 记录各阶段时间戳
+
   void Clear() {
     index = 0;
     timestamp_delta = 0;
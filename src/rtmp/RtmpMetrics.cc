@@ -0,0 +1,515 @@
+/// @file RtmpMetrics.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpMetrics.h"
+
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "HttpServer.h"
+#include "Logger.h"
+#include "RtmpConnection.h"
+#include "RtmpServer.h"
+
+namespace {
+
+struct StreamSnapshot {
+  std::string path;
+  uint64_t bytes_in = 0;
+  uint64_t video_frames = 0;
+  uint64_t audio_frames = 0;
+  uint64_t bitrate_bps = 0;
+  uint32_t fps = 0;
+  uint32_t gop_frames = 0;
+  uint32_t subscribers = 0;
+  std::shared_ptr<const StreamLatency> latency;  // 未开启帧采样时为空
+};
+
+// 帧延迟的各阶段, 对应 StreamLatency 中的直方图
+struct LatencyStage {
+  const char *name;
+  const LatencyHistogram StreamLatency::*field;
+};
+
+const LatencyStage kLatencyStages[] = {
+    {"parse", &StreamLatency::parse_ns},  {"dispatch", &StreamLatency::dispatch_ns},
+    {"queue", &StreamLatency::queue_ns},  {"send", &StreamLatency::send_ns},
+    {"total", &StreamLatency::total_ns},
+};
+
+// 起播耗时的各阶段, 对应 StartupLatency 中的直方图
+struct StartupStage {
+  const char *name;
+  LatencyHistogram StartupLatency::*field;
+};
+
+const StartupStage kStartupStages[] = {
+    {"handshake", &StartupLatency::handshake_ns},
+    {"connect", &StartupLatency::connect_ns},
+    {"create_stream", &StartupLatency::create_stream_ns},
+    {"play", &StartupLatency::play_ns},
+    {"sequence_header", &StartupLatency::sequence_header_ns},
+    {"first_keyframe", &StartupLatency::first_keyframe_ns},
+    {"total", &StartupLatency::total_ns},
+};
+
+const size_t kStartupStageCount = sizeof(kStartupStages) / sizeof(kStartupStages[0]);
+
+struct StartupSnapshot {
+  std::string app;
+  LatencyHistogram::Snapshot stages[kStartupStageCount];
+  LatencyHistogram::Snapshot gop_burst_bytes;
+};
+
+struct ConnectionSnapshot {
+  uint32_t id = 0;
+  std::string stream;
+  const char *role = "";
+  uint64_t bytes_in = 0;
+  uint64_t bytes_out = 0;
+  uint64_t queued_bytes = 0;
+  uint64_t dropped_packets = 0;
+  uint64_t dropped_frames = 0;
+};
+
+struct SchedulerSnapshot {
+  int id = 0;
+  uint64_t loop_iterations = 0;
+  int trigger_queue_depth = 0;
+  int connections = 0;
+  LatencyHistogram::Snapshot trigger_ns;
+  LatencyHistogram::Snapshot timer_ns;
+  LatencyHistogram::Snapshot io_ns;
+  LatencyHistogram::Snapshot trigger_lag_ns;
+  LatencyHistogram::Snapshot triggers;
+  LatencyHistogram::Snapshot io_events;
+};
+
+// 导出的直方图: 名称, 说明, 数值缩放 (纳秒转秒), 取 SchedulerSnapshot 中的字段
+struct HistogramMetric {
+  const char *name;
+  const char *help;
+  double scale;
+  LatencyHistogram::Snapshot SchedulerSnapshot::*field;
+};
+
+const HistogramMetric kSchedulerHistograms[] = {
+    {"rtmp_scheduler_trigger_seconds", "Time spent running trigger events per loop iteration.",
+     1e-9, &SchedulerSnapshot::trigger_ns},
+    {"rtmp_scheduler_timer_seconds", "Time spent running timers per loop iteration.", 1e-9,
+     &SchedulerSnapshot::timer_ns},
+    {"rtmp_scheduler_io_seconds", "Time spent dispatching I/O events per loop iteration.", 1e-9,
+     &SchedulerSnapshot::io_ns},
+    {"rtmp_scheduler_trigger_lag_seconds", "Delay between posting a trigger event and running it.",
+     1e-9, &SchedulerSnapshot::trigger_lag_ns},
+    {"rtmp_scheduler_triggers_per_iteration", "Trigger events run per loop iteration.", 1,
+     &SchedulerSnapshot::triggers},
+    {"rtmp_scheduler_io_events_per_iteration", "I/O events handled per loop iteration.", 1,
+     &SchedulerSnapshot::io_events},
+};
+
+const double kQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+struct Snapshot {
+  std::vector<StreamSnapshot> streams;
+  std::vector<ConnectionSnapshot> connections;
+  std::vector<SchedulerSnapshot> schedulers;
+  std::vector<StartupSnapshot> startups;
+  uint64_t connections_accepted = 0;
+  uint64_t connections_closed = 0;
+  uint64_t bytes_in = 0;
+  uint64_t bytes_out = 0;
+  uint64_t handshakes = 0;
+  uint64_t events_dropped = 0;
+  uint64_t logs_dropped = 0;
+};
+
+uint64_t Load(const std::atomic<uint64_t> &value) {
+  return value.load(std::memory_order_relaxed);
+}
+
+void Collect(RtmpServer &server, Snapshot &snapshot) {
+  server.ForEachSession([&snapshot](const std::string &path, const RtmpSession::Ptr &session) {
+    const StreamStats &stats = session->GetStats();
+    StreamSnapshot stream;
+    stream.path = path;
+    stream.bytes_in = Load(stats.bytes_in);
+    stream.video_frames = Load(stats.video_frames);
+    stream.audio_frames = Load(stats.audio_frames);
+    stream.bitrate_bps = stats.GetBitrate();
+    stream.fps = stats.GetFps();
+    stream.gop_frames = stats.gop_frames.load(std::memory_order_relaxed);
+    stream.subscribers = stats.subscribers.load(std::memory_order_relaxed);
+    stream.latency = session->GetLatency();
+    snapshot.streams.push_back(stream);
+
+    session->ForEachConn(
+        [&snapshot, &path](const std::shared_ptr<RtmpConnection> &conn, bool is_publisher) {
+          const ConnectionStats &stats = conn->GetStats();
+          ConnectionSnapshot c;
+          c.id = conn->GetId();
+          c.stream = path;
+          c.role = is_publisher ? "publisher" : "player";
+          c.bytes_in = Load(stats.bytes_in);
+          c.bytes_out = Load(stats.bytes_out);
+          c.queued_bytes = Load(stats.queued_bytes);
+          c.dropped_packets = Load(stats.dropped_packets);
+          c.dropped_frames = Load(stats.dropped_frames);
+          snapshot.connections.push_back(c);
+        });
+  });
+
+  for (auto &scheduler : server.GetEventLoop()->GetTaskSchedulers()) {
+    SchedulerSnapshot s;
+    s.id = scheduler->GetId();
+    s.loop_iterations = scheduler->GetLoopIterations();
+    s.trigger_queue_depth = scheduler->GetTriggerQueueDepth();
+    s.connections = scheduler->GetConnectionsNum();
+    const SchedulerStats &stats = scheduler->GetStats();
+    s.trigger_ns = stats.trigger_ns.GetSnapshot();
+    s.timer_ns = stats.timer_ns.GetSnapshot();
+    s.io_ns = stats.io_ns.GetSnapshot();
+    s.trigger_lag_ns = stats.trigger_lag_ns.GetSnapshot();
+    s.triggers = stats.triggers.GetSnapshot();
+    s.io_events = stats.io_events.GetSnapshot();
+    snapshot.schedulers.push_back(std::move(s));
+  }
+
+  server.ForEachStartupStats([&snapshot](const std::string &app, const StartupLatency &latency) {
+    StartupSnapshot s;
+    s.app = app;
+    for (size_t i = 0; i < kStartupStageCount; i++) {
+      s.stages[i] = (latency.*kStartupStages[i].field).GetSnapshot();
+    }
+    s.gop_burst_bytes = latency.gop_burst_bytes.GetSnapshot();
+    snapshot.startups.push_back(std::move(s));
+  });
+
+  GlobalMetrics &global = GlobalMetrics::Instance();
+  snapshot.connections_accepted = global.connections_accepted.Value();
+  snapshot.connections_closed = global.connections_closed.Value();
+  snapshot.bytes_in = global.bytes_in.Value();
+  snapshot.bytes_out = global.bytes_out.Value();
+  snapshot.handshakes = global.handshakes.Value();
+  snapshot.events_dropped = server.GetDroppedEvents();
+  snapshot.logs_dropped = Logger::Instance().GetDroppedLogs();
+}
+
+// Prometheus 标签值和 JSON 字符串都需要转义反斜杠, 双引号和换行
+std::string Escape(const std::string &str) {
+  std::string out;
+  out.reserve(str.size());
+  for (char c : str) {
+    if (c == '\\' || c == '"') {
+      out += '\\';
+      out += c;
+    } else if (c == '\n') {
+      out += "\\n";
+    } else if ((unsigned char)c < 0x20) {
+      continue;
+    } else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+class Writer {
+ public:
+  // 先格式化到栈上的缓冲区, 一行放不下时按需要的长度直接格式化到 out_ 的末尾, 长的流名不会被截断.
+  // out_ 只增长到实际的长度, 不填充预留的空间
+  void Printf(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[512];
+    va_list args;
+    va_start(args, fmt);
+    int size = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    if (size < 0) {
+      return;
+    }
+    if ((size_t)size < sizeof(buf)) {
+      out_.append(buf, size);
+      return;
+    }
+
+    size_t offset = out_.size();
+    out_.resize(offset + size);
+    va_start(args, fmt);
+    vsnprintf(&out_[offset], size + 1, fmt, args);
+    va_end(args);
+  }
+
+  // Prometheus 指标的 HELP 和 TYPE 行
+  void Header(const char *name, const char *type, const char *help) {
+    Printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+  }
+
+  std::string &Str() { return out_; }
+
+ private:
+  std::string out_;
+};
+
+}  // namespace
+
+std::string RtmpMetrics::RenderPrometheus(RtmpServer &server) {
+  Snapshot snapshot;
+  Collect(server, snapshot);
+  Writer w;
+
+  w.Header("rtmp_connections_accepted_total", "counter", "Accepted TCP connections.");
+  w.Printf("rtmp_connections_accepted_total %" PRIu64 "\n", snapshot.connections_accepted);
+  w.Header("rtmp_connections_closed_total", "counter", "Closed TCP connections.");
+  w.Printf("rtmp_connections_closed_total %" PRIu64 "\n", snapshot.connections_closed);
+  w.Header("rtmp_handshakes_total", "counter", "Completed RTMP handshakes.");
+  w.Printf("rtmp_handshakes_total %" PRIu64 "\n", snapshot.handshakes);
+  w.Header("rtmp_bytes_in_total", "counter", "Bytes received on all connections.");
+  w.Printf("rtmp_bytes_in_total %" PRIu64 "\n", snapshot.bytes_in);
+  w.Header("rtmp_bytes_out_total", "counter", "Bytes sent on all connections.");
+  w.Printf("rtmp_bytes_out_total %" PRIu64 "\n", snapshot.bytes_out);
+  w.Header("rtmp_events_dropped_total", "counter", "Server events dropped by a full queue.");
+  w.Printf("rtmp_events_dropped_total %" PRIu64 "\n", snapshot.events_dropped);
+  w.Header("rtmp_logs_dropped_total", "counter", "Log lines dropped by a full log ring.");
+  w.Printf("rtmp_logs_dropped_total %" PRIu64 "\n", snapshot.logs_dropped);
+
+  w.Header("rtmp_stream_ingest_bitrate_bps", "gauge", "Ingest bitrate over the last second.");
+  for (auto &s : snapshot.streams) {
+    w.Printf("rtmp_stream_ingest_bitrate_bps{stream=\"%s\"} %" PRIu64 "\n",
+             Escape(s.path).c_str(), s.bitrate_bps);
+  }
+  w.Header("rtmp_stream_fps", "gauge", "Video frames over the last second.");
+  for (auto &s : snapshot.streams) {
+    w.Printf("rtmp_stream_fps{stream=\"%s\"} %u\n", Escape(s.path).c_str(), s.fps);
+  }
+  w.Header("rtmp_stream_gop_frames", "gauge", "Video frames in the last complete GOP.");
+  for (auto &s : snapshot.streams) {
+    w.Printf("rtmp_stream_gop_frames{stream=\"%s\"} %u\n", Escape(s.path).c_str(), s.gop_frames);
+  }
+  w.Header("rtmp_stream_subscribers", "gauge", "Players attached to the stream.");
+  for (auto &s : snapshot.streams) {
+    w.Printf("rtmp_stream_subscribers{stream=\"%s\"} %u\n", Escape(s.path).c_str(),
+             s.subscribers);
+  }
+  w.Header("rtmp_stream_bytes_in_total", "counter", "Media bytes received for the stream.");
+  for (auto &s : snapshot.streams) {
+    w.Printf("rtmp_stream_bytes_in_total{stream=\"%s\"} %" PRIu64 "\n", Escape(s.path).c_str(),
+             s.bytes_in);
+  }
+
+  w.Header("rtmp_stream_frame_latency_seconds", "summary",
+           "Sampled time a frame spends in each server stage.");
+  for (auto &s : snapshot.streams) {
+    if (!s.latency) {
+      continue;
+    }
+    for (auto &stage : kLatencyStages) {
+      LatencyHistogram::Snapshot h = ((*s.latency).*stage.field).GetSnapshot();
+      for (double q : kQuantiles) {
+        w.Printf("rtmp_stream_frame_latency_seconds{stream=\"%s\",stage=\"%s\",quantile=\"%g\"} "
+                 "%.9g\n",
+                 Escape(s.path).c_str(), stage.name, q, h.Percentile(q) * 1e-9);
+      }
+      w.Printf("rtmp_stream_frame_latency_seconds_sum{stream=\"%s\",stage=\"%s\"} %.9g\n",
+               Escape(s.path).c_str(), stage.name, h.sum * 1e-9);
+      w.Printf("rtmp_stream_frame_latency_seconds_count{stream=\"%s\",stage=\"%s\"} %" PRIu64
+               "\n",
+               Escape(s.path).c_str(), stage.name, h.count);
+    }
+  }
+
+  w.Header("rtmp_player_startup_seconds", "summary",
+           "Time from accept through each player startup stage to the first key frame sent.");
+  for (auto &s : snapshot.startups) {
+    for (size_t i = 0; i < kStartupStageCount; i++) {
+      const LatencyHistogram::Snapshot &h = s.stages[i];
+      const char *stage = kStartupStages[i].name;
+      for (double q : kQuantiles) {
+        w.Printf("rtmp_player_startup_seconds{app=\"%s\",stage=\"%s\",quantile=\"%g\"} %.9g\n",
+                 Escape(s.app).c_str(), stage, q, h.Percentile(q) * 1e-9);
+      }
+      w.Printf("rtmp_player_startup_seconds_sum{app=\"%s\",stage=\"%s\"} %.9g\n",
+               Escape(s.app).c_str(), stage, h.sum * 1e-9);
+      w.Printf("rtmp_player_startup_seconds_count{app=\"%s\",stage=\"%s\"} %" PRIu64 "\n",
+               Escape(s.app).c_str(), stage, h.count);
+    }
+  }
+  w.Header("rtmp_player_gop_burst_bytes", "summary",
+           "Bytes sent from the GOP cache when a player starts.");
+  for (auto &s : snapshot.startups) {
+    const LatencyHistogram::Snapshot &h = s.gop_burst_bytes;
+    for (double q : kQuantiles) {
+      w.Printf("rtmp_player_gop_burst_bytes{app=\"%s\",quantile=\"%g\"} %" PRIu64 "\n",
+               Escape(s.app).c_str(), q, h.Percentile(q));
+    }
+    w.Printf("rtmp_player_gop_burst_bytes_sum{app=\"%s\"} %" PRIu64 "\n", Escape(s.app).c_str(),
+             h.sum);
+    w.Printf("rtmp_player_gop_burst_bytes_count{app=\"%s\"} %" PRIu64 "\n",
+             Escape(s.app).c_str(), h.count);
+  }
+
+  struct ConnMetric {
+    const char *name;
+    const char *type;
+    const char *help;
+    uint64_t ConnectionSnapshot::*field;
+  };
+  const ConnMetric conn_metrics[] = {
+      {"rtmp_connection_bytes_in_total", "counter", "Bytes received on the connection.",
+       &ConnectionSnapshot::bytes_in},
+      {"rtmp_connection_bytes_out_total", "counter", "Bytes sent on the connection.",
+       &ConnectionSnapshot::bytes_out},
+      {"rtmp_connection_queued_bytes", "gauge", "Bytes waiting in the send queue.",
+       &ConnectionSnapshot::queued_bytes},
+      {"rtmp_connection_dropped_packets_total", "counter",
+       "Packets dropped because the send queue was full.", &ConnectionSnapshot::dropped_packets},
+      {"rtmp_connection_dropped_frames_total", "counter",
+       "Media frames skipped before the first key frame.", &ConnectionSnapshot::dropped_frames},
+  };
+  for (auto &m : conn_metrics) {
+    w.Header(m.name, m.type, m.help);
+    for (auto &c : snapshot.connections) {
+      w.Printf("%s{id=\"%u\",stream=\"%s\",role=\"%s\"} %" PRIu64 "\n", m.name, c.id,
+               Escape(c.stream).c_str(), c.role, c.*m.field);
+    }
+  }
+
+  w.Header("rtmp_scheduler_loop_iterations_total", "counter", "Event loop iterations.");
+  for (auto &s : snapshot.schedulers) {
+    w.Printf("rtmp_scheduler_loop_iterations_total{scheduler=\"%d\"} %" PRIu64 "\n", s.id,
+             s.loop_iterations);
+  }
+  w.Header("rtmp_scheduler_trigger_queue_depth", "gauge", "Pending trigger events.");
+  for (auto &s : snapshot.schedulers) {
+    w.Printf("rtmp_scheduler_trigger_queue_depth{scheduler=\"%d\"} %d\n", s.id,
+             s.trigger_queue_depth);
+  }
+  w.Header("rtmp_scheduler_connections", "gauge", "Connections owned by the scheduler.");
+  for (auto &s : snapshot.schedulers) {
+    w.Printf("rtmp_scheduler_connections{scheduler=\"%d\"} %d\n", s.id, s.connections);
+  }
+
+  // 直方图按 Prometheus summary 导出: 分位数, _sum, _count
+  for (auto &m : kSchedulerHistograms) {
+    w.Header(m.name, "summary", m.help);
+    for (auto &s : snapshot.schedulers) {
+      const LatencyHistogram::Snapshot &h = s.*m.field;
+      for (double q : kQuantiles) {
+        w.Printf("%s{scheduler=\"%d\",quantile=\"%g\"} %.9g\n", m.name, s.id, q,
+                 h.Percentile(q) * m.scale);
+      }
+      w.Printf("%s_sum{scheduler=\"%d\"} %.9g\n", m.name, s.id, h.sum * m.scale);
+      w.Printf("%s_count{scheduler=\"%d\"} %" PRIu64 "\n", m.name, s.id, h.count);
+    }
+  }
+
+  return std::move(w.Str());
+}
+
+std::string RtmpMetrics::RenderJson(RtmpServer &server) {
+  Snapshot snapshot;
+  Collect(server, snapshot);
+  Writer w;
+
+  w.Printf("{\"connections_accepted\":%" PRIu64 ",\"connections_closed\":%" PRIu64
+           ",\"handshakes\":%" PRIu64 ",\"bytes_in\":%" PRIu64 ",\"bytes_out\":%" PRIu64
+           ",\"events_dropped\":%" PRIu64 ",\"logs_dropped\":%" PRIu64 ",\"streams\":[",
+           snapshot.connections_accepted, snapshot.connections_closed, snapshot.handshakes,
+           snapshot.bytes_in, snapshot.bytes_out, snapshot.events_dropped, snapshot.logs_dropped);
+  for (size_t i = 0; i < snapshot.streams.size(); i++) {
+    auto &s = snapshot.streams[i];
+    w.Printf("%s{\"stream\":\"%s\",\"ingest_bitrate_bps\":%" PRIu64
+             ",\"fps\":%u,\"gop_frames\":%u,\"subscribers\":%u,\"bytes_in\":%" PRIu64
+             ",\"video_frames\":%" PRIu64 ",\"audio_frames\":%" PRIu64,
+             i ? "," : "", Escape(s.path).c_str(), s.bitrate_bps, s.fps, s.gop_frames,
+             s.subscribers, s.bytes_in, s.video_frames, s.audio_frames);
+    if (s.latency) {
+      w.Printf(",\"frame_latency_seconds\":{");
+      for (size_t j = 0; j < sizeof(kLatencyStages) / sizeof(kLatencyStages[0]); j++) {
+        const LatencyStage &stage = kLatencyStages[j];
+        LatencyHistogram::Snapshot h = ((*s.latency).*stage.field).GetSnapshot();
+        w.Printf("%s\"%s\":{\"count\":%" PRIu64 ",\"p50\":%.9g,\"p99\":%.9g,\"max\":%.9g}",
+                 j ? "," : "", stage.name, h.count, h.Percentile(0.5) * 1e-9,
+                 h.Percentile(0.99) * 1e-9, h.max * 1e-9);
+      }
+      w.Printf("}");
+    }
+    w.Printf("}");
+  }
+  w.Printf("],\"connections\":[");
+  for (size_t i = 0; i < snapshot.connections.size(); i++) {
+    auto &c = snapshot.connections[i];
+    w.Printf("%s{\"id\":%u,\"stream\":\"%s\",\"role\":\"%s\",\"bytes_in\":%" PRIu64
+             ",\"bytes_out\":%" PRIu64 ",\"queued_bytes\":%" PRIu64
+             ",\"dropped_packets\":%" PRIu64 ",\"dropped_frames\":%" PRIu64 "}",
+             i ? "," : "", c.id, Escape(c.stream).c_str(), c.role, c.bytes_in, c.bytes_out,
+             c.queued_bytes, c.dropped_packets, c.dropped_frames);
+  }
+  w.Printf("],\"schedulers\":[");
+  for (size_t i = 0; i < snapshot.schedulers.size(); i++) {
+    auto &s = snapshot.schedulers[i];
+    w.Printf("%s{\"id\":%d,\"loop_iterations\":%" PRIu64
+             ",\"trigger_queue_depth\":%d,\"connections\":%d",
+             i ? "," : "", s.id, s.loop_iterations, s.trigger_queue_depth, s.connections);
+    for (auto &m : kSchedulerHistograms) {
+      const LatencyHistogram::Snapshot &h = s.*m.field;
+      // JSON 中去掉 rtmp_scheduler_ 前缀
+      w.Printf(",\"%s\":{\"count\":%" PRIu64 ",\"mean\":%.9g,\"p50\":%.9g,\"p90\":%.9g,"
+               "\"p99\":%.9g,\"p999\":%.9g,\"max\":%.9g}",
+               m.name + strlen("rtmp_scheduler_"), h.count, h.Mean() * m.scale,
+               h.Percentile(0.5) * m.scale, h.Percentile(0.9) * m.scale,
+               h.Percentile(0.99) * m.scale, h.Percentile(0.999) * m.scale, h.max * m.scale);
+    }
+    w.Printf("}");
+  }
+  w.Printf("],\"player_startup\":[");
+  for (size_t i = 0; i < snapshot.startups.size(); i++) {
+    auto &s = snapshot.startups[i];
+    w.Printf("%s{\"app\":\"%s\",\"stages_seconds\":{", i ? "," : "", Escape(s.app).c_str());
+    for (size_t j = 0; j < kStartupStageCount; j++) {
+      const LatencyHistogram::Snapshot &h = s.stages[j];
+      w.Printf("%s\"%s\":{\"count\":%" PRIu64 ",\"p50\":%.9g,\"p90\":%.9g,\"p99\":%.9g,"
+               "\"max\":%.9g}",
+               j ? "," : "", kStartupStages[j].name, h.count, h.Percentile(0.5) * 1e-9,
+               h.Percentile(0.9) * 1e-9, h.Percentile(0.99) * 1e-9, h.max * 1e-9);
+    }
+    const LatencyHistogram::Snapshot &b = s.gop_burst_bytes;
+    w.Printf("},\"gop_burst_bytes\":{\"count\":%" PRIu64 ",\"p50\":%" PRIu64
+             ",\"p99\":%" PRIu64 ",\"max\":%" PRIu64 "}}",
+             b.count, b.Percentile(0.5), b.Percentile(0.99), b.max);
+  }
+  w.Printf("]}\n");
+
+  return std::move(w.Str());
+}
+
+void RtmpMetrics::RegisterRoutes(HttpServer &http_server, std::shared_ptr<RtmpServer> server) {
+  std::weak_ptr<RtmpServer> weak_server = server;
+
+  http_server.AddRoute("/metrics", [weak_server](const HttpRequest &request,
+                                                 HttpResponse &response) {
+    auto server = weak_server.lock();
+    if (!server) {
+      response.status = 503;
+      return;
+    }
+    response.content_type = "text/plain; version=0.0.4; charset=utf-8";
+    response.body = RenderPrometheus(*server);
+  });
+
+  http_server.AddRoute("/metrics.json", [weak_server](const HttpRequest &request,
+                                                      HttpResponse &response) {
+    auto server = weak_server.lock();
+    if (!server) {
+      response.status = 503;
+      return;
+    }
+    response.content_type = "application/json";
+    response.body = RenderJson(*server);
+  });
+}
@@ -0,0 +1,28 @@
+/// @file RtmpMetrics.h
+/// @brief 汇总 RTMP 服务器的统计信息并输出为 Prometheus 文本格式或 JSON
+///        包括流 (码率, 帧率, GOP 长度, 订阅者数), 连接 (收发字节, 发送队列, 丢帧)
+///        和 TaskScheduler (循环次数, 触发事件队列深度, 连接数, 各阶段耗时和调度延迟的分位数),
+///        计数器用 relaxed 原子变量读取, 遍历连接时短暂持有各流会话的锁
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_METRICS_H
+#define RTMP_SERVER_RTMP_METRICS_H
+
+#include <memory>
+#include <string>
+
+class RtmpServer;
+class HttpServer;
+
+class RtmpMetrics {
+ public:
+  static std::string RenderPrometheus(RtmpServer &server);
+  static std::string RenderJson(RtmpServer &server);
+
+  // 注册 /metrics (Prometheus) 和 /metrics.json 两个路径
+  static void RegisterRoutes(HttpServer &http_server, std::shared_ptr<RtmpServer> server);
+};
+
+#endif  // RTMP_SERVER_RTMP_METRICS_H
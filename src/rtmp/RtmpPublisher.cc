@@ -7,6 +7,7 @@
 #include "RtmpPublisher.h"
 
 #include "Logger.h"
+#include "SocketUtil.h"
 
 RtmpPublisher::RtmpPublisher(EventLoop *event_loop) : event_loop_(event_loop) {}
 
@@ -103,6 +104,14 @@ int RtmpPublisher::SetMediaInfo(MediaInfo media_info) {
 }
 
 int RtmpPublisher::OpenUrl(std::string url, int msec, std::string &status) {
+  return Open(url, msec, status, INVALID_SOCKET);
+}
+
+int RtmpPublisher::OpenSocket(SOCKET sockfd, std::string url, int msec, std::string &status) {
+  return Open(url, msec, status, sockfd);
+}
+
+int RtmpPublisher::Open(std::string url, int msec, std::string &status, SOCKET sockfd) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   static Timestamp timestamp;
@@ -115,6 +124,9 @@ int RtmpPublisher::OpenUrl(std::string url, int msec, std::string &status) {
 
   if (this->ParseRtmpUrl(url) != 0) {
     LOG_INFO("[RtmpPublisher] rtmp url(%s) was illegal.\n", url.c_str());
+    if (sockfd != INVALID_SOCKET) {
+      SocketUtil::Close(sockfd);
+    }
     return -1;
   }
 
@@ -127,15 +139,18 @@ int RtmpPublisher::OpenUrl(std::string url, int msec, std::string &status) {
     rtmp_conn_ = nullptr;
   }
 
-  TcpSocket tcp_socket;
-  tcp_socket.Create();
-  if (!tcp_socket.Connect(ip_, port_, timeout)) {
-    tcp_socket.Close();
-    return -1;
+  if (sockfd == INVALID_SOCKET) {
+    TcpSocket tcp_socket;
+    tcp_socket.Create();
+    if (!tcp_socket.Connect(ip_, port_, timeout)) {
+      tcp_socket.Close();
+      return -1;
+    }
+    sockfd = tcp_socket.GetSocket();
   }
 
   task_scheduler_ = event_loop_->GetTaskScheduler().get();
-  rtmp_conn_.reset(new RtmpConnection(shared_from_this(), task_scheduler_, tcp_socket.GetSocket()));
+  rtmp_conn_.reset(new RtmpConnection(shared_from_this(), task_scheduler_, sockfd));
   task_scheduler_->AddTriggerEvent([this]() { rtmp_conn_->Handshake(); });
 
   timeout -= (int)timestamp.Elapsed();
@@ -143,9 +158,10 @@ int RtmpPublisher::OpenUrl(std::string url, int msec, std::string &status) {
     timeout = 1000;
   }
 
+  // 进程内 socketpair 的握手只需要几百微秒, 轮询间隔不宜太长
   do {
-    Timer::SleepMilliseconds(100);
-    timeout -= 100;
+    Timer::SleepMilliseconds(10);
+    timeout -= 10;
   } while (!rtmp_conn_->IsClosed() && !rtmp_conn_->IsPublishing() && timeout > 0);
 
   // RTMP连接未开始发布，则断开连接并返回 -1
@@ -207,6 +223,11 @@ bool RtmpPublisher::IsKeyFrame(uint8_t *data, uint32_t size) {
   return false;
 }
 
+void RtmpPublisher::SetLatencyProbe(RtmpLatencyProbe::Mode mode) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  probe_mode_ = mode;
+}
+
 int RtmpPublisher::PushVideoFrame(uint8_t *data, uint32_t size) {
   std::lock_guard<std::mutex> lock(mutex_);
 
@@ -242,7 +263,13 @@ int RtmpPublisher::PushVideoFrame(uint8_t *data, uint32_t size) {
     buffer[index++] = 0;
     buffer[index++] = 0;
     buffer[index++] = 0;
-    
+
+    // 探测 SEI 放在图像数据之前
+    if (probe_mode_ == RtmpLatencyProbe::PROBE_SEI) {
+      index += RtmpLatencyProbe::WriteSei(buffer + index, size + 4096 - index,
+                                          Timestamp::NowMicros());
+    }
+
     // NALU数据长度, 4字节, 大端序
     buffer[index++] = (size >> 24) & 0xff;
     buffer[index++] = (size >> 16) & 0xff;
@@ -255,6 +282,14 @@ int RtmpPublisher::PushVideoFrame(uint8_t *data, uint32_t size) {
     // task_scheduler_->addTriggerEvent([=]() {
     rtmp_conn_->SendVideoData(timestamp, payload, payload_size);
     // });
+
+    if (probe_mode_ == RtmpLatencyProbe::PROBE_AMF) {
+      std::shared_ptr<char> probe(new char[RtmpLatencyProbe::kAmfSize],
+                                  std::default_delete<char[]>());
+      uint32_t probe_size = RtmpLatencyProbe::WriteAmf(probe.get(), RtmpLatencyProbe::kAmfSize,
+                                                       Timestamp::NowMicros());
+      rtmp_conn_->SendDataFrame(timestamp, probe, probe_size);
+    }
   }
 
   return 0;
@@ -281,4 +316,60 @@ int RtmpPublisher::PushAudioFrame(uint8_t *data, uint32_t size) {
   }
 
   return 0;
-}
\ No newline at end of file
+}
+
+int RtmpPublisher::PushMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload,
+                                 uint32_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (rtmp_conn_ == nullptr || rtmp_conn_->IsClosed() || size == 0) {
+    return -1;
+  }
+
+  if (type == RTMP_VIDEO) {
+    rtmp_conn_->SendVideoData(timestamp, payload, size);
+  } else if (type == RTMP_AUDIO) {
+    rtmp_conn_->SendAudioData(timestamp, payload, size);
+  } else {
+    return -1;
+  }
+
+  return 0;
+}
+
+int RtmpPublisher::PushMetaData(const AmfObjects &meta_data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (rtmp_conn_ == nullptr || rtmp_conn_->IsClosed() || meta_data.empty()) {
+    return -1;
+  }
+
+  AmfObjects objects = meta_data;
+  AmfEncoder encoder;
+  encoder.EncodeString("@setDataFrame", 13);
+  encoder.EncodeString("onMetaData", 10);
+  encoder.EncodeECMA(objects);
+
+  std::shared_ptr<RtmpConnection> conn = rtmp_conn_;
+  std::shared_ptr<char> payload = encoder.Data();
+  uint32_t size = encoder.Size();
+  if (!task_scheduler_->AddTriggerEvent(
+          [conn, payload, size]() { conn->SendDataMessage(RTMP_CHUNK_DATA_ID, payload, size); })) {
+    return -1;
+  }
+  return 0;
+}
+
+TaskScheduler *RtmpPublisher::GetTaskScheduler() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return task_scheduler_;
+}
+
+uint64_t RtmpPublisher::GetQueuedBytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (rtmp_conn_ == nullptr) {
+    return 0;
+  }
+  return rtmp_conn_->GetStats().queued_bytes.load(std::memory_order_relaxed);
+}
@@ -12,6 +12,7 @@
 
 #include "EventLoop.h"
 #include "RtmpConnection.h"
+#include "RtmpLatencyProbe.h"
 #include "Timestamp.h"
 
 class RtmpPublisher : public Rtmp, public std::enable_shared_from_this<RtmpPublisher> {
@@ -29,17 +30,39 @@ class RtmpPublisher : public Rtmp, public std::enable_shared_from_this<RtmpPubli
   /// @param status 传出参数, 打开后的 rtmp 连接状态
   /// @return int 异常情况返回 -1
   int OpenUrl(std::string url, int msec, std::string &status);
+  // 在已经连接好的 sockfd (例如 socketpair 的一端) 上推流, url 只用来取 app 和流名,
+  // sockfd 的所有权交给推流端, 失败时关闭
+  int OpenSocket(SOCKET sockfd, std::string url, int msec, std::string &status);
   void Close();
 
   bool IsConnected();
 
+  // 在推出的视频帧中写入发送时的系统时间, 拉流端用 RtmpClient::SetLatencyProbe 取出
+  void SetLatencyProbe(RtmpLatencyProbe::Mode mode);
+
   int PushVideoFrame(uint8_t *data, uint32_t size);
   int PushAudioFrame(uint8_t *data, uint32_t size);
 
+  // 推送已经封装好的音视频消息 (例如 FLV tag 数据), 序列头也由调用者推送
+  // type: RTMP_VIDEO 或 RTMP_AUDIO, timestamp 单位毫秒, payload 直接进入发送队列不拷贝
+  int PushMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload,
+                    uint32_t size);
+
+  // 推送元数据 (@setDataFrame onMetaData), 在推流连接的线程中发送
+  int PushMetaData(const AmfObjects &meta_data);
+
+  // 推流连接所属的调度器, 打开之前为 nullptr
+  TaskScheduler *GetTaskScheduler();
+
+  // 推流连接发送队列中还未写出的字节数, 用于推送端自行限速
+  uint64_t GetQueuedBytes();
+
  private:
   friend class RtmpConnection;
 
   RtmpPublisher(EventLoop *event_loop);
+  // sockfd 为 INVALID_SOCKET 时按 url 建立 TCP 连接
+  int Open(std::string url, int msec, std::string &status, SOCKET sockfd);
   bool IsKeyFrame(uint8_t *data, uint32_t size);
 
   EventLoop *event_loop_ = nullptr;
@@ -54,6 +77,7 @@ class RtmpPublisher : public Rtmp, public std::enable_shared_from_this<RtmpPubli
   uint32_t aac_sequence_header_size_ = 0;
   uint8_t audio_tag_ = 0;  // 0: aac, 1: mp3
   bool has_key_frame_ = false;  // 有了关键帧才能从 I 帧开始推流
+  RtmpLatencyProbe::Mode probe_mode_ = RtmpLatencyProbe::PROBE_NONE;
   Timestamp timestamp_;
   uint64_t video_timestamp_ = 0;
   uint64_t audio_timestamp_ = 0;
@@ -0,0 +1,280 @@
+/// @file RtmpRecorder.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpRecorder.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "FlvWriter.h"
+#include "Timer.h"
+#include "Timestamp.h"
+#include "rtmp.h"
+
+// 除 close_lost 以外只在所属的写线程中访问
+struct RtmpRecordStream::State {
+  std::atomic_bool close_lost{false};  // 关闭项没能入队, 推流线程设置, 写线程在队列空闲时检查
+  std::string name;  // 不含序号和扩展名
+  uint32_t file_index = 0;
+  std::unique_ptr<FlvWriter> writer;
+  uint32_t file_start = 0;
+
+  std::shared_ptr<char> meta, avc_sequence_header, aac_sequence_header;
+  uint32_t meta_size = 0, avc_sequence_header_size = 0, aac_sequence_header_size = 0;
+};
+
+namespace {
+
+bool IsKeyFrame(const char *data, uint32_t size) {
+  return size > 0 && (((uint8_t)data[0] >> 4) & 0x0f) == 1;
+}
+
+}  // namespace
+
+bool RtmpRecordStream::Push(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data,
+                            uint32_t size) {
+  RtmpRecorder::Item item;
+  item.state = state_;
+  item.type = type;
+  item.timestamp = (uint32_t)timestamp;
+  item.data = std::move(data);
+  item.size = size;
+  return recorder_->workers_[thread_index_]->queue.Push(std::move(item));
+}
+
+void RtmpRecordStream::OnMedia(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data,
+                               uint32_t size) {
+  if (closed_ || data == nullptr || size == 0) {
+    return;
+  }
+
+  if (type == RTMP_VIDEO && wait_key_frame_) {
+    if (!IsKeyFrame(data.get(), size)) {
+      recorder_->dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    wait_key_frame_ = false;
+  }
+
+  if (!Push(type, timestamp, std::move(data), size)) {
+    // 写线程跟不上, 丢掉这一帧, 视频之后的帧依赖它, 一直丢到下一个关键帧
+    recorder_->dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+    if (type == RTMP_VIDEO) {
+      wait_key_frame_ = true;
+    }
+  }
+}
+
+void RtmpRecordStream::Close() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+
+  // 在会话锁内调用, 不能等待写线程. 通常由关闭项在之前的帧都写完之后关闭文件,
+  // 队列满放不下关闭项时才设置标记, 写线程在写完队列中已有的帧之后根据标记关闭文件
+  if (!Push(0, 0, nullptr, 0)) {
+    state_->close_lost.store(true, std::memory_order_release);
+  }
+}
+
+std::shared_ptr<RtmpRecorder> RtmpRecorder::Create(const RtmpRecordOptions &options) {
+  std::shared_ptr<RtmpRecorder> recorder(new RtmpRecorder(options));
+  for (auto &worker : recorder->workers_) {
+    Worker *w = worker.get();
+    RtmpRecorder *r = recorder.get();
+    worker->thread = std::thread([r, w] { r->Run(w); });
+  }
+  return recorder;
+}
+
+RtmpRecorder::RtmpRecorder(const RtmpRecordOptions &options) : options_(options) {
+  uint32_t threads = std::max<uint32_t>(options_.threads, 1);
+  for (uint32_t i = 0; i < threads; i++) {
+    workers_.emplace_back(new Worker(std::max<uint32_t>(options_.queue_size, 2)));
+  }
+}
+
+RtmpRecorder::~RtmpRecorder() {
+  quit_ = true;
+  for (auto &worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+}
+
+std::shared_ptr<RtmpRecordStream> RtmpRecorder::OpenStream(const std::string &stream_path) {
+  auto state = std::make_shared<RtmpRecordStream::State>();
+  std::string name;
+  for (char c : stream_path) {
+    if (isalnum((unsigned char)c) || c == '-') {
+      name.push_back(c);
+    } else if (!name.empty()) {
+      name.push_back('_');
+    }
+  }
+  state->name = options_.dir + "/" + name + "_" +
+                std::to_string(Timestamp::NowMicros() / 1000000);
+
+  uint32_t index = next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+  return std::shared_ptr<RtmpRecordStream>(
+      new RtmpRecordStream(shared_from_this(), index, state));
+}
+
+void RtmpRecorder::Run(Worker *worker) {
+  Item item;
+  while (true) {
+    // 生产者不通知写线程, 队列空时睡一会儿再看, 推流线程上没有任何额外的系统调用
+    bool busy = false;
+    while (worker->queue.Pop(item)) {
+      busy = true;
+      Process(worker, item);
+      item = Item();
+    }
+
+    if (!busy) {
+      CloseRequested(worker);
+      if (quit_) {
+        break;
+      }
+      Timer::SleepMilliseconds(kIdleWaitMs);
+    }
+  }
+
+  while (!worker->opened.empty()) {
+    CloseFile(worker, worker->opened.back());
+  }
+}
+
+void RtmpRecorder::CloseRequested(Worker *worker) {
+  std::vector<std::shared_ptr<RtmpRecordStream::State>> requested;
+  for (auto &state : worker->opened) {
+    if (state->close_lost.load(std::memory_order_acquire)) {
+      requested.push_back(state);
+    }
+  }
+  if (requested.empty()) {
+    return;
+  }
+
+  // 先看到标记再确认队列为空: 标记之前入队的帧都已经取出, 否则先写完队列中的帧
+  Item item;
+  if (worker->queue.Pop(item)) {
+    Process(worker, item);
+    return;
+  }
+  for (auto &state : requested) {
+    CloseFile(worker, state);
+  }
+}
+
+void RtmpRecorder::Process(Worker *worker, Item &item) {
+  auto &state = *item.state;
+  const char *data = item.data.get();
+
+  switch (item.type) {
+    case 0:
+      CloseFile(worker, item.state);
+      return;
+    case RTMP_DATA_MESSAGE:
+      state.meta = item.data;
+      state.meta_size = item.size;
+      break;
+    case RTMP_AVC_SEQUENCE_HEADER:
+      state.avc_sequence_header = item.data;
+      state.avc_sequence_header_size = item.size;
+      break;
+    case RTMP_AAC_SEQUENCE_HEADER:
+      state.aac_sequence_header = item.data;
+      state.aac_sequence_header_size = item.size;
+      break;
+    case RTMP_VIDEO:
+    case RTMP_AUDIO: {
+      // 新文件从视频关键帧开始; 只有音频时任意一帧都可以切换
+      bool has_video = state.avc_sequence_header != nullptr;
+      bool can_switch = item.type == RTMP_VIDEO ? IsKeyFrame(data, item.size) : !has_video;
+      if (state.writer == nullptr || !state.writer->IsOpened()) {
+        if (!can_switch || !OpenFile(worker, item.state, item.timestamp)) {
+          return;
+        }
+      } else if (can_switch) {
+        bool by_time = options_.segment_ms > 0 &&
+                       item.timestamp - state.file_start >= options_.segment_ms;
+        bool by_size = options_.segment_bytes > 0 &&
+                       state.writer->GetSize() >= options_.segment_bytes;
+        if (by_time || by_size) {
+          CloseFile(worker, item.state);
+          if (!OpenFile(worker, item.state, item.timestamp)) {
+            return;
+          }
+        }
+      }
+      break;
+    }
+    default:
+      return;
+  }
+
+  if (state.writer == nullptr || !state.writer->IsOpened()) {
+    return;  // 元数据和序列头在打开文件时写入
+  }
+
+  uint8_t tag_type = item.type == RTMP_AVC_SEQUENCE_HEADER   ? RTMP_VIDEO
+                     : item.type == RTMP_AAC_SEQUENCE_HEADER ? RTMP_AUDIO
+                                                             : item.type;
+  if (!state.writer->WriteTag(tag_type, item.timestamp, data, item.size)) {
+    write_errors_.fetch_add(1, std::memory_order_relaxed);
+    CloseFile(worker, item.state);  // 下一个关键帧再尝试新文件
+    return;
+  }
+  written_bytes_.fetch_add(item.size, std::memory_order_relaxed);
+}
+
+bool RtmpRecorder::OpenFile(Worker *worker, std::shared_ptr<RtmpRecordStream::State> state,
+                            uint32_t timestamp) {
+  if (state->writer == nullptr) {
+    state->writer.reset(
+        new FlvWriter(options_.buffer_size, options_.preallocate, options_.direct_io));
+  }
+
+  std::string path = state->name + "_" + std::to_string(state->file_index++) + ".flv";
+  bool has_audio = state->aac_sequence_header != nullptr;
+  bool has_video = state->avc_sequence_header != nullptr;
+  if (!state->writer->Open(path, has_audio || !has_video, has_video || !has_audio)) {
+    write_errors_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  state->file_start = timestamp;
+  worker->opened.push_back(state);
+  files_.fetch_add(1, std::memory_order_relaxed);
+
+  // 每个文件都可以单独播放
+  FlvWriter &writer = *state->writer;
+  if (state->meta != nullptr) {
+    writer.WriteTag(RTMP_DATA_MESSAGE, 0, state->meta.get(), state->meta_size);
+  }
+  if (state->avc_sequence_header != nullptr) {
+    writer.WriteTag(RTMP_VIDEO, timestamp, state->avc_sequence_header.get(),
+                    state->avc_sequence_header_size);
+  }
+  if (state->aac_sequence_header != nullptr) {
+    writer.WriteTag(RTMP_AUDIO, timestamp, state->aac_sequence_header.get(),
+                    state->aac_sequence_header_size);
+  }
+  return true;
+}
+
+void RtmpRecorder::CloseFile(Worker *worker, std::shared_ptr<RtmpRecordStream::State> state) {
+  if (state->writer != nullptr && state->writer->IsOpened()) {
+    state->writer->Close();
+  }
+
+  auto iter = std::find(worker->opened.begin(), worker->opened.end(), state);
+  if (iter != worker->opened.end()) {
+    worker->opened.erase(iter);
+  }
+}
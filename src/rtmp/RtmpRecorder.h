@@ -0,0 +1,127 @@
+/// @file RtmpRecorder.h
+/// @brief FLV 录制: 推流线程只把帧的引用 (共享的 payload) 放进写线程的无锁队列, 不拷贝也不做系统调用,
+///        写线程用 FlvWriter 批量写文件. 每路流固定分配给一个写线程, 保证同一路流的 tag 按顺序写入
+///        按时长或大小在关键帧处切换文件, 新文件开头重新写入元数据和序列头
+///        队列满时丢弃帧并计数, 视频从下一个关键帧恢复, 录制永远不会反压转发
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_RECORDER_H
+#define RTMP_SERVER_RTMP_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MpmcQueue.h"
+
+class FlvWriter;
+
+struct RtmpRecordOptions {
+  std::string dir;             // 录制文件目录, 需已存在
+  uint32_t segment_ms = 0;     // 单个文件的时长上限, 0 表示不按时长切换
+  uint64_t segment_bytes = 0;  // 单个文件的大小上限, 0 表示不按大小切换
+  bool direct_io = false;
+  uint32_t threads = 1;            // 写线程数
+  uint32_t queue_size = 16384;     // 每个写线程的队列长度
+  uint32_t buffer_size = 1 << 20;  // 每路流的写缓冲区
+  uint64_t preallocate = 64 << 20;
+};
+
+class RtmpRecorder;
+
+// 一路流的录制句柄, 由会话持有, 在推流线程中调用
+class RtmpRecordStream {
+ public:
+  // type: RTMP_AUDIO, RTMP_VIDEO, RTMP_AVC_SEQUENCE_HEADER, RTMP_AAC_SEQUENCE_HEADER 或
+  // RTMP_DATA_MESSAGE (已经编码的 onMetaData)
+  void OnMedia(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size);
+
+  // 推流结束, 写线程关闭当前文件. 不阻塞, 队列满时也不等待
+  void Close();
+
+  struct State;
+
+ private:
+  friend class RtmpRecorder;
+
+  RtmpRecordStream(std::shared_ptr<RtmpRecorder> recorder, uint32_t thread_index,
+                   std::shared_ptr<State> state)
+      : recorder_(recorder), thread_index_(thread_index), state_(state) {}
+
+  bool Push(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size);
+
+  std::shared_ptr<RtmpRecorder> recorder_;
+  uint32_t thread_index_;
+  std::shared_ptr<State> state_;  // 除关闭标记以外只在写线程访问
+  bool wait_key_frame_ = false;   // 丢帧之后等关键帧
+  bool closed_ = false;
+};
+
+class RtmpRecorder : public std::enable_shared_from_this<RtmpRecorder> {
+ public:
+  // 创建后立即启动写线程, 析构时写完队列中剩余的帧并关闭所有文件
+  static std::shared_ptr<RtmpRecorder> Create(const RtmpRecordOptions &options);
+  ~RtmpRecorder();
+  RtmpRecorder(const RtmpRecorder &) = delete;
+  RtmpRecorder &operator=(const RtmpRecorder &) = delete;
+
+  // 开始录制一路流, 文件名为 <dir>/<app>_<stream>_<开始时间>_<序号>.flv
+  std::shared_ptr<RtmpRecordStream> OpenStream(const std::string &stream_path);
+
+  const RtmpRecordOptions &GetOptions() const { return options_; }
+
+  uint64_t GetDroppedFrames() const { return dropped_frames_.load(std::memory_order_relaxed); }
+  uint64_t GetWrittenBytes() const { return written_bytes_.load(std::memory_order_relaxed); }
+  uint64_t GetFiles() const { return files_.load(std::memory_order_relaxed); }
+  uint64_t GetWriteErrors() const { return write_errors_.load(std::memory_order_relaxed); }
+
+ private:
+  friend class RtmpRecordStream;
+
+  struct Item {
+    std::shared_ptr<RtmpRecordStream::State> state;
+    uint8_t type = 0;  // 0 表示关闭文件
+    uint32_t timestamp = 0;
+    std::shared_ptr<char> data;
+    uint32_t size = 0;
+  };
+
+  struct Worker {
+    explicit Worker(size_t capacity) : queue(capacity) {}
+    MpmcQueue<Item> queue;
+    std::thread thread;
+    std::vector<std::shared_ptr<RtmpRecordStream::State>> opened;  // 退出时关闭
+  };
+
+  explicit RtmpRecorder(const RtmpRecordOptions &options);
+
+  void Run(Worker *worker);
+  void Process(Worker *worker, Item &item);
+
+  // 关闭项因为队列满没能入队的流, 在队列空闲时关闭文件, 此时流在关闭之前的帧都已经写入
+  void CloseRequested(Worker *worker);
+
+  // 打开下一个文件, 写入缓存的元数据和序列头
+  bool OpenFile(Worker *worker, std::shared_ptr<RtmpRecordStream::State> state,
+                uint32_t timestamp);
+  void CloseFile(Worker *worker, std::shared_ptr<RtmpRecordStream::State> state);
+
+  static const uint32_t kIdleWaitMs = 5;
+
+  const RtmpRecordOptions options_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<uint32_t> next_worker_{0};
+  std::atomic_bool quit_{false};
+
+  std::atomic<uint64_t> dropped_frames_{0};
+  std::atomic<uint64_t> written_bytes_{0};
+  std::atomic<uint64_t> files_{0};
+  std::atomic<uint64_t> write_errors_{0};
+};
+
+#endif  // RTMP_SERVER_RTMP_RECORDER_H
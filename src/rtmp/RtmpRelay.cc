@@ -0,0 +1,103 @@
+/// @file RtmpRelay.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpRelay.h"
+
+#include <chrono>
+
+#include "Logger.h"
+#include "rtmp.h"
+
+RtmpRelay::RtmpRelay(EventLoop *loop, const std::string &url, RtmpSession::Ptr session,
+                     uint32_t idle_ms)
+    : event_loop_(loop), url_(url), sink_(session, idle_ms > kCheckMs ? idle_ms : kCheckMs) {}
+
+RtmpRelay::~RtmpRelay() {
+  Stop();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void RtmpRelay::Start() { thread_ = std::thread(&RtmpRelay::Run, this); }
+
+void RtmpRelay::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  cond_.notify_all();
+}
+
+bool RtmpRelay::Wait(uint32_t msec) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return !cond_.wait_for(lock, std::chrono::milliseconds(msec), [this] { return quit_; });
+}
+
+void RtmpRelay::Run() {
+  // 回调在回源连接的线程中执行, 回源结束之后可能还有已经收到的消息在回调
+  std::weak_ptr<RtmpRelay> weak_relay = shared_from_this();
+  bool quit = false;
+  while (!quit) {
+    auto client = RtmpClient::Create(event_loop_);
+    client->SetRecvMediaCB(
+        [weak_relay](uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload,
+                     uint32_t length) {
+          auto relay = weak_relay.lock();
+          if (relay) {
+            relay->OnMedia(type, timestamp, payload, length);
+          }
+        });
+    client->SetRecvDataCB([weak_relay](const char *payload, uint32_t length) {
+      auto relay = weak_relay.lock();
+      if (relay) {
+        relay->OnData(payload, length);
+      }
+    });
+
+    std::string status;
+    connects_++;
+    if (client->OpenUrl(url_, kOpenTimeoutMs, status) == 0) {
+      LOG_INFO("[Relay] %s connected.\n", url_.c_str());
+      connected_ = true;
+      while (client->IsConnected()) {
+        if (sink_.IsIdle() || !Wait(kCheckMs)) {
+          quit = true;
+          break;
+        }
+      }
+      connected_ = false;
+    } else {
+      LOG_INFO("[Relay] %s failed: %s\n", url_.c_str(), status.c_str());
+    }
+
+    // 拉流端还在时等一会儿重连, 源站上的推流端可能稍后才开始
+    for (uint32_t waited = 0; !quit && waited < kRetryMs; waited += kCheckMs) {
+      quit = sink_.IsIdle() || !Wait(kCheckMs);
+    }
+
+    // 断开之前停止写入会话, 之后到达的消息直接丢弃
+    if (quit) {
+      stopped_ = true;
+    }
+    client->Close();
+  }
+
+  LOG_INFO("[Relay] %s stopped.\n", url_.c_str());
+}
+
+void RtmpRelay::OnMedia(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload,
+                        uint32_t length) {
+  if (!IsStopped()) {
+    sink_.OnMedia(type, timestamp, payload, length);
+  }
+}
+
+void RtmpRelay::OnData(const char *payload, uint32_t length) {
+  if (!IsStopped()) {
+    sink_.OnMetaData(payload, length);
+  }
+}
@@ -0,0 +1,82 @@
+/// @file RtmpRelay.h
+/// @brief 边缘回源: 拉流的流在本机没有推流端时, 用 RtmpClient 从源站拉取同名的流, 收到的帧写入本机的会话,
+///        由会话扇出给本机的拉流端. 同一个流的所有拉流端共用一个回源连接, 最后一个拉流端离开之后
+///        等待一段时间再断开, 期间重新进入的拉流端不需要重新回源.
+///        回源连接的建立会阻塞等待握手, 每个回源在自己的线程中建立和维护连接, 不阻塞事件循环
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_RELAY_H
+#define RTMP_SERVER_RTMP_RELAY_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "EventLoop.h"
+#include "RtmpClient.h"
+#include "RtmpRelaySink.h"
+#include "RtmpSession.h"
+
+class RtmpRelay : public std::enable_shared_from_this<RtmpRelay> {
+ public:
+  // url: 源站上的完整流地址, idle_ms: 会话没有拉流端之后保持回源的时长
+  RtmpRelay(EventLoop *loop, const std::string &url, RtmpSession::Ptr session, uint32_t idle_ms);
+  ~RtmpRelay();
+  RtmpRelay(const RtmpRelay &) = delete;
+  RtmpRelay &operator=(const RtmpRelay &) = delete;
+
+  // 启动回源线程, 只调用一次
+  void Start();
+
+  // 通知回源线程断开并退出, 不等待, 线程退出后 IsStopped 返回 true, 析构时等待线程退出
+  void Stop();
+
+  // 拉流端进入时调用, 见 RtmpRelaySink::Touch
+  void Touch() { sink_.Touch(); }
+
+  // 空闲超时或者已经 Stop, 不会再向会话写入数据
+  bool IsStopped() const { return stopped_.load(std::memory_order_acquire); }
+
+  bool IsConnected() const { return connected_.load(std::memory_order_relaxed); }
+
+  RtmpSession::Ptr GetSession() const { return sink_.GetSession(); }
+  const std::string &GetUrl() const { return url_; }
+
+  uint64_t GetFrames() const { return sink_.GetFrames(); }
+  uint32_t GetConnects() const { return connects_.load(std::memory_order_relaxed); }
+
+  static const uint32_t kCheckMs = 100;       // 检查连接状态和拉流端数的间隔
+  static const uint32_t kRetryMs = 1000;      // 回源失败或者断开之后重连的间隔
+  static const uint32_t kOpenTimeoutMs = 5000;
+
+ private:
+  // 回源线程: 建立连接, 断开后重连, 空闲超时后退出
+  void Run();
+
+  // 等待 msec 毫秒, 期间 Stop 时返回 false
+  bool Wait(uint32_t msec);
+
+  // 在回源连接所属的线程中回调, 回源停止之后丢弃, 否则交给 sink_ 按推流端的方式写入会话
+  void OnMedia(uint8_t type, uint64_t timestamp, std::shared_ptr<char> payload, uint32_t length);
+  void OnData(const char *payload, uint32_t length);
+
+  EventLoop *event_loop_;
+  const std::string url_;
+  RtmpRelaySink sink_;  // 空闲判断只在回源线程中
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool quit_ = false;
+  std::thread thread_;
+
+  std::atomic_bool stopped_{false};
+  std::atomic_bool connected_{false};
+  std::atomic<uint32_t> connects_{0};
+};
+
+#endif  // RTMP_SERVER_RTMP_RELAY_H
@@ -0,0 +1,67 @@
+/// @file RtmpRelaySink.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpRelaySink.h"
+
+#include <algorithm>
+
+#include "rtmp.h"
+
+RtmpRelaySink::RtmpRelaySink(RtmpSession::Ptr session, uint32_t idle_ms)
+    : session_(session), idle_ms_(idle_ms) {
+  Touch();
+}
+
+bool RtmpRelaySink::IsIdle() {
+  int64_t now = Timestamp::NowNanos();
+  if (session_->GetClientsNum() > 0) {
+    idle_since_ns_ = 0;
+    return false;
+  }
+  if (idle_since_ns_ == 0) {
+    idle_since_ns_ = now;
+  }
+  int64_t since = std::max(idle_since_ns_, last_touch_ns_.load(std::memory_order_relaxed));
+  return now - since >= (int64_t)idle_ms_ * 1000000;
+}
+
+void RtmpRelaySink::OnMedia(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data,
+                            uint32_t size) {
+  if (data == nullptr || size < 2 || session_->GetPublisher() != nullptr) {
+    return;
+  }
+
+  const uint8_t *payload = (const uint8_t *)data.get();
+  if (type == RTMP_VIDEO && ((payload[0] >> 4) & 0x0f) == 1 &&
+      (payload[0] & 0x0f) == RTMP_CODEC_ID_H264 && payload[1] == 0) {
+    type = RTMP_AVC_SEQUENCE_HEADER;
+  } else if (type == RTMP_AUDIO && ((payload[0] >> 4) & 0x0f) == RTMP_CODEC_ID_AAC &&
+             payload[1] == 0) {
+    type = RTMP_AAC_SEQUENCE_HEADER;
+  }
+
+  if (type == RTMP_AVC_SEQUENCE_HEADER) {
+    session_->SetAvcSequenceHeader(data, size);
+  } else if (type == RTMP_AAC_SEQUENCE_HEADER) {
+    session_->SetAacSequenceHeader(data, size);
+  }
+  session_->SendMediaData(type, timestamp, data, size);
+  frames_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RtmpRelaySink::OnMetaData(const char *data, uint32_t size) {
+  AmfReader reader(data, size);
+  AmfStringView name;
+  if (!reader.ReadString(name) || !(name == "onMetaData")) {
+    return;
+  }
+
+  AmfDecoder decoder;
+  decoder.Decode(data + reader.Position(), size - reader.Position());
+  AmfObjects meta_data = decoder.GetObjects();
+  session_->SetMetaData(meta_data);
+  session_->SendMetaData(meta_data);
+}
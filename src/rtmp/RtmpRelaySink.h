@@ -0,0 +1,50 @@
+/// @file RtmpRelaySink.h
+/// @brief 回源 (RtmpRelay 从源站拉取, RtmpBusRelay 从帧总线读取) 共用的会话写入端:
+///        把上游的帧和元数据按推流端的方式写入本机的会话, 并判断会话空闲到可以停止回源
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_RELAY_SINK_H
+#define RTMP_SERVER_RTMP_RELAY_SINK_H
+
+#include <atomic>
+#include <memory>
+
+#include "RtmpSession.h"
+#include "Timestamp.h"
+
+class RtmpRelaySink {
+ public:
+  // idle_ms: 会话没有拉流端之后保持回源的时长
+  RtmpRelaySink(RtmpSession::Ptr session, uint32_t idle_ms);
+  RtmpRelaySink(const RtmpRelaySink &) = delete;
+  RtmpRelaySink &operator=(const RtmpRelaySink &) = delete;
+
+  const RtmpSession::Ptr &GetSession() const { return session_; }
+
+  // 拉流端进入时调用, 空闲时长从最后一次 Touch 和最后一个拉流端离开中较晚的时刻算起,
+  // 拉流端在加入会话之前不会因为会话暂时为空而断开回源
+  void Touch() { last_touch_ns_.store(Timestamp::NowNanos(), std::memory_order_relaxed); }
+
+  // 会话没有拉流端的时长超过 idle_ms 时返回 true, 只在回源自己的线程中调用
+  bool IsIdle();
+
+  // type 为 RTMP_VIDEO, RTMP_AUDIO 或者已经区分出的序列头类型. 和推流连接一样,
+  // 序列头保存到会话, 新的拉流端起播时先收到序列头. 本机有推流端时以本机为准, 丢弃
+  void OnMedia(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size);
+
+  // onMetaData + ECMA 数组, 不带 @setDataFrame, 保存到会话并发给拉流端
+  void OnMetaData(const char *data, uint32_t size);
+
+  uint64_t GetFrames() const { return frames_.load(std::memory_order_relaxed); }
+
+ private:
+  RtmpSession::Ptr session_;
+  const uint32_t idle_ms_;
+  int64_t idle_since_ns_ = 0;  // 开始空闲的时刻, 0 表示不空闲
+  std::atomic<int64_t> last_touch_ns_{0};
+  std::atomic<uint64_t> frames_{0};
+};
+
+#endif  // RTMP_SERVER_RTMP_RELAY_SINK_H
@@ -0,0 +1,104 @@
+/// @file RtmpResponseTemplate.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpResponseTemplate.h"
+
+#include <cstring>
+
+#include "BufferWriter.h"
+#include "amf.h"
+
+static AmfTemplate MakeTemplate(AmfEncoder& encoder) {
+  AmfTemplate tpl;
+  tpl.size = encoder.Size();
+  tpl.data.reset(new char[tpl.size], std::default_delete<char[]>());
+  memcpy(tpl.data.get(), encoder.Data().get(), tpl.size);
+  return tpl;
+}
+
+// onStatus 的事务 id 固定为 0, 整个消息都是常量
+static AmfTemplate MakeOnStatus(const char* level, const char* code, const char* description) {
+  AmfEncoder encoder;
+  AmfObjects objects;
+  encoder.EncodeString("onStatus", 8);
+  encoder.EncodeNumber(0);
+  encoder.EncodeObjects(objects);
+  objects["level"] = AmfObject(std::string(level));
+  objects["code"] = AmfObject(std::string(code));
+  objects["description"] = AmfObject(std::string(description));
+  encoder.EncodeObjects(objects);
+  return MakeTemplate(encoder);
+}
+
+uint32_t AmfTemplate::Fill(char* buf, uint32_t buf_size, double transaction_id,
+                           double stream_id) const {
+  if (buf_size < size) {
+    return 0;
+  }
+
+  memcpy(buf, data.get(), size);
+  if (transaction_id_offset >= 0) {
+    WriteDoubleBE(buf + transaction_id_offset, transaction_id);
+  }
+  if (stream_id_offset >= 0) {
+    WriteDoubleBE(buf + stream_id_offset, stream_id);
+  }
+  return size;
+}
+
+const RtmpResponseTemplate& RtmpResponseTemplate::Instance() {
+  static RtmpResponseTemplate s_template;  // C++11之后, 局部静态变量线程安全
+  return s_template;
+}
+
+RtmpResponseTemplate::RtmpResponseTemplate() {
+  AmfEncoder encoder;
+  AmfObjects objects;
+  int offset = 0;
+
+  // connect 响应: _result, 事务 id, 服务器属性, 连接状态
+  encoder.EncodeString("_result", 7);
+  offset = (int)encoder.Size() + 1;  // 跳过 AMF0_NUMBER 类型标记
+  encoder.EncodeNumber(0);
+  objects["fmsVer"] = AmfObject(std::string("FMS/4,5,0,297"));  // fms服务器版本
+  objects["capabilities"] = AmfObject(255.0);  // 服务器支持的功能, 取全部
+  encoder.EncodeObjects(objects);
+  objects.clear();
+  objects["level"] = AmfObject(std::string("status"));
+  objects["code"] = AmfObject(std::string("NetConnection.Connect.Success"));
+  objects["description"] = AmfObject(std::string("Connection succeeded."));
+  objects["objectEncoding"] = AmfObject(0.0);
+  encoder.EncodeObjects(objects);
+  connect_result = MakeTemplate(encoder);
+  connect_result.transaction_id_offset = offset;
+
+  // createStream 响应: _result, 事务 id, null, 流 id
+  encoder.Reset();
+  objects.clear();
+  encoder.EncodeString("_result", 7);
+  offset = (int)encoder.Size() + 1;
+  encoder.EncodeNumber(0);
+  encoder.EncodeObjects(objects);
+  int stream_id_offset = (int)encoder.Size() + 1;
+  encoder.EncodeNumber(0);
+  create_stream_result = MakeTemplate(encoder);
+  create_stream_result.transaction_id_offset = offset;
+  create_stream_result.stream_id_offset = stream_id_offset;
+
+  publish_start = MakeOnStatus("status", "NetStream.Publish.Start", "Start publishing.");
+  publish_bad_name =
+      MakeOnStatus("error", "NetStream.Publish.BadName", "Stream already publishing.");
+  publish_bad_connection =
+      MakeOnStatus("error", "NetStream.Publish.BadConnection", "Connection already publishing.");
+  play_reset = MakeOnStatus("status", "NetStream.Play.Reset", "Resetting and playing stream.");
+  play_start = MakeOnStatus("status", "NetStream.Play.Start", "Started playing.");
+
+  encoder.Reset();
+  encoder.EncodeString("|RtmpSampleAccess", 17);
+  encoder.EncodeBoolean(true);
+  encoder.EncodeBoolean(true);
+  sample_access = MakeTemplate(encoder);
+}
@@ -0,0 +1,47 @@
+/// @file RtmpResponseTemplate.h
+/// @brief 预编码的控制命令响应, connect/createStream/publish/play 的响应内容基本是常量,
+///        启动时用 AmfEncoder 编码一次, 之后每个连接只需要拷贝模板并改写事务 id 等少数字段
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_RESPONSE_TEMPLATE_H
+#define RTMP_SERVER_RTMP_RESPONSE_TEMPLATE_H
+
+#include <cstdint>
+#include <memory>
+
+struct AmfTemplate {
+  std::shared_ptr<char> data;  // 编码完成后只读, 多线程共享
+  uint32_t size = 0;
+  int transaction_id_offset = -1;  // 事务 id 的 8 字节 double 在 data 中的偏移, -1 表示不需要改写
+  int stream_id_offset = -1;       // createStream 响应中流 id 的偏移
+
+  /// @brief 拷贝模板到 buf 并改写事务 id 和流 id
+  ///
+  /// @return uint32_t 写入的字节数, buf 空间不足返回 0
+  uint32_t Fill(char* buf, uint32_t buf_size, double transaction_id, double stream_id = 0) const;
+};
+
+class RtmpResponseTemplate {
+ public:
+  RtmpResponseTemplate(const RtmpResponseTemplate&) = delete;
+  RtmpResponseTemplate& operator=(const RtmpResponseTemplate&) = delete;
+
+  // 首次调用时编码所有模板, RtmpServer 构造时调用一次保证在接收连接之前完成
+  static const RtmpResponseTemplate& Instance();
+
+  AmfTemplate connect_result;        // _result, NetConnection.Connect.Success
+  AmfTemplate create_stream_result;  // _result, 流 id
+  AmfTemplate publish_start;         // onStatus, NetStream.Publish.Start
+  AmfTemplate publish_bad_name;      // onStatus, NetStream.Publish.BadName
+  AmfTemplate publish_bad_connection;  // onStatus, NetStream.Publish.BadConnection
+  AmfTemplate play_reset;            // onStatus, NetStream.Play.Reset
+  AmfTemplate play_start;            // onStatus, NetStream.Play.Start
+  AmfTemplate sample_access;         // |RtmpSampleAccess 数据消息
+
+ private:
+  RtmpResponseTemplate();
+};
+
+#endif  // RTMP_SERVER_RTMP_RESPONSE_TEMPLATE_H
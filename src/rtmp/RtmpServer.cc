@@ -6,45 +6,100 @@
 
 #include "RtmpServer.h"
 
+#include <set>
+
 #include "Logger.h"
 #include "RtmpConnection.h"
+#include "RtmpResponseTemplate.h"
 #include "SocketUtil.h"
 
 RtmpServer::RtmpServer(EventLoop* event_loop)
-    : TcpServer(event_loop), event_loop_(event_loop), event_callbacks_(10) {
+    : TcpServer(event_loop), event_loop_(event_loop) {
+  // 在接收连接之前编码好控制命令的响应模板
+  RtmpResponseTemplate::Instance();
+
   // 定时关闭无客户端的 session 节省服务器资源  
   event_loop_->AddTimer(
       [this] {
-        std::lock_guard<std::mutex> lock(mutex_);
-        for (auto iter = rtmp_sessions_.begin(); iter != rtmp_sessions_.end();) {
-          if (iter->second->GetClientsNum() == 0) {
-            rtmp_sessions_.erase(iter++);
-          } else {
-            iter++;
+        // 回源的会话在回源空闲超时之前保留, 回源线程已经退出的在锁外释放
+        std::vector<std::shared_ptr<RtmpRelay>> stopped;
+        std::set<RtmpSession*> relay_sessions;
+        {
+          std::lock_guard<std::mutex> lock(relay_mutex_);
+          for (auto iter = relays_.begin(); iter != relays_.end();) {
+            if (iter->second->IsStopped()) {
+              stopped.push_back(iter->second);
+              iter = relays_.erase(iter);
+            } else {
+              relay_sessions.insert(iter->second->GetSession().get());
+              iter++;
+            }
+          }
+          for (auto iter = bus_relays_.begin(); iter != bus_relays_.end();) {
+            if (iter->second->IsStopped()) {
+              iter = bus_relays_.erase(iter);
+            } else {
+              relay_sessions.insert(iter->second->GetSession().get());
+              iter++;
+            }
+          }
+          for (auto iter = retired_relays_.begin(); iter != retired_relays_.end();) {
+            if ((*iter)->IsStopped()) {
+              stopped.push_back(*iter);
+              iter = retired_relays_.erase(iter);
+            } else {
+              iter++;
+            }
+          }
+        }
+
+        std::vector<std::shared_ptr<RtmpForwarder>> stopped_forwarders;
+        {
+          std::lock_guard<std::mutex> lock(forward_mutex_);
+          for (auto iter = forwarders_.begin(); iter != forwarders_.end();) {
+            if ((*iter)->IsStopped()) {
+              stopped_forwarders.push_back(*iter);
+              iter = forwarders_.erase(iter);
+            } else {
+              iter++;
+            }
           }
         }
+
+        rtmp_sessions_.RemoveIf([&relay_sessions](const RtmpSession::Ptr& session) {
+          return session->GetClientsNum() == 0 && relay_sessions.count(session.get()) == 0;
+        });
         return true;
       },
       30000);
 }
 
+RtmpServer::~RtmpServer() {
+  // 会话可能比服务器活得久, 在这里等待连接线程退出, 之后不会再用 event_loop_ 建立连接
+  std::vector<std::shared_ptr<RtmpForwarder>> forwarders;
+  {
+    std::lock_guard<std::mutex> lock(forward_mutex_);
+    forwarders.swap(forwarders_);
+  }
+  for (auto& forward : forwarders) {
+    forward->Close();
+  }
+  for (auto& forward : forwarders) {
+    forward->Join();
+  }
+}
+
 std::shared_ptr<RtmpServer> RtmpServer::Create(EventLoop* event_loop) {
   std::shared_ptr<RtmpServer> server(new RtmpServer(event_loop));
   return server;
 }
 
 void RtmpServer::SetEventCallback(EventCallback event_cb) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  event_callbacks_.push_back(event_cb);
+  event_notifier_.AddCallback(event_cb);
 }
 
-void RtmpServer:: NotifyEvent(std::string event_type, std::string stream_path) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  for (auto event_cb : event_callbacks_) {
-    if (event_cb) {
-      event_cb(event_type, stream_path);
-    }
-  }
+void RtmpServer::NotifyEvent(const char* event_type, const std::string& stream_path) {
+  event_notifier_.Post(event_type, stream_path);
 }
 
 TcpConnection::Ptr RtmpServer::OnConnect(SOCKET sockfd) {
@@ -52,37 +107,132 @@ TcpConnection::Ptr RtmpServer::OnConnect(SOCKET sockfd) {
                                           sockfd);
 }
 
-void RtmpServer::AddSession(std::string stream_path) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (rtmp_sessions_.find(stream_path) == rtmp_sessions_.end()) {
-    rtmp_sessions_[stream_path] = std::make_shared<RtmpSession>();
-  }
+void RtmpServer::AddSession(const std::string& stream_path, uint64_t stream_hash) {
+  rtmp_sessions_.FindOrCreate(stream_hash, stream_path);
 }
 
-void RtmpServer::RemoveSession(std::string stream_path) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  rtmp_sessions_.erase(stream_path);
+void RtmpServer::RemoveSession(const std::string& stream_path, uint64_t stream_hash) {
+  rtmp_sessions_.Remove(stream_hash, stream_path);
 }
 
-bool RtmpServer::HasSession(std::string stream_path) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  return (rtmp_sessions_.find(stream_path) != rtmp_sessions_.end());
+bool RtmpServer::HasSession(const std::string& stream_path, uint64_t stream_hash) {
+  return rtmp_sessions_.Find(stream_hash, stream_path) != nullptr;
 }
 
-RtmpSession::Ptr RtmpServer::GetSession(std::string stream_path) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (rtmp_sessions_.find(stream_path) == rtmp_sessions_.end()) {
-    rtmp_sessions_[stream_path] = std::make_shared<RtmpSession>();
-  }
-
-  return rtmp_sessions_[stream_path];
+RtmpSession::Ptr RtmpServer::GetSession(const std::string& stream_path, uint64_t stream_hash) {
+  return rtmp_sessions_.FindOrCreate(stream_hash, stream_path);
 }
 
-bool RtmpServer::HasPublisher(std::string stream_path) {
-  auto session = GetSession(stream_path);
+bool RtmpServer::HasPublisher(const std::string& stream_path, uint64_t stream_hash) {
+  // 只查不建, 查询不存在的流不会留下空会话
+  auto session = rtmp_sessions_.Find(stream_hash, stream_path);
   if (session == nullptr) {
     return false;
   }
 
   return (session->GetPublisher() != nullptr);
 }
+
+void RtmpServer::StartRelay(const std::string& stream_path, uint64_t stream_hash) {
+  if ((edge_origin_.empty() && !frame_bus_) || HasPublisher(stream_path, stream_hash)) {
+    return;
+  }
+
+  auto session = GetSession(stream_path, stream_hash);
+  // 其他 worker 上已经有推流端时从总线读取, 都没有时只在非边缘模式下等待推流端出现在总线上
+  if (frame_bus_ && (edge_origin_.empty() || frame_bus_->HasStream(stream_path))) {
+    StartBusRelay(stream_path, session);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(relay_mutex_);
+    auto& relay = relays_[stream_path];
+    if (relay && !relay->IsStopped() && relay->GetSession() == session) {
+      relay->Touch();
+      return;
+    }
+
+    // 会话被清理之后重新创建, 旧的回源还在写旧的会话, 通知它退出, 不在事件循环中等待
+    if (relay) {
+      relay->Stop();
+      retired_relays_.push_back(relay);
+    }
+    relay = std::make_shared<RtmpRelay>(event_loop_, edge_origin_ + stream_path, session,
+                                        edge_idle_ms_);
+    relay->Start();
+  }
+
+  LOG_INFO("[Relay] pull %s%s\n", edge_origin_.c_str(), stream_path.c_str());
+  NotifyEvent("relay.start", stream_path);
+}
+
+void RtmpServer::StartBusRelay(const std::string& stream_path, const RtmpSession::Ptr& session) {
+  {
+    std::lock_guard<std::mutex> lock(relay_mutex_);
+    auto& relay = bus_relays_[stream_path];
+    if (relay && !relay->IsStopped() && relay->GetSession() == session) {
+      relay->Touch();
+      return;
+    }
+
+    // 轮询在定时器中进行, 旧的回源在下一次轮询时退出
+    if (relay) {
+      relay->Stop();
+    }
+    relay = std::make_shared<RtmpBusRelay>(event_loop_, frame_bus_, stream_path, session,
+                                           bus_idle_ms_);
+    relay->Start();
+  }
+
+  NotifyEvent("relay.start", stream_path);
+}
+
+void RtmpServer::StartForward(const std::string& app, const std::string& stream_name,
+                              const std::string& stream_path, const RtmpSession::Ptr& session) {
+  auto rule = forward_rules_.find(app);
+  if (rule == forward_rules_.end()) {
+    return;
+  }
+
+  auto forward = RtmpForwarder::Create(event_loop_, stream_name, rule->second);
+  session->SetForward(forward);
+  forward->Start();
+  {
+    std::lock_guard<std::mutex> lock(forward_mutex_);
+    forwarders_.push_back(forward);
+  }
+  NotifyEvent("forward.start", stream_path);
+}
+
+std::shared_ptr<RtmpRelay> RtmpServer::FindRelay(const std::string& stream_path) {
+  std::lock_guard<std::mutex> lock(relay_mutex_);
+  auto iter = relays_.find(stream_path);
+  if (iter == relays_.end() || iter->second->IsStopped()) {
+    return nullptr;
+  }
+  return iter->second;
+}
+
+std::shared_ptr<RtmpVodFile> RtmpServer::FindVod(const std::string& app,
+                                                 const std::string& stream_name) {
+  if (vod_cache_ == nullptr || stream_name.empty()) {
+    return nullptr;
+  }
+
+  // 流名称来自客户端, 不能跳出点播目录
+  for (const std::string* name : {&app, &stream_name}) {
+    if (name->find('/') != std::string::npos || name->find("..") != std::string::npos) {
+      return nullptr;
+    }
+  }
+
+  std::shared_ptr<RtmpVodFile> file;
+  if (!app.empty()) {
+    file = vod_cache_->Get(vod_dir_ + "/" + app + "/" + stream_name + ".flv");
+  }
+  if (file == nullptr) {
+    file = vod_cache_->Get(vod_dir_ + "/" + stream_name + ".flv");
+  }
+  return file;
+}
@@ -2,7 +2,7 @@
 /// @brief 应用层实现 rtmp 服务器
 ///        1. 设置 acceptor 回调
 ///        2. 管理 url 和 session
-///        3. 出现新连接到达或者连接断开事件时调回调函数输出一些日志等
+///        3. 出现新连接到达或者连接断开事件时调回调函数输出一些日志等, 回调在独立的通知线程中异步执行
 /// @version 0.1
 /// @author lq
 /// @date 2023/05/13
@@ -10,41 +10,183 @@
 #ifndef RTMP_SERVER_RTMP_SERVER_H
 #define RTMP_SERVER_RTMP_SERVER_H
 
-#include <mutex>
 #include <string>
 
+#include "RtmpBusRelay.h"
+#include "RtmpEventNotifier.h"
+#include "RtmpForwarder.h"
+#include "RtmpRecorder.h"
+#include "RtmpRelay.h"
+#include "RtmpTimeshift.h"
+#include "RtmpVod.h"
 #include "RtmpSession.h"
+#include "RtmpSessionRegistry.h"
+#include "RtmpStartupStats.h"
 #include "TcpServer.h"
 #include "rtmp.h"
 
 class RtmpServer : public TcpServer, public Rtmp, public std::enable_shared_from_this<RtmpServer> {
  public:
-  using EventCallback = std::function<void(std::string event_type, std::string stream_path)>;
+  using EventCallback = RtmpEventNotifier::EventCallback;
 
   static std::shared_ptr<RtmpServer> Create(EventLoop *event_loop);
-  ~RtmpServer() = default;
+  ~RtmpServer();
 
   void SetEventCallback(EventCallback event_cb);
 
+  // 推流连接的入口抓包, 每个推流连接在 dir 下写一个 .rtmpcap 文件, 用 replay_bench 回放
+  // dir 为空表示关闭, 需在 Start 之前设置. 抓包在事件循环线程中同步写文件, 只用于采集样本
+  void SetIngressCapture(const std::string &dir, uint64_t max_bytes = 256 * 1024 * 1024) {
+    capture_dir_ = dir;
+    capture_max_bytes_ = max_bytes;
+  }
+
+  // 开启 HLS 输出, 每个推流的会话在内存中切片, 由 RtmpHls::RegisterRoutes 注册的 HTTP 路径提供,
+  // segment_ms 为 0 表示关闭, 需在 Start 之前设置
+  void SetHls(uint32_t segment_ms = 2000, uint32_t list_size = 5) {
+    hls_segment_ms_ = segment_ms;
+    hls_list_size_ = list_size;
+  }
+
+  // 开启低延迟 HLS 输出 (CMAF 部分分片), 由 RtmpLlHls::RegisterRoutes 注册的 HTTP 路径提供,
+  // segment_ms 为 0 表示关闭, 需在 Start 之前设置
+  void SetLlHls(uint32_t segment_ms = 2000, uint32_t part_ms = 200, uint32_t list_size = 5) {
+    ll_hls_segment_ms_ = segment_ms;
+    ll_hls_part_ms_ = part_ms;
+    ll_hls_list_size_ = list_size;
+  }
+
+  // 开启时移, 拉流端 play 命令的 start 参数大于 0 时从直播之前 start 毫秒开始播放,
+  // options.max_ms 为 0 表示关闭, 需在 Start 之前设置
+  void SetTimeshift(const RtmpTimeshiftOptions &options) { timeshift_options_ = options; }
+
+  // 开启点播, 拉流的流没有推流端时播放 <dir>/<app>/<stream>.flv 或 <dir>/<stream>.flv,
+  // speed 大于 1 时按倍速发送, dir 为空表示关闭, 需在 Start 之前设置
+  void SetVod(const std::string &dir, double speed = 1.0) {
+    vod_dir_ = dir;
+    vod_speed_ = speed;
+    vod_cache_ = dir.empty() ? nullptr : std::make_shared<RtmpVodCache>();
+  }
+
+  // 查找点播文件, 没有开启点播或者文件不存在返回 nullptr
+  std::shared_ptr<RtmpVodFile> FindVod(const std::string &app, const std::string &stream_name);
+
+  // 开启边缘模式, 拉流的流在本机没有推流端时从源站 origin_url (例如 rtmp://10.0.0.1:1935) 拉取
+  // 同路径的流, 同一个流的拉流端共用一个回源连接, 最后一个拉流端离开 idle_ms 之后断开,
+  // origin_url 为空表示关闭, 需在 Start 之前设置
+  void SetEdge(const std::string &origin_url, uint32_t idle_ms = 10000) {
+    edge_origin_ = origin_url;
+    while (!edge_origin_.empty() && edge_origin_.back() == '/') {
+      edge_origin_.pop_back();
+    }
+    edge_idle_ms_ = idle_ms;
+  }
+
+  // 流的回源, 没有回源或者回源已经结束返回 nullptr
+  std::shared_ptr<RtmpRelay> FindRelay(const std::string &stream_path);
+
+  // 按 app 转发推流, 推流端 publish 时把流重新推到 <target.url>/<流名>, 同一个 app 可以添加多个上游,
+  // 需在 Start 之前设置
+  void AddForward(const std::string &app, RtmpForwardTarget target) {
+    while (!target.url.empty() && target.url.back() == '/') {
+      target.url.pop_back();
+    }
+    forward_rules_[app].push_back(target);
+  }
+
+  // 多进程模式下各 worker 共用的帧总线 (在 fork 之前创建), 推流写入总线, 本 worker 没有推流端的流
+  // 从总线读取其他 worker 上的推流; 同一个流只能在一个 worker 上推. idle_ms 为最后一个拉流端离开之后
+  // 继续读取的时长, bus 为空表示关闭, 需在 Start 之前设置
+  void SetFrameBus(std::shared_ptr<RtmpFrameBus> bus, uint32_t idle_ms = 10000) {
+    frame_bus_ = bus;
+    bus_idle_ms_ = idle_ms;
+  }
+
+  std::shared_ptr<RtmpFrameBus> GetFrameBus() const { return frame_bus_; }
+
+  // 开启 FLV 录制, options.dir 为空表示关闭, 需在 Start 之前设置
+  void SetRecord(const RtmpRecordOptions &options) {
+    recorder_ = options.dir.empty() ? nullptr : RtmpRecorder::Create(options);
+  }
+
+  // 没有开启录制时为 nullptr
+  std::shared_ptr<RtmpRecorder> GetRecorder() const { return recorder_; }
+
+  // 只查不建, 不存在返回 nullptr
+  RtmpSession::Ptr FindSession(const std::string &stream_path) const {
+    return rtmp_sessions_.Find(RtmpSessionRegistry::Hash(stream_path), stream_path);
+  }
+
+  // 遍历所有流会话, 用于统计
+  void ForEachSession(const RtmpSessionRegistry::Visitor &visitor) const {
+    rtmp_sessions_.ForEach(visitor);
+  }
+
+  // 遍历各 app 的拉流端起播耗时统计
+  void ForEachStartupStats(const RtmpStartupStats::Visitor &visitor) const {
+    startup_stats_.ForEach(visitor);
+  }
+
+  EventLoop *GetEventLoop() const { return event_loop_; }
+
+  // 因事件队列满而丢弃的事件数
+  uint64_t GetDroppedEvents() const { return event_notifier_.GetDroppedEvents(); }
+
  private:
   friend class RtmpConnection;
+  friend class HttpFlvConnection;
 
   RtmpServer(EventLoop *event_loop);
-  void AddSession(std::string stream_path);
-  void RemoveSession(std::string stream_path);
-  RtmpSession::Ptr GetSession(std::string stream_path);
+  // stream_hash 为 RtmpSessionRegistry::Hash(stream_path), 由连接预先计算好
+  void AddSession(const std::string& stream_path, uint64_t stream_hash);
+  void RemoveSession(const std::string& stream_path, uint64_t stream_hash);
+  RtmpSession::Ptr GetSession(const std::string& stream_path, uint64_t stream_hash);
+
+  bool HasSession(const std::string& stream_path, uint64_t stream_hash);
+  bool HasPublisher(const std::string& stream_path, uint64_t stream_hash);
+
+  // 为没有推流端的流建立回源: 多进程模式下从帧总线读取, 边缘模式下从源站拉取,
+  // 已经有回源时只刷新空闲计时, 拉流端加入会话之前调用
+  void StartRelay(const std::string& stream_path, uint64_t stream_hash);
+  void StartBusRelay(const std::string& stream_path, const RtmpSession::Ptr& session);
 
-  bool HasSession(std::string stream_path);
-  bool HasPublisher(std::string stream_path);
+  // 按 app 的转发规则为推流会话建立转发, 没有规则时不做任何事.
+  // 服务器持有转发器直到连接线程退出, 析构时等待所有连接线程退出
+  void StartForward(const std::string& app, const std::string& stream_name,
+                    const std::string& stream_path, const RtmpSession::Ptr& session);
 
-  void NotifyEvent(std::string event_type, std::string stream_path);
+  // 只入队, 不在调用线程执行回调
+  void NotifyEvent(const char *event_type, const std::string &stream_path);
 
   TcpConnection::Ptr OnConnect(SOCKET sockfd) override;
 
   EventLoop *event_loop_;
-  std::mutex mutex_;
-  std::unordered_map<std::string, RtmpSession::Ptr> rtmp_sessions_;  // <流url, 流会话>
-  std::vector<EventCallback> event_callbacks_;
+  RtmpSessionRegistry rtmp_sessions_;  // <流url, 流会话>
+  RtmpEventNotifier event_notifier_;
+  RtmpStartupStats startup_stats_;  // <app, 起播耗时>
+  std::string capture_dir_;
+  uint64_t capture_max_bytes_ = 0;
+  uint32_t hls_segment_ms_ = 0;
+  uint32_t hls_list_size_ = 0;
+  uint32_t ll_hls_segment_ms_ = 0;
+  uint32_t ll_hls_part_ms_ = 0;
+  uint32_t ll_hls_list_size_ = 0;
+  std::shared_ptr<RtmpRecorder> recorder_;
+  RtmpTimeshiftOptions timeshift_options_;
+  std::string vod_dir_;
+  double vod_speed_ = 1.0;
+  std::shared_ptr<RtmpVodCache> vod_cache_;
+  std::unordered_map<std::string, std::vector<RtmpForwardTarget>> forward_rules_;  // <app, 上游>
+  std::mutex forward_mutex_;
+  std::vector<std::shared_ptr<RtmpForwarder>> forwarders_;  // 连接线程退出后释放
+  std::string edge_origin_;
+  uint32_t edge_idle_ms_ = 0;
+  std::mutex relay_mutex_;
+  std::unordered_map<std::string, std::shared_ptr<RtmpRelay>> relays_;  // <流url, 回源>
+  std::vector<std::shared_ptr<RtmpRelay>> retired_relays_;  // 被替换的回源, 线程退出后释放
+  std::shared_ptr<RtmpFrameBus> frame_bus_;
+  uint32_t bus_idle_ms_ = 0;
+  std::unordered_map<std::string, std::shared_ptr<RtmpBusRelay>> bus_relays_;  // <流url, 总线回源>
 };
 
 #endif  // RTMP_SERVER_RTMP_SERVER_H
\ No newline at end of file
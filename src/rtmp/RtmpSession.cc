@@ -6,7 +6,15 @@
 
 #include "RtmpSession.h"
 
+#include "HttpFlvConnection.h"
 #include "RtmpConnection.h"
+#include "RtmpForwarder.h"
+#include "RtmpFrameBus.h"
+#include "RtmpHls.h"
+#include "RtmpLlHls.h"
+#include "RtmpRecorder.h"
+#include "RtmpTimeshift.h"
+#include "Timestamp.h"
 
 void RtmpSession::SendMetaData(AmfObjects &metaData) {
   std::lock_guard<std::mutex> lock(mutex_);
@@ -22,22 +30,92 @@ void RtmpSession::SendMetaData(AmfObjects &metaData) {
       iter++;
     }
   }
+
+  if (forward_) {
+    forward_->OnMetaData(metaData);
+  }
+
+  if (bus_writer_) {
+    bus_writer_->OnMetaData(metaData);
+  }
+
+  if (http_flv_conns_.empty() && !record_) {
+    return;
+  }
+
+  AmfEncoder encoder;
+  encoder.EncodeString("onMetaData", 10);
+  encoder.EncodeECMA(metaData);
+  if (record_) {
+    record_->OnMedia(RTMP_DATA_MESSAGE, 0, encoder.Data(), encoder.Size());
+  }
+  if (!http_flv_conns_.empty()) {
+    auto chunk = HttpFlvChunk::Create(RTMP_DATA_MESSAGE, 0, encoder.Data(), encoder.Size());
+    for (auto &iter : http_flv_conns_) {
+      auto conn = iter.second.conn.lock();
+      if (conn && iter.second.is_playing) {
+        conn->SendChunk(chunk);
+      }
+    }
+  }
 }
 
 void RtmpSession::SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data,
-                                uint32_t size) {
-  std::lock_guard<std::mutex> lock(mutex_);
+                                uint32_t size, std::shared_ptr<FrameTrace> trace) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  if (trace) {
+    if (!latency_) {
+      std::atomic_store(&latency_, std::make_shared<StreamLatency>());
+    }
+    trace->latency = latency_;
+    trace->dispatch_ns = Timestamp::NowNanos();
+    latency_->parse_ns.Record(trace->parsed_ns - trace->recv_ns);
+    latency_->dispatch_ns.Record(trace->dispatch_ns - trace->parsed_ns);
+  }
+
+  // 在保存 GOP 之前起播, HTTP-FLV 拉流端不会重复收到当前帧
+  if (!http_flv_conns_.empty()) {
+    this->SendHttpFlv(type, timestamp, data, size);
+  }
 
   if (this->max_gop_cache_len_ > 0) {
     this->SaveGop(type, timestamp, data, size);
   }
 
+  if (timeshift_) {
+    timeshift_->OnMedia(type, timestamp, data, size);
+  }
+
+  if (record_) {
+    record_->OnMedia(type, timestamp, data, size);
+  }
+
+  if (forward_) {
+    forward_->OnMedia(type, timestamp, data, size);
+  }
+
+  if (bus_writer_) {
+    bus_writer_->OnMedia(type, timestamp, data.get(), size);
+  }
+
+  if (type == RTMP_VIDEO || type == RTMP_AUDIO) {
+    uint8_t *payload = (uint8_t *)data.get();
+    bool is_key_frame = (type == RTMP_VIDEO && ((payload[0] >> 4) & 0x0f) == 1);
+    stats_.OnFrame(type == RTMP_VIDEO, is_key_frame, size);
+  }
+
+  bool erased = false;
   for (auto iter = rtmp_conns_.begin(); iter != rtmp_conns_.end();) {
     auto conn = iter->second.lock();
     if (conn == nullptr) {  // 删除失效的连接
+      timeshift_cursors_.erase(iter->first);
       rtmp_conns_.erase(iter++);
+      erased = true;
     } else {
-      if (conn->IsPlayer()) {
+      if (conn->IsPlayer() && timeshift_ && conn->GetPlayStart() > 0) {
+        SendTimeshift(conn);
+      } else if (conn->IsPlayer()) {
         if (!conn->IsPlaying()) {  // 还未开始播放则先发送元数据和序列头信息
           conn->SendMetaData(meta_data_);
           conn->SendMediaData(RTMP_AVC_SEQUENCE_HEADER, 0, this->avc_sequence_header_,
@@ -46,13 +124,111 @@ void RtmpSession::SendMediaData(uint8_t type, uint64_t timestamp, std::shared_pt
                               this->aac_sequence_header_size_);
           SendGop(conn);
         }
-        conn->SendMediaData(type, timestamp, data, size);
+        conn->SendMediaData(type, timestamp, data, size, trace);
       }
       iter++;
     }
   }
 
-  return;
+  if (erased) {
+    UpdateSubscribers();
+  }
+
+  // HLS 和低延迟 HLS 的封装在扇出之后, 释放会话锁再进行, RTMP 拉流端的转发和 AddConn 不等待封装,
+  // 低延迟 HLS 唤醒等待中的 HTTP 请求时也不持有会话锁
+  std::shared_ptr<RtmpHls> hls = hls_;
+  std::shared_ptr<RtmpLlHls> ll_hls = ll_hls_;
+  lock.unlock();
+  if (hls || ll_hls) {
+    std::lock_guard<std::mutex> hls_lock(hls_mutex_);
+    if (hls) {
+      hls->OnMedia(type, timestamp, data.get(), size);
+    }
+    if (ll_hls) {
+      ll_hls->OnMedia(type, timestamp, data.get(), size);
+    }
+  }
+}
+
+void RtmpSession::SendHttpFlv(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data,
+                              uint32_t size) {
+  bool is_sequence_header = (type == RTMP_AVC_SEQUENCE_HEADER || type == RTMP_AAC_SEQUENCE_HEADER);
+  uint8_t tag_type = (type == RTMP_VIDEO || type == RTMP_AVC_SEQUENCE_HEADER) ? RTMP_VIDEO
+                                                                              : RTMP_AUDIO;
+  auto chunk = HttpFlvChunk::Create(tag_type, is_sequence_header ? 0 : timestamp, data, size);
+
+  bool erased = false;
+  std::vector<std::shared_ptr<const HttpFlvChunk>> start_chunks;
+  for (auto iter = http_flv_conns_.begin(); iter != http_flv_conns_.end();) {
+    auto conn = iter->second.conn.lock();
+    if (conn == nullptr) {
+      http_flv_conns_.erase(iter++);
+      erased = true;
+      continue;
+    }
+
+    if (iter->second.is_playing) {
+      conn->SendChunk(chunk);
+    } else {
+      // 同一帧上起播的拉流端共用起播数据, 起播数据中已经包含新的序列头
+      if (start_chunks.empty()) {
+        GetHttpFlvStartChunks(start_chunks);
+        if (!is_sequence_header) {
+          start_chunks.push_back(chunk);
+        }
+      }
+      conn->SendChunks(start_chunks);
+      iter->second.is_playing = true;
+    }
+    iter++;
+  }
+
+  if (erased) {
+    UpdateSubscribers();
+  }
+}
+
+void RtmpSession::GetHttpFlvStartChunks(std::vector<std::shared_ptr<const HttpFlvChunk>> &chunks) {
+  if (meta_data_.size() > 0) {
+    if (!http_flv_meta_data_) {
+      AmfEncoder encoder;
+      encoder.EncodeString("onMetaData", 10);
+      encoder.EncodeECMA(meta_data_);
+      http_flv_meta_data_ =
+          HttpFlvChunk::Create(RTMP_DATA_MESSAGE, 0, encoder.Data(), encoder.Size());
+    }
+    chunks.push_back(http_flv_meta_data_);
+  }
+
+  if (avc_sequence_header_size_ > 0) {
+    chunks.push_back(
+        HttpFlvChunk::Create(RTMP_VIDEO, 0, avc_sequence_header_, avc_sequence_header_size_));
+  }
+  if (aac_sequence_header_size_ > 0) {
+    chunks.push_back(
+        HttpFlvChunk::Create(RTMP_AUDIO, 0, aac_sequence_header_, aac_sequence_header_size_));
+  }
+
+  if (gop_cache_.size() > 0) {
+    auto gop = gop_cache_.begin()->second;
+    for (auto &frame : *gop) {
+      if (!frame->flv) {
+        frame->flv = HttpFlvChunk::Create(frame->type, frame->timestamp, frame->data, frame->size);
+      }
+      chunks.push_back(frame->flv);
+    }
+  }
+}
+
+void RtmpSession::SendDataFrame(uint64_t timestamp, std::shared_ptr<char> data, uint32_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (auto &iter : rtmp_conns_) {
+    auto conn = iter.second.lock();
+    if (conn && conn->IsPlayer() && conn->IsPlaying()) {
+      conn->SendDataFrame(timestamp, data, size);
+    }
+  }
 }
 
 void RtmpSession::SaveGop(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data,
@@ -112,6 +288,7 @@ void RtmpSession::SaveGop(uint8_t type, uint64_t timestamp, std::shared_ptr<char
 }
 
 void RtmpSession::SendGop(std::shared_ptr<RtmpConnection> conn) {
+  uint64_t burst_bytes = 0;
   if (gop_cache_.size() > 0) {
     auto gop = gop_cache_.begin()->second;
     for (auto iter : *gop) {
@@ -120,8 +297,91 @@ void RtmpSession::SendGop(std::shared_ptr<RtmpConnection> conn) {
       } else if (iter->type == RTMP_AUDIO) {
         conn->SendAudioData(iter->timestamp, iter->data, iter->size);
       }
+      burst_bytes += iter->size;
+    }
+  }
+  conn->RecordGopBurst(burst_bytes);
+}
+
+void RtmpSession::SetHls(const std::string &name, uint32_t segment_ms, uint32_t list_size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!hls_) {
+    std::atomic_store(&hls_, std::make_shared<RtmpHls>(name, segment_ms, list_size));
+  }
+}
+
+void RtmpSession::SetLlHls(const std::string &name, uint32_t segment_ms, uint32_t part_ms,
+                           uint32_t list_size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!ll_hls_) {
+    std::atomic_store(&ll_hls_,
+                      std::make_shared<RtmpLlHls>(name, segment_ms, part_ms, list_size));
+  }
+}
+
+void RtmpSession::SetTimeshift(const std::string &name, const RtmpTimeshiftOptions &options) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!timeshift_) {
+    timeshift_ = std::make_shared<RtmpTimeshift>(name, options);
+  }
+}
+
+void RtmpSession::SendTimeshift(const std::shared_ptr<RtmpConnection> &conn) {
+  uint64_t live = timeshift_->GetLastTimestamp();
+  RtmpTimeshift::Frame frame;
+
+  // 第一次发送, 或者播放位置已经被淘汰, 从请求的延迟之前最近的关键帧开始
+  auto iter = timeshift_cursors_.find(conn->GetId());
+  if (iter == timeshift_cursors_.end() || iter->second.seq < timeshift_->GetBegin()) {
+    uint64_t delay = conn->GetPlayStart();
+    uint64_t seq = 0;
+    if (!timeshift_->Seek(live > delay ? live - delay : 0, seq) || !timeshift_->Get(seq, frame)) {
+      return;
     }
+
+    conn->SendMetaData(meta_data_);
+    conn->SendMediaData(RTMP_AVC_SEQUENCE_HEADER, 0, avc_sequence_header_,
+                        avc_sequence_header_size_);
+    conn->SendMediaData(RTMP_AAC_SEQUENCE_HEADER, 0, aac_sequence_header_,
+                        aac_sequence_header_size_);
+
+    TimeshiftCursor cursor;
+    cursor.seq = seq;
+    cursor.delay = live > frame.timestamp ? live - frame.timestamp : 0;
+    iter = timeshift_cursors_.emplace(conn->GetId(), cursor).first;
+    iter->second = cursor;
+  }
+
+  // 帧引用的是时移缓存中的 payload, 和直播拉流端共用
+  TimeshiftCursor &cursor = iter->second;
+  while (timeshift_->Get(cursor.seq, frame) && frame.timestamp + cursor.delay <= live) {
+    conn->SendMediaData(frame.type, frame.timestamp, frame.data, frame.size);
+    cursor.seq += 1;
+  }
+}
+
+void RtmpSession::SetRecord(std::shared_ptr<RtmpRecordStream> record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (record_) {
+    record_->Close();
+  }
+  record_ = record;
+}
+
+void RtmpSession::SetForward(std::shared_ptr<RtmpForwarder> forward) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (forward_) {
+    forward_->Close();
   }
+  std::atomic_store(&forward_, forward);
+}
+
+void RtmpSession::SetBusWriter(std::shared_ptr<RtmpFrameBusWriter> writer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (bus_writer_) {
+    bus_writer_->Close();
+  }
+  bus_writer_ = writer;
 }
 
 void RtmpSession::AddConn(std::shared_ptr<RtmpConnection> conn) {
@@ -136,8 +396,20 @@ void RtmpSession::AddConn(std::shared_ptr<RtmpConnection> conn) {
     gop_index_ = 0;
     has_publisher_ = true;
     publisher_ = conn;
+    if (hls_) {
+      std::lock_guard<std::mutex> hls_lock(hls_mutex_);
+      hls_->Reset();
+    }
+    if (ll_hls_) {
+      std::lock_guard<std::mutex> hls_lock(hls_mutex_);
+      ll_hls_->Reset();
+    }
+    if (timeshift_) {
+      timeshift_->Reset();
+      timeshift_cursors_.clear();
+    }
   }
-  return;
+  UpdateSubscribers();
 }
 
 void RtmpSession::RemoveConn(std::shared_ptr<RtmpConnection> conn) {
@@ -150,8 +422,66 @@ void RtmpSession::RemoveConn(std::shared_ptr<RtmpConnection> conn) {
     gop_cache_.clear();
     gop_index_ = 0;
     has_publisher_ = false;
+    if (hls_) {
+      std::lock_guard<std::mutex> hls_lock(hls_mutex_);
+      hls_->Flush();
+    }
+    if (ll_hls_) {
+      std::lock_guard<std::mutex> hls_lock(hls_mutex_);
+      ll_hls_->Flush();
+    }
+    if (record_) {
+      record_->Close();
+      record_.reset();
+    }
+    if (forward_) {
+      forward_->Close();
+      std::atomic_store(&forward_, std::shared_ptr<RtmpForwarder>());
+    }
+    if (bus_writer_) {
+      bus_writer_->Close();
+      bus_writer_.reset();
+    }
   }
   rtmp_conns_.erase(conn->GetId());
+  timeshift_cursors_.erase(conn->GetId());
+  UpdateSubscribers();
+}
+
+void RtmpSession::AddHttpFlvConn(std::shared_ptr<HttpFlvConnection> conn) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  HttpFlvPlayer player;
+  player.conn = conn;
+  http_flv_conns_[conn->GetSocket()] = player;
+  UpdateSubscribers();
+}
+
+void RtmpSession::RemoveHttpFlvConn(std::shared_ptr<HttpFlvConnection> conn) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  http_flv_conns_.erase(conn->GetSocket());
+  UpdateSubscribers();
+}
+
+void RtmpSession::UpdateSubscribers() {
+  uint32_t num = (uint32_t)rtmp_conns_.size();
+  if (has_publisher_ && num > 0) {
+    num -= 1;
+  }
+  num += (uint32_t)http_flv_conns_.size();
+  stats_.subscribers.store(num, std::memory_order_relaxed);
+}
+
+void RtmpSession::ForEachConn(
+    const std::function<void(const std::shared_ptr<RtmpConnection> &conn, bool is_publisher)>
+        &callback) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto publisher = publisher_.lock();
+  for (auto &iter : rtmp_conns_) {
+    auto conn = iter.second.lock();
+    if (conn) {
+      callback(conn, conn == publisher);
+    }
+  }
 }
 
 int RtmpSession::GetClientsNum() {
@@ -165,6 +495,12 @@ int RtmpSession::GetClientsNum() {
     }
   }
 
+  for (auto &iter : http_flv_conns_) {
+    if (!iter.second.conn.expired()) {
+      clients += 1;
+    }
+  }
+
   return clients;
 }
 
@@ -8,15 +8,27 @@
 #ifndef RTMP_SERVER_RTMP_SESSION_H
 #define RTMP_SERVER_RTMP_SESSION_H
 
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
+#include <vector>
 
+#include "FrameTrace.h"
+#include "Metrics.h"
 #include "Socket.h"
 #include "amf.h"
 
 class RtmpConnection;
+class RtmpForwarder;
+class RtmpFrameBusWriter;
+class RtmpHls;
+class RtmpLlHls;
+class RtmpRecordStream;
+class RtmpTimeshift;
+struct RtmpTimeshiftOptions;
 class HttpFlvConnection;
+struct HttpFlvChunk;
 
 class RtmpSession {
  public:
@@ -28,6 +40,7 @@ class RtmpSession {
   void SetMetaData(AmfObjects metaData) {
     std::lock_guard<std::mutex> lock(mutex_);
     meta_data_ = metaData;
+    http_flv_meta_data_ = nullptr;
   }
 
   AmfObjects GetMetaData() {
@@ -39,7 +52,12 @@ class RtmpSession {
   void SendMetaData(AmfObjects& metaData);
 
   // 向所有拉流端发送音视频数据 type: RTMP_AUDIO 或 RTMP_VIDEO
-  void SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size);
+  // trace 非空表示该帧被采样, 会记录分发延迟并传给每个拉流端
+  void SendMediaData(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size,
+                     std::shared_ptr<FrameTrace> trace = nullptr);
+
+  // 向已经开始播放的拉流端转发数据消息, 和音视频帧保持先后顺序
+  void SendDataFrame(uint64_t timestamp, std::shared_ptr<char> data, uint32_t size);
 
   void SetAvcSequenceHeader(std::shared_ptr<char> avcSequenceHeader,
                             uint32_t avcSequenceHeaderSize) {
@@ -58,6 +76,10 @@ class RtmpSession {
   void AddConn(std::shared_ptr<RtmpConnection> conn);
   void RemoveConn(std::shared_ptr<RtmpConnection> conn);
 
+  // HTTP-FLV 拉流端, 和 RTMP 拉流端一样在下一帧到来时收到元数据, 序列头和 GOP 缓存
+  void AddHttpFlvConn(std::shared_ptr<HttpFlvConnection> conn);
+  void RemoveHttpFlvConn(std::shared_ptr<HttpFlvConnection> conn);
+
   std::shared_ptr<RtmpConnection> GetPublisher();
   int GetClientsNum();
 
@@ -66,15 +88,76 @@ class RtmpSession {
     max_gop_cache_len_ = cacheLen;
   }
 
+  // 开启 HLS 输出, 推流端 publish 时调用, 已经开启时不重复创建
+  void SetHls(const std::string& name, uint32_t segment_ms, uint32_t list_size);
+
+  // 没有开启 HLS 时为 nullptr, HTTP 线程调用
+  std::shared_ptr<RtmpHls> GetHls() const { return std::atomic_load(&hls_); }
+
+  // 开启低延迟 HLS (CMAF) 输出, 推流端 publish 时调用, 已经开启时不重复创建
+  void SetLlHls(const std::string& name, uint32_t segment_ms, uint32_t part_ms,
+                uint32_t list_size);
+
+  // 没有开启低延迟 HLS 时为 nullptr, HTTP 线程调用
+  std::shared_ptr<RtmpLlHls> GetLlHls() const { return std::atomic_load(&ll_hls_); }
+
+  // 开启时移缓存, 推流端 publish 时调用, 已经开启时不重复创建
+  void SetTimeshift(const std::string& name, const RtmpTimeshiftOptions& options);
+
+  // 开始录制, 推流端 publish 时调用, 推流结束时关闭; 之前的录制会被关闭
+  void SetRecord(std::shared_ptr<RtmpRecordStream> record);
+
+  // 开始转发, 推流端 publish 时调用, 推流结束时关闭; 之前的转发会被关闭
+  void SetForward(std::shared_ptr<RtmpForwarder> forward);
+
+  // 没有转发时为 nullptr
+  std::shared_ptr<RtmpForwarder> GetForward() const { return std::atomic_load(&forward_); }
+
+  // 多进程模式下把推流写入帧总线, 推流端 publish 时调用, 推流结束时释放槽位
+  void SetBusWriter(std::shared_ptr<RtmpFrameBusWriter> writer);
+
+  const StreamStats& GetStats() const { return stats_; }
+
+  // 分阶段的帧延迟, 第一帧被采样之前为 nullptr
+  std::shared_ptr<const StreamLatency> GetLatency() const { return std::atomic_load(&latency_); }
+
+  // 遍历会话中的连接, 用于统计; 回调在会话锁内执行, 不能再调用会话的方法
+  void ForEachConn(
+      const std::function<void(const std::shared_ptr<RtmpConnection>& conn, bool is_publisher)>&
+          callback);
+
   void SaveGop(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size);
   void SendGop(std::shared_ptr<RtmpConnection> conn);
 
  private:
+  // rtmp_conns_ 或 http_flv_conns_ 变化后更新订阅者数, 需持有 mutex_
+  void UpdateSubscribers();
+
+  // 向 HTTP-FLV 拉流端转发, 每个消息只封装一次 FLV tag, 需持有 mutex_
+  void SendHttpFlv(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size);
+
+  // 按时移拉流端的延迟从时移缓存中发送已经到期的帧, 需持有 mutex_
+  void SendTimeshift(const std::shared_ptr<RtmpConnection>& conn);
+
+  // 起播数据: 元数据, 序列头和 GOP 缓存, 需持有 mutex_
+  void GetHttpFlvStartChunks(std::vector<std::shared_ptr<const HttpFlvChunk>>& chunks);
+
   struct AVFrame {
     uint8_t type = 0;                      // RTMP_AUDIO 或 RTMP_VIDEO
     uint64_t timestamp = 0;                // 对应绝对时间戳
     std::shared_ptr<char> data = nullptr;  // 存数据的数组指针
     uint32_t size = 0;                     // 占用字节数, data 数组大小
+    std::shared_ptr<const HttpFlvChunk> flv;  // 第一个 HTTP-FLV 拉流端起播时封装, 之后共用
+  };
+
+  struct TimeshiftCursor {
+    uint64_t seq = 0;    // 下一个要发送的帧
+    uint64_t delay = 0;  // 对齐到关键帧之后的实际延迟, 毫秒
+  };
+
+  struct HttpFlvPlayer {
+    std::weak_ptr<HttpFlvConnection> conn;
+    bool is_playing = false;  // 是否已经发送过起播数据
   };
 
   std::mutex mutex_;  // 多个 connection 分布在多个 thread 访问 session
@@ -82,6 +165,20 @@ class RtmpSession {
   bool has_publisher_ = false;
   std::weak_ptr<RtmpConnection> publisher_;
   std::unordered_map<SOCKET, std::weak_ptr<RtmpConnection>> rtmp_conns_;
+  std::unordered_map<SOCKET, HttpFlvPlayer> http_flv_conns_;
+  std::shared_ptr<const HttpFlvChunk> http_flv_meta_data_;  // 元数据变化后重新封装
+  StreamStats stats_;
+  std::shared_ptr<StreamLatency> latency_;  // 按需创建, 没开启采样的流不占用直方图内存
+  std::shared_ptr<RtmpHls> hls_;  // 在推流线程中封装, 和拉流端数量无关
+  std::shared_ptr<RtmpLlHls> ll_hls_;
+  // 串行化 HLS 和低延迟 HLS 的封装, Reset 和 Flush. 封装时不持有 mutex_,
+  // 两个锁都要持有时先 mutex_ 后 hls_mutex_
+  std::mutex hls_mutex_;
+  std::shared_ptr<RtmpRecordStream> record_;  // 只把帧的引用交给写线程
+  std::shared_ptr<RtmpForwarder> forward_;  // 只把帧的引用放进各上游的队列
+  std::shared_ptr<RtmpFrameBusWriter> bus_writer_;
+  std::shared_ptr<RtmpTimeshift> timeshift_;
+  std::unordered_map<SOCKET, TimeshiftCursor> timeshift_cursors_;  // 时移拉流端的播放位置
 
   std::shared_ptr<char> avc_sequence_header_;
   std::shared_ptr<char> aac_sequence_header_;
@@ -0,0 +1,222 @@
+/// @file RtmpSessionRegistry.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpSessionRegistry.h"
+
+#include <algorithm>
+
+RtmpSessionRegistry::ReadGuard::ReadGuard(const Shard& shard) : shard_(shard) {
+  // 先登记读者再取快照: 写者替换快照之后看到读者数为 0 时, 之前取到旧表的读者都已经离开
+  shard_.readers.fetch_add(1, std::memory_order_seq_cst);
+  table_ = shard_.table.load(std::memory_order_seq_cst);
+}
+
+RtmpSessionRegistry::ReadGuard::~ReadGuard() {
+  shard_.readers.fetch_sub(1, std::memory_order_release);
+}
+
+RtmpSessionRegistry::RtmpSessionRegistry() {
+  for (auto& shard : shards_) {
+    shard.table.store(new Table(), std::memory_order_release);
+  }
+}
+
+RtmpSessionRegistry::~RtmpSessionRegistry() {
+  for (auto& shard : shards_) {
+    delete shard.table.load(std::memory_order_acquire);
+    for (const Table* table : shard.retired) {
+      delete table;
+    }
+  }
+}
+
+uint64_t RtmpSessionRegistry::Hash(const char* data, size_t size, uint64_t seed) {
+  uint64_t hash = seed;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= (uint8_t)data[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+RtmpSessionRegistry::PathPtr RtmpSessionRegistry::InternPath(const std::string& app,
+                                                             const std::string& stream_name,
+                                                             uint64_t& hash) const {
+  hash = Hash("/", 1);
+  hash = Hash(app.data(), app.size(), hash);
+  hash = Hash("/", 1, hash);
+  hash = Hash(stream_name.data(), stream_name.size(), hash);
+
+  size_t size = app.size() + stream_name.size() + 2;
+  {
+    ReadGuard guard(GetShard(hash));
+    const Table& table = guard.GetTable();
+    auto iter = std::lower_bound(table.begin(), table.end(), hash,
+                                 [](const Entry& entry, uint64_t h) { return entry.hash < h; });
+    for (; iter != table.end() && iter->hash == hash; ++iter) {
+      const std::string& path = *iter->path;
+      if (path.size() == size && path[0] == '/' && path[app.size() + 1] == '/' &&
+          path.compare(1, app.size(), app) == 0 &&
+          path.compare(app.size() + 2, stream_name.size(), stream_name) == 0) {
+        return iter->path;
+      }
+    }
+  }
+
+  auto path = std::make_shared<std::string>();
+  path->reserve(size);
+  path->append(1, '/').append(app).append(1, '/').append(stream_name);
+  return path;
+}
+
+RtmpSessionRegistry::PathPtr RtmpSessionRegistry::InternPath(const char* path, size_t size,
+                                                             uint64_t& hash) const {
+  hash = Hash(path, size);
+  {
+    ReadGuard guard(GetShard(hash));
+    const Table& table = guard.GetTable();
+    auto iter = std::lower_bound(table.begin(), table.end(), hash,
+                                 [](const Entry& entry, uint64_t h) { return entry.hash < h; });
+    for (; iter != table.end() && iter->hash == hash; ++iter) {
+      if (iter->path->compare(0, std::string::npos, path, size) == 0) {
+        return iter->path;
+      }
+    }
+  }
+  return std::make_shared<const std::string>(path, size);
+}
+
+int RtmpSessionRegistry::FindEntry(const Table& table, uint64_t hash, const std::string& path) {
+  auto iter = std::lower_bound(table.begin(), table.end(), hash,
+                               [](const Entry& entry, uint64_t h) { return entry.hash < h; });
+  // 哈希冲突时相同 hash 的条目相邻, 逐个比较字符串
+  for (; iter != table.end() && iter->hash == hash; ++iter) {
+    if (*iter->path == path) {
+      return (int)(iter - table.begin());
+    }
+  }
+  return -1;
+}
+
+void RtmpSessionRegistry::Publish(Shard& shard, const Table* table) {
+  const Table* old = shard.table.exchange(table, std::memory_order_seq_cst);
+  shard.retired.push_back(old);
+  Reclaim(shard);
+}
+
+void RtmpSessionRegistry::Reclaim(Shard& shard) {
+  if (shard.retired.empty() || shard.readers.load(std::memory_order_seq_cst) != 0) {
+    return;
+  }
+  for (const Table* table : shard.retired) {
+    delete table;
+  }
+  shard.retired.clear();
+}
+
+RtmpSession::Ptr RtmpSessionRegistry::Find(uint64_t hash, const std::string& path) const {
+  ReadGuard guard(GetShard(hash));
+  const Table& table = guard.GetTable();
+  int index = FindEntry(table, hash, path);
+  if (index < 0) {
+    return nullptr;
+  }
+  return table[index].session;
+}
+
+RtmpSession::Ptr RtmpSessionRegistry::FindOrCreate(uint64_t hash, const std::string& path) {
+  // 绝大多数情况下会话已经存在, 先在快照中查找, 不获取分片的写锁
+  RtmpSession::Ptr session = Find(hash, path);
+  if (session) {
+    return session;
+  }
+
+  // 持有写锁时快照不会被替换, 可以直接使用
+  Shard& shard = GetShard(hash);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const Table& table = *shard.table.load(std::memory_order_relaxed);
+  int index = FindEntry(table, hash, path);
+  if (index >= 0) {  // 等锁期间其他线程已经创建
+    return table[index].session;
+  }
+
+  Entry entry;
+  entry.hash = hash;
+  entry.path = std::make_shared<const std::string>(path);
+  entry.session = std::make_shared<RtmpSession>();
+  session = entry.session;
+
+  Table* new_table = new Table();
+  new_table->reserve(table.size() + 1);
+  auto pos = std::upper_bound(table.begin(), table.end(), hash,
+                              [](uint64_t h, const Entry& e) { return h < e.hash; });
+  new_table->insert(new_table->end(), table.begin(), pos);
+  new_table->push_back(std::move(entry));
+  new_table->insert(new_table->end(), pos, table.end());
+  Publish(shard, new_table);
+  return session;
+}
+
+bool RtmpSessionRegistry::Remove(uint64_t hash, const std::string& path) {
+  Shard& shard = GetShard(hash);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  const Table& table = *shard.table.load(std::memory_order_relaxed);
+  int index = FindEntry(table, hash, path);
+  if (index < 0) {
+    return false;
+  }
+
+  Table* new_table = new Table(table);
+  new_table->erase(new_table->begin() + index);
+  Publish(shard, new_table);
+  return true;
+}
+
+size_t RtmpSessionRegistry::RemoveIf(const Predicate& pred) {
+  size_t removed = 0;
+  for (auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const Table& table = *shard.table.load(std::memory_order_relaxed);
+    if (table.empty()) {
+      Reclaim(shard);
+      continue;
+    }
+
+    std::unique_ptr<Table> new_table(new Table());
+    new_table->reserve(table.size());
+    for (const auto& entry : table) {
+      if (!pred(entry.session)) {
+        new_table->push_back(entry);
+      }
+    }
+
+    if (new_table->size() == table.size()) {
+      Reclaim(shard);
+      continue;
+    }
+    removed += table.size() - new_table->size();
+    Publish(shard, new_table.release());
+  }
+  return removed;
+}
+
+size_t RtmpSessionRegistry::Size() const {
+  size_t size = 0;
+  for (const auto& shard : shards_) {
+    ReadGuard guard(shard);
+    size += guard.GetTable().size();
+  }
+  return size;
+}
+
+void RtmpSessionRegistry::ForEach(const Visitor& visitor) const {
+  for (const auto& shard : shards_) {
+    ReadGuard guard(shard);
+    for (const auto& entry : guard.GetTable()) {
+      visitor(*entry.path, entry.session);
+    }
+  }
+}
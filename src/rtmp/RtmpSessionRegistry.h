@@ -0,0 +1,109 @@
+/// @file RtmpSessionRegistry.h
+/// @brief 分片的流会话注册表, 以流路径的哈希值为键
+///        1. 按哈希值分成 kShardCount 个分片, 不同流的增删互不阻塞
+///        2. 每个分片的表是写时复制的只读快照, 通过原子的裸指针发布, 查找不加锁:
+///           读者只在分片的读者计数上加减一次, 写者替换快照之后把旧表放进待释放列表,
+///           分片上没有读者时才释放, 没来得及释放的在下一次写入或者定时清理 (RemoveIf) 时释放
+///        3. 流路径字符串在注册表中只保存一份, InternPath 返回同一个共享的字符串,
+///           已经注册的流不需要为每个连接拼接和分配路径
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_SESSION_REGISTRY_H
+#define RTMP_SERVER_RTMP_SESSION_REGISTRY_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "RtmpSession.h"
+
+class RtmpSessionRegistry {
+ public:
+  using Predicate = std::function<bool(const RtmpSession::Ptr& session)>;
+  using Visitor = std::function<void(const std::string& path, const RtmpSession::Ptr& session)>;
+  using PathPtr = std::shared_ptr<const std::string>;
+
+  RtmpSessionRegistry();
+  ~RtmpSessionRegistry();
+  RtmpSessionRegistry(const RtmpSessionRegistry&) = delete;
+  RtmpSessionRegistry& operator=(const RtmpSessionRegistry&) = delete;
+
+  // 流路径的 64 位 FNV-1a 哈希, 连接在确定流路径时计算一次并保存.
+  // seed 为前一段的哈希, 可以分段计算, 结果和整个字符串一次计算相同
+  static const uint64_t kHashSeed = 14695981039346656037ULL;
+  static uint64_t Hash(const char* data, size_t size, uint64_t seed = kHashSeed);
+  static uint64_t Hash(const std::string& path) { return Hash(path.data(), path.size()); }
+
+  // 流路径 "/app/stream" 的共享字符串和哈希, 已经注册的流返回注册表中的字符串, 不拼接也不分配
+  PathPtr InternPath(const std::string& app, const std::string& stream_name,
+                     uint64_t& hash) const;
+  // path 为完整的流路径
+  PathPtr InternPath(const char* path, size_t size, uint64_t& hash) const;
+
+  // 只读查找, 不存在返回 nullptr, 不会创建会话
+  RtmpSession::Ptr Find(uint64_t hash, const std::string& path) const;
+
+  // 查找会话, 不存在时创建
+  RtmpSession::Ptr FindOrCreate(uint64_t hash, const std::string& path);
+
+  bool Remove(uint64_t hash, const std::string& path);
+
+  // 删除所有满足条件的会话, 返回删除的个数. 同时释放各分片中已经没有读者的旧表
+  size_t RemoveIf(const Predicate& pred);
+
+  size_t Size() const;
+
+  // 在各分片的快照上遍历, 遍历期间不持有分片的写锁
+  void ForEach(const Visitor& visitor) const;
+
+ private:
+  struct Entry {
+    uint64_t hash = 0;
+    PathPtr path;  // 写者复制快照时只复制指针, 不复制字符串
+    RtmpSession::Ptr session;
+  };
+
+  // 按 hash 升序排列, 快照一旦发布就不再修改
+  using Table = std::vector<Entry>;
+
+  struct Shard {
+    std::mutex mutex;                          // 只用于串行化写者
+    std::atomic<const Table*> table{nullptr};  // 当前快照, 读者不获取 mutex
+    mutable std::atomic<uint32_t> readers{0};  // 正在使用快照的读者数
+    std::vector<const Table*> retired;         // 被替换下来等待释放的旧表, 在 mutex 内访问
+  };
+
+  // 读者在构造和析构之间可以使用分片的快照, 期间快照不会被释放
+  class ReadGuard {
+   public:
+    explicit ReadGuard(const Shard& shard);
+    ~ReadGuard();
+    const Table& GetTable() const { return *table_; }
+
+   private:
+    const Shard& shard_;
+    const Table* table_;
+  };
+
+  static const uint32_t kShardCount = 64;
+
+  Shard& GetShard(uint64_t hash) { return shards_[hash & (kShardCount - 1)]; }
+  const Shard& GetShard(uint64_t hash) const { return shards_[hash & (kShardCount - 1)]; }
+
+  // 在快照中查找, 返回下标, 不存在返回 -1
+  static int FindEntry(const Table& table, uint64_t hash, const std::string& path);
+
+  // 在 shard.mutex 内调用: 发布新表, 旧表在没有读者时释放
+  static void Publish(Shard& shard, const Table* table);
+  static void Reclaim(Shard& shard);
+
+  Shard shards_[kShardCount];
+};
+
+#endif  // RTMP_SERVER_RTMP_SESSION_REGISTRY_H
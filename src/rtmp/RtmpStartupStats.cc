@@ -0,0 +1,62 @@
+/// @file RtmpStartupStats.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpStartupStats.h"
+
+const size_t RtmpStartupStats::kMaxApps;
+const char *const RtmpStartupStats::kOverflowApp = "_other";
+
+namespace {
+
+// 两个阶段都发生且顺序正确时才记录
+void RecordStage(LatencyHistogram &histogram, int64_t begin_ns, int64_t end_ns) {
+  if (begin_ns > 0 && end_ns >= begin_ns) {
+    histogram.Record(end_ns - begin_ns);
+  }
+}
+
+}  // namespace
+
+void StartupTrace::OnFirstKeyFrameSent(int64_t now_ns) {
+  if (first_keyframe_ns != 0) {
+    return;
+  }
+
+  first_keyframe_ns = now_ns;
+  if (!latency) {
+    return;
+  }
+
+  RecordStage(latency->handshake_ns, accept_ns, handshake_ns);
+  RecordStage(latency->connect_ns, handshake_ns, connect_ns);
+  RecordStage(latency->create_stream_ns, connect_ns, create_stream_ns);
+  RecordStage(latency->play_ns, create_stream_ns, play_ns);
+  RecordStage(latency->sequence_header_ns, play_ns, sequence_header_ns);
+  RecordStage(latency->first_keyframe_ns, sequence_header_ns, first_keyframe_ns);
+  RecordStage(latency->total_ns, accept_ns, first_keyframe_ns);
+}
+
+std::shared_ptr<StartupLatency> RtmpStartupStats::Get(const std::string &app) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto iter = apps_.find(app);
+  if (iter != apps_.end()) {
+    return iter->second;
+  }
+
+  std::shared_ptr<StartupLatency> &latency =
+      apps_.size() < kMaxApps ? apps_[app] : apps_[kOverflowApp];
+  if (!latency) {
+    latency = std::make_shared<StartupLatency>();
+  }
+  return latency;
+}
+
+void RtmpStartupStats::ForEach(const Visitor &visitor) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto &app : apps_) {
+    visitor(app.first, *app.second);
+  }
+}
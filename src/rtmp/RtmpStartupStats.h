@@ -0,0 +1,76 @@
+/// @file RtmpStartupStats.h
+/// @brief 拉流端起播耗时 (time-to-first-frame) 统计, 按 app 聚合
+///        accept -> 握手完成 -> connect -> createStream -> play -> 第一个序列头入发送队列
+///        -> 第一个关键帧全部写入内核, 同时记录起播时 GOP 缓存突发发送的字节数,
+///        用于根据真实的起播延迟调整 GOP 缓存策略和 chunk 大小
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_STARTUP_STATS_H
+#define RTMP_SERVER_RTMP_STARTUP_STATS_H
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "FrameTrace.h"
+#include "LatencyHistogram.h"
+
+// 一个 app 下所有拉流端的起播耗时分布, 单位纳秒
+struct StartupLatency {
+  LatencyHistogram handshake_ns;        // accept -> 握手完成
+  LatencyHistogram connect_ns;          // 握手完成 -> connect
+  LatencyHistogram create_stream_ns;    // connect -> createStream
+  LatencyHistogram play_ns;             // createStream -> play
+  LatencyHistogram sequence_header_ns;  // play -> 第一个序列头入发送队列, 包含等待推流端的时间
+  LatencyHistogram first_keyframe_ns;   // 第一个序列头 -> 第一个关键帧全部写入内核
+  LatencyHistogram total_ns;            // accept -> 第一个关键帧全部写入内核
+  LatencyHistogram gop_burst_bytes;     // 起播时从 GOP 缓存一次性发送的字节数
+};
+
+// 一个拉流连接的起播时间线, 时间戳由连接所在线程写入, 0 表示该阶段未发生
+struct StartupTrace {
+  int64_t accept_ns = 0;
+  int64_t handshake_ns = 0;
+  int64_t connect_ns = 0;
+  int64_t create_stream_ns = 0;
+  int64_t play_ns = 0;
+  int64_t sequence_header_ns = 0;
+  int64_t first_keyframe_ns = 0;
+  bool keyframe_queued = false;             // 第一个关键帧已经进入发送队列
+  std::shared_ptr<StartupLatency> latency;  // play 时按 app 绑定, 之后不再修改
+
+  // 第一个关键帧发送完成, 把各阶段耗时记录到 latency, 每个连接只记录一次
+  void OnFirstKeyFrameSent(int64_t now_ns);
+};
+
+// 第一个关键帧数据包的发送回调
+struct StartupPacketTrace : public PacketTrace {
+  std::shared_ptr<StartupTrace> startup;
+
+  void OnSent(int64_t now_ns) const override { startup->OnFirstKeyFrameSent(now_ns); }
+};
+
+class RtmpStartupStats {
+ public:
+  using Visitor = std::function<void(const std::string &app, const StartupLatency &latency)>;
+
+  // app 数量超过上限后都归到 kOverflowApp, 防止客户端随意构造 app 名撑大内存
+  static const size_t kMaxApps = 256;
+  static const char *const kOverflowApp;
+
+  // 返回 app 对应的统计, 不存在则创建; 每个拉流端 play 时调用一次
+  std::shared_ptr<StartupLatency> Get(const std::string &app);
+
+  void ForEach(const Visitor &visitor) const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::map<std::string, std::shared_ptr<StartupLatency>> apps_;
+};
+
+#endif  // RTMP_SERVER_RTMP_STARTUP_STATS_H
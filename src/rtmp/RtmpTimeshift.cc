@@ -0,0 +1,214 @@
+/// @file RtmpTimeshift.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpTimeshift.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "Logger.h"
+#include "rtmp.h"
+
+RtmpTimeshift::RtmpTimeshift(const std::string &name, const RtmpTimeshiftOptions &options)
+    : options_(options) {
+  if (options_.spill_dir.empty() || options_.spill_bytes == 0) {
+    return;
+  }
+
+  std::string path = options_.spill_dir + "/";
+  for (char c : name) {
+    path.push_back(isalnum((unsigned char)c) || c == '-' ? c : '_');
+  }
+  path += ".timeshift";
+
+  // 文件只通过映射访问, 创建后立即删除, 进程退出时自动释放
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    LOG_ERROR("[Timeshift] open %s failed\n", path.c_str());
+    return;
+  }
+  ::unlink(path.c_str());
+
+  if (ftruncate(fd, (off_t)options_.spill_bytes) == 0) {
+    void *addr = mmap(nullptr, options_.spill_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr != MAP_FAILED) {
+      spill_ = (char *)addr;
+    }
+  }
+  ::close(fd);
+
+  if (spill_ == nullptr) {
+    LOG_ERROR("[Timeshift] map %s failed\n", path.c_str());
+  }
+}
+
+RtmpTimeshift::~RtmpTimeshift() {
+  if (spill_ != nullptr) {
+    munmap(spill_, options_.spill_bytes);
+  }
+}
+
+void RtmpTimeshift::OnMedia(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data,
+                            uint32_t size) {
+  if ((type != RTMP_VIDEO && type != RTMP_AUDIO) || data == nullptr || size == 0) {
+    return;
+  }
+
+  // 只有音频的流每一帧都可以起播
+  bool is_key_frame = false;
+  if (type == RTMP_VIDEO) {
+    has_video_ = true;
+    is_key_frame = (((uint8_t)data.get()[0] >> 4) & 0x0f) == 1;
+  } else {
+    is_key_frame = !has_video_;
+  }
+
+  if (is_key_frame) {
+    KeyFrame key_frame;
+    key_frame.seq = GetEnd();
+    key_frame.timestamp = timestamp;
+    keyframes_.push_back(key_frame);
+  }
+
+  Frame frame;
+  frame.type = type;
+  frame.timestamp = timestamp;
+  frame.data = std::move(data);
+  frame.size = size;
+  frames_.push_back(std::move(frame));
+  bytes_ += size;
+  last_timestamp_ = timestamp;
+
+  Evict();
+}
+
+void RtmpTimeshift::Reset() {
+  begin_ = GetEnd();  // 序号继续增长, 之前的序号不会读到新的帧
+  frames_.clear();
+  bytes_ = 0;
+  last_timestamp_ = 0;
+  has_video_ = false;
+  keyframes_.clear();
+  spill_pos_ = 0;
+  spill_frames_.clear();
+}
+
+bool RtmpTimeshift::Seek(uint64_t timestamp, uint64_t &seq) const {
+  if (keyframes_.empty()) {
+    return false;
+  }
+
+  auto iter = std::upper_bound(
+      keyframes_.begin(), keyframes_.end(), timestamp,
+      [](uint64_t value, const KeyFrame &key_frame) { return value < key_frame.timestamp; });
+  if (iter != keyframes_.begin()) {
+    iter--;
+  }
+  seq = iter->seq;
+  return true;
+}
+
+bool RtmpTimeshift::Get(uint64_t seq, Frame &frame) const {
+  if (seq >= begin_) {
+    if (seq >= GetEnd()) {
+      return false;
+    }
+    frame = frames_[seq - begin_];
+    return true;
+  }
+
+  if (spill_frames_.empty() || seq < spill_frames_.front().seq) {
+    return false;
+  }
+
+  const SpillFrame &spill_frame = spill_frames_[seq - spill_frames_.front().seq];
+  frame.type = spill_frame.type;
+  frame.timestamp = spill_frame.timestamp;
+  frame.size = spill_frame.size;
+  frame.data.reset(new char[spill_frame.size], std::default_delete<char[]>());
+  memcpy(frame.data.get(), spill_ + spill_frame.offset, spill_frame.size);
+  return true;
+}
+
+uint64_t RtmpTimeshift::GetDuration() const {
+  uint64_t first = last_timestamp_;
+  if (!spill_frames_.empty()) {
+    first = spill_frames_.front().timestamp;
+  } else if (!frames_.empty()) {
+    first = frames_.front().timestamp;
+  }
+  return last_timestamp_ > first ? last_timestamp_ - first : 0;
+}
+
+void RtmpTimeshift::Evict() {
+  while (!frames_.empty()) {
+    const Frame &front = frames_.front();
+    bool expired = last_timestamp_ > front.timestamp &&
+                   last_timestamp_ - front.timestamp > options_.max_ms;
+    if (!expired && bytes_ <= options_.max_bytes) {
+      break;
+    }
+
+    if (!expired && spill_ != nullptr) {
+      Spill(front);
+    } else {
+      spill_frames_.clear();  // 文件中的帧更老, 同样过期, 而且序号必须连续
+    }
+    bytes_ -= front.size;
+    frames_.pop_front();
+    begin_ += 1;
+  }
+
+  while (!spill_frames_.empty() && last_timestamp_ > spill_frames_.front().timestamp &&
+         last_timestamp_ - spill_frames_.front().timestamp > options_.max_ms) {
+    spill_frames_.pop_front();
+  }
+
+  DropKeyFrames();
+}
+
+void RtmpTimeshift::Spill(const Frame &frame) {
+  if (frame.size > options_.spill_bytes) {
+    spill_frames_.clear();
+    return;
+  }
+
+  // 环形文件中的帧按写入顺序排列, 写入位置之后的是最老的帧, 依次被覆盖
+  uint64_t pos = spill_pos_;
+  if (pos + frame.size > options_.spill_bytes) {
+    while (!spill_frames_.empty() && spill_frames_.front().offset >= pos) {
+      spill_frames_.pop_front();
+    }
+    pos = 0;
+  }
+  while (!spill_frames_.empty() && spill_frames_.front().offset >= pos &&
+         spill_frames_.front().offset < pos + frame.size) {
+    spill_frames_.pop_front();
+  }
+
+  memcpy(spill_ + pos, frame.data.get(), frame.size);
+
+  SpillFrame spill_frame;
+  spill_frame.seq = begin_;
+  spill_frame.type = frame.type;
+  spill_frame.timestamp = frame.timestamp;
+  spill_frame.offset = pos;
+  spill_frame.size = frame.size;
+  spill_frames_.push_back(spill_frame);
+  spill_pos_ = pos + frame.size;
+}
+
+void RtmpTimeshift::DropKeyFrames() {
+  uint64_t begin = GetBegin();
+  while (!keyframes_.empty() && keyframes_.front().seq < begin) {
+    keyframes_.pop_front();
+  }
+}
@@ -0,0 +1,102 @@
+/// @file RtmpTimeshift.h
+/// @brief 时移缓存: 保存一路流最近 N 分钟的音视频帧 (引用推流端的 payload, 不拷贝) 和关键帧索引,
+///        拉流端在 play 命令中带 start 参数时, 从直播之前 start 毫秒处的关键帧开始播放
+///        内存按字节预算限制, 超出预算的老帧可以溢出到 mmap 映射的环形文件, 仍然在时长窗口内可以回看
+///        只在会话锁内访问, 不加锁
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_TIMESHIFT_H
+#define RTMP_SERVER_RTMP_TIMESHIFT_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+struct RtmpTimeshiftOptions {
+  uint32_t max_ms = 0;                 // 保存的时长, 0 表示关闭时移
+  uint64_t max_bytes = 256 << 20;      // 每路流在内存中保存的字节数上限
+  std::string spill_dir;               // 非空时超出内存预算的帧写入这个目录下的环形文件
+  uint64_t spill_bytes = 1ULL << 30;   // 每路流环形文件的大小
+};
+
+class RtmpTimeshift {
+ public:
+  struct Frame {
+    uint8_t type = 0;  // RTMP_AUDIO 或 RTMP_VIDEO
+    uint64_t timestamp = 0;
+    std::shared_ptr<char> data;
+    uint32_t size = 0;
+  };
+
+  // name 用于环形文件的文件名, 文件创建后立即删除, 只通过映射访问
+  RtmpTimeshift(const std::string &name, const RtmpTimeshiftOptions &options);
+  ~RtmpTimeshift();
+  RtmpTimeshift(const RtmpTimeshift &) = delete;
+  RtmpTimeshift &operator=(const RtmpTimeshift &) = delete;
+
+  // 保存一帧音视频, 序列头不保存
+  void OnMedia(uint8_t type, uint64_t timestamp, std::shared_ptr<char> data, uint32_t size);
+
+  // 推流端重新 publish 时清空, 时间戳重新开始
+  void Reset();
+
+  // 时间戳不晚于 timestamp 的最后一个关键帧的序号, 都晚于 timestamp 时返回最早的关键帧,
+  // 没有关键帧返回 false
+  bool Seek(uint64_t timestamp, uint64_t &seq) const;
+
+  // 按序号读取一帧, 已经淘汰或者还没有收到返回 false; 溢出到文件的帧拷贝一份
+  bool Get(uint64_t seq, Frame &frame) const;
+
+  // 可以读取的序号范围 [GetBegin, GetEnd)
+  uint64_t GetBegin() const { return spill_frames_.empty() ? begin_ : spill_frames_.front().seq; }
+  uint64_t GetEnd() const { return begin_ + frames_.size(); }
+
+  uint64_t GetLastTimestamp() const { return last_timestamp_; }
+
+  // 最早的帧到最新的帧的时长, 毫秒
+  uint64_t GetDuration() const;
+
+  uint64_t GetMemoryBytes() const { return bytes_; }
+  size_t GetKeyFrames() const { return keyframes_.size(); }
+  bool HasSpill() const { return spill_ != nullptr; }
+
+ private:
+  struct SpillFrame {
+    uint64_t seq = 0;
+    uint8_t type = 0;
+    uint64_t timestamp = 0;
+    uint64_t offset = 0;  // 在环形文件中的位置
+    uint32_t size = 0;
+  };
+
+  struct KeyFrame {
+    uint64_t seq = 0;
+    uint64_t timestamp = 0;
+  };
+
+  // 淘汰超出时长窗口和内存预算的帧
+  void Evict();
+
+  // 内存中最老的帧写入环形文件, 覆盖的老帧被淘汰
+  void Spill(const Frame &frame);
+
+  void DropKeyFrames();
+
+  const RtmpTimeshiftOptions options_;
+
+  std::deque<Frame> frames_;  // 内存中的帧, 第一帧的序号为 begin_
+  uint64_t begin_ = 0;
+  uint64_t bytes_ = 0;
+  uint64_t last_timestamp_ = 0;
+  bool has_video_ = false;
+  std::deque<KeyFrame> keyframes_;  // 覆盖内存和环形文件中的帧
+
+  char *spill_ = nullptr;  // 环形文件的映射, 序号紧接在内存中的帧之前
+  uint64_t spill_pos_ = 0;
+  std::deque<SpillFrame> spill_frames_;
+};
+
+#endif  // RTMP_SERVER_RTMP_TIMESHIFT_H
@@ -0,0 +1,251 @@
+/// @file RtmpVod.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "RtmpVod.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#include "RtmpConnection.h"
+#include "TaskScheduler.h"
+#include "Timestamp.h"
+#include "rtmp.h"
+
+namespace {
+
+// 元数据和序列头都在文件开头, 最多看这么多个 tag
+const int kHeadTags = 64;
+
+}  // namespace
+
+std::shared_ptr<RtmpVodFile> RtmpVodFile::Open(const std::string &path) {
+  std::shared_ptr<RtmpVodFile> file(new RtmpVodFile);
+  if (!file->file_.Open(path.c_str())) {
+    return nullptr;
+  }
+
+  size_t pos = file->GetFirstTag();
+  bool has_frame = false;
+  RtmpVodFrame frame;
+  for (int i = 0; i < kHeadTags; i++) {
+    size_t tag_pos = pos;
+    if (!file->Read(pos, frame)) {
+      break;
+    }
+
+    if (frame.type == RTMP_DATA_MESSAGE && file->meta_data_.empty()) {
+      AmfReader reader(frame.data.get(), frame.size);
+      AmfStringView name;
+      if (reader.ReadString(name) && name == "onMetaData") {
+        AmfDecoder decoder;
+        decoder.Decode(frame.data.get() + reader.Position(), frame.size - reader.Position());
+        file->meta_data_ = decoder.GetObjects();
+      }
+    } else if (IsAvcSequenceHeader(frame)) {
+      if (file->avc_sequence_header_ == 0) {
+        file->avc_sequence_header_ = tag_pos;
+      }
+    } else if (IsAacSequenceHeader(frame)) {
+      if (file->aac_sequence_header_ == 0) {
+        file->aac_sequence_header_ = tag_pos;
+      }
+    } else if ((frame.type == RTMP_VIDEO || frame.type == RTMP_AUDIO) && !has_frame) {
+      file->first_timestamp_ = frame.timestamp;
+      has_frame = true;
+    }
+  }
+  return file;
+}
+
+bool RtmpVodFile::Read(size_t &pos, RtmpVodFrame &frame) {
+  FlvTag tag;
+  if (!file_.ReadTag(pos, tag)) {
+    return false;
+  }
+
+  frame.type = tag.type;
+  frame.timestamp = tag.timestamp;
+  frame.size = tag.size;
+  // 和文件共用引用计数, 最后一个帧释放之前映射一直有效
+  frame.data = std::shared_ptr<char>(shared_from_this(), (char *)tag.data);
+  return true;
+}
+
+size_t RtmpVodFile::Seek(uint32_t timestamp) {
+  std::call_once(index_once_, [this] { BuildIndex(); });
+  if (keyframes_.empty()) {
+    return GetFirstTag();
+  }
+
+  auto iter = std::upper_bound(
+      keyframes_.begin(), keyframes_.end(), timestamp,
+      [](uint32_t value, const KeyFrame &key_frame) { return value < key_frame.timestamp; });
+  if (iter != keyframes_.begin()) {
+    iter--;
+  }
+  return iter->pos;
+}
+
+size_t RtmpVodFile::GetKeyFrames() {
+  std::call_once(index_once_, [this] { BuildIndex(); });
+  return keyframes_.size();
+}
+
+void RtmpVodFile::BuildIndex() {
+  // 只读 tag 头, 不需要 payload 的引用
+  size_t pos = GetFirstTag();
+  FlvTag tag;
+  while (true) {
+    size_t tag_pos = pos;
+    if (!file_.ReadTag(pos, tag)) {
+      break;
+    }
+    if (tag.type == RTMP_VIDEO && tag.size >= 2 && ((tag.data[0] >> 4) & 0x0f) == 1 &&
+        !((tag.data[0] & 0x0f) == RTMP_CODEC_ID_H264 && tag.data[1] == 0)) {
+      KeyFrame key_frame;
+      key_frame.timestamp = tag.timestamp;
+      key_frame.pos = tag_pos;
+      keyframes_.push_back(key_frame);
+    }
+  }
+}
+
+bool RtmpVodFile::IsAvcSequenceHeader(const RtmpVodFrame &frame) {
+  const uint8_t *p = (const uint8_t *)frame.data.get();
+  return frame.type == RTMP_VIDEO && frame.size >= 2 && (p[0] & 0x0f) == RTMP_CODEC_ID_H264 &&
+         p[1] == 0;
+}
+
+bool RtmpVodFile::IsAacSequenceHeader(const RtmpVodFrame &frame) {
+  const uint8_t *p = (const uint8_t *)frame.data.get();
+  return frame.type == RTMP_AUDIO && frame.size >= 2 &&
+         ((p[0] >> 4) & 0x0f) == RTMP_CODEC_ID_AAC && p[1] == 0;
+}
+
+bool RtmpVodFile::IsKeyFrame(const RtmpVodFrame &frame) {
+  const uint8_t *p = (const uint8_t *)frame.data.get();
+  return frame.type == RTMP_VIDEO && frame.size >= 2 && ((p[0] >> 4) & 0x0f) == 1 &&
+         !IsAvcSequenceHeader(frame);
+}
+
+std::shared_ptr<RtmpVodFile> RtmpVodCache::Get(const std::string &path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  clock_ += 1;
+
+  auto iter = files_.find(path);
+  if (iter != files_.end() && iter->second.size == st.st_size &&
+      iter->second.mtime.tv_sec == st.st_mtim.tv_sec &&
+      iter->second.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+    iter->second.last_used = clock_;
+    return iter->second.file;
+  }
+
+  // 文件变化后重新映射, 正在播放旧文件的拉流端继续持有旧的映射
+  auto file = RtmpVodFile::Open(path);
+  if (file == nullptr) {
+    files_.erase(path);
+    return nullptr;
+  }
+
+  if (iter == files_.end() && files_.size() >= max_files_) {
+    auto oldest = std::min_element(
+        files_.begin(), files_.end(),
+        [](const std::pair<const std::string, Entry> &a,
+           const std::pair<const std::string, Entry> &b) {
+          return a.second.last_used < b.second.last_used;
+        });
+    files_.erase(oldest);
+  }
+
+  Entry &entry = files_[path];
+  entry.file = file;
+  entry.size = st.st_size;
+  entry.mtime = st.st_mtim;
+  entry.last_used = clock_;
+  return file;
+}
+
+size_t RtmpVodCache::GetFiles() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return files_.size();
+}
+
+RtmpVodPlayer::RtmpVodPlayer(std::shared_ptr<RtmpVodFile> file, double speed)
+    : file_(file), speed_(speed > 0 ? speed : 1.0) {}
+
+void RtmpVodPlayer::Start(std::shared_ptr<RtmpConnection> conn, uint32_t start_ms) {
+  conn_ = conn;
+  pos_ = file_->GetFirstTag();
+  if (start_ms > 0) {
+    pos_ = file_->Seek(file_->GetFirstTimestamp() + start_ms);
+  }
+
+  conn->SendMetaData(file_->GetMetaData());
+  RtmpVodFrame frame;
+  if (file_->GetAvcSequenceHeader(frame)) {
+    conn->SendMediaData(RTMP_AVC_SEQUENCE_HEADER, 0, frame.data, frame.size);
+  }
+  if (file_->GetAacSequenceHeader(frame)) {
+    conn->SendMediaData(RTMP_AAC_SEQUENCE_HEADER, 0, frame.data, frame.size);
+  }
+
+  // 第一个音视频帧的时间戳作为起点
+  base_timestamp_ = file_->GetFirstTimestamp();
+  size_t pos = pos_;
+  while (file_->Read(pos, frame)) {
+    if (frame.type == RTMP_VIDEO || frame.type == RTMP_AUDIO) {
+      base_timestamp_ = frame.timestamp;
+      break;
+    }
+  }
+  start_ns_ = Timestamp::NowNanos();
+
+  if (OnTimer()) {
+    std::weak_ptr<RtmpVodPlayer> weak_player = shared_from_this();
+    conn->GetTaskScheduler()->AddTimer(
+        [weak_player] {
+          auto player = weak_player.lock();
+          return player != nullptr && player->OnTimer();
+        },
+        kIntervalMs);
+  }
+}
+
+bool RtmpVodPlayer::OnTimer() {
+  auto conn = conn_.lock();
+  if (conn == nullptr || conn->IsClosed() || finished_) {
+    return false;
+  }
+
+  double elapsed_ms = (Timestamp::NowNanos() - start_ns_) / 1000000.0 * speed_;
+  uint64_t deadline = (uint64_t)base_timestamp_ + kBurstMs + (uint64_t)elapsed_ms;
+
+  RtmpVodFrame frame;
+  while (true) {
+    size_t pos = pos_;
+    if (!file_->Read(pos, frame)) {
+      finished_ = true;
+      return false;
+    }
+    if ((frame.type == RTMP_VIDEO || frame.type == RTMP_AUDIO) && frame.timestamp > deadline) {
+      return true;
+    }
+    pos_ = pos;
+
+    // 序列头已经在起播时发送, 脚本 tag (元数据, 录制文件末尾的关键帧索引) 不转发
+    if (frame.type == RTMP_VIDEO && !RtmpVodFile::IsAvcSequenceHeader(frame)) {
+      conn->SendMediaData(RTMP_VIDEO, frame.timestamp, frame.data, frame.size);
+    } else if (frame.type == RTMP_AUDIO && !RtmpVodFile::IsAacSequenceHeader(frame)) {
+      conn->SendMediaData(RTMP_AUDIO, frame.timestamp, frame.data, frame.size);
+    }
+  }
+}
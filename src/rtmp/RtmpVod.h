@@ -0,0 +1,136 @@
+/// @file RtmpVod.h
+/// @brief FLV 点播: 拉流的流没有推流端时, 从点播目录中找同名的 FLV 文件播放
+///        文件整个映射到内存, 多个拉流端共用一个映射, 发送的 payload 直接引用映射的内存, 不拷贝
+///        关键帧索引在第一次定位时才扫描文件建立, 之后缓存在文件对象中
+///        每个拉流端按文件的时间戳实时发送, 也可以按倍速发送追赶进度
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_RTMP_VOD_H
+#define RTMP_SERVER_RTMP_VOD_H
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FlvFile.h"
+#include "amf.h"
+
+class RtmpConnection;
+
+struct RtmpVodFrame {
+  uint8_t type = 0;  // RTMP_AUDIO, RTMP_VIDEO 或 RTMP_DATA_MESSAGE, 与 FLV tag 类型相同
+  uint32_t timestamp = 0;
+  std::shared_ptr<char> data;  // 指向映射的内存, 同时持有文件
+  uint32_t size = 0;
+};
+
+// 映射的点播文件, 只读, 多个线程共用
+class RtmpVodFile : public std::enable_shared_from_this<RtmpVodFile> {
+ public:
+  // 映射文件并读取开头的元数据和序列头, 失败返回 nullptr
+  static std::shared_ptr<RtmpVodFile> Open(const std::string &path);
+
+  // 读取 pos 处的 tag, pos 移到下一个 tag, 到文件末尾返回 false
+  bool Read(size_t &pos, RtmpVodFrame &frame);
+
+  // 时间戳不晚于 timestamp 的最后一个关键帧的位置, 第一次调用时建立关键帧索引
+  size_t Seek(uint32_t timestamp);
+
+  size_t GetFirstTag() const { return file_.FirstTag(); }
+  uint32_t GetFirstTimestamp() const { return first_timestamp_; }
+  size_t GetSize() const { return file_.Size(); }
+  size_t GetKeyFrames();
+
+  const AmfObjects &GetMetaData() const { return meta_data_; }
+
+  // 文件开头没有对应的序列头时返回 false
+  bool GetAvcSequenceHeader(RtmpVodFrame &frame) { return ReadAt(avc_sequence_header_, frame); }
+  bool GetAacSequenceHeader(RtmpVodFrame &frame) { return ReadAt(aac_sequence_header_, frame); }
+
+  static bool IsAvcSequenceHeader(const RtmpVodFrame &frame);
+  static bool IsAacSequenceHeader(const RtmpVodFrame &frame);
+  static bool IsKeyFrame(const RtmpVodFrame &frame);
+
+ private:
+  RtmpVodFile() = default;
+
+  void BuildIndex();
+
+  bool ReadAt(size_t pos, RtmpVodFrame &frame) { return pos > 0 && Read(pos, frame); }
+
+  struct KeyFrame {
+    uint32_t timestamp = 0;
+    size_t pos = 0;
+  };
+
+  FlvFile file_;
+  uint32_t first_timestamp_ = 0;
+  AmfObjects meta_data_;
+  size_t avc_sequence_header_ = 0;  // 序列头的位置, 只保存位置, payload 持有文件会形成循环引用
+  size_t aac_sequence_header_ = 0;
+
+  std::once_flag index_once_;
+  std::vector<KeyFrame> keyframes_;
+};
+
+// 按路径缓存打开的点播文件, 文件大小或修改时间变化后重新打开
+class RtmpVodCache {
+ public:
+  explicit RtmpVodCache(size_t max_files = 16) : max_files_(max_files) {}
+
+  // 文件不存在或者不是 FLV 文件返回 nullptr
+  std::shared_ptr<RtmpVodFile> Get(const std::string &path);
+
+  size_t GetFiles();
+
+ private:
+  struct Entry {
+    std::shared_ptr<RtmpVodFile> file;
+    off_t size = 0;
+    struct timespec mtime = {0, 0};
+    uint64_t last_used = 0;
+  };
+
+  const size_t max_files_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, Entry> files_;
+  uint64_t clock_ = 0;
+};
+
+// 一个拉流端的点播, 在连接所属的线程中用定时器发送
+class RtmpVodPlayer : public std::enable_shared_from_this<RtmpVodPlayer> {
+ public:
+  // speed: 播放速度, 1.0 为实时
+  RtmpVodPlayer(std::shared_ptr<RtmpVodFile> file, double speed = 1.0);
+
+  // 发送元数据和序列头, 从 start_ms 之前最近的关键帧开始播放, 只能在连接所属的线程中调用
+  void Start(std::shared_ptr<RtmpConnection> conn, uint32_t start_ms);
+
+  bool IsFinished() const { return finished_; }
+
+  // 起播时立即发送的时长, 播放端可以尽快开始播放
+  static const uint32_t kBurstMs = 1000;
+  static const uint32_t kIntervalMs = 20;
+
+ private:
+  // 发送到期的帧, 播放结束或者连接关闭时返回 false 停止定时器
+  bool OnTimer();
+
+  std::shared_ptr<RtmpVodFile> file_;
+  std::weak_ptr<RtmpConnection> conn_;
+  const double speed_;
+  size_t pos_ = 0;
+  uint32_t base_timestamp_ = 0;
+  int64_t start_ns_ = 0;
+  bool finished_ = false;
+};
+
+#endif  // RTMP_SERVER_RTMP_VOD_H
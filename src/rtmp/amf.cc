@@ -69,17 +69,7 @@ int AmfDecoder::DecodeNumber(const char *data, int size, double &amf_number) {
     return 0;
   }
   // amf 大端序(网络字节序), 转成小端序(主机字节序)
-  char *ci = (char *)data;
-  char *co = (char *)&amf_number;
-  co[0] = ci[7];
-  co[1] = ci[6];
-  co[2] = ci[5];
-  co[3] = ci[4];
-  co[4] = ci[3];
-  co[5] = ci[2];
-  co[6] = ci[1];
-  co[7] = ci[0];
-
+  amf_number = ReadDoubleBE(data);
   return 8;
 }
 
@@ -135,6 +125,15 @@ int AmfDecoder::DecodeBoolean(const char *data, int size, bool &amf_boolean) {
   return 1;
 }
 
+const AmfObject &AmfDecoder::GetObject(const std::string &key) const {
+  static const AmfObject kEmptyObject;
+  auto iter = objs_.find(key);
+  if (iter == objs_.end()) {
+    return kEmptyObject;
+  }
+  return iter->second;
+}
+
 uint16_t AmfDecoder::DecodeInt16(const char *data, int size) {
   uint16_t val = ReadUint16BE((char *)data);
   return val;
@@ -150,6 +149,219 @@ uint32_t AmfDecoder::DecodeInt32(const char *data, int size) {
   return val;
 }
 
+bool AmfValue::Find(const char *key, AmfValue &value) const {
+  if (!IsObject()) {
+    return false;
+  }
+
+  uint32_t key_len = (uint32_t)strlen(key);
+  AmfPropertyIterator iter(*this);
+  AmfStringView name;
+  while (iter.Next(name, value)) {
+    if (name.Equals(key, key_len)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool AmfReader::Next(AmfValue &value) {
+  if (pos_ >= size_) {
+    return false;
+  }
+
+  int ret = ParseValue(data_ + pos_, size_ - pos_, value, 0);
+  if (ret < 0) {
+    return false;
+  }
+
+  pos_ += ret;
+  return true;
+}
+
+bool AmfReader::ReadString(AmfStringView &str) {
+  AmfValue value;
+  uint32_t pos = pos_;
+  if (!Next(value)) {
+    return false;
+  }
+
+  if (!value.IsString()) {
+    pos_ = pos;
+    return false;
+  }
+
+  str = value.string;
+  return true;
+}
+
+bool AmfReader::ReadNumber(double &number) {
+  AmfValue value;
+  uint32_t pos = pos_;
+  if (!Next(value)) {
+    return false;
+  }
+
+  if (!value.IsNumber()) {
+    pos_ = pos;
+    return false;
+  }
+
+  number = value.number;
+  return true;
+}
+
+int AmfReader::ParseValue(const char *data, uint32_t size, AmfValue &value, int depth) {
+  if (size < 1 || depth > kMaxDepth) {
+    return -1;
+  }
+
+  uint32_t bytes_used = 1;
+  value.marker = (uint8_t)data[0];
+
+  switch (value.marker) {
+    case AMF0_NUMBER:
+      if (size < bytes_used + 8) {
+        return -1;
+      }
+      value.number = ReadDoubleBE(data + bytes_used);
+      bytes_used += 8;
+      break;
+
+    case AMF0_BOOLEAN:
+      if (size < bytes_used + 1) {
+        return -1;
+      }
+      value.boolean = (data[bytes_used] != 0);
+      bytes_used += 1;
+      break;
+
+    case AMF0_STRING:
+    case AMF0_LONG_STRING: {
+      uint32_t len_size = (value.marker == AMF0_STRING) ? 2 : 4;
+      if (size < bytes_used + len_size) {
+        return -1;
+      }
+      uint32_t len = (len_size == 2) ? ReadUint16BE((char *)data + bytes_used)
+                                     : ReadUint32BE((char *)data + bytes_used);
+      bytes_used += len_size;
+      if (len > size - bytes_used) {
+        return -1;
+      }
+      value.string.data = data + bytes_used;
+      value.string.size = len;
+      bytes_used += len;
+      break;
+    }
+
+    case AMF0_ECMA_ARRAY:
+      // 4 字节的元素个数只是提示, 不可靠, 以结束标志为准
+      if (size < bytes_used + 4) {
+        return -1;
+      }
+      bytes_used += 4;
+      // fall through
+    case AMF0_OBJECT: {
+      int ret = SkipProperties(data + bytes_used, size - bytes_used, depth + 1);
+      if (ret < 0) {
+        return -1;
+      }
+      value.body.data = data + bytes_used;
+      value.body.size = (uint32_t)ret;
+      bytes_used += ret;
+      break;
+    }
+
+    case AMF0_STRICT_ARRAY: {
+      if (size < bytes_used + 4) {
+        return -1;
+      }
+      uint32_t count = ReadUint32BE((char *)data + bytes_used);
+      bytes_used += 4;
+      for (uint32_t i = 0; i < count; i++) {
+        AmfValue elem;
+        int ret = ParseValue(data + bytes_used, size - bytes_used, elem, depth + 1);
+        if (ret < 0) {
+          return -1;
+        }
+        bytes_used += ret;
+      }
+      break;
+    }
+
+    case AMF0_DATE:  // 8 字节时间 + 2 字节时区
+      if (size < bytes_used + 10) {
+        return -1;
+      }
+      value.number = ReadDoubleBE(data + bytes_used);
+      bytes_used += 10;
+      break;
+
+    case AMF0_NULL:
+    case AMF0_UNDEFINED:
+      break;
+
+    default:
+      return -1;
+  }
+
+  return (int)bytes_used;
+}
+
+int AmfReader::SkipProperties(const char *data, uint32_t size, int depth) {
+  uint32_t bytes_used = 0;
+  while (true) {
+    if (size < bytes_used + 2) {
+      return -1;
+    }
+
+    uint32_t key_len = ReadUint16BE((char *)data + bytes_used);
+    bytes_used += 2;
+    if (key_len == 0) {
+      // 空 key 之后紧跟 AMF0_OBJECT_END
+      if (size < bytes_used + 1 || data[bytes_used] != AMF0_OBJECT_END) {
+        return -1;
+      }
+      return (int)(bytes_used + 1);
+    }
+
+    if (key_len > size - bytes_used) {
+      return -1;
+    }
+    bytes_used += key_len;
+
+    AmfValue value;
+    int ret = ParseValue(data + bytes_used, size - bytes_used, value, depth);
+    if (ret < 0) {
+      return -1;
+    }
+    bytes_used += ret;
+  }
+}
+
+bool AmfPropertyIterator::Next(AmfStringView &key, AmfValue &value) {
+  // 属性区在 AmfReader 中已经校验过, 这里只需按顺序切分
+  if (pos_ + 2 > size_) {
+    return false;
+  }
+
+  uint32_t key_len = ReadUint16BE((char *)data_ + pos_);
+  if (key_len == 0) {
+    return false;
+  }
+
+  key.data = data_ + pos_ + 2;
+  key.size = key_len;
+  uint32_t pos = pos_ + 2 + key_len;
+  int ret = AmfReader::ParseValue(data_ + pos, size_ - pos, value, 0);
+  if (ret < 0) {
+    return false;
+  }
+
+  pos_ = pos + ret;
+  return true;
+}
+
 AmfEncoder::AmfEncoder(uint32_t size)
     : data_(new char[size], std::default_delete<char[]>()), size_(size) {}
 
@@ -217,17 +429,8 @@ void AmfEncoder::EncodeNumber(double value) {
   }
 
   data_.get()[index_++] = AMF0_NUMBER;
-
-  char *ci = (char *)&value;
-  char *co = data_.get();
-  co[index_++] = ci[7];
-  co[index_++] = ci[6];
-  co[index_++] = ci[5];
-  co[index_++] = ci[4];
-  co[index_++] = ci[3];
-  co[index_++] = ci[2];
-  co[index_++] = ci[1];
-  co[index_++] = ci[0];
+  WriteDoubleBE(data_.get() + index_, value);
+  index_ += 8;
 }
 
 void AmfEncoder::EncodeBoolean(int value) {
@@ -60,11 +60,11 @@ typedef enum {
 } AmfObjectType;
 
 struct AmfObject {
-  AmfObjectType type;
+  AmfObjectType type = AMF_STRING;
 
   std::string amf_string;
-  double amf_number;
-  bool amf_boolean;
+  double amf_number = 0;
+  bool amf_boolean = false;
 
   AmfObject() {}
 
@@ -97,17 +97,18 @@ class AmfDecoder {
     objs_.clear();
   }
 
-  std::string GetString() const { return obj_.amf_string; }
+  const std::string &GetString() const { return obj_.amf_string; }
 
   double GetNumber() const { return obj_.amf_number; }
 
-  bool HasObject(std::string key) const { return (objs_.find(key) != objs_.end()); }
+  bool HasObject(const std::string &key) const { return (objs_.find(key) != objs_.end()); }
 
-  AmfObject GetObject(std::string key) { return objs_[key]; }
+  // 不存在的 key 返回空对象, 不再插入 objs_
+  const AmfObject &GetObject(const std::string &key) const;
 
-  AmfObject GetObject() { return obj_; }
+  const AmfObject &GetObject() const { return obj_; }
 
-  AmfObjects GetObjects() { return objs_; }
+  const AmfObjects &GetObjects() const { return objs_; }
 
  private:
   static int DecodeBoolean(const char *data, int size, bool &amf_boolean);
@@ -122,6 +123,89 @@ class AmfDecoder {
   AmfObjects objs_;
 };
 
+/// 以下是命令消息使用的零拷贝 AMF0 读取器, 不分配内存, 字符串直接指向消息 payload,
+/// 对象和数组只记录字节范围, 用到的时候再懒解析, 所以 payload 必须比读出的值活得久.
+/// C++14 没有 std::string_view, 这里用一个简单的视图结构代替.
+
+struct AmfStringView {
+  const char *data = nullptr;
+  uint32_t size = 0;
+
+  bool Equals(const char *str, uint32_t len) const {
+    return size == len && (len == 0 || memcmp(data, str, len) == 0);
+  }
+
+  bool operator==(const char *str) const { return Equals(str, (uint32_t)strlen(str)); }
+
+  bool operator!=(const char *str) const { return !(*this == str); }
+
+  bool Empty() const { return size == 0; }
+
+  std::string ToString() const { return std::string(data, size); }
+};
+
+struct AmfValue {
+  uint8_t marker = AMF0_INVALID;  // AMF0DataType
+  double number = 0;
+  bool boolean = false;
+  AmfStringView string;  // AMF0_STRING / AMF0_LONG_STRING
+  AmfStringView body;    // AMF0_OBJECT / AMF0_ECMA_ARRAY 的属性区, 不含类型和数组长度
+
+  bool IsNumber() const { return marker == AMF0_NUMBER; }
+
+  bool IsString() const { return marker == AMF0_STRING || marker == AMF0_LONG_STRING; }
+
+  bool IsObject() const { return marker == AMF0_OBJECT || marker == AMF0_ECMA_ARRAY; }
+
+  // 在对象属性中线性查找 key, 命令消息的对象一般只有几个属性, 比建哈希表便宜
+  bool Find(const char *key, AmfValue &value) const;
+};
+
+class AmfReader {
+ public:
+  AmfReader(const char *data, uint32_t size) : data_(data), size_(size) {}
+
+  // 读出下一个值, 失败(数据不完整或不支持的类型)返回 false 且位置不变
+  bool Next(AmfValue &value);
+
+  // 下一个值类型不符时返回 false, 同样不移动位置
+  bool ReadString(AmfStringView &str);
+  bool ReadNumber(double &number);
+
+  bool IsEnd() const { return pos_ >= size_; }
+
+  uint32_t Position() const { return pos_; }
+
+ private:
+  friend struct AmfValue;
+  friend class AmfPropertyIterator;
+
+  // 解析 data 开头的一个值, 返回占用字节数, -1 表示失败
+  static int ParseValue(const char *data, uint32_t size, AmfValue &value, int depth);
+  // 跳过对象属性区, 返回占用的字节数(包括 0x00 0x00 0x09 结束标志), -1 表示失败
+  static int SkipProperties(const char *data, uint32_t size, int depth);
+
+  const char *data_ = nullptr;
+  uint32_t size_ = 0;
+  uint32_t pos_ = 0;
+
+  static const int kMaxDepth = 16;  // 防止恶意嵌套导致栈溢出
+};
+
+// 懒遍历对象属性, 每次 Next 解析一个 key/value
+class AmfPropertyIterator {
+ public:
+  explicit AmfPropertyIterator(const AmfValue &object)
+      : data_(object.body.data), size_(object.body.size) {}
+
+  bool Next(AmfStringView &key, AmfValue &value);
+
+ private:
+  const char *data_ = nullptr;
+  uint32_t size_ = 0;
+  uint32_t pos_ = 0;
+};
+
 class AmfEncoder {
  public:
   AmfEncoder(uint32_t size = 1024);
@@ -5,7 +5,12 @@
 /// @date 2023/04/23
 
 #include "BufferReader.h"
+
+#include <cstring>
+
+#include "FrameTrace.h"
 #include "Socket.h"
+#include "Timestamp.h"
 
 
 uint32_t ReadUint32BE(char* data) {
@@ -44,29 +49,51 @@ uint16_t ReadUint16LE(char* data) {
   return value;
 }
 
+double ReadDoubleBE(const char* data) {
+  // 一次读出 8 字节再用 bswap 指令翻转, 替代逐字节拷贝
+  uint64_t bits = 0;
+  memcpy(&bits, data, sizeof(bits));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  bits = __builtin_bswap64(bits);
+#endif
+  double value = 0;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
 BufferReader::BufferReader(uint32_t initial_size) { buffer_.resize(initial_size); }
 
 BufferReader::~BufferReader() {}
 
 int BufferReader::Read(SOCKET sockfd) {
-  uint32_t size = WritableBytes();
-  if (size < MAX_BYTES_PER_READ) {
-    uint32_t bufferReaderSize = (uint32_t)buffer_.size();
-    if (bufferReaderSize > MAX_BUFFER_SIZE) {
+  if (WritableBytes() < MAX_BYTES_PER_READ) {
+    if (ReadableBytes() > MAX_BUFFER_SIZE) {
       return 0;
     }
 
-    buffer_.resize(bufferReaderSize + MAX_BYTES_PER_READ);
+    MakeSpace(MAX_BYTES_PER_READ);
   }
 
   int bytes_read = ::recv(sockfd, beginWrite(), MAX_BYTES_PER_READ, 0);
   if (bytes_read > 0) {
     writer_index_ += bytes_read;
+    if (FrameTracer::Enabled()) {
+      last_read_ns_ = Timestamp::NowNanos();
+    }
   }
 
   return bytes_read;
 }
 
+void BufferReader::Append(const char* data, uint32_t size) {
+  if (WritableBytes() < size) {
+    MakeSpace(size);
+  }
+
+  memcpy(beginWrite(), data, size);
+  writer_index_ += size;
+}
+
 uint32_t BufferReader::ReadAll(std::string& data) {
   uint32_t size = ReadableBytes();
   if (size > 0) {
@@ -89,3 +116,15 @@ uint32_t BufferReader::ReadUntilCrlf(std::string& data) {
   Retrieve(size);
   return size;
 }
+
+void BufferReader::MakeSpace(uint32_t len) {
+  if (WritableBytes() + reader_index_ < len) {
+    buffer_.resize(writer_index_ + len);
+    return;
+  }
+
+  uint32_t readable = ReadableBytes();
+  memmove(Begin(), Begin() + reader_index_, readable);
+  reader_index_ = 0;
+  writer_index_ = readable;
+}
@@ -21,6 +21,7 @@ uint32_t ReadUint24BE(char* data);
 uint32_t ReadUint24LE(char* data);
 uint16_t ReadUint16BE(char* data);
 uint16_t ReadUint16LE(char* data);
+double ReadDoubleBE(const char* data);  // IEEE 754 大端序, AMF0 的 Number 类型
 
 class BufferReader {
  public:
@@ -45,6 +46,11 @@ class BufferReader {
     return crlf == BeginWrite() ? nullptr : crlf;
   }
 
+  const char* FindFirstCrlfCrlf() const {
+    const char* crlf = std::search(Peek(), BeginWrite(), kCrlfCrlf, kCrlfCrlf + 4);
+    return crlf == BeginWrite() ? nullptr : crlf;
+  }
+
   const char* FindLastCrlfCrlf() const {
     const char* crlf = std::find_end(Peek(), BeginWrite(), kCrlfCrlf, kCrlfCrlf + 4);
     return crlf == BeginWrite() ? nullptr : crlf;
@@ -69,6 +75,12 @@ class BufferReader {
   void RetrieveUntil(const char* end) { Retrieve(end - Peek()); }
 
   int Read(SOCKET sockfd);
+
+  // 最近一次 recv 的时间 (Timestamp::NowNanos), 只在开启帧采样时记录
+  int64_t GetLastReadTime() const { return last_read_ns_; }
+
+  // 不经过 socket 直接追加数据, 用于基准测试和离线回放
+  void Append(const char* data, uint32_t size);
   uint32_t ReadAll(std::string& data);
   uint32_t ReadUntilCrlf(std::string& data);
 
@@ -83,7 +95,12 @@ class BufferReader {
 
   const char* BeginWrite() const { return Begin() + writer_index_; }
 
+  // 可写空间不足 len 时先把未读数据移到开头, 仍然不够再扩容.
+  // 不移动的话, 一直有半个 chunk 未读时 reader_index_ 永远不会归零, 缓冲区只增不减
+  void MakeSpace(uint32_t len);
+
   std::vector<char> buffer_;
+  int64_t last_read_ns_ = 0;
   size_t reader_index_ = 0;
   size_t writer_index_ = 0;
 
@@ -6,8 +6,13 @@
 
 #include "BufferWriter.h"
 
+#include <sys/uio.h>
+
+#include <algorithm>
+
 #include "Socket.h"
 #include "SocketUtil.h"
+#include "Timestamp.h"
 
 void WriteUint32BE(char* p, uint32_t value) {
   p[0] = value >> 24;
@@ -45,9 +50,19 @@ void WriteUint16LE(char* p, uint16_t value) {
   p[1] = value >> 8;
 }
 
+void WriteDoubleBE(char* p, double value) {
+  uint64_t bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  bits = __builtin_bswap64(bits);
+#endif
+  memcpy(p, &bits, sizeof(bits));
+}
+
 BufferWriter::BufferWriter(int capacity) : max_queue_length_(capacity) {}
 
-bool BufferWriter::Append(std::shared_ptr<char> data, uint32_t size, uint32_t index) {
+bool BufferWriter::Append(std::shared_ptr<char> data, uint32_t size, uint32_t index,
+                          std::shared_ptr<const PacketTrace> trace) {
   if (size <= index) {
     return false;
   }
@@ -56,8 +71,9 @@ bool BufferWriter::Append(std::shared_ptr<char> data, uint32_t size, uint32_t in
     return false;
   }
 
-  Packet pkt = {data, size, index};
-  buffer_.emplace(std::move(pkt));
+  Packet pkt = {data, size, index, std::move(trace)};
+  buffer_.emplace_back(std::move(pkt));
+  queued_bytes_ += size - index;
   return true;
 }
 
@@ -75,7 +91,8 @@ bool BufferWriter::Append(const char* data, uint32_t size, uint32_t index) {
   memcpy(pkt.data.get(), data, size);
   pkt.size = size;
   pkt.writeIndex = index;
-  buffer_.emplace(std::move(pkt));
+  buffer_.emplace_back(std::move(pkt));
+  queued_bytes_ += size - index;
   return true;
 }
 
@@ -85,26 +102,46 @@ int BufferWriter::Send(SOCKET sockfd, int timeout) {
   }
 
   int ret = 0;
-  int count = 1;
+  struct iovec iov[kMaxIovecs];
+
+  while (!buffer_.empty()) {
+    int count = 0;
+    size_t total = 0;
+    for (auto iter = buffer_.begin(); iter != buffer_.end() && count < kMaxIovecs; ++iter) {
+      iov[count].iov_base = iter->data.get() + iter->writeIndex;
+      iov[count].iov_len = iter->size - iter->writeIndex;
+      total += iov[count].iov_len;
+      count += 1;
+    }
 
-  do {
-    if (buffer_.empty()) {
-      return 0;
+    ret = (int)::writev(sockfd, iov, count);
+    if (ret < 0) {
+      if (errno == EINTR || errno == EAGAIN) ret = 0;
+      break;
     }
 
-    count -= 1;
-    Packet& pkt = buffer_.front();
-    ret = ::send(sockfd, pkt.data.get() + pkt.writeIndex, pkt.size - pkt.writeIndex, 0);
-    if (ret > 0) {
-      pkt.writeIndex += ret;
+    queued_bytes_ -= ret;
+    sent_bytes_ += ret;
+
+    // 按发送的字节数依次移动写位置, 完整发送的包出队
+    uint32_t left = (uint32_t)ret;
+    while (left > 0) {
+      Packet& pkt = buffer_.front();
+      uint32_t bytes = std::min(left, pkt.size - pkt.writeIndex);
+      pkt.writeIndex += bytes;
+      left -= bytes;
       if (pkt.size == pkt.writeIndex) {
-        count += 1;
-        buffer_.pop();
+        if (pkt.trace) {
+          pkt.trace->OnSent(Timestamp::NowNanos());
+        }
+        buffer_.pop_front();
       }
-    } else if (ret < 0) {
-      if (errno == EINTR || errno == EAGAIN) ret = 0;
     }
-  } while (count > 0);
+
+    if ((size_t)ret < total) {  // 内核发送缓冲区已满, 等待下一次可写事件
+      break;
+    }
+  }
 
   if (timeout > 0) {
     SocketUtil::SetNonBlock(sockfd);
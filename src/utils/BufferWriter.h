@@ -9,9 +9,10 @@
 
 #include <cstdint>
 #include <memory>
-#include <queue>
+#include <deque>
 #include <string>
 
+#include "FrameTrace.h"
 #include "Socket.h"
 
 void WriteUint32BE(char* p, uint32_t value);
@@ -20,33 +21,51 @@ void WriteUint24BE(char* p, uint32_t value);
 void WriteUint24LE(char* p, uint32_t value);
 void WriteUint16BE(char* p, uint16_t value);
 void WriteUint16LE(char* p, uint16_t value);
+void WriteDoubleBE(char* p, double value);
 
 class BufferWriter {
  public:
   BufferWriter(int capacity = kMaxQueueLength);
   ~BufferWriter() {}
 
-  bool Append(std::shared_ptr<char> data, uint32_t size, uint32_t index = 0);
+  // trace 非空时, 该包全部发送完成后回调 trace->OnSent, 用于延迟统计
+  bool Append(std::shared_ptr<char> data, uint32_t size, uint32_t index = 0,
+              std::shared_ptr<const PacketTrace> trace = nullptr);
   bool Append(const char* data, uint32_t size, uint32_t index = 0);
+
+  // 队列中连续的多个包合并成一次 writev 发送, 直到队列为空或者内核发送缓冲区满
   int Send(SOCKET sockfd, int timeout = 0);
 
   bool IsEmpty() const { return buffer_.empty(); }
 
   bool IsFull() const { return ((int)buffer_.size() >= max_queue_length_ ? true : false); }
 
+  // 还能否再放入 num 个包, 多个包组成一个完整消息时先检查, 避免只放入一部分
+  bool HasRoom(uint32_t num) const { return (int)(buffer_.size() + num) <= max_queue_length_; }
+
   uint32_t Size() const { return (uint32_t)buffer_.size(); }
 
+  // 队列中还未发送的字节数
+  uint64_t QueuedBytes() const { return queued_bytes_; }
+
+  // 累计已发送的字节数
+  uint64_t SentBytes() const { return sent_bytes_; }
+
  private:
   typedef struct {
     std::shared_ptr<char> data;
     uint32_t size;
     uint32_t writeIndex;
+    std::shared_ptr<const PacketTrace> trace;
   } Packet;
 
-  std::queue<Packet> buffer_;
+  std::deque<Packet> buffer_;
   int max_queue_length_ = 0;
+  uint64_t queued_bytes_ = 0;
+  uint64_t sent_bytes_ = 0;
 
   static const int kMaxQueueLength = 10000;
+  static const int kMaxIovecs = 64;  // 一次 writev 最多合并的包数
 };
 
 #endif  // RTMP_SERVER_BUFFER_WRITER_H
@@ -0,0 +1,104 @@
+/// @file FlvFile.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "FlvFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint8_t FlvFile::kTagAudio;
+const uint8_t FlvFile::kTagVideo;
+const uint8_t FlvFile::kTagScript;
+
+namespace {
+
+const size_t kTagHeaderSize = 11;
+const size_t kPreviousTagSize = 4;
+
+uint32_t ReadBE(const uint8_t *p, int bytes) {
+  uint32_t value = 0;
+  for (int i = 0; i < bytes; i++) {
+    value = (value << 8) | p[i];
+  }
+  return value;
+}
+
+}  // namespace
+
+FlvFile::~FlvFile() { Close(); }
+
+bool FlvFile::Open(const char *path) {
+  Close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < 9 + (off_t)kPreviousTagSize) {
+    ::close(fd);
+    return false;
+  }
+
+  void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);  // 映射建立后文件描述符不再需要
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+
+  const uint8_t *data = (const uint8_t *)addr;
+  uint32_t header_size = ReadBE(data + 5, 4);
+  if (data[0] != 'F' || data[1] != 'L' || data[2] != 'V' || header_size < 9 ||
+      header_size + kPreviousTagSize > (size_t)st.st_size) {
+    munmap(addr, st.st_size);
+    return false;
+  }
+
+  // 顺序读取, 提示内核加大预读
+  madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+  data_ = data;
+  size_ = st.st_size;
+  flags_ = data[4];
+  first_tag_ = header_size + kPreviousTagSize;
+  pos_ = first_tag_;
+  return true;
+}
+
+void FlvFile::Close() {
+  if (data_ != nullptr) {
+    munmap((void *)data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+    pos_ = 0;
+    first_tag_ = 0;
+    flags_ = 0;
+  }
+}
+
+bool FlvFile::ReadTag(FlvTag &tag) { return ReadTag(pos_, tag); }
+
+bool FlvFile::ReadTag(size_t &pos, FlvTag &tag) const {
+  if (data_ == nullptr || pos + kTagHeaderSize > size_) {
+    return false;
+  }
+
+  const uint8_t *p = data_ + pos;
+  uint32_t data_size = ReadBE(p + 1, 3);
+  if (pos + kTagHeaderSize + data_size > size_) {
+    return false;
+  }
+
+  tag.type = p[0] & 0x1f;  // 高位是加密标志
+  tag.timestamp = ReadBE(p + 4, 3) | ((uint32_t)p[7] << 24);
+  tag.data = p + kTagHeaderSize;
+  tag.size = data_size;
+  pos += kTagHeaderSize + data_size + kPreviousTagSize;
+  return true;
+}
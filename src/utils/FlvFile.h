@@ -0,0 +1,63 @@
+/// @file FlvFile.h
+/// @brief 只读的 FLV 文件, 整个文件 mmap 到内存, 按 tag 顺序读取, tag 数据不拷贝
+///        FLV 的音视频 tag 数据就是 RTMP 音视频消息的 payload, 可以直接推送
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_FLV_FILE_H
+#define RTMP_SERVER_FLV_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct FlvTag {
+  uint8_t type = 0;        // 8: 音频, 9: 视频, 18: 脚本数据, 与 RTMP 消息类型相同
+  uint32_t timestamp = 0;  // 毫秒, 已合并扩展时间戳
+  const uint8_t *data = nullptr;  // 指向映射的内存, Close 之前有效
+  uint32_t size = 0;
+};
+
+class FlvFile {
+ public:
+  static const uint8_t kTagAudio = 8;
+  static const uint8_t kTagVideo = 9;
+  static const uint8_t kTagScript = 18;
+
+  FlvFile() = default;
+  ~FlvFile();
+  FlvFile(const FlvFile &) = delete;
+  FlvFile &operator=(const FlvFile &) = delete;
+
+  // 映射文件并检查 FLV 文件头, 失败返回 false
+  bool Open(const char *path);
+  void Close();
+
+  bool IsOpened() const { return data_ != nullptr; }
+
+  bool HasAudio() const { return (flags_ & 0x04) != 0; }
+  bool HasVideo() const { return (flags_ & 0x01) != 0; }
+
+  // 读取下一个 tag, 到文件末尾或者 tag 不完整时返回 false
+  bool ReadTag(FlvTag &tag);
+
+  // 读取 pos 处的 tag, pos 移到下一个 tag, 不改变当前位置; 多个线程可以同时读取
+  bool ReadTag(size_t &pos, FlvTag &tag) const;
+
+  // 回到第一个 tag
+  void Rewind() { pos_ = first_tag_; }
+
+  // 第一个 tag 的位置
+  size_t FirstTag() const { return first_tag_; }
+
+  size_t Size() const { return size_; }
+
+ private:
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  size_t pos_ = 0;
+  size_t first_tag_ = 0;
+  uint8_t flags_ = 0;
+};
+
+#endif  // RTMP_SERVER_FLV_FILE_H
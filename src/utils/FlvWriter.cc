@@ -0,0 +1,233 @@
+/// @file FlvWriter.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "FlvWriter.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const uint32_t kTagHeaderSize = 11;
+const uint32_t kPreviousTagSize = 4;
+
+void PutBE(std::string &out, uint64_t value, int bytes) {
+  for (int i = bytes - 1; i >= 0; i--) {
+    out += (char)(value >> (i * 8));
+  }
+}
+
+// AMF0 字符串, 对象的属性名不带类型标记
+void PutAmfName(std::string &out, const char *name) {
+  uint16_t size = (uint16_t)strlen(name);
+  PutBE(out, size, 2);
+  out.append(name, size);
+}
+
+void PutAmfNumbers(std::string &out, const char *name, const std::vector<double> &values) {
+  PutAmfName(out, name);
+  out += (char)0x0a;  // strict array
+  PutBE(out, values.size(), 4);
+  for (double value : values) {
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    out += (char)0x00;  // number
+    PutBE(out, bits, 8);
+  }
+}
+
+}  // namespace
+
+FlvWriter::FlvWriter(uint32_t buffer_size, uint64_t preallocate, bool direct_io)
+    : buffer_size_(std::max<uint32_t>((buffer_size + kAlignment - 1) / kAlignment * kAlignment,
+                                      kAlignment)),
+      preallocate_(preallocate),
+      want_direct_io_(direct_io) {}
+
+FlvWriter::~FlvWriter() {
+  Close();
+  free(buffer_);
+}
+
+bool FlvWriter::Open(const std::string &path, bool has_audio, bool has_video) {
+  Close();
+
+  if (buffer_ == nullptr && posix_memalign((void **)&buffer_, kAlignment, buffer_size_) != 0) {
+    buffer_ = nullptr;
+    return false;
+  }
+
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  direct_io_ = false;
+  if (want_direct_io_) {
+    fd_ = ::open(path.c_str(), flags | O_DIRECT, 0644);
+    direct_io_ = fd_ >= 0;
+  }
+  if (fd_ < 0) {  // tmpfs 等不支持 O_DIRECT 时返回 EINVAL
+    fd_ = ::open(path.c_str(), flags, 0644);
+  }
+  if (fd_ < 0) {
+    return false;
+  }
+
+  buffer_used_ = 0;
+  written_ = 0;
+  allocated_ = 0;
+  failed_ = false;
+  has_tag_ = false;
+  first_timestamp_ = 0;
+  last_timestamp_ = 0;
+  keyframe_times_.clear();
+  keyframe_positions_.clear();
+
+  // 文件头 + 第一个 PreviousTagSize
+  char header[9 + kPreviousTagSize] = {'F', 'L', 'V', 0x01, 0, 0, 0, 0, 0x09, 0, 0, 0, 0};
+  header[4] = (char)((has_audio ? 0x04 : 0) | (has_video ? 0x01 : 0));
+  Append(header, sizeof(header));
+  return true;
+}
+
+bool FlvWriter::WriteTag(uint8_t type, uint32_t timestamp, const char *data, uint32_t size) {
+  if (fd_ < 0 || failed_) {
+    return false;
+  }
+
+  if (type == 8 || type == 9) {
+    if (!has_tag_) {
+      has_tag_ = true;
+      first_timestamp_ = timestamp;
+    }
+    last_timestamp_ = std::max(last_timestamp_, timestamp);
+
+    // 视频关键帧, H.264 的序列头除外
+    const uint8_t *p = (const uint8_t *)data;
+    if (type == 9 && size >= 2 && ((p[0] >> 4) & 0x0f) == 1 &&
+        !((p[0] & 0x0f) == 7 && p[1] == 0)) {
+      keyframe_times_.push_back(timestamp / 1000.0);
+      keyframe_positions_.push_back((double)GetSize());
+    }
+  }
+
+  char header[kTagHeaderSize];
+  header[0] = (char)type;
+  header[1] = (char)(size >> 16);
+  header[2] = (char)(size >> 8);
+  header[3] = (char)size;
+  header[4] = (char)(timestamp >> 16);
+  header[5] = (char)(timestamp >> 8);
+  header[6] = (char)timestamp;
+  header[7] = (char)(timestamp >> 24);  // 扩展时间戳
+  header[8] = header[9] = header[10] = 0;  // stream id
+
+  uint32_t tag_size = kTagHeaderSize + size;
+  char tail[kPreviousTagSize] = {(char)(tag_size >> 24), (char)(tag_size >> 16),
+                                 (char)(tag_size >> 8), (char)tag_size};
+  Append(header, sizeof(header));
+  Append(data, size);
+  Append(tail, sizeof(tail));
+  return !failed_;
+}
+
+void FlvWriter::Append(const char *data, uint32_t size) {
+  while (size > 0 && !failed_) {
+    uint32_t n = std::min(size, buffer_size_ - buffer_used_);
+    memcpy(buffer_ + buffer_used_, data, n);
+    buffer_used_ += n;
+    data += n;
+    size -= n;
+    if (buffer_used_ == buffer_size_) {
+      FlushBuffer();
+    }
+  }
+}
+
+bool FlvWriter::FlushBuffer() {
+  Preallocate(written_ + buffer_used_);
+
+  // O_DIRECT 要求偏移和长度都按块对齐, 最后不满一块的部分补 0, 关闭时再截断
+  uint32_t size = buffer_used_;
+  if (direct_io_) {
+    size = (size + kAlignment - 1) / kAlignment * kAlignment;
+    memset(buffer_ + buffer_used_, 0, size - buffer_used_);
+  }
+
+  uint32_t done = 0;
+  while (done < size) {
+    ssize_t ret = ::pwrite(fd_, buffer_ + done, size - done, (off_t)(written_ + done));
+    if (ret > 0) {
+      done += (uint32_t)ret;
+      continue;
+    }
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret < 0 && errno == EINVAL && direct_io_) {
+      // 文件系统不支持直接 I/O, 退回普通写
+      direct_io_ = false;
+      fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+      continue;
+    }
+    failed_ = true;
+    return false;
+  }
+
+  written_ += buffer_used_;
+  buffer_used_ = 0;
+  return true;
+}
+
+void FlvWriter::Preallocate(uint64_t end) {
+  if (preallocate_ == 0 || end <= allocated_) {
+    return;
+  }
+
+  // 保持文件大小不变, 只预留空间, 录制过程中读到的仍然是实际写入的数据
+  uint64_t length = std::max<uint64_t>(preallocate_, end - allocated_);
+  if (fallocate(fd_, FALLOC_FL_KEEP_SIZE, (off_t)allocated_, (off_t)length) != 0) {
+    allocated_ = UINT64_MAX;  // 不支持预分配, 以后不再尝试
+    return;
+  }
+  allocated_ += length;
+}
+
+std::string FlvWriter::MakeIndexTag() const {
+  std::string body;
+  body += (char)0x02;  // string
+  PutAmfName(body, "keyframes");
+  body += (char)0x03;  // object
+  PutAmfNumbers(body, "times", keyframe_times_);
+  PutAmfNumbers(body, "filepositions", keyframe_positions_);
+  body += {0x00, 0x00, 0x09};  // object end
+  return body;
+}
+
+void FlvWriter::Close() {
+  if (fd_ < 0) {
+    return;
+  }
+
+  if (!failed_) {
+    std::string index = MakeIndexTag();
+    WriteTag(18, last_timestamp_, index.data(), (uint32_t)index.size());
+  }
+
+  uint64_t size = GetSize();
+  if (!failed_ && buffer_used_ > 0) {
+    FlushBuffer();
+  }
+
+  // 去掉直接 I/O 补齐的 0 和多余的预分配空间
+  if (ftruncate(fd_, (off_t)std::min(size, written_)) != 0) {
+    failed_ = true;
+  }
+  ::close(fd_);
+  fd_ = -1;
+}
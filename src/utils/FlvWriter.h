@@ -0,0 +1,80 @@
+/// @file FlvWriter.h
+/// @brief 顺序写 FLV 文件, 用于录制: tag 先拷贝到按页对齐的大缓冲区, 写满后一次 write,
+///        文件空间用 fallocate 分段预分配, 可选 O_DIRECT 绕过页缓存
+///        关闭时在文件末尾追加一个 "keyframes" 脚本 tag, 内容和 onMetaData.keyframes 相同
+///        (times 秒, filepositions 字节偏移), 通过文件最后 4 字节的 PreviousTagSize 找到
+///        只在一个线程中使用, 不加锁
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_FLV_WRITER_H
+#define RTMP_SERVER_FLV_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FlvWriter {
+ public:
+  static const uint32_t kAlignment = 4096;
+
+  // buffer_size: 写缓冲区大小, 向上对齐到 kAlignment; preallocate: 每次预分配的字节数, 0 表示不预分配
+  // direct_io: 使用 O_DIRECT, 文件系统不支持时自动退回普通写
+  explicit FlvWriter(uint32_t buffer_size = 1024 * 1024, uint64_t preallocate = 64 * 1024 * 1024,
+                     bool direct_io = false);
+  ~FlvWriter();
+  FlvWriter(const FlvWriter &) = delete;
+  FlvWriter &operator=(const FlvWriter &) = delete;
+
+  // 创建文件并写入 FLV 文件头, 失败返回 false
+  bool Open(const std::string &path, bool has_audio, bool has_video);
+
+  // type: 8 音频, 9 视频, 18 脚本数据; 视频关键帧记入索引. 写文件失败返回 false
+  bool WriteTag(uint8_t type, uint32_t timestamp, const char *data, uint32_t size);
+
+  // 写入关键帧索引和缓冲区中剩余的数据, 文件截断到实际大小
+  void Close();
+
+  bool IsOpened() const { return fd_ >= 0; }
+  bool IsDirectIo() const { return direct_io_; }
+
+  // 已经写入的逻辑字节数, 包含缓冲区中还没有落盘的部分
+  uint64_t GetSize() const { return written_ + buffer_used_; }
+
+  // 第一个 tag 到最后一个 tag 的时长, 毫秒
+  uint32_t GetDuration() const { return has_tag_ ? last_timestamp_ - first_timestamp_ : 0; }
+
+  size_t GetKeyFrames() const { return keyframe_times_.size(); }
+
+ private:
+  void Append(const char *data, uint32_t size);
+
+  // 缓冲区写满后整块写入文件
+  bool FlushBuffer();
+
+  // 写入位置超过已经预分配的空间时再预分配一段
+  void Preallocate(uint64_t end);
+
+  std::string MakeIndexTag() const;
+
+  const uint32_t buffer_size_;
+  const uint64_t preallocate_;
+  const bool want_direct_io_;
+
+  int fd_ = -1;
+  bool direct_io_ = false;
+  char *buffer_ = nullptr;  // 按 kAlignment 对齐, O_DIRECT 要求
+  uint32_t buffer_used_ = 0;
+  uint64_t written_ = 0;  // 已经写入文件的字节数, 总是 buffer_size_ 的整数倍
+  uint64_t allocated_ = 0;
+  bool failed_ = false;
+
+  bool has_tag_ = false;
+  uint32_t first_timestamp_ = 0;
+  uint32_t last_timestamp_ = 0;
+  std::vector<double> keyframe_times_;
+  std::vector<double> keyframe_positions_;
+};
+
+#endif  // RTMP_SERVER_FLV_WRITER_H
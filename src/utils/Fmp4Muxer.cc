@@ -0,0 +1,493 @@
+/// @file Fmp4Muxer.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "Fmp4Muxer.h"
+
+#include <cstring>
+
+namespace {
+
+const uint32_t kSampleRates[] = {96000, 88200, 64000, 48000, 44100, 32000, 24000,
+                                 22050, 16000, 12000, 11025, 8000,  7350};
+
+// 关键帧不依赖其他帧; 非关键帧依赖其他帧且不是同步样本
+const uint32_t kKeyFrameFlags = 0x02000000;
+const uint32_t kNonKeyFrameFlags = 0x01010000;
+
+// trun: data-offset, sample-duration, sample-size, sample-flags, sample-composition-time-offset
+const uint32_t kTrunFlags = 0x000001 | 0x000100 | 0x000200 | 0x000400 | 0x000800;
+
+void Put8(std::string &out, uint8_t value) { out += (char)value; }
+
+void Put16(std::string &out, uint16_t value) {
+  out += (char)(value >> 8);
+  out += (char)value;
+}
+
+void Put24(std::string &out, uint32_t value) {
+  out += (char)(value >> 16);
+  out += (char)(value >> 8);
+  out += (char)value;
+}
+
+void Put32(std::string &out, uint32_t value) {
+  out += (char)(value >> 24);
+  out += (char)(value >> 16);
+  out += (char)(value >> 8);
+  out += (char)value;
+}
+
+void Put64(std::string &out, uint64_t value) {
+  Put32(out, (uint32_t)(value >> 32));
+  Put32(out, (uint32_t)value);
+}
+
+void Patch32(std::string &out, size_t pos, uint32_t value) {
+  out[pos] = (char)(value >> 24);
+  out[pos + 1] = (char)(value >> 16);
+  out[pos + 2] = (char)(value >> 8);
+  out[pos + 3] = (char)value;
+}
+
+// 写入盒子头, 返回盒子起始位置, 内容写完后调用 EndBox 回填大小
+size_t BeginBox(std::string &out, const char *type) {
+  size_t pos = out.size();
+  Put32(out, 0);
+  out.append(type, 4);
+  return pos;
+}
+
+size_t BeginFullBox(std::string &out, const char *type, uint8_t version, uint32_t flags) {
+  size_t pos = BeginBox(out, type);
+  Put8(out, version);
+  Put24(out, flags);
+  return pos;
+}
+
+void EndBox(std::string &out, size_t pos) { Patch32(out, pos, (uint32_t)(out.size() - pos)); }
+
+void PutMatrix(std::string &out) {
+  static const uint32_t kMatrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+  for (uint32_t value : kMatrix) {
+    Put32(out, value);
+  }
+}
+
+// MPEG-4 描述符, 内容都小于 128 字节, 长度用一个字节
+void PutDescriptor(std::string &out, uint8_t tag, const std::string &body) {
+  Put8(out, tag);
+  Put8(out, (uint8_t)body.size());
+  out += body;
+}
+
+// 去掉防竞争字节后按位读取 SPS
+class BitReader {
+ public:
+  BitReader(const uint8_t *data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      if (i >= 2 && data[i] == 0x03 && data[i - 1] == 0 && data[i - 2] == 0) {
+        continue;
+      }
+      data_.push_back(data[i]);
+    }
+  }
+
+  bool Overflow() const { return pos_ > data_.size() * 8; }
+
+  uint32_t ReadBits(int n) {
+    uint32_t value = 0;
+    for (int i = 0; i < n; i++) {
+      size_t byte = pos_ / 8;
+      uint32_t bit = byte < data_.size() ? (data_[byte] >> (7 - pos_ % 8)) & 0x01 : 0;
+      value = (value << 1) | bit;
+      pos_++;
+    }
+    return value;
+  }
+
+  uint32_t ReadUe() {
+    int zeros = 0;
+    while (ReadBits(1) == 0 && !Overflow() && zeros < 31) {
+      zeros++;
+    }
+    return ((1u << zeros) - 1) + ReadBits(zeros);
+  }
+
+  int32_t ReadSe() {
+    uint32_t value = ReadUe();
+    return (value & 0x01) ? (int32_t)((value + 1) / 2) : -(int32_t)(value / 2);
+  }
+
+ private:
+  std::vector<uint8_t> data_;
+  size_t pos_ = 0;
+};
+
+void WriteVideoEntry(std::string &out, const std::string &avc_config, uint32_t width,
+                     uint32_t height) {
+  size_t avc1 = BeginBox(out, "avc1");
+  out.append(6, '\0');  // reserved
+  Put16(out, 1);        // data_reference_index
+  out.append(16, '\0');  // pre_defined, reserved
+  Put16(out, (uint16_t)width);
+  Put16(out, (uint16_t)height);
+  Put32(out, 0x00480000);  // 72 dpi
+  Put32(out, 0x00480000);
+  Put32(out, 0);
+  Put16(out, 1);  // frame_count
+  out.append(32, '\0');  // compressorname
+  Put16(out, 0x0018);    // depth
+  Put16(out, 0xffff);    // pre_defined = -1
+
+  size_t avcc = BeginBox(out, "avcC");
+  out += avc_config;
+  EndBox(out, avcc);
+  EndBox(out, avc1);
+}
+
+void WriteAudioEntry(std::string &out, const std::string &aac_config, uint32_t sample_rate,
+                     uint32_t channels) {
+  size_t mp4a = BeginBox(out, "mp4a");
+  out.append(6, '\0');
+  Put16(out, 1);  // data_reference_index
+  out.append(8, '\0');
+  Put16(out, (uint16_t)channels);
+  Put16(out, 16);  // samplesize
+  Put32(out, 0);
+  Put32(out, sample_rate <= 0xffff ? sample_rate << 16 : 0);
+
+  std::string decoder_config;
+  Put8(decoder_config, 0x40);  // objectTypeIndication: MPEG-4 Audio
+  Put8(decoder_config, 0x15);  // streamType: AudioStream, upStream = 0, reserved = 1
+  Put24(decoder_config, 0);    // bufferSizeDB
+  Put32(decoder_config, 0);    // maxBitrate
+  Put32(decoder_config, 0);    // avgBitrate
+  PutDescriptor(decoder_config, 0x05, aac_config);
+
+  std::string es;
+  Put16(es, 0);  // ES_ID
+  Put8(es, 0);   // flags
+  PutDescriptor(es, 0x04, decoder_config);
+  PutDescriptor(es, 0x06, std::string(1, 0x02));  // SLConfigDescriptor: predefined = 2
+
+  size_t esds = BeginFullBox(out, "esds", 0, 0);
+  PutDescriptor(out, 0x03, es);
+  EndBox(out, esds);
+  EndBox(out, mp4a);
+}
+
+void WriteTrack(std::string &out, uint32_t track_id, const std::string &config, bool is_video) {
+  uint32_t width = 0, height = 0, sample_rate = 0, channels = 0;
+  if (is_video) {
+    Fmp4Muxer::ParseAvcSize(config, width, height);
+  } else {
+    Fmp4Muxer::ParseAacConfig(config, sample_rate, channels);
+  }
+
+  size_t trak = BeginBox(out, "trak");
+
+  size_t tkhd = BeginFullBox(out, "tkhd", 0, 0x03);  // track_enabled | track_in_movie
+  Put32(out, 0);  // creation_time
+  Put32(out, 0);  // modification_time
+  Put32(out, track_id);
+  Put32(out, 0);
+  Put32(out, 0);  // duration
+  out.append(8, '\0');
+  Put16(out, 0);  // layer
+  Put16(out, 0);  // alternate_group
+  Put16(out, is_video ? 0 : 0x0100);  // volume
+  Put16(out, 0);
+  PutMatrix(out);
+  Put32(out, width << 16);
+  Put32(out, height << 16);
+  EndBox(out, tkhd);
+
+  size_t mdia = BeginBox(out, "mdia");
+  size_t mdhd = BeginFullBox(out, "mdhd", 0, 0);
+  Put32(out, 0);
+  Put32(out, 0);
+  Put32(out, is_video ? Fmp4Muxer::kVideoTimescale : sample_rate);
+  Put32(out, 0);
+  Put16(out, 0x55c4);  // und
+  Put16(out, 0);
+  EndBox(out, mdhd);
+
+  size_t hdlr = BeginFullBox(out, "hdlr", 0, 0);
+  Put32(out, 0);
+  out.append(is_video ? "vide" : "soun", 4);
+  out.append(12, '\0');
+  const char *name = is_video ? "VideoHandler" : "SoundHandler";
+  out.append(name, strlen(name) + 1);
+  EndBox(out, hdlr);
+
+  size_t minf = BeginBox(out, "minf");
+  if (is_video) {
+    size_t vmhd = BeginFullBox(out, "vmhd", 0, 0x01);
+    out.append(8, '\0');  // graphicsmode, opcolor
+    EndBox(out, vmhd);
+  } else {
+    size_t smhd = BeginFullBox(out, "smhd", 0, 0);
+    Put32(out, 0);  // balance, reserved
+    EndBox(out, smhd);
+  }
+
+  size_t dinf = BeginBox(out, "dinf");
+  size_t dref = BeginFullBox(out, "dref", 0, 0);
+  Put32(out, 1);
+  EndBox(out, BeginFullBox(out, "url ", 0, 0x01));  // 数据在同一文件中
+  EndBox(out, dref);
+  EndBox(out, dinf);
+
+  // 样本表都在 moof 中, 这里只有样本描述
+  size_t stbl = BeginBox(out, "stbl");
+  size_t stsd = BeginFullBox(out, "stsd", 0, 0);
+  Put32(out, 1);
+  if (is_video) {
+    WriteVideoEntry(out, config, width, height);
+  } else {
+    WriteAudioEntry(out, config, sample_rate, channels);
+  }
+  EndBox(out, stsd);
+  for (const char *type : {"stts", "stsc", "stco"}) {
+    size_t box = BeginFullBox(out, type, 0, 0);
+    Put32(out, 0);
+    EndBox(out, box);
+  }
+  size_t stsz = BeginFullBox(out, "stsz", 0, 0);
+  Put32(out, 0);
+  Put32(out, 0);
+  EndBox(out, stsz);
+  EndBox(out, stbl);
+
+  EndBox(out, minf);
+  EndBox(out, mdia);
+  EndBox(out, trak);
+}
+
+uint32_t TrackDataSize(const Fmp4Muxer::Track &track) {
+  if (track.samples == nullptr || track.samples->empty()) {
+    return 0;
+  }
+  const Fmp4Muxer::Sample &last = track.samples->back();
+  return last.offset + last.size - track.samples->front().offset;
+}
+
+// 返回 trun 中 data_offset 的位置, 写完 moof 后回填
+size_t WriteTraf(std::string &out, uint32_t track_id, const Fmp4Muxer::Track &track) {
+  size_t traf = BeginBox(out, "traf");
+
+  size_t tfhd = BeginFullBox(out, "tfhd", 0, 0x020000);  // default-base-is-moof
+  Put32(out, track_id);
+  EndBox(out, tfhd);
+
+  size_t tfdt = BeginFullBox(out, "tfdt", 1, 0);
+  Put64(out, track.base_time);
+  EndBox(out, tfdt);
+
+  size_t trun = BeginFullBox(out, "trun", 1, kTrunFlags);
+  Put32(out, (uint32_t)track.samples->size());
+  size_t data_offset = out.size();
+  Put32(out, 0);
+  for (auto &sample : *track.samples) {
+    Put32(out, sample.duration);
+    Put32(out, sample.size);
+    Put32(out, sample.key_frame ? kKeyFrameFlags : kNonKeyFrameFlags);
+    Put32(out, (uint32_t)sample.composition_offset);
+  }
+  EndBox(out, trun);
+
+  EndBox(out, traf);
+  return data_offset;
+}
+
+}  // namespace
+
+void Fmp4Muxer::WriteInit(std::string &out, const std::string &avc_config,
+                          const std::string &aac_config) {
+  size_t ftyp = BeginBox(out, "ftyp");
+  out.append("iso6", 4);
+  Put32(out, 1);
+  out.append("iso6cmfcdashmp41", 16);
+  EndBox(out, ftyp);
+
+  size_t moov = BeginBox(out, "moov");
+  size_t mvhd = BeginFullBox(out, "mvhd", 0, 0);
+  Put32(out, 0);
+  Put32(out, 0);
+  Put32(out, 1000);  // timescale
+  Put32(out, 0);     // duration
+  Put32(out, 0x00010000);  // rate
+  Put16(out, 0x0100);      // volume
+  out.append(10, '\0');
+  PutMatrix(out);
+  out.append(24, '\0');  // pre_defined
+  Put32(out, kAudioTrackId + 1);  // next_track_ID
+  EndBox(out, mvhd);
+
+  if (!avc_config.empty()) {
+    WriteTrack(out, kVideoTrackId, avc_config, true);
+  }
+  if (!aac_config.empty()) {
+    WriteTrack(out, kAudioTrackId, aac_config, false);
+  }
+
+  size_t mvex = BeginBox(out, "mvex");
+  for (uint32_t track_id : {kVideoTrackId, kAudioTrackId}) {
+    if ((track_id == kVideoTrackId ? avc_config : aac_config).empty()) {
+      continue;
+    }
+    size_t trex = BeginFullBox(out, "trex", 0, 0);
+    Put32(out, track_id);
+    Put32(out, 1);  // default_sample_description_index
+    Put32(out, 0);
+    Put32(out, 0);
+    Put32(out, 0);
+    EndBox(out, trex);
+  }
+  EndBox(out, mvex);
+  EndBox(out, moov);
+}
+
+void Fmp4Muxer::WriteFragment(std::string &out, uint32_t sequence, const Track &video,
+                              const Track &audio) {
+  uint32_t video_size = TrackDataSize(video);
+  uint32_t audio_size = TrackDataSize(audio);
+
+  size_t moof = BeginBox(out, "moof");
+  size_t mfhd = BeginFullBox(out, "mfhd", 0, 0);
+  Put32(out, sequence);
+  EndBox(out, mfhd);
+
+  size_t video_offset = 0, audio_offset = 0;
+  if (video_size > 0) {
+    video_offset = WriteTraf(out, kVideoTrackId, video);
+  }
+  if (audio_size > 0) {
+    audio_offset = WriteTraf(out, kAudioTrackId, audio);
+  }
+  EndBox(out, moof);
+
+  // data_offset 相对 moof 起始位置, 数据从 mdat 头之后开始
+  uint32_t data_start = (uint32_t)(out.size() - moof) + 8;
+  if (video_size > 0) {
+    Patch32(out, video_offset, data_start);
+  }
+  if (audio_size > 0) {
+    Patch32(out, audio_offset, data_start + video_size);
+  }
+
+  out.reserve(out.size() + 8 + video_size + audio_size);
+  Put32(out, 8 + video_size + audio_size);
+  out.append("mdat", 4);
+  if (video_size > 0) {
+    out.append(video.data + video.samples->front().offset, video_size);
+  }
+  if (audio_size > 0) {
+    out.append(audio.data + audio.samples->front().offset, audio_size);
+  }
+}
+
+bool Fmp4Muxer::ParseAacConfig(const std::string &aac_config, uint32_t &sample_rate,
+                               uint32_t &channels) {
+  if (aac_config.size() < 2) {
+    return false;
+  }
+
+  const uint8_t *p = (const uint8_t *)aac_config.data();
+  uint8_t index = (uint8_t)(((p[0] & 0x07) << 1) | (p[1] >> 7));
+  if (index >= sizeof(kSampleRates) / sizeof(kSampleRates[0])) {
+    return false;
+  }
+  sample_rate = kSampleRates[index];
+  channels = (p[1] >> 3) & 0x0f;
+  return true;
+}
+
+void Fmp4Muxer::ParseAvcSize(const std::string &avc_config, uint32_t &width, uint32_t &height) {
+  width = 0;
+  height = 0;
+
+  // configurationVersion, profile, compatibility, level, lengthSize, numOfSPS, spsLength
+  if (avc_config.size() < 8) {
+    return;
+  }
+  const uint8_t *p = (const uint8_t *)avc_config.data();
+  uint32_t sps_size = (p[6] << 8) | p[7];
+  if ((p[5] & 0x1f) == 0 || sps_size < 4 || 8 + sps_size > avc_config.size()) {
+    return;
+  }
+
+  BitReader reader(p + 9, sps_size - 1);  // 跳过 NAL 头
+  uint32_t profile_idc = reader.ReadBits(8);
+  reader.ReadBits(16);  // constraint flags, level_idc
+  reader.ReadUe();      // seq_parameter_set_id
+
+  uint32_t chroma_format_idc = 1;
+  if (profile_idc == 100 || profile_idc == 110 || profile_idc == 122 || profile_idc == 244 ||
+      profile_idc == 44 || profile_idc == 83 || profile_idc == 86 || profile_idc == 118 ||
+      profile_idc == 128 || profile_idc == 138 || profile_idc == 139 || profile_idc == 134) {
+    chroma_format_idc = reader.ReadUe();
+    if (chroma_format_idc == 3) {
+      reader.ReadBits(1);  // separate_colour_plane_flag
+    }
+    reader.ReadUe();      // bit_depth_luma_minus8
+    reader.ReadUe();      // bit_depth_chroma_minus8
+    reader.ReadBits(1);   // qpprime_y_zero_transform_bypass_flag
+    if (reader.ReadBits(1)) {  // seq_scaling_matrix_present_flag
+      int count = chroma_format_idc != 3 ? 8 : 12;
+      for (int i = 0; i < count; i++) {
+        if (!reader.ReadBits(1)) {
+          continue;
+        }
+        int size = i < 6 ? 16 : 64;
+        int last = 8, next = 8;
+        for (int j = 0; j < size && next != 0; j++) {
+          next = (last + reader.ReadSe() + 256) % 256;
+          last = next == 0 ? last : next;
+        }
+      }
+    }
+  }
+
+  reader.ReadUe();  // log2_max_frame_num_minus4
+  uint32_t poc_type = reader.ReadUe();
+  if (poc_type == 0) {
+    reader.ReadUe();
+  } else if (poc_type == 1) {
+    reader.ReadBits(1);
+    reader.ReadSe();
+    reader.ReadSe();
+    uint32_t cycle = reader.ReadUe();
+    for (uint32_t i = 0; i < cycle && !reader.Overflow(); i++) {
+      reader.ReadSe();
+    }
+  }
+  reader.ReadUe();      // max_num_ref_frames
+  reader.ReadBits(1);   // gaps_in_frame_num_value_allowed_flag
+  uint32_t width_mbs = reader.ReadUe() + 1;
+  uint32_t height_map_units = reader.ReadUe() + 1;
+  uint32_t frame_mbs_only = reader.ReadBits(1);
+  if (!frame_mbs_only) {
+    reader.ReadBits(1);  // mb_adaptive_frame_field_flag
+  }
+  reader.ReadBits(1);  // direct_8x8_inference_flag
+
+  uint32_t crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+  if (reader.ReadBits(1)) {
+    crop_left = reader.ReadUe();
+    crop_right = reader.ReadUe();
+    crop_top = reader.ReadUe();
+    crop_bottom = reader.ReadUe();
+  }
+  if (reader.Overflow()) {
+    return;
+  }
+
+  uint32_t crop_x = chroma_format_idc == 0 || chroma_format_idc == 3 ? 1 : 2;
+  uint32_t crop_y = (chroma_format_idc == 1 ? 2 : 1) * (2 - frame_mbs_only);
+  width = width_mbs * 16 - (crop_left + crop_right) * crop_x;
+  height = (2 - frame_mbs_only) * height_map_units * 16 - (crop_top + crop_bottom) * crop_y;
+}
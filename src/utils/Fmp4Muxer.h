@@ -0,0 +1,53 @@
+/// @file Fmp4Muxer.h
+/// @brief CMAF 分片 MP4 封装, 只支持一路 H.264 视频 (AVCC) 和一路 AAC 音频 (raw),
+///        初始化段 (ftyp + moov) 和媒体分片 (moof + mdat) 分开输出, 用于 LL-HLS 的部分分片
+///        视频轨道 1, 时间刻度 90kHz; 音频轨道 2, 时间刻度为采样率, 每帧 1024 个采样
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_FMP4_MUXER_H
+#define RTMP_SERVER_FMP4_MUXER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Fmp4Muxer {
+ public:
+  static const uint32_t kVideoTrackId = 1;
+  static const uint32_t kAudioTrackId = 2;
+  static const uint32_t kVideoTimescale = 90000;
+  static const uint32_t kAacFrameSamples = 1024;
+
+  struct Sample {
+    uint32_t offset = 0;  // 在轨道数据中的偏移
+    uint32_t size = 0;
+    uint32_t duration = 0;  // 轨道时间刻度
+    int32_t composition_offset = 0;
+    bool key_frame = true;
+  };
+
+  struct Track {
+    uint64_t base_time = 0;  // 第一个样本的解码时间, 轨道时间刻度
+    const std::vector<Sample> *samples = nullptr;
+    const char *data = nullptr;  // 样本数据连续存放, 按 Sample::offset 访问
+  };
+
+  // avc_config: AVCDecoderConfigurationRecord; aac_config: AudioSpecificConfig, 为空表示没有该轨道
+  static void WriteInit(std::string &out, const std::string &avc_config,
+                        const std::string &aac_config);
+
+  // 一个 moof + mdat, 样本数为 0 的轨道不写 traf. 样本数据直接跟在 moof 后面, 视频在前
+  static void WriteFragment(std::string &out, uint32_t sequence, const Track &video,
+                            const Track &audio);
+
+  // AudioSpecificConfig 中的采样率和声道数, 格式错误返回 false
+  static bool ParseAacConfig(const std::string &aac_config, uint32_t &sample_rate,
+                             uint32_t &channels);
+
+  // 从 AVCDecoderConfigurationRecord 的第一个 SPS 解析图像宽高, 失败时为 0
+  static void ParseAvcSize(const std::string &avc_config, uint32_t &width, uint32_t &height);
+};
+
+#endif  // RTMP_SERVER_FMP4_MUXER_H
@@ -0,0 +1,16 @@
+/// @file FrameTrace.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "FrameTrace.h"
+
+std::atomic<uint32_t> FrameTracer::sample_interval_{0};
+
+void EgressTrace::OnSent(int64_t now_ns) const {
+  if (frame && frame->latency) {
+    frame->latency->send_ns.Record(now_ns - run_ns);
+    frame->latency->total_ns.Record(now_ns - frame->recv_ns);
+  }
+}
@@ -0,0 +1,72 @@
+/// @file FrameTrace.h
+/// @brief 按采样记录单帧在服务器内部各阶段的时间戳, 统计每个流的分阶段延迟
+///        recv (BufferReader::Read) -> parse (RtmpChunk::Parse 完成) -> dispatch (RtmpSession::SendMediaData)
+///        -> queue (订阅者线程执行触发事件) -> send (BufferWriter::Send 被内核全部接收)
+///        关闭采样时每帧只多一次原子变量读取
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_FRAME_TRACE_H
+#define RTMP_SERVER_FRAME_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "LatencyHistogram.h"
+
+// 一个流的分阶段延迟直方图, 单位纳秒
+struct StreamLatency {
+  LatencyHistogram parse_ns;     // recv -> 消息解析完成
+  LatencyHistogram dispatch_ns;  // 解析完成 -> 会话开始分发
+  LatencyHistogram queue_ns;     // 会话分发 -> 订阅者线程开始处理
+  LatencyHistogram send_ns;      // 订阅者线程开始处理 -> 数据全部写入内核
+  LatencyHistogram total_ns;     // recv -> 数据全部写入内核
+};
+
+// 推流端一帧的时间戳, 在分发给订阅者之前填写, 之后只读
+struct FrameTrace {
+  int64_t recv_ns = 0;
+  int64_t parsed_ns = 0;
+  int64_t dispatch_ns = 0;
+  std::shared_ptr<StreamLatency> latency;
+};
+
+// 跟随数据包进入发送队列的记录, 数据包全部写入内核后由 BufferWriter 回调, 在连接所在线程执行
+class PacketTrace {
+ public:
+  virtual ~PacketTrace() = default;
+  virtual void OnSent(int64_t now_ns) const = 0;
+};
+
+// 一帧发往一个订阅者的记录, 发送完成时记录 send 和 total 阶段
+struct EgressTrace : public PacketTrace {
+  std::shared_ptr<const FrameTrace> frame;
+  int64_t run_ns = 0;
+
+  void OnSent(int64_t now_ns) const override;
+};
+
+class FrameTracer {
+ public:
+  // 每 n 帧采样一帧, 0 表示关闭
+  static void SetSampleInterval(uint32_t n) {
+    sample_interval_.store(n, std::memory_order_relaxed);
+  }
+
+  static uint32_t GetSampleInterval() { return sample_interval_.load(std::memory_order_relaxed); }
+
+  static bool Enabled() { return GetSampleInterval() != 0; }
+
+  // 按推流连接自己的帧计数决定是否采样
+  static bool ShouldSample(uint32_t &frame_counter) {
+    uint32_t n = GetSampleInterval();
+    return n != 0 && (frame_counter++ % n) == 0;
+  }
+
+ private:
+  static std::atomic<uint32_t> sample_interval_;
+};
+
+#endif  // RTMP_SERVER_FRAME_TRACE_H
@@ -0,0 +1,102 @@
+/// @file LatencyHistogram.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "LatencyHistogram.h"
+
+#include <cmath>
+
+const int LatencyHistogram::kBucketCount;
+
+LatencyHistogram::LatencyHistogram() {
+  for (auto &bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+int LatencyHistogram::BucketIndex(uint64_t value) {
+  const uint64_t kSubBuckets = 1ULL << kSubBucketBits;
+  if (value < kSubBuckets) {  // 第 0 组精确记录
+    return (int)value;
+  }
+
+  if (value >= (1ULL << kMaxBits)) {
+    value = (1ULL << kMaxBits) - 1;
+  }
+
+  int msb = 63 - __builtin_clzll(value);
+  int group = msb - kSubBucketBits + 1;
+  int sub = (int)((value >> (msb - kSubBucketBits)) - kSubBuckets);
+  return (group << kSubBucketBits) + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(int index) {
+  const int kSubBuckets = 1 << kSubBucketBits;
+  if (index < kSubBuckets) {
+    return (uint64_t)index;
+  }
+
+  int group = index >> kSubBucketBits;
+  int sub = index & (kSubBuckets - 1);
+  int shift = group - 1;  // msb - kSubBucketBits
+  uint64_t lower = (uint64_t)(kSubBuckets + sub) << shift;
+  return lower + (1ULL << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+  buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+
+  uint64_t max = max_.load(std::memory_order_relaxed);
+  while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::RecordSingleWriter(uint64_t value) {
+  std::atomic<uint64_t> &bucket = buckets_[BucketIndex(value)];
+  bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  if (value > max_.load(std::memory_order_relaxed)) {
+    max_.store(value, std::memory_order_relaxed);
+  }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::GetSnapshot() const {
+  Snapshot snapshot;
+  snapshot.buckets.resize(kBucketCount);
+  // 各字段分别读取, 与并发的 Record 之间不是严格一致的快照, 用于统计足够
+  uint64_t count = 0;
+  for (int i = 0; i < kBucketCount; i++) {
+    snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    count += snapshot.buckets[i];
+  }
+  snapshot.count = count;
+  snapshot.sum = sum_.load(std::memory_order_relaxed);
+  snapshot.max = max_.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+uint64_t LatencyHistogram::Snapshot::Percentile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+
+  uint64_t target = (uint64_t)std::ceil(q * count);
+  if (target == 0) {
+    target = 1;
+  }
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    seen += buckets[i];
+    if (seen >= target) {
+      uint64_t upper = BucketUpperBound((int)i);
+      return upper < max ? upper : max;
+    }
+  }
+  return max;
+}
@@ -0,0 +1,59 @@
+/// @file LatencyHistogram.h
+/// @brief HDR 风格的无锁直方图: 按 2 的幂分组, 每组再线性分 16 个子桶, 相对误差不超过 1/16.
+///        记录只是对一个原子计数加一, 任意线程都可以同时读取快照并计算分位数.
+///        只有一个线程写入时用 RecordSingleWriter, 不需要带锁前缀的读改写指令
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_LATENCY_HISTOGRAM_H
+#define RTMP_SERVER_LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+class LatencyHistogram {
+ public:
+  static const int kSubBucketBits = 4;  // 每组 16 个子桶
+  static const int kMaxBits = 40;       // 可记录的最大值 2^40-1, 以纳秒计约 18 分钟, 超出的值截断
+  static const int kBucketCount = (kMaxBits - kSubBucketBits + 1) << kSubBucketBits;
+
+  struct Snapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets;
+
+    // q 取值 [0, 1], 返回该分位所在桶的上界
+    uint64_t Percentile(double q) const;
+
+    double Mean() const { return count ? (double)sum / count : 0.0; }
+  };
+
+  LatencyHistogram();
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+  void Record(uint64_t value);
+
+  // 只能由唯一的写线程调用, 用 relaxed 的读和写代替 fetch_add, 不能和 Record 混用
+  void RecordSingleWriter(uint64_t value);
+
+  Snapshot GetSnapshot() const;
+
+  uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+
+  static int BucketIndex(uint64_t value);
+
+  // 桶中能表示的最大值
+  static uint64_t BucketUpperBound(int index);
+
+ private:
+  std::atomic<uint64_t> buckets_[kBucketCount];
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+#endif  // RTMP_SERVER_LATENCY_HISTOGRAM_H
@@ -6,68 +6,283 @@
 
 #include "Logger.h"
 
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cstdarg>
+#include <cstdio>
+#include <ctime>
 #include <iostream>
 
-#include "Timestamp.h"
-
 const char* Priority_To_String[]{"DEBUG", "STATE", "INFO", "WARNING", "ERROR"};
 
-Logger::Logger() {}
+namespace {
+
+// 按秒缓存的时间戳 "[年-月-日 时:分:秒]", 每个线程一份, 不需要同步
+struct CachedTime {
+  time_t second = 0;
+  char text[32] = {0};
+  int size = 0;
+
+  void Update() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    if (ts.tv_sec == second && size > 0) {
+      return;
+    }
+
+    second = ts.tv_sec;
+    struct tm tm_time;
+    localtime_r(&second, &tm_time);
+    size = (int)strftime(text, sizeof(text), "[%F %T]", &tm_time);
+  }
+};
+
+thread_local CachedTime t_cached_time;
+
+}  // namespace
+
+Logger::Logger() { thread_ = std::thread(&Logger::Run, this); }
 
 Logger& Logger::Instance() {
   static Logger s_logger;  // C++11之后, 局部静态变量线程安全
   return s_logger;
 }
 
-Logger::~Logger() {}
+Logger::~Logger() {
+  quit_ = true;
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    wait_cond_.notify_one();
+  }
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  Exit();
+}
+
+Logger::RingOwner::~RingOwner() {
+  if (ring) {
+    ring->closed = true;
+  }
+}
 
 void Logger::Init(char* pathname) {
-  std::unique_lock<std::mutex> lock(mutex_);
+  std::lock_guard<std::mutex> lock(write_mutex_);
 
   if (pathname != nullptr) {
-    ofs_.open(pathname, std::ios::out | std::ios::binary);
-    if (ofs_.fail()) {
+    fd_ = open(pathname, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
       std::cerr << "Failed to open logfile." << std::endl;
     }
   }
 }
 
 void Logger::Exit() {
-  std::unique_lock<std::mutex> lock(mutex_);
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  Drain();
 
-  if (ofs_.is_open()) {
-    ofs_.close();
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
   }
 }
 
+void Logger::Flush() {
+  std::lock_guard<std::mutex> lock(write_mutex_);
+  Drain();
+}
+
+Logger::LogRing* Logger::GetThreadRing() {
+  thread_local RingOwner t_owner;
+  if (!t_owner.ring) {
+    t_owner.ring = std::make_shared<LogRing>();
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    rings_.push_back(t_owner.ring);
+  }
+  return t_owner.ring.get();
+}
+
 void Logger::Log(Priority priority, const char* __file, const char* __func, int __line,
                  const char* fmt, ...) {
-  char buf[2048] = {0};
-  sprintf(buf, "[%s][%s:%s:%d] ", Priority_To_String[priority], __file, __func, __line);
+  char prefix[512];
+  int prefix_size = snprintf(prefix, sizeof(prefix), "[%s][%s:%s:%d] ",
+                             Priority_To_String[priority], __file, __func, __line);
   va_list args;
   va_start(args, fmt);
-  vsprintf(buf + strlen(buf), fmt, args);
+  this->Write(priority, prefix, prefix_size, fmt, args);
   va_end(args);
-  this->Write(std::string(buf));
 }
 
 void Logger::Log2(Priority priority, const char* fmt, ...) {
-  char buf[4096] = {0};
-  sprintf(buf, "[%s] ", Priority_To_String[priority]);
+  char prefix[32];
+  int prefix_size = snprintf(prefix, sizeof(prefix), "[%s] ", Priority_To_String[priority]);
   va_list args;
   va_start(args, fmt);
-  vsprintf(buf + strlen(buf), fmt, args);
+  this->Write(priority, prefix, prefix_size, fmt, args);
   va_end(args);
-  this->Write(std::string(buf));
 }
 
-void Logger::Write(std::string&& info) {
-  std::unique_lock<std::mutex> lock(mutex_);
+void Logger::Write(Priority priority, const char* prefix, int prefix_size, const char* fmt,
+                   va_list args) {
+  LogRing* ring = GetThreadRing();
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  if (head - ring->tail.load(std::memory_order_acquire) >= kSlotCount) {
+    // 日志环满时丢弃, 不能让日志阻塞 I/O 线程
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  LogRing::Slot& slot = ring->slots[head & (kSlotCount - 1)];
+  char* buf = slot.data;
+  const uint32_t capacity = kSlotSize - 1;  // 留一个字节给换行符
+  uint32_t size = 0;
+
+  t_cached_time.Update();
+  memcpy(buf, t_cached_time.text, t_cached_time.size);
+  size += t_cached_time.size;
+
+  uint32_t n = std::min((uint32_t)prefix_size, capacity - size);
+  memcpy(buf + size, prefix, n);
+  size += n;
+
+  int ret = vsnprintf(buf + size, capacity - size + 1, fmt, args);
+  if (ret > 0) {
+    size += std::min((uint32_t)ret, capacity - size);
+  }
+
+  // 统一以一个换行结尾
+  while (size > 0 && buf[size - 1] == '\n') {
+    size--;
+  }
+  buf[size++] = '\n';
+  slot.size = size;
+
+  ring->head.store(head + 1, std::memory_order_release);
+  Commit(ring);
+}
+
+void Logger::Commit(LogRing* ring) {
+  // 与 Run 中 "设置 waiting_ 后再检查日志环" 配对, 保证不会丢失唤醒
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    wait_cond_.notify_one();
+  }
+}
+
+void Logger::Run() {
+  while (true) {
+    bool written;
+    {
+      std::lock_guard<std::mutex> lock(write_mutex_);
+      written = Drain();
+    }
 
-  if (ofs_.is_open()) {
-    ofs_ << "[" << Timestamp::Localtime() << "]" << info << std::endl;
+    if (written) {
+      continue;
+    }
+
+    if (quit_) {
+      break;
+    }
+
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    waiting_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto has_logs = [this] {
+      std::lock_guard<std::mutex> rings_lock(rings_mutex_);
+      for (auto& ring : rings_) {
+        if (ring->head.load(std::memory_order_acquire) !=
+            ring->tail.load(std::memory_order_relaxed)) {
+          return true;
+        }
+      }
+      return false;
+    };
+    // 超时只是兜底, 正常情况下由写日志的线程唤醒
+    wait_cond_.wait_for(lock, std::chrono::milliseconds(100),
+                        [this, &has_logs] { return quit_ || has_logs(); });
+    waiting_.store(false, std::memory_order_relaxed);
+  }
+}
+
+bool Logger::Drain() {
+  std::vector<std::shared_ptr<LogRing>> rings;
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    // 回收已经退出且取空的线程的日志环
+    for (auto iter = rings_.begin(); iter != rings_.end();) {
+      LogRing* ring = iter->get();
+      if (ring->closed && ring->head.load(std::memory_order_acquire) ==
+                              ring->tail.load(std::memory_order_relaxed)) {
+        iter = rings_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+    rings = rings_;
   }
 
-  std::cout << "[" << Timestamp::Localtime() << "]" << info << std::endl;
+  bool written = false;
+  struct iovec iov[IOV_MAX < 1024 ? IOV_MAX : 1024];
+  const int max_iov = (int)(sizeof(iov) / sizeof(iov[0]));
+
+  for (auto& ring : rings) {
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    while (tail != head) {
+      int iovcnt = 0;
+      uint64_t end = tail;
+      for (; end != head && iovcnt < max_iov; end++, iovcnt++) {
+        LogRing::Slot& slot = ring->slots[end & (kSlotCount - 1)];
+        iov[iovcnt].iov_base = slot.data;
+        iov[iovcnt].iov_len = slot.size;
+      }
+
+      if (fd_ >= 0) {
+        WriteAll(fd_, iov, iovcnt);
+      }
+      WriteAll(STDOUT_FILENO, iov, iovcnt);
+
+      tail = end;
+      ring->tail.store(tail, std::memory_order_release);
+      written = true;
+    }
+  }
+
+  return written;
+}
+
+void Logger::WriteAll(int fd, struct iovec* iov, int iovcnt) {
+  // writev 会修改 iov, 拷贝一份以便同一批数据写到多个 fd
+  struct iovec vec[1024];
+  memcpy(vec, iov, sizeof(struct iovec) * iovcnt);
+  struct iovec* cur = vec;
+
+  while (iovcnt > 0) {
+    ssize_t ret = writev(fd, cur, iovcnt);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+
+    // 处理部分写入
+    while (iovcnt > 0 && (size_t)ret >= cur->iov_len) {
+      ret -= cur->iov_len;
+      cur++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      cur->iov_base = (char*)cur->iov_base + ret;
+      cur->iov_len -= ret;
+    }
+  }
 }
@@ -1,20 +1,26 @@
 /// @file Logger.h
-/// @brief 单例日志类, 懒汉模式
+/// @brief 单例异步日志类
+///        1. 每个线程一个无锁 SPSC 日志环, 写日志只格式化到本线程的环里, 不加锁, 不做 I/O
+///        2. 后台写线程批量取出各线程的日志, 用 writev 一次写到标准输出和日志文件
+///        3. 时间戳字符串按秒缓存, 同一秒内不重复格式化
+///        4. 低于 RTMP_LOG_LEVEL 的日志宏在编译期被完全去掉
 /// @version 0.1
 /// @author lq
 /// @date 2023/04/27
-/// @todo 双缓冲区, 阻塞队列, 异步定时写入文件, core dump 做 tag 方便定位
 
 #ifndef RTMP_SERVER_LOGGER_H
 #define RTMP_SERVER_LOGGER_H
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
 #include <cstring>
-#include <fstream>
-#include <iostream>
+#include <memory>
 #include <mutex>
-#include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
 
 enum Priority {
   LOG_DEBUG,
@@ -24,6 +30,15 @@ enum Priority {
   LOG_ERROR,
 };
 
+// 编译期日志级别阈值, 数值与 Priority 对应, 可以用 -DRTMP_LOG_LEVEL=N 覆盖
+#ifndef RTMP_LOG_LEVEL
+#ifdef _DEBUG
+#define RTMP_LOG_LEVEL 0
+#else
+#define RTMP_LOG_LEVEL 2
+#endif
+#endif
+
 class Logger {
  public:
   Logger &operator=(const Logger &) = delete;
@@ -38,22 +53,84 @@ class Logger {
            ...);
   void Log2(Priority priority, const char *fmt, ...);
 
+  // 阻塞直到调用前写入的日志都已写出
+  void Flush();
+
+  // 日志环满而被丢弃的日志条数
+  uint64_t GetDroppedLogs() const { return dropped_.load(std::memory_order_relaxed); }
+
  private:
-  void Write(std::string &&buf);
+  static const uint32_t kSlotSize = 1024;  // 单条日志最大长度, 超出截断
+  static const uint32_t kSlotCount = 256;  // 每个线程的日志环容量, 2 的幂
+
+  // 单生产者 (所属线程) 单消费者 (持有 write_mutex_ 的线程) 的日志环
+  struct LogRing {
+    struct Slot {
+      uint32_t size = 0;
+      char data[kSlotSize];
+    };
+
+    Slot slots[kSlotCount];
+    std::atomic<uint64_t> head{0};  // 生产者写位置
+    std::atomic<uint64_t> tail{0};  // 消费者读位置
+    std::atomic_bool closed{false};  // 所属线程已退出, 取完剩余日志后回收
+  };
+
+  // 线程退出时标记日志环关闭
+  struct RingOwner {
+    std::shared_ptr<LogRing> ring;
+    ~RingOwner();
+  };
+
   Logger();
 
-  std::mutex mutex_;
-  std::ofstream ofs_;
+  LogRing *GetThreadRing();
+  void Write(Priority priority, const char *prefix, int prefix_size, const char *fmt, va_list args);
+  void Commit(LogRing *ring);
+
+  void Run();
+  bool Drain();  // 写出所有日志环中的日志, 需持有 write_mutex_, 有写出内容返回 true
+  void WriteAll(int fd, struct iovec *iov, int iovcnt);
+
+  std::mutex rings_mutex_;  // 只在线程首次写日志时注册日志环
+  std::vector<std::shared_ptr<LogRing>> rings_;
+
+  std::mutex write_mutex_;  // 串行化日志环的消费者和文件 fd
+  int fd_ = -1;
+
+  std::atomic<uint64_t> dropped_{0};
+
+  std::mutex wait_mutex_;
+  std::condition_variable wait_cond_;
+  std::atomic_bool waiting_{false};
+  std::atomic_bool quit_{false};
+  std::thread thread_;
 };
 
-#ifdef _DEBUG
+#if RTMP_LOG_LEVEL <= 0
 #define LOG_DEBUG(fmt, ...) \
   Logger::Instance().Log(LOG_DEBUG, __FILE__, __FUNCTION__, __LINE__, fmt, ##__VA_ARGS__)
 #else
-#define LOG_DEBUG(fmt, ...)
+#define LOG_DEBUG(fmt, ...) \
+  do {                      \
+  } while (0)
 #endif
+
+#if RTMP_LOG_LEVEL <= 2
 #define LOG_INFO(fmt, ...) Logger::Instance().Log2(LOG_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...) \
+  do {                     \
+  } while (0)
+#endif
+
+#if RTMP_LOG_LEVEL <= 4
 #define LOG_ERROR(fmt, ...) \
   Logger::Instance().Log(LOG_ERROR, __FILE__, __FUNCTION__, __LINE__, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...) \
+  do {                      \
+  } while (0)
+#endif
 
 #endif  // RTMP_SERVER_LOGGER_H
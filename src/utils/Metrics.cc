@@ -0,0 +1,68 @@
+/// @file Metrics.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "Metrics.h"
+
+#include <ctime>
+
+uint32_t MetricCounter::ThreadSlot() {
+  static std::atomic<uint32_t> next_slot{0};
+  thread_local uint32_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % kSlots;
+  return slot;
+}
+
+GlobalMetrics &GlobalMetrics::Instance() {
+  static GlobalMetrics s_metrics;
+  return s_metrics;
+}
+
+void StreamStats::OnFrame(bool is_video, bool is_key_frame, uint32_t size) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  if (ts.tv_sec != window_second_) {
+    // 只有相邻的一秒才是完整窗口, 中间断流则码率和帧率归零
+    bool adjacent = (ts.tv_sec == window_second_ + 1);
+    bitrate_bps.store(adjacent ? window_bytes_ * 8 : 0, std::memory_order_relaxed);
+    fps.store(adjacent ? window_video_frames_ : 0, std::memory_order_relaxed);
+    rate_second_.store(ts.tv_sec, std::memory_order_relaxed);
+    window_second_ = ts.tv_sec;
+    window_bytes_ = 0;
+    window_video_frames_ = 0;
+  }
+
+  window_bytes_ += size;
+  bytes_in.store(bytes_in.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+
+  if (is_video) {
+    window_video_frames_ += 1;
+    video_frames.store(video_frames.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+    if (is_key_frame) {
+      if (current_gop_frames_ > 0) {
+        gop_frames.store(current_gop_frames_, std::memory_order_relaxed);
+      }
+      current_gop_frames_ = 0;
+    }
+    current_gop_frames_ += 1;
+  } else {
+    audio_frames.store(audio_frames.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+  }
+}
+
+bool StreamStats::IsRateStale() const {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return ts.tv_sec > rate_second_.load(std::memory_order_relaxed) + 1;
+}
+
+uint64_t StreamStats::GetBitrate() const {
+  return IsRateStale() ? 0 : bitrate_bps.load(std::memory_order_relaxed);
+}
+
+uint32_t StreamStats::GetFps() const {
+  return IsRateStale() ? 0 : fps.load(std::memory_order_relaxed);
+}
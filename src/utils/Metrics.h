@@ -0,0 +1,93 @@
+/// @file Metrics.h
+/// @brief 运行时统计计数器
+///        1. MetricCounter: 多线程累加的计数器, 每个线程落在独立 cache line 的槽位上, 读取时汇总
+///        2. ConnectionStats: 单个连接的统计, 只由连接所在线程更新, 任意线程无锁读取
+///        3. StreamStats: 单个流的统计, 码率和帧率按秒滚动计算
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_METRICS_H
+#define RTMP_SERVER_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+
+class MetricCounter {
+ public:
+  MetricCounter() = default;
+  MetricCounter(const MetricCounter &) = delete;
+  MetricCounter &operator=(const MetricCounter &) = delete;
+
+  void Add(uint64_t n = 1) { cells_[ThreadSlot()].value.fetch_add(n, std::memory_order_relaxed); }
+
+  uint64_t Value() const {
+    uint64_t sum = 0;
+    for (const auto &cell : cells_) {
+      sum += cell.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+ private:
+  static const uint32_t kSlots = 16;
+  static const uint32_t kCacheLineSize = 64;
+
+  // 每个槽位占满一个 cache line, 不同线程的累加互不干扰
+  struct Cell {
+    std::atomic<uint64_t> value{0};
+    char padding[kCacheLineSize - sizeof(std::atomic<uint64_t>)];
+  };
+
+  // 线程第一次使用时分配一个槽位, 线程数超过 kSlots 时多个线程共享槽位, 依然正确
+  static uint32_t ThreadSlot();
+
+  Cell cells_[kSlots];
+};
+
+// 进程级别的全局计数器
+struct GlobalMetrics {
+  MetricCounter connections_accepted;
+  MetricCounter connections_closed;
+  MetricCounter bytes_in;
+  MetricCounter bytes_out;
+  MetricCounter handshakes;
+
+  static GlobalMetrics &Instance();
+};
+
+struct ConnectionStats {
+  std::atomic<uint64_t> bytes_in{0};
+  std::atomic<uint64_t> bytes_out{0};
+  std::atomic<uint64_t> queued_bytes{0};     // 发送队列中还未写出的字节数
+  std::atomic<uint64_t> dropped_packets{0};  // 发送队列满而丢弃的数据包
+  std::atomic<uint64_t> dropped_frames{0};   // 应用层丢弃的媒体帧, 如等待关键帧时跳过的帧
+};
+
+struct StreamStats {
+  std::atomic<uint64_t> bytes_in{0};
+  std::atomic<uint64_t> video_frames{0};
+  std::atomic<uint64_t> audio_frames{0};
+  std::atomic<uint64_t> bitrate_bps{0};   // 上一秒的输入码率, 读取用 GetBitrate
+  std::atomic<uint32_t> fps{0};           // 上一秒的视频帧率, 读取用 GetFps
+  std::atomic<uint32_t> gop_frames{0};    // 上一个完整 GOP 的视频帧数
+  std::atomic<uint32_t> subscribers{0};
+
+  // 由推流线程调用 (RtmpSession 持锁), 每秒滚动一次窗口
+  void OnFrame(bool is_video, bool is_key_frame, uint32_t size);
+
+  // 窗口只在收到帧时滚动, 断流之后 bitrate_bps 和 fps 停在最后的值, 读取时超过一秒没有滚动则返回 0
+  uint64_t GetBitrate() const;
+  uint32_t GetFps() const;
+
+ private:
+  bool IsRateStale() const;
+
+  std::atomic<int64_t> rate_second_{0};  // 上一次滚动窗口的秒数
+  int64_t window_second_ = 0;
+  uint64_t window_bytes_ = 0;
+  uint32_t window_video_frames_ = 0;
+  uint32_t current_gop_frames_ = 0;
+};
+
+#endif  // RTMP_SERVER_METRICS_H
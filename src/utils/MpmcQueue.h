@@ -0,0 +1,118 @@
+/// @file MpmcQueue.h
+/// @brief 有界无锁多生产者多消费者队列 (Dmitry Vyukov 算法)
+///        每个槽位带一个序号, 生产者和消费者各自 CAS 推进自己的位置, 满了 Push 直接失败, 不阻塞
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_MPMC_QUEUE_H
+#define RTMP_SERVER_MPMC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+template <typename T>
+class MpmcQueue {
+ public:
+  // 容量向上取整到 2 的幂
+  explicit MpmcQueue(size_t capacity) {
+    capacity_ = 2;
+    while (capacity_ < capacity) {
+      capacity_ <<= 1;
+    }
+    mask_ = capacity_ - 1;
+    cells_.reset(new Cell[capacity_]);
+    for (size_t i = 0; i < capacity_; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpmcQueue(const MpmcQueue &) = delete;
+  MpmcQueue &operator=(const MpmcQueue &) = delete;
+
+  bool Push(const T &data) { return Emplace(data); }
+
+  bool Push(T &&data) { return Emplace(std::move(data)); }
+
+  bool Pop(T &data) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {  // 队列空
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    data = std::move(cell->data);
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 近似值, 仅用于统计
+  size_t Size() const {
+    size_t enqueue = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t dequeue = dequeue_pos_.load(std::memory_order_relaxed);
+    return enqueue > dequeue ? enqueue - dequeue : 0;
+  }
+
+  bool IsEmpty() const { return Size() == 0; }
+
+  size_t Capacity() const { return capacity_; }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  template <typename F>
+  bool Emplace(F &&data) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {  // 队列满
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->data = std::forward<F>(data);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  static const size_t kCacheLineSize = 64;
+
+  size_t capacity_ = 0;
+  size_t mask_ = 0;
+  std::unique_ptr<Cell[]> cells_;
+
+  // 生产者和消费者的位置放在不同的 cache line, 避免伪共享
+  char pad0_[kCacheLineSize];
+  std::atomic<size_t> enqueue_pos_{0};
+  char pad1_[kCacheLineSize];
+  std::atomic<size_t> dequeue_pos_{0};
+  char pad2_[kCacheLineSize];
+};
+
+#endif  // RTMP_SERVER_MPMC_QUEUE_H
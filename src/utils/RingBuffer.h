@@ -19,9 +19,9 @@ class RingBuffer {
 
   virtual ~RingBuffer() {}
 
-  bool Push(const T& data) { return pushData(std::forward<T>(data)); }
+  bool Push(const T& data) { return PushData(data); }
 
-  bool Push(T&& data) { return PushData(data); }
+  bool Push(T&& data) { return PushData(std::move(data)); }
 
   bool Pop(T& data) {
     if (num_datas_ > 0) {
@@ -26,6 +26,20 @@ class Timestamp {
         .count();
   }
 
+  // 单调时钟的纳秒数, 只用于计算时间间隔
+  static int64_t NowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // 系统时钟的微秒数, 可以在不同进程间比较, 时钟同步时也可以跨主机比较
+  static int64_t NowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+
   // 返回当前系统时间的字符串表示, 格式为 年-月-日 时:分:秒
   static std::string Localtime();
 
@@ -0,0 +1,230 @@
+/// @file TsMuxer.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "TsMuxer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const uint8_t kVideoStreamId = 0xe0;
+const uint8_t kAudioStreamId = 0xc0;
+const uint8_t kStreamTypeH264 = 0x1b;
+const uint8_t kStreamTypeAac = 0x0f;
+
+// PTS/DTS 的 5 字节编码, prefix: 0x2 只有 PTS, 0x3 PTS 后跟 DTS, 0x1 DTS
+void WriteTimestamp(uint8_t *p, uint8_t prefix, uint64_t ts) {
+  p[0] = (uint8_t)((prefix << 4) | ((ts >> 29) & 0x0e) | 0x01);
+  p[1] = (uint8_t)(ts >> 22);
+  p[2] = (uint8_t)(((ts >> 14) & 0xfe) | 0x01);
+  p[3] = (uint8_t)(ts >> 7);
+  p[4] = (uint8_t)(((ts << 1) & 0xfe) | 0x01);
+}
+
+// 33 位 PCR base, 扩展部分为 0
+void WritePcr(uint8_t *p, uint64_t base) {
+  p[0] = (uint8_t)(base >> 25);
+  p[1] = (uint8_t)(base >> 17);
+  p[2] = (uint8_t)(base >> 9);
+  p[3] = (uint8_t)(base >> 1);
+  p[4] = (uint8_t)(((base & 0x01) << 7) | 0x7e);
+  p[5] = 0;
+}
+
+struct CrcTable {
+  uint32_t value[256];
+
+  CrcTable() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i << 24;
+      for (int j = 0; j < 8; j++) {
+        crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+      }
+      value[i] = crc;
+    }
+  }
+};
+
+}  // namespace
+
+uint32_t TsMuxer::Crc32(const uint8_t *data, size_t size) {
+  static const CrcTable table;
+
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < size; i++) {
+    crc = (crc << 8) ^ table.value[((crc >> 24) ^ data[i]) & 0xff];
+  }
+  return crc;
+}
+
+void TsMuxer::Reset() {
+  pat_cc_ = 0;
+  pmt_cc_ = 0;
+  video_cc_ = 0;
+  audio_cc_ = 0;
+}
+
+void TsMuxer::WritePsi(std::string &out, uint16_t pid, const uint8_t *section, size_t size) {
+  size_t pos = out.size();
+  out.resize(pos + kPacketSize, (char)0xff);
+  uint8_t *p = (uint8_t *)&out[pos];
+  uint8_t &cc = (pid == 0) ? pat_cc_ : pmt_cc_;
+
+  p[0] = 0x47;
+  p[1] = (uint8_t)(0x40 | (pid >> 8));  // payload_unit_start_indicator
+  p[2] = (uint8_t)pid;
+  p[3] = (uint8_t)(0x10 | (cc & 0x0f));
+  p[4] = 0;  // pointer_field
+  memcpy(p + 5, section, size);
+  cc++;
+}
+
+void TsMuxer::WritePatPmt(std::string &out) {
+  uint8_t pat[16] = {0x00, 0xb0, 0x0d,  // table_id, section_length = 13
+                     0x00, 0x01,        // transport_stream_id
+                     0xc1, 0x00, 0x00,  // version, current_next, section_number
+                     0x00, 0x01,        // program_number
+                     (uint8_t)(0xe0 | (kPmtPid >> 8)), (uint8_t)kPmtPid};
+  uint32_t crc = Crc32(pat, 12);
+  pat[12] = (uint8_t)(crc >> 24);
+  pat[13] = (uint8_t)(crc >> 16);
+  pat[14] = (uint8_t)(crc >> 8);
+  pat[15] = (uint8_t)crc;
+  WritePsi(out, 0, pat, 16);
+
+  uint16_t pcr_pid = has_video_ ? kVideoPid : kAudioPid;
+  uint8_t pmt[32] = {0x02, 0xb0, 0x00,  // table_id, section_length 后面填
+                     0x00, 0x01,        // program_number
+                     0xc1, 0x00, 0x00,  // version, current_next, section_number
+                     (uint8_t)(0xe0 | (pcr_pid >> 8)), (uint8_t)pcr_pid,
+                     0xf0, 0x00};  // program_info_length
+  size_t size = 12;
+  if (has_video_) {
+    pmt[size++] = kStreamTypeH264;
+    pmt[size++] = (uint8_t)(0xe0 | (kVideoPid >> 8));
+    pmt[size++] = (uint8_t)kVideoPid;
+    pmt[size++] = 0xf0;
+    pmt[size++] = 0x00;
+  }
+  if (has_audio_) {
+    pmt[size++] = kStreamTypeAac;
+    pmt[size++] = (uint8_t)(0xe0 | (kAudioPid >> 8));
+    pmt[size++] = (uint8_t)kAudioPid;
+    pmt[size++] = 0xf0;
+    pmt[size++] = 0x00;
+  }
+  pmt[2] = (uint8_t)(size + 4 - 3);  // section_length 从其后开始计算, 包含 CRC
+  crc = Crc32(pmt, size);
+  pmt[size++] = (uint8_t)(crc >> 24);
+  pmt[size++] = (uint8_t)(crc >> 16);
+  pmt[size++] = (uint8_t)(crc >> 8);
+  pmt[size++] = (uint8_t)crc;
+  WritePsi(out, kPmtPid, pmt, size);
+}
+
+void TsMuxer::WriteVideo(std::string &out, const uint8_t *data, size_t size, uint64_t pts,
+                         uint64_t dts, bool key_frame) {
+  WritePes(out, kVideoPid, kVideoStreamId, data, size, pts, dts, pts != dts, true, key_frame);
+}
+
+void TsMuxer::WriteAudio(std::string &out, const uint8_t *data, size_t size, uint64_t pts) {
+  WritePes(out, kAudioPid, kAudioStreamId, data, size, pts, pts, false, !has_video_, false);
+}
+
+void TsMuxer::WritePes(std::string &out, uint16_t pid, uint8_t stream_id, const uint8_t *data,
+                       size_t size, uint64_t pts, uint64_t dts, bool has_dts, bool pcr,
+                       bool random_access) {
+  uint8_t header[19] = {0x00, 0x00, 0x01, stream_id};
+  uint8_t header_data_size = has_dts ? 10 : 5;
+  size_t header_size = 9 + header_data_size;
+  size_t pes_size = 3 + header_data_size + size;
+  if (stream_id == kVideoStreamId || pes_size > 0xffff) {
+    pes_size = 0;  // 视频的 PES 长度可以不指定
+  }
+  header[4] = (uint8_t)(pes_size >> 8);
+  header[5] = (uint8_t)pes_size;
+  header[6] = 0x80;
+  header[7] = has_dts ? 0xc0 : 0x80;
+  header[8] = header_data_size;
+  WriteTimestamp(header + 9, has_dts ? 0x3 : 0x2, pts);
+  if (has_dts) {
+    WriteTimestamp(header + 14, 0x1, dts);
+  }
+
+  uint8_t &cc = (pid == kVideoPid) ? video_cc_ : audio_cc_;
+  size_t remaining = header_size + size;
+  size_t header_pos = 0;
+  size_t data_pos = 0;
+  bool first = true;
+
+  // 预先扩容, 每个包最多 184 字节负载
+  out.reserve(out.size() + (remaining / 184 + 1) * kPacketSize);
+
+  while (remaining > 0) {
+    size_t pos = out.size();
+    out.resize(pos + kPacketSize);
+    uint8_t *p = (uint8_t *)&out[pos];
+
+    bool has_adaptation = false;
+    size_t adaptation_size = 0;  // adaptation_field_length 的值, 不含长度字节本身
+    uint8_t flags = 0;
+    if (first && (pcr || random_access)) {
+      has_adaptation = true;
+      adaptation_size = 1 + (pcr ? 6 : 0);
+      flags = (uint8_t)((pcr ? 0x10 : 0) | (random_access ? 0x40 : 0));
+    }
+
+    // 最后一个包的负载不足时, 用自适应字段填充
+    size_t payload_space = 184 - (has_adaptation ? 1 + adaptation_size : 0);
+    if (remaining < payload_space) {
+      size_t stuffing = payload_space - remaining;
+      if (!has_adaptation) {
+        has_adaptation = true;
+        adaptation_size = stuffing - 1;
+      } else {
+        adaptation_size += stuffing;
+      }
+      payload_space = remaining;
+    }
+
+    p[0] = 0x47;
+    p[1] = (uint8_t)((first ? 0x40 : 0x00) | (pid >> 8));
+    p[2] = (uint8_t)pid;
+    p[3] = (uint8_t)((has_adaptation ? 0x30 : 0x10) | (cc & 0x0f));
+    cc++;
+
+    uint8_t *payload = p + 4;
+    if (has_adaptation) {
+      p[4] = (uint8_t)adaptation_size;
+      if (adaptation_size > 0) {
+        p[5] = flags;
+        size_t used = 1;
+        if (flags & 0x10) {
+          WritePcr(p + 6, dts);
+          used += 6;
+        }
+        memset(p + 5 + used, 0xff, adaptation_size - used);
+      }
+      payload = p + 5 + adaptation_size;
+    }
+
+    // 先写 PES 头, 再写数据
+    size_t n = 0;
+    if (header_pos < header_size) {
+      n = std::min(header_size - header_pos, payload_space);
+      memcpy(payload, header + header_pos, n);
+      header_pos += n;
+    }
+    if (n < payload_space) {
+      memcpy(payload + n, data + data_pos, payload_space - n);
+      data_pos += payload_space - n;
+    }
+
+    remaining -= payload_space;
+    first = false;
+  }
+}
@@ -0,0 +1,62 @@
+/// @file TsMuxer.h
+/// @brief MPEG-TS 封装, 只支持一路 H.264 视频 (Annex B) 和一路 AAC 音频 (ADTS),
+///        输出追加到调用者的缓冲区, 用于 HLS 分片. 时间戳单位为 90kHz
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_TS_MUXER_H
+#define RTMP_SERVER_TS_MUXER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class TsMuxer {
+ public:
+  static const uint32_t kPacketSize = 188;
+  static const uint16_t kPmtPid = 0x1000;
+  static const uint16_t kVideoPid = 0x100;
+  static const uint16_t kAudioPid = 0x101;
+
+  // 设置 PMT 中的流, 有视频时 PCR 放在视频上, 否则放在音频上
+  void SetStreams(bool has_video, bool has_audio) {
+    has_video_ = has_video;
+    has_audio_ = has_audio;
+  }
+
+  bool HasVideo() const { return has_video_; }
+  bool HasAudio() const { return has_audio_; }
+
+  // 写 PAT 和 PMT, 每个分片开头调用一次, 分片可以单独解码
+  void WritePatPmt(std::string &out);
+
+  // 一个 H.264 访问单元, key_frame 时设置随机访问标记
+  void WriteVideo(std::string &out, const uint8_t *data, size_t size, uint64_t pts, uint64_t dts,
+                  bool key_frame);
+
+  // 一个带 ADTS 头的 AAC 帧
+  void WriteAudio(std::string &out, const uint8_t *data, size_t size, uint64_t pts);
+
+  // 连续计数器清零, 换推流端时调用
+  void Reset();
+
+  // MPEG-2 CRC32, 用于 PSI 表
+  static uint32_t Crc32(const uint8_t *data, size_t size);
+
+ private:
+  void WritePsi(std::string &out, uint16_t pid, const uint8_t *section, size_t size);
+
+  // PES 头和数据切成 TS 包, pcr 和 random_access 只写在第一个包的自适应字段中
+  void WritePes(std::string &out, uint16_t pid, uint8_t stream_id, const uint8_t *data, size_t size,
+                uint64_t pts, uint64_t dts, bool has_dts, bool pcr, bool random_access);
+
+  bool has_video_ = true;
+  bool has_audio_ = true;
+  uint8_t pat_cc_ = 0;
+  uint8_t pmt_cc_ = 0;
+  uint8_t video_cc_ = 0;
+  uint8_t audio_cc_ = 0;
+};
+
+#endif  // RTMP_SERVER_TS_MUXER_H
@@ -0,0 +1,136 @@
+/// @file WorkerPool.cc
+/// @brief
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#include "WorkerPool.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+volatile sig_atomic_t g_quit = 0;
+
+void OnQuitSignal(int) { g_quit = 1; }
+
+// 不设置 SA_RESTART, 收到信号时 waitpid 和 nanosleep 返回 EINTR
+void SetQuitHandler(void (*handler)(int)) {
+  struct sigaction action = {};
+  action.sa_handler = handler;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+}
+
+pid_t Spawn(uint32_t worker_id, const WorkerPool::WorkerMain &worker_main) {
+  // 缓冲区中还没写出的输出会被子进程复制一份
+  fflush(nullptr);
+  pid_t pid = fork();
+  if (pid != 0) {
+    return pid;
+  }
+
+  SetQuitHandler(SIG_DFL);
+#ifdef __linux__
+  // master 退出时 worker 跟着退出, 不会留下继续占用端口的进程
+  // TaskScheduler 忽略了 SIGTERM, 这里和停止 worker 时一样用 SIGKILL
+  prctl(PR_SET_PDEATHSIG, SIGKILL);
+  if (getppid() == 1) {
+    _exit(0);
+  }
+#endif
+  _exit(worker_main(worker_id));
+}
+
+}  // namespace
+
+int WorkerPool::Run(uint32_t num, const WorkerMain &worker_main, const ExitCallback &exit_cb) {
+  g_quit = 0;
+  SetQuitHandler(OnQuitSignal);
+
+  std::vector<pid_t> pids(num, -1);
+  int ret = 0;
+  for (uint32_t i = 0; i < num; i++) {
+    pids[i] = Spawn(i, worker_main);
+    if (pids[i] < 0) {
+      fprintf(stderr, "[Worker] fork worker %u failed, errno: %d\n", i, errno);
+      ret = -1;
+      g_quit = 1;
+      break;
+    }
+    printf("[Worker] worker %u started, pid: %d\n", i, (int)pids[i]);
+  }
+
+  while (!g_quit) {
+    int status = 0;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    uint32_t worker_id = 0;
+    while (worker_id < num && pids[worker_id] != pid) {
+      worker_id++;
+    }
+    if (worker_id == num) {
+      continue;
+    }
+    pids[worker_id] = -1;
+    if (exit_cb) {
+      exit_cb(worker_id, pid, status);
+    }
+    if (g_quit) {
+      break;
+    }
+
+    // worker 只会异常退出, 等一会儿再拉起, 期间可以被信号打断
+    fprintf(stderr, "[Worker] worker %u (pid %d) exited, status: %d, restarting.\n", worker_id,
+            (int)pid, status);
+    struct timespec delay = {kRestartMs / 1000, (long)(kRestartMs % 1000) * 1000000};
+    nanosleep(&delay, nullptr);
+    if (g_quit) {
+      break;
+    }
+    pids[worker_id] = Spawn(worker_id, worker_main);
+    if (pids[worker_id] < 0) {
+      fprintf(stderr, "[Worker] fork worker %u failed, errno: %d\n", worker_id, errno);
+      ret = -1;
+      break;
+    }
+    printf("[Worker] worker %u restarted, pid: %d\n", worker_id, (int)pids[worker_id]);
+  }
+
+  for (pid_t pid : pids) {
+    if (pid > 0) {
+      kill(pid, SIGKILL);
+    }
+  }
+  for (uint32_t i = 0; i < num; i++) {
+    if (pids[i] <= 0) {
+      continue;
+    }
+    int status = 0;
+    while (waitpid(pids[i], &status, 0) < 0 && errno == EINTR) {
+    }
+    if (exit_cb) {
+      exit_cb(i, pids[i], status);
+    }
+  }
+
+  SetQuitHandler(SIG_DFL);
+  return ret;
+}
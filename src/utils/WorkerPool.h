@@ -0,0 +1,36 @@
+/// @file WorkerPool.h
+/// @brief master/worker 多进程模式: master 只 fork 和监控 worker, 每个 worker 独立运行自己的事件循环,
+///        监听同一个端口 (SO_REUSEPORT) 由内核分配连接. 一个 worker 崩溃只影响它上面的连接, master 重新拉起.
+///        master 中不能创建线程 (包括日志线程), fork 之后子进程只有调用 fork 的线程
+/// @version 0.1
+/// @author lq
+/// @date 2026/10/19
+
+#ifndef RTMP_SERVER_WORKER_POOL_H
+#define RTMP_SERVER_WORKER_POOL_H
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <functional>
+
+class WorkerPool {
+ public:
+  // 在 worker 进程中执行, 返回值为进程的退出码
+  using WorkerMain = std::function<int(uint32_t worker_id)>;
+  // worker 退出后在 master 中回调, 例如释放它占用的共享资源, status 同 waitpid
+  using ExitCallback = std::function<void(uint32_t worker_id, pid_t pid, int status)>;
+
+  /// @brief 启动 num 个 worker 并阻塞到收到 SIGINT 或 SIGTERM, 之后用 SIGKILL 停止所有 worker
+  ///        (TaskScheduler 忽略 SIGTERM), worker 占用的共享资源由 exit_cb 释放
+  ///
+  /// @param num worker 进程数
+  /// @param worker_main worker 的入口
+  /// @param exit_cb worker 退出后的回调, 可以为空
+  /// @return int 所有 worker 退出后返回 0, fork 失败返回 -1
+  static int Run(uint32_t num, const WorkerMain &worker_main, const ExitCallback &exit_cb = nullptr);
+
+  static const uint32_t kRestartMs = 1000;  // worker 退出之后重新拉起的间隔, 避免反复崩溃时空转
+};
+
+#endif  // RTMP_SERVER_WORKER_POOL_H